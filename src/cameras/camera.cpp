@@ -3,6 +3,71 @@
 namespace liang {
 
 Camera::Camera(const Transform world_to_camera, std::shared_ptr<Film> film) :
-    world_to_camera{world_to_camera}, film{film} {}
+    world_to_camera{world_to_camera}, camera_to_world{world_to_camera.Inverse()}, film{film},
+    shutter_open{0.f}, shutter_close{0.f} {}
+
+float Camera::GenerateRayDifferential(const Point2f &film_location,
+    RayDifferential *ray) const {
+  Ray3f main_ray, rx, ry;
+  float weight = GenerateRay(film_location, &main_ray);
+  *ray = RayDifferential(main_ray);
+  if (GenerateRay(Point2f(film_location.x + 1.f, film_location.y), &rx) == 0.f ||
+      GenerateRay(Point2f(film_location.x, film_location.y + 1.f), &ry) == 0.f) {
+    return weight;
+  }
+  ray->rx_origin = rx.origin;
+  ray->rx_direction = rx.direction;
+  ray->ry_origin = ry.origin;
+  ray->ry_direction = ry.direction;
+  ray->has_differentials = true;
+  return weight;
+}
+
+void Camera::GenerateRays(const Point2f *film_locations, uint count, Ray3f *rays,
+    float *weights) const {
+  for (uint i = 0; i < count; i++) {
+    weights[i] = GenerateRay(film_locations[i], &rays[i]);
+  }
+}
+
+bool Camera::ProjectToRaster(const Point3f & /* point */, Point2f * /* film_location */) const {
+  return false;
+}
+
+bool Camera::ProjectDirectionToRaster(const Vector3f & /* direction */,
+    Point2f * /* film_location */) const {
+  return false;
+}
+
+std::shared_ptr<Film> Camera::GetFilm() const {
+  return film;
+}
+
+const Transform &Camera::GetWorldToCamera() const {
+  return world_to_camera;
+}
+
+void Camera::SetShutter(float shutter_open, float shutter_close) {
+  assert(shutter_open <= shutter_close);
+  this->shutter_open = shutter_open;
+  this->shutter_close = shutter_close;
+}
+
+float Camera::GetShutterOpen() const {
+  return shutter_open;
+}
+
+float Camera::GetShutterClose() const {
+  return shutter_close;
+}
+
+bool Camera::HasMotionBlur() const {
+  return shutter_open < shutter_close;
+}
+
+float Camera::SampleTime(float sample) const {
+  assert(sample >= 0.f && sample <= 1.f);
+  return shutter_open * (1.f - sample) + shutter_close * sample;
+}
 
 }
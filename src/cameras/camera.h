@@ -24,11 +24,61 @@ class Camera {
     // how much we should weight the generated ray.
     virtual float GenerateRay(const Point2f &film_location, Ray3f *ray) const = 0;
 
+    // Generates a ray given a point on the film along with the rays through the points one pixel
+    // over along x and y. By default, this calls GenerateRay() for each of the three points.
+    // Returns the weight of the main ray, and leaves the differentials unset if either offset ray
+    // has a weight of 0.
+    virtual float GenerateRayDifferential(const Point2f &film_location,
+        RayDifferential *ray) const;
+
+    // Generates a ray for each of count points on the film, along with its weight. The rays are
+    // the same as GenerateRay() would return, so implementations only override this to go faster.
+    virtual void GenerateRays(const Point2f *film_locations, uint count, Ray3f *rays,
+        float *weights) const;
+
+    // Projects a world space point onto the film, filling in the film location whose ray passes
+    // through it. Returns false if the point is outside the camera's view. By default, cameras
+    // can't project points and always return false.
+    virtual bool ProjectToRaster(const Point3f &point, Point2f *film_location) const;
+
+    // Projects a world space direction onto the film like ProjectToRaster(), filling in the film
+    // location whose ray travels along it. This is where a point infinitely far away lands.
+    virtual bool ProjectDirectionToRaster(const Vector3f &direction,
+        Point2f *film_location) const;
+
+    // Returns the film the camera is recording to.
+    std::shared_ptr<Film> GetFilm() const;
+
+    // Returns the transform from world space to camera space.
+    const Transform &GetWorldToCamera() const;
+
+    // Sets the times the shutter opens and closes at, across which camera rays are spread. Both
+    // default to 0, which captures a single instant without motion blur.
+    void SetShutter(float shutter_open, float shutter_close);
+
+    // Returns the time the shutter opens at.
+    float GetShutterOpen() const;
+
+    // Returns the time the shutter closes at.
+    float GetShutterClose() const;
+
+    // Returns whether the shutter stays open for any length of time, in which case camera rays
+    // need a sample to pick their time from.
+    bool HasMotionBlur() const;
+
+    // Returns the time of a camera ray given a uniform sample in [0, 1), which is spread evenly
+    // across the time the shutter is open.
+    float SampleTime(float sample) const;
+
   protected:
     // Transform from world space to camera space.
     Transform world_to_camera;
+    // Transform from camera space to world space, cached so rays don't build it every time.
+    Transform camera_to_world;
     // Shared pointer to the film we are recording to.
     std::shared_ptr<Film> film;
+    // The times the shutter opens and closes at.
+    float shutter_open, shutter_close;
 };
 
 }
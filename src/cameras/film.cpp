@@ -1,50 +1,763 @@
 #include "cameras/film.h"
+#include "images/pfm_writer.h"
+#include "images/png_encoder.h"
+#include "utils/half.h"
+#include "utils/parallel.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
 
 namespace liang {
 
-Film::Film(uint width, uint height, std::unique_ptr<Filter> filter) : width{width}, height{height},
-    filter{std::move(filter)}, pixels{std::unique_ptr<Pixel[]>(new Pixel[width * height])} {
-  ClearFilm();
+// Identifies checkpoint files and the version of their layout.
+static const char CHECKPOINT_MAGIC[8] = {'L', 'I', 'A', 'N', 'G', 'C', 'K', '3'};
+
+// The header at the start of every checkpoint file, followed by the array of the film's pixels in
+// whichever layout the film stores them and then by the extra channel values.
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_size;
+  uint32_t tiles_merged;
+  uint64_t fingerprint;
+  uint32_t num_channels;
+  uint32_t reserved;
+};
+
+// The most pixels along each axis a sample is splatted onto with lookups kept on the stack. Wider
+// filters put them on the heap instead.
+static const int MAX_SPLAT_WIDTH = 64;
+// The number of rows each thread converts at a time while tone mapping.
+static const uint TONE_MAP_STRIP_HEIGHT = 16;
+
+// The largest sample count a CompactPixel can hold.
+static const uint MAX_COMPACT_SAMPLE_COUNT = 65535;
+
+// Returns what the color sums of a CompactPixel with the given weight sum are divided by. Where
+// negative filter lobes cancel the weight sum to near 0, the sums themselves are stored, since
+// the ratio would overflow half precision.
+static float CompactColorScale(float weight_sum) {
+  return std::max(std::abs(weight_sum), 1.f);
+}
+
+// Expands a CompactPixel back into the sums of a Pixel.
+static Pixel ExpandPixel(const CompactPixel &compact_pixel) {
+  Pixel pixel;
+  float count = (float)compact_pixel.sample_count;
+  float color_scale = CompactColorScale(compact_pixel.weight_sum);
+  pixel.r = HalfToFloat(compact_pixel.r) * color_scale;
+  pixel.g = HalfToFloat(compact_pixel.g) * color_scale;
+  pixel.b = HalfToFloat(compact_pixel.b) * color_scale;
+  pixel.weight_sum = compact_pixel.weight_sum;
+  float luminance_mean = HalfToFloat(compact_pixel.luminance_mean);
+  pixel.luminance_sum = luminance_mean * count;
+  pixel.luminance_squared_sum = (HalfToFloat(compact_pixel.luminance_variance) +
+      luminance_mean * luminance_mean) * count;
+  pixel.sample_count = compact_pixel.sample_count;
+  return pixel;
+}
+
+// Rounds a Pixel down to a CompactPixel.
+static CompactPixel CompactPixelFrom(const Pixel &pixel) {
+  CompactPixel compact_pixel;
+  float inverse_scale = 1.f / CompactColorScale(pixel.weight_sum);
+  float inverse_count = pixel.sample_count > 0 ? 1.f / (float)pixel.sample_count : 0.f;
+  compact_pixel.r = FloatToHalf(pixel.r * inverse_scale);
+  compact_pixel.g = FloatToHalf(pixel.g * inverse_scale);
+  compact_pixel.b = FloatToHalf(pixel.b * inverse_scale);
+  float luminance_mean = pixel.luminance_sum * inverse_count;
+  float luminance_variance = std::max(pixel.luminance_squared_sum * inverse_count -
+      luminance_mean * luminance_mean, 0.f);
+  compact_pixel.luminance_mean = FloatToHalf(luminance_mean);
+  compact_pixel.weight_sum = pixel.weight_sum;
+  compact_pixel.luminance_variance = FloatToHalf(luminance_variance);
+  compact_pixel.sample_count = (uint16_t)std::min(pixel.sample_count, MAX_COMPACT_SAMPLE_COUNT);
+  return compact_pixel;
+}
+
+// The extra channels a sample is recorded in along with its color.
+struct ChannelSample {
+  // The modes of the channels.
+  const std::vector<ChannelMode> *modes;
+  // The indices of the channels that are averaged.
+  const std::vector<uint> *averaged_channels;
+  // The channel values of the pixels, one plane per channel.
+  float *values;
+  // The number of pixels in each plane.
+  size_t num_pixels;
+  // The sample's value for every channel.
+  const float *sample_values;
+};
+
+// Records a sample's luminance in the statistics of the pixel it was taken in.
+static void RecordSample(Pixel *pixel, float r, float g, float b) {
+  float luminance = Luminance(r, g, b);
+  pixel->luminance_sum += luminance;
+  pixel->luminance_squared_sum += luminance * luminance;
+  pixel->sample_count++;
+}
+
+// Records a sample in the summed and first sample channels of the pixel at the given index, which
+// the sample was taken in and which now holds sample_count samples.
+static void RecordChannels(const ChannelSample &channels, size_t index, uint sample_count) {
+  for (uint channel = 0; channel < channels.modes->size(); channel++) {
+    float &value = channels.values[channel * channels.num_pixels + index];
+    if ((*channels.modes)[channel] == ChannelMode::SUM) {
+      value += channels.sample_values[channel];
+    } else if ((*channels.modes)[channel] == ChannelMode::FIRST && sample_count == 1) {
+      value = channels.sample_values[channel];
+    }
+  }
+}
+
+// Adds a sample's filtered contribution to the averaged channels of the pixel at the given index.
+static void SplatChannels(const ChannelSample *channels, size_t index, float filter_weight) {
+  for (uint channel : *channels->averaged_channels) {
+    channels->values[channel * channels->num_pixels + index] +=
+        filter_weight * channels->sample_values[channel];
+  }
+}
+
+// Adds a sample's filtered contribution to every pixel within the filter's radius that lies in the
+// given bounds. The pixels are stored in row-major order over the bounds. If channels is not
+// nullptr, the sample is also splatted into its averaged channels.
+static void SplatSample(const FilterTable &filter_table, Pixel *pixels, const Point2i &pixel_min,
+    const Point2i &pixel_max, float x, float y, float r, float g, float b, float weight,
+    const ChannelSample *channels) {
+  // Move to discrete coordinates, where pixel centers lie on integers.
+  float discrete_x = x - 0.5f;
+  float discrete_y = y - 0.5f;
+  float radius = filter_table.GetRadius();
+  int x0 = std::max((int)std::ceil(discrete_x - radius), pixel_min.x);
+  int x1 = std::min((int)std::floor(discrete_x + radius) + 1, pixel_max.x);
+  int y0 = std::max((int)std::ceil(discrete_y - radius), pixel_min.y);
+  int y1 = std::min((int)std::floor(discrete_y + radius) + 1, pixel_max.y);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+  int row_width = pixel_max.x - pixel_min.x;
+  bool on_heap = x1 - x0 > MAX_SPLAT_WIDTH;
+  if (filter_table.IsSeparable()) {
+    // Look up the column weights once, so each pixel only costs a multiply by the row weight.
+    float stack_x_weights[MAX_SPLAT_WIDTH];
+    std::vector<float> heap_x_weights(on_heap ? x1 - x0 : 0);
+    float *x_weights = on_heap ? heap_x_weights.data() : stack_x_weights;
+    for (int px = x0; px < x1; px++) {
+      x_weights[px - x0] = filter_table.GetAxisWeight(filter_table.OffsetToIndex(px - discrete_x));
+    }
+    for (int py = y0; py < y1; py++) {
+      float y_weight = weight *
+          filter_table.GetAxisWeight(filter_table.OffsetToIndex(py - discrete_y));
+      Pixel *row = pixels + (py - pixel_min.y) * row_width;
+      for (int px = x0; px < x1; px++) {
+        float filter_weight = y_weight * x_weights[px - x0];
+        Pixel &pixel = row[px - pixel_min.x];
+        pixel.r += filter_weight * r;
+        pixel.g += filter_weight * g;
+        pixel.b += filter_weight * b;
+        pixel.weight_sum += filter_weight;
+        if (channels) {
+          SplatChannels(channels, &pixel - pixels, filter_weight);
+        }
+      }
+    }
+    return;
+  }
+  uint stack_x_indices[MAX_SPLAT_WIDTH];
+  std::vector<uint> heap_x_indices(on_heap ? x1 - x0 : 0);
+  uint *x_indices = on_heap ? heap_x_indices.data() : stack_x_indices;
+  for (int px = x0; px < x1; px++) {
+    x_indices[px - x0] = filter_table.OffsetToIndex(px - discrete_x);
+  }
+  for (int py = y0; py < y1; py++) {
+    uint y_index = filter_table.OffsetToIndex(py - discrete_y);
+    Pixel *row = pixels + (py - pixel_min.y) * row_width;
+    for (int px = x0; px < x1; px++) {
+      float filter_weight = weight * filter_table.GetWeight(x_indices[px - x0], y_index);
+      Pixel &pixel = row[px - pixel_min.x];
+      pixel.r += filter_weight * r;
+      pixel.g += filter_weight * g;
+      pixel.b += filter_weight * b;
+      pixel.weight_sum += filter_weight;
+      if (channels) {
+        SplatChannels(channels, &pixel - pixels, filter_weight);
+      }
+    }
+  }
+}
+
+// Returns the indices of the averaged channels among the given modes.
+static std::vector<uint> AveragedChannels(const std::vector<ChannelMode> &modes) {
+  std::vector<uint> averaged_channels;
+  for (uint channel = 0; channel < modes.size(); channel++) {
+    if (modes[channel] == ChannelMode::AVERAGE) {
+      averaged_channels.push_back(channel);
+    }
+  }
+  return averaged_channels;
+}
+
+// Converts a single pixel to an interleaved RGB value. This is the scalar version of
+// ToneMapPixels() and must match it exactly.
+template <typename T>
+static void ToneMapPixel(const Pixel &pixel, float exposure_scale, bool srgb, float max_value,
+    T *output) {
+  // Filters with negative lobes can leave pixels with no net weight.
+  float scale = pixel.weight_sum > 0.f ? exposure_scale / pixel.weight_sum : 0.f;
+  float color[3] = {pixel.r, pixel.g, pixel.b};
+  for (uint channel = 0; channel < 3; channel++) {
+    float value = std::min(std::max(color[channel] * scale, 0.f), 1.f);
+    if (srgb) {
+      value = GetSrgbTable().Encode(value);
+    }
+    output[channel] = (T)(value * max_value + 0.5f);
+  }
+}
+
+// Converts a run of pixels to interleaved RGB values.
+template <typename T>
+static void ToneMapPixels(const Pixel *pixels, uint count, float exposure_scale, bool srgb,
+    float max_value, T *output) {
+  uint i = 0;
+#ifdef __SSE2__
+  const SrgbTable &srgb_table = GetSrgbTable();
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 exposure = _mm_set1_ps(exposure_scale);
+  const __m128 max = _mm_set1_ps(max_value);
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (; i + 4 <= count; i += 4) {
+    // The color and weight of a pixel are adjacent, so each pixel is a single load. Transposing
+    // four of them gives a vector per channel.
+    __m128 r = _mm_loadu_ps(&pixels[i].r);
+    __m128 g = _mm_loadu_ps(&pixels[i + 1].r);
+    __m128 b = _mm_loadu_ps(&pixels[i + 2].r);
+    __m128 weight = _mm_loadu_ps(&pixels[i + 3].r);
+    _MM_TRANSPOSE4_PS(r, g, b, weight);
+    __m128 has_weight = _mm_cmpgt_ps(weight, zero);
+    __m128 scale = _mm_and_ps(has_weight, _mm_div_ps(exposure, weight));
+    __m128 channels[3] = {r, g, b};
+    uint32_t quantized[3][4];
+    for (uint channel = 0; channel < 3; channel++) {
+      __m128 value = _mm_min_ps(_mm_max_ps(_mm_mul_ps(channels[channel], scale), zero), one);
+      if (srgb) {
+        value = srgb_table.Encode4(value);
+      }
+      __m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, max), half));
+      _mm_storeu_si128((__m128i *)quantized[channel], rounded);
+    }
+    for (uint lane = 0; lane < 4; lane++) {
+      T *pixel_output = output + (i + lane) * 3;
+      pixel_output[0] = (T)quantized[0][lane];
+      pixel_output[1] = (T)quantized[1][lane];
+      pixel_output[2] = (T)quantized[2][lane];
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    ToneMapPixel(pixels[i], exposure_scale, srgb, max_value, output + i * 3);
+  }
+}
+
+// Converts the pixels of a film to interleaved RGB values in strips of rows spread across threads.
+template <typename T>
+static void ToneMapFilm(const Film &film, const ToneMapSettings &settings, float max_value,
+    T *output) {
+  float exposure_scale = std::exp2(settings.exposure);
+  uint num_strips = (film.height + TONE_MAP_STRIP_HEIGHT - 1) / TONE_MAP_STRIP_HEIGHT;
+  ParallelFor(num_strips, settings.num_threads, [&](uint strip) {
+    uint first_row = strip * TONE_MAP_STRIP_HEIGHT;
+    uint num_rows = std::min(first_row + TONE_MAP_STRIP_HEIGHT, film.height) - first_row;
+    std::vector<Pixel> scratch;
+    const Pixel *pixels = film.GetRows(first_row, num_rows, &scratch);
+    ToneMapPixels(pixels, num_rows * film.width, exposure_scale, settings.srgb, max_value,
+        output + (size_t)first_row * film.width * 3);
+  });
+}
+
+float PixelVariance(const Pixel &pixel) {
+  if (pixel.sample_count < 2) {
+    return 0.f;
+  }
+  float count = (float)pixel.sample_count;
+  float mean = pixel.luminance_sum / count;
+  // Use the unbiased estimator and clamp to 0 to guard against cancellation.
+  float variance = (pixel.luminance_squared_sum - count * mean * mean) / (count - 1.f);
+  return std::max(0.f, variance);
+}
+
+float PixelRelativeError(const Pixel &pixel) {
+  if (pixel.sample_count < 2) {
+    return std::numeric_limits<float>::infinity();
+  }
+  const float MIN_LUMINANCE = 0.01f;
+  float count = (float)pixel.sample_count;
+  float mean = std::max(pixel.luminance_sum / count, MIN_LUMINANCE);
+  return std::sqrt(PixelVariance(pixel) / count) / mean;
+}
+
+FilmTile::FilmTile(const Point2i &pixel_min, const Point2i &pixel_max, const Point2i &splat_min,
+    const Point2i &splat_max, std::shared_ptr<const FilterTable> filter_table,
+    const std::vector<ChannelMode> &channel_modes) : pixel_min{pixel_min}, pixel_max{pixel_max},
+    splat_min{splat_min}, splat_max{splat_max}, filter_table{filter_table},
+    channel_modes{channel_modes}, averaged_channels{AveragedChannels(channel_modes)} {
+  assert(pixel_min.x <= pixel_max.x && pixel_min.y <= pixel_max.y);
+  assert(splat_min.x <= pixel_min.x && splat_min.y <= pixel_min.y);
+  assert(splat_max.x >= pixel_max.x && splat_max.y >= pixel_max.y);
+  pixels.resize((splat_max.x - splat_min.x) * (splat_max.y - splat_min.y));
+  channel_values.resize(channel_modes.size() * pixels.size());
+}
+
+Pixel FilmTile::GetPixel(uint x, uint y) const {
+  return pixels[PixelIndex(x, y)];
+}
+
+float FilmTile::GetChannelValue(uint channel, uint x, uint y) const {
+  assert(channel < channel_modes.size());
+  return channel_values[channel * pixels.size() + PixelIndex(x, y)];
+}
+
+void FilmTile::AddSample(float x, float y, float r, float g, float b, float weight,
+    const float *sample_channel_values) {
+  assert(x >= pixel_min.x && x < pixel_max.x);
+  assert(y >= pixel_min.y && y < pixel_max.y);
+  assert(r >= 0.f && g >= 0.f && b >= 0.f);
+  uint index = PixelIndex((uint)x, (uint)y);
+  RecordSample(&pixels[index], r, g, b);
+  if (!sample_channel_values || channel_modes.empty()) {
+    SplatSample(*filter_table, pixels.data(), splat_min, splat_max, x, y, r, g, b, weight,
+        nullptr);
+    return;
+  }
+  ChannelSample channels = {&channel_modes, &averaged_channels, channel_values.data(),
+      pixels.size(), sample_channel_values};
+  RecordChannels(channels, index, pixels[index].sample_count);
+  SplatSample(*filter_table, pixels.data(), splat_min, splat_max, x, y, r, g, b, weight,
+      averaged_channels.empty() ? nullptr : &channels);
+}
+
+void FilmTile::SetPixel(uint x, uint y, float r, float g, float b, float weight,
+    const float *sample_channel_values) {
+  assert((int)x >= pixel_min.x && (int)x < pixel_max.x);
+  assert((int)y >= pixel_min.y && (int)y < pixel_max.y);
+  uint index = PixelIndex(x, y);
+  Pixel pixel = {r * weight, g * weight, b * weight, weight, 0.f, 0.f, 0};
+  RecordSample(&pixel, r, g, b);
+  pixels[index] = pixel;
+  set_pixels.emplace_back(index, pixel);
+  for (uint channel = 0; channel < channel_modes.size(); channel++) {
+    float value = sample_channel_values ? sample_channel_values[channel] : 0.f;
+    // Averaged channels are divided by the pixel's weight when read, just like the color.
+    if (channel_modes[channel] == ChannelMode::AVERAGE) {
+      value *= weight;
+    }
+    channel_values[channel * pixels.size() + index] = value;
+    set_channel_values.push_back(value);
+  }
+}
+
+uint FilmTile::NumPixels() const {
+  return pixels.size();
+}
+
+Pixel *FilmTile::GetPixels() {
+  return pixels.data();
+}
+
+const Pixel *FilmTile::GetPixels() const {
+  return pixels.data();
+}
+
+uint FilmTile::NumChannelValues() const {
+  return channel_values.size();
+}
+
+float *FilmTile::GetChannelValues() {
+  return channel_values.data();
+}
+
+const float *FilmTile::GetChannelValues() const {
+  return channel_values.data();
+}
+
+uint FilmTile::PixelIndex(uint x, uint y) const {
+  assert((int)x >= splat_min.x && (int)x < splat_max.x);
+  assert((int)y >= splat_min.y && (int)y < splat_max.y);
+  return (y - splat_min.y) * (splat_max.x - splat_min.x) + (x - splat_min.x);
+}
+
+Film::Film(uint width, uint height, std::unique_ptr<Filter> filter, FilmStorage storage) :
+    Film(width, height, std::move(filter), storage, nullptr) {}
+
+Film::Film(uint width, uint height, std::unique_ptr<Filter> filter, FilmStorage storage,
+    std::unique_ptr<MappedFile> mapped_file) : width{width}, height{height},
+    filter{std::move(filter)}, filter_table{std::make_shared<FilterTable>(*this->filter)},
+    storage{storage}, heap_pixels{nullptr, std::free}, mapped_file{std::move(mapped_file)},
+    pixels{nullptr}, compact_pixels{nullptr} {
+  // Both a new mapped file and memory from calloc() are already zeroed, and clearing them would
+  // commit every page.
+  char *data;
+  if (this->mapped_file) {
+    assert(this->mapped_file->GetSize() == (size_t)PixelSize() * width * height);
+    data = this->mapped_file->GetData();
+  } else {
+    heap_pixels.reset(static_cast<char *>(std::calloc((size_t)width * height, PixelSize())));
+    assert(heap_pixels);
+    data = heap_pixels.get();
+  }
+  if (storage == FilmStorage::COMPACT) {
+    compact_pixels = reinterpret_cast<CompactPixel *>(data);
+  } else {
+    pixels = reinterpret_cast<Pixel *>(data);
+  }
+}
+
+std::unique_ptr<Film> Film::CreateMappedFilm(uint width, uint height,
+    std::unique_ptr<Filter> filter, FilmStorage storage, const std::string &file_name) {
+  size_t pixel_size = storage == FilmStorage::COMPACT ? sizeof(CompactPixel) : sizeof(Pixel);
+  std::unique_ptr<MappedFile> mapped_file = MappedFile::Create(file_name,
+      pixel_size * width * height);
+  if (!mapped_file) {
+    return nullptr;
+  }
+  return std::unique_ptr<Film>(new Film(width, height, std::move(filter), storage,
+      std::move(mapped_file)));
+}
+
+FilmStorage Film::GetStorage() const {
+  return storage;
+}
+
+bool Film::IsMapped() const {
+  return mapped_file != nullptr;
 }
 
 Pixel Film::GetPixel(uint x, uint y) const {
   assert(x < width && y < height);
-  return pixels.get()[y * width + x];
+  if (storage == FilmStorage::COMPACT) {
+    return ExpandPixel(compact_pixels[(size_t)y * width + x]);
+  }
+  return pixels[(size_t)y * width + x];
+}
+
+uint Film::AddChannel(const std::string &name, ChannelMode mode) {
+  assert(name != "R" && name != "G" && name != "B");
+  for (uint channel = 0; channel < channels.size(); channel++) {
+    assert(channels[channel].name != name);
+  }
+  channels.push_back({name, mode});
+  channel_modes.push_back(mode);
+  if (mode == ChannelMode::AVERAGE) {
+    averaged_channels.push_back(channels.size() - 1);
+  }
+  channel_values.resize(channels.size() * (size_t)width * height, 0.f);
+  return channels.size() - 1;
+}
+
+uint Film::NumChannels() const {
+  return channels.size();
+}
+
+const FilmChannel &Film::GetChannel(uint channel) const {
+  assert(channel < channels.size());
+  return channels[channel];
+}
+
+float Film::GetChannelValue(uint channel, uint x, uint y) const {
+  assert(channel < channels.size() && x < width && y < height);
+  size_t index = (size_t)y * width + x;
+  float value = channel_values[channel * (size_t)width * height + index];
+  if (channels[channel].mode != ChannelMode::AVERAGE) {
+    return value;
+  }
+  float weight_sum = GetPixel(x, y).weight_sum;
+  return weight_sum > 0.f ? value / weight_sum : 0.f;
+}
+
+const Pixel *Film::GetRows(uint first_row, uint num_rows, std::vector<Pixel> *scratch) const {
+  assert(first_row + num_rows <= height);
+  size_t offset = (size_t)first_row * width;
+  if (storage != FilmStorage::COMPACT) {
+    return pixels + offset;
+  }
+  scratch->resize((size_t)num_rows * width);
+  for (size_t i = 0; i < scratch->size(); i++) {
+    (*scratch)[i] = ExpandPixel(compact_pixels[offset + i]);
+  }
+  return scratch->data();
 }
 
 void Film::ClearFilm() {
-  std::memset(pixels.get(), 0, sizeof(Pixel) * width * height);
+  std::fill(channel_values.begin(), channel_values.end(), 0.f);
+  set_pixels.clear();
+  if (mapped_file && mapped_file->Clear()) {
+    return;
+  }
+  if (storage == FilmStorage::COMPACT) {
+    std::memset(compact_pixels, 0, sizeof(CompactPixel) * (size_t)width * height);
+  } else {
+    std::memset(pixels, 0, sizeof(Pixel) * (size_t)width * height);
+  }
 }
 
-void Film::AddSample(float x, float y, float r, float g, float b, float weight) {
-  assert(x >= 0.f && x <= (float)width);
-  assert(y >= 0.f && y <= (float)height);
+void Film::AddSample(float x, float y, float r, float g, float b, float weight,
+    const float *sample_channel_values) {
+  assert(x >= 0.f && x < (float)width);
+  assert(y >= 0.f && y < (float)height);
   assert(r >= 0.f && g >= 0.f && b >= 0.f);
-  // TODO(brkho): Do real conversion from continuous to discrete locations here.
-  int index = (int)y * width + (int)x;
-  pixels.get()[index].r += r;
-  pixels.get()[index].g += g;
-  pixels.get()[index].b += b;
-  pixels.get()[index].weight_sum += weight;
-}
-
-void Film::SaveAsPng(std::string name) const {
-  char *output_pixels = new char[width * height * 3];
-  for (uint i = 0; i < height; i++) {
-    for (uint j = 0; j < width; j++) {
-      Pixel pixel = pixels.get()[(int)i * width + (int)j];
-      int base_index = (int)i * width * 3 + (int)j * 3;
-      output_pixels[base_index] = (char)((pixel.r / pixel.weight_sum) * 255);
-      output_pixels[base_index + 1] = (char)((pixel.g / pixel.weight_sum) * 255);
-      output_pixels[base_index + 2] = (char)((pixel.b / pixel.weight_sum) * 255);
-    }
-  }
-  int result = stbi_write_png(name.c_str(), width, height, 3, output_pixels, width * 3);
-  delete output_pixels;
-  assert(result != 0);
+  if (storage == FilmStorage::COMPACT) {
+    std::unique_ptr<FilmTile> tile = GetFilmTile(Point2i((int)x, (int)y),
+        Point2i((int)x + 1, (int)y + 1));
+    tile->AddSample(x, y, r, g, b, weight, sample_channel_values);
+    MergeFilmTile(*tile);
+    return;
+  }
+  size_t index = (size_t)(int)y * width + (int)x;
+  RecordSample(&pixels[index], r, g, b);
+  if (!sample_channel_values || channels.empty()) {
+    SplatSample(*filter_table, pixels, Point2i(0, 0), Point2i(width, height), x, y, r, g, b,
+        weight, nullptr);
+    return;
+  }
+  ChannelSample channel_sample = {&channel_modes, &averaged_channels, channel_values.data(),
+      (size_t)width * height, sample_channel_values};
+  RecordChannels(channel_sample, index, pixels[index].sample_count);
+  SplatSample(*filter_table, pixels, Point2i(0, 0), Point2i(width, height), x, y, r, g, b,
+      weight, averaged_channels.empty() ? nullptr : &channel_sample);
+}
+
+std::unique_ptr<FilmTile> Film::GetFilmTile(const Point2i &pixel_min,
+    const Point2i &pixel_max) const {
+  Point2i clamped_min = Point2i(std::max(pixel_min.x, 0), std::max(pixel_min.y, 0));
+  Point2i clamped_max = Point2i(std::min(pixel_max.x, (int)width),
+      std::min(pixel_max.y, (int)height));
+  Point2i splat_min, splat_max;
+  GetSplatBounds(clamped_min, clamped_max, &splat_min, &splat_max);
+  return std::unique_ptr<FilmTile>(new FilmTile(clamped_min, clamped_max, splat_min, splat_max,
+      filter_table, channel_modes));
+}
+
+void Film::GetSplatBounds(const Point2i &pixel_min, const Point2i &pixel_max, Point2i *splat_min,
+    Point2i *splat_max) const {
+  // Grow the bounds by the pixels that samples on the edge of the tile reach, which follow the
+  // same discrete conversion as SplatSample().
+  float radius = filter_table->GetRadius();
+  *splat_min = Point2i(
+      std::max((int)std::ceil(std::max(pixel_min.x, 0) - 0.5f - radius), 0),
+      std::max((int)std::ceil(std::max(pixel_min.y, 0) - 0.5f - radius), 0));
+  *splat_max = Point2i(
+      std::min((int)std::floor(std::min(pixel_max.x, (int)width) - 0.5f + radius) + 1,
+      (int)width),
+      std::min((int)std::floor(std::min(pixel_max.y, (int)height) - 0.5f + radius) + 1,
+      (int)height));
+}
+
+void Film::MergeFilmTile(const FilmTile &tile) {
+  assert(tile.channel_modes.size() == channels.size());
+  size_t film_plane_size = (size_t)width * height;
+  size_t tile_plane_size = tile.pixels.size();
+  for (int y = tile.splat_min.y; y < tile.splat_max.y; y++) {
+    for (int x = tile.splat_min.x; x < tile.splat_max.x; x++) {
+      uint tile_index = tile.PixelIndex(x, y);
+      const Pixel &tile_pixel = tile.pixels[tile_index];
+      size_t index = (size_t)y * width + x;
+      if (!set_pixels.empty() && set_pixels[index]) {
+        continue;
+      }
+      uint film_sample_count;
+      if (storage == FilmStorage::COMPACT) {
+        // Expand the pixel so the sums are added in float and only rounded once.
+        Pixel pixel = ExpandPixel(compact_pixels[index]);
+        film_sample_count = pixel.sample_count;
+        AddPixel(tile_pixel, &pixel);
+        compact_pixels[index] = CompactPixelFrom(pixel);
+      } else {
+        film_sample_count = pixels[index].sample_count;
+        AddPixel(tile_pixel, &pixels[index]);
+      }
+      for (uint channel = 0; channel < channels.size(); channel++) {
+        float tile_value = tile.channel_values[channel * tile_plane_size + tile_index];
+        float &value = channel_values[channel * film_plane_size + index];
+        if (channels[channel].mode != ChannelMode::FIRST) {
+          value += tile_value;
+        } else if (film_sample_count == 0 && tile_pixel.sample_count > 0) {
+          value = tile_value;
+        }
+      }
+    }
+  }
+  for (uint i = 0; i < tile.set_pixels.size(); i++) {
+    uint tile_index = tile.set_pixels[i].first;
+    int x = tile.splat_min.x + tile_index % (tile.splat_max.x - tile.splat_min.x);
+    int y = tile.splat_min.y + tile_index / (tile.splat_max.x - tile.splat_min.x);
+    size_t index = (size_t)y * width + x;
+    if (storage == FilmStorage::COMPACT) {
+      compact_pixels[index] = CompactPixelFrom(tile.set_pixels[i].second);
+    } else {
+      pixels[index] = tile.set_pixels[i].second;
+    }
+    for (uint channel = 0; channel < channels.size(); channel++) {
+      channel_values[channel * film_plane_size + index] =
+          tile.set_channel_values[i * channels.size() + channel];
+    }
+    if (set_pixels.empty()) {
+      set_pixels.resize(film_plane_size, false);
+    }
+    set_pixels[index] = true;
+  }
+  if (mapped_file) {
+    size_t row_size = (size_t)PixelSize() * width;
+    mapped_file->Flush(tile.splat_min.y * row_size,
+        (tile.splat_max.y - tile.splat_min.y) * row_size);
+  }
+}
+
+bool Film::SaveCheckpoint(const std::string &name, uint64_t fingerprint,
+    uint tiles_merged) const {
+  return WriteCheckpoint(name, GetCheckpointData(fingerprint, tiles_merged));
+}
+
+std::vector<char> Film::GetCheckpointData(uint64_t fingerprint, uint tiles_merged) const {
+  CheckpointHeader header;
+  std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  header.width = width;
+  header.height = height;
+  header.pixel_size = PixelSize();
+  header.tiles_merged = tiles_merged;
+  header.fingerprint = fingerprint;
+  header.num_channels = channels.size();
+  header.reserved = 0;
+  size_t pixels_size = (size_t)PixelSize() * width * height;
+  std::vector<char> data(sizeof(header) + pixels_size + channel_values.size() * sizeof(float));
+  std::memcpy(data.data(), &header, sizeof(header));
+  std::memcpy(data.data() + sizeof(header), PixelData(), pixels_size);
+  std::memcpy(data.data() + sizeof(header) + pixels_size, channel_values.data(),
+      channel_values.size() * sizeof(float));
+  return data;
+}
+
+bool Film::WriteCheckpoint(const std::string &name, const std::vector<char> &data) {
+  std::string temp_name = name + ".tmp";
+  {
+    std::ofstream file(temp_name, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    if (!file.good()) {
+      return false;
+    }
+  }
+  return std::rename(temp_name.c_str(), name.c_str()) == 0;
+}
+
+bool Film::LoadCheckpoint(const std::string &name, uint64_t fingerprint, uint *tiles_merged,
+    uint max_tiles_merged) {
+  ClearFilm();
+  std::ifstream file(name, std::ios::binary);
+  CheckpointHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+      header.width != width || header.height != height || header.pixel_size != PixelSize() ||
+      header.fingerprint != fingerprint || header.num_channels != channels.size() ||
+      header.tiles_merged > max_tiles_merged) {
+    return false;
+  }
+  if (!file.read(PixelData(), (size_t)PixelSize() * width * height) ||
+      !file.read(reinterpret_cast<char *>(channel_values.data()),
+      channel_values.size() * sizeof(float))) {
+    ClearFilm();
+    return false;
+  }
+  *tiles_merged = header.tiles_merged;
+  return true;
+}
+
+void Film::ToneMap(const ToneMapSettings &settings, uint8_t *output) const {
+  ToneMapFilm(*this, settings, 255.f, output);
+}
+
+void Film::ToneMap(const ToneMapSettings &settings, uint16_t *output) const {
+  ToneMapFilm(*this, settings, 65535.f, output);
+}
+
+bool Film::Save(const std::string &name, const ImageEncoder &encoder,
+    const ToneMapSettings &settings) const {
+  std::vector<uint8_t> output_pixels(width * height * 3);
+  ToneMap(settings, output_pixels.data());
+  return encoder.Encode(name, output_pixels.data(), width, height, settings.num_threads);
+}
+
+void Film::SaveAsPng(std::string name, const ToneMapSettings &settings) const {
+  bool result = Save(name, PngEncoder(), settings);
+  assert(result);
+}
+
+bool Film::SaveAsExr(const std::string &name, ExrPixelType pixel_type,
+    ExrCompression compression) const {
+  std::vector<std::string> channel_names;
+  for (const FilmChannel &channel : channels) {
+    channel_names.push_back(channel.name);
+  }
+  ExrWriter writer(name, width, height, pixel_type, compression, channel_names);
+  return WriteImage(&writer);
+}
+
+bool Film::SaveAsPfm(const std::string &name) const {
+  PfmWriter writer(name, width, height);
+  return WriteImage(&writer);
+}
+
+bool Film::WriteImage(ImageWriter *writer) const {
+  assert(writer->width == width && writer->height == height);
+  // The writer's extra channels are looked up by name among the film's.
+  std::vector<uint> writer_channels;
+  for (const std::string &name : writer->channels) {
+    uint channel = 0;
+    while (channel < channels.size() && channels[channel].name != name) {
+      channel++;
+    }
+    assert(channel < channels.size());
+    writer_channels.push_back(channel);
+  }
+  std::vector<float> row(width * 3);
+  std::vector<float> channel_row(writer_channels.size() * width);
+  std::vector<Pixel> scratch;
+  bool ok = true;
+  for (uint y = 0; y < height && ok; y++) {
+    const Pixel *film_row = GetRows(y, 1, &scratch);
+    for (uint x = 0; x < width; x++) {
+      const Pixel &pixel = film_row[x];
+      float inverse_weight = pixel.weight_sum > 0.f ? 1.f / pixel.weight_sum : 0.f;
+      row[x * 3] = pixel.r * inverse_weight;
+      row[x * 3 + 1] = pixel.g * inverse_weight;
+      row[x * 3 + 2] = pixel.b * inverse_weight;
+      for (uint i = 0; i < writer_channels.size(); i++) {
+        uint channel = writer_channels[i];
+        float value = channel_values[(channel * (size_t)height + y) * width + x];
+        channel_row[i * width + x] =
+            channels[channel].mode == ChannelMode::AVERAGE ? value * inverse_weight : value;
+      }
+    }
+    ok = writer->WriteRow(row.data(), channel_row.empty() ? nullptr : channel_row.data());
+  }
+  return writer->Close() && ok;
+}
+
+uint Film::PixelSize() const {
+  return storage == FilmStorage::COMPACT ? sizeof(CompactPixel) : sizeof(Pixel);
+}
+
+char *Film::PixelData() {
+  return mapped_file ? mapped_file->GetData() : heap_pixels.get();
+}
+
+const char *Film::PixelData() const {
+  return mapped_file ? mapped_file->GetData() : heap_pixels.get();
 }
 
 }
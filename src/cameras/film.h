@@ -1,6 +1,11 @@
 // This header defines the Film, an analogy to the imaging sensor in a real camera. The film
 // accumulates information about light hitting the sensor which can then be used in turn to output
-// an image to disk.
+// an image to disk. Every sample is weighted by the reconstruction filter and added to all the
+// pixels within the filter's radius, with pixel centers at half-integer coordinates.
+//
+// Besides the color, a film can hold any number of extra float channels, like depth or object ids
+// for compositing. Each channel is stored as its own plane of values after the other channels, so
+// passes that only read one channel touch only its memory.
 //
 // Author: brian@brkho.com
 
@@ -11,6 +16,12 @@
 #include "core/liang.h"
 #include "core/transform.h"
 #include "filters/filter.h"
+#include "filters/filter_table.h"
+#include "images/exr_writer.h"
+#include "images/image_encoder.h"
+#include "images/image_writer.h"
+#include "images/tone_map.h"
+#include "utils/mapped_file.h"
 
 namespace liang {
 
@@ -25,6 +36,176 @@ struct Pixel {
     float b;
     // The sum of all of the weights of the samples so far.
     float weight_sum;
+    // The sum of the luminance of the samples taken inside the pixel.
+    float luminance_sum;
+    // The sum of the squared luminance of the samples taken inside the pixel. Together with
+    // luminance_sum, this lets us estimate the variance of the pixel.
+    float luminance_squared_sum;
+    // The number of samples taken inside the pixel.
+    uint sample_count;
+};
+
+// A Pixel stored in 16 bytes instead of 28 for films too large to hold at full precision. The
+// color and luminance statistics are stored as half precision averages rather than sums, so their
+// precision doesn't degrade as samples pile up, while the weight stays a float so merges weight
+// the old and new samples correctly. The color is only averaged once the weight sum reaches a
+// magnitude of 1. Until then, which includes border pixels whose negative filter lobes cancel the
+// weight to near 0, the color sums are stored as they are, so they neither overflow nor get lost.
+// Samples are still accumulated in float inside FilmTiles and only rounded when a tile is merged,
+// so each merge adds at most half a half-precision ulp of relative error.
+struct CompactPixel {
+  // The half precision bits of the red component divided by the larger of the magnitude of the
+  // weight sum and 1.
+  uint16_t r;
+  // The half precision bits of the green component, scaled like r.
+  uint16_t g;
+  // The half precision bits of the blue component, scaled like r.
+  uint16_t b;
+  // The half precision bits of the mean luminance of the samples taken inside the pixel.
+  uint16_t luminance_mean;
+  // The sum of all of the weights of the samples so far.
+  float weight_sum;
+  // The half precision bits of the population variance of the luminance of the samples taken
+  // inside the pixel. Storing the variance rather than the mean squared luminance keeps it from
+  // cancelling away in half precision.
+  uint16_t luminance_variance;
+  // The number of samples taken inside the pixel, which saturates at 65535. Past that point the
+  // luminance means give new samples slightly more than their share.
+  uint16_t sample_count;
+};
+
+// The layouts a Film can store its pixels in.
+enum class FilmStorage {
+  // Pixels at full float precision.
+  FULL,
+  // CompactPixels, which take a little over half the memory.
+  COMPACT
+};
+
+// How a film channel combines the values of the samples that contribute to a pixel.
+enum class ChannelMode {
+  // The filtered average of the samples around the pixel, just like the color. This suits depth
+  // and normals.
+  AVERAGE,
+  // The sum of the values of the samples taken inside the pixel. This suits counts.
+  SUM,
+  // The value of the first sample taken inside the pixel. This suits ids, which can't be averaged.
+  FIRST
+};
+
+// An extra output channel of a Film.
+struct FilmChannel {
+  // The name the channel is saved under.
+  std::string name;
+  // How the channel combines samples.
+  ChannelMode mode;
+};
+
+// Returns the luminance of an rgb triple.
+inline float Luminance(float r, float g, float b) {
+  return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+// Adds the sums of one pixel to another.
+inline void AddPixel(const Pixel &source, Pixel *destination) {
+  destination->r += source.r;
+  destination->g += source.g;
+  destination->b += source.b;
+  destination->weight_sum += source.weight_sum;
+  destination->luminance_sum += source.luminance_sum;
+  destination->luminance_squared_sum += source.luminance_squared_sum;
+  destination->sample_count += source.sample_count;
+}
+
+// Returns the estimated variance of the luminance of the samples taken inside the pixel.
+float PixelVariance(const Pixel &pixel);
+
+// Returns the standard error of the pixel's mean luminance relative to the mean itself. Dark
+// pixels are compared against a small floor instead so noise in the black does not run forever.
+float PixelRelativeError(const Pixel &pixel);
+
+// A rectangular region of the Film that accumulates samples independently of the rest of the
+// image. Each rendering thread records its samples into its own FilmTile, which is later merged
+// back into the Film, so threads never contend on the Film's pixels. Samples near the edge of the
+// tile spill onto neighboring pixels, so a tile stores a border of pixels as wide as the filter's
+// radius around the pixels it takes samples in.
+class FilmTile {
+  public:
+    // The top left corner of the pixels the tile takes samples in, in film pixel coordinates.
+    const Point2i pixel_min;
+    // The bottom right corner of the pixels the tile takes samples in (exclusive).
+    const Point2i pixel_max;
+    // The top left corner of the pixels the tile stores, including the border.
+    const Point2i splat_min;
+    // The bottom right corner of the pixels the tile stores, including the border (exclusive).
+    const Point2i splat_max;
+
+    // FilmTile constructor that takes the bounds of the pixels the tile takes samples in, the
+    // bounds of the pixels it stores, the table of the film's filter, and the modes of the film's
+    // extra channels.
+    FilmTile(const Point2i &pixel_min, const Point2i &pixel_max, const Point2i &splat_min,
+        const Point2i &splat_max, std::shared_ptr<const FilterTable> filter_table,
+        const std::vector<ChannelMode> &channel_modes = std::vector<ChannelMode>());
+
+    // Gets the pixel at the given film coordinates, which must be stored by the tile.
+    Pixel GetPixel(uint x, uint y) const;
+
+    // Gets the accumulated value of an extra channel at the given film coordinates. Averaged
+    // channels have not been divided by the weight yet.
+    float GetChannelValue(uint channel, uint x, uint y) const;
+
+    // Adds a sample's contribution to the pixels around it. The sample (supplied in continuous
+    // film coordinates) must lie within the pixels the tile takes samples in. If the film has
+    // extra channels, channel_values holds the sample's value for each of them, or is nullptr to
+    // leave them alone.
+    void AddSample(float x, float y, float r, float g, float b, float weight,
+        const float *channel_values = nullptr);
+
+    // Sets the pixel at the given film coordinates, which must be one the tile takes samples in,
+    // to a finished color carried with the weight it was accumulated with. The color isn't
+    // filtered: once the tile is merged, it replaces whatever the film and the other tiles
+    // gathered for the pixel, and later merges leave it alone. channel_values holds the pixel's
+    // final value for each extra channel, or is nullptr to clear them.
+    void SetPixel(uint x, uint y, float r, float g, float b, float weight,
+        const float *channel_values = nullptr);
+
+    // Returns the number of pixels the tile stores.
+    uint NumPixels() const;
+
+    // Gets the pixels the tile stores in row-major order. This is used to move tiles between
+    // processes.
+    Pixel *GetPixels();
+    const Pixel *GetPixels() const;
+
+    // Returns the number of extra channel values the tile stores, which is the number of pixels
+    // for every channel.
+    uint NumChannelValues() const;
+
+    // Gets the extra channel values, with every channel's pixels stored contiguously in row-major
+    // order.
+    float *GetChannelValues();
+    const float *GetChannelValues() const;
+
+  private:
+    // The table of the film's filter.
+    std::shared_ptr<const FilterTable> filter_table;
+    // The Pixel data of the tile in row-major order.
+    std::vector<Pixel> pixels;
+    // The modes of the film's extra channels.
+    std::vector<ChannelMode> channel_modes;
+    // The indices of the extra channels that are averaged.
+    std::vector<uint> averaged_channels;
+    // The extra channel values, one plane of NumPixels() values per channel.
+    std::vector<float> channel_values;
+    // The indices of the pixels set with SetPixel() along with what they were set to.
+    std::vector<std::pair<uint, Pixel>> set_pixels;
+    // The extra channel values of the pixels set with SetPixel(), a run of values for each.
+    std::vector<float> set_channel_values;
+
+    // Returns the index into pixels of the given film coordinates.
+    uint PixelIndex(uint x, uint y) const;
+
+    friend class Film;
 };
 
 class Film {
@@ -34,9 +215,24 @@ class Film {
     // Height of the film.
     uint height;
 
-    // Film constructor that takes a width in pixels, a height in pixels, and a reconstruction
-    // filter.
-    Film(uint width, uint height, std::unique_ptr<Filter> filter);
+    // Film constructor that takes a width in pixels, a height in pixels, a reconstruction filter,
+    // and the layout to store the pixels in.
+    Film(uint width, uint height, std::unique_ptr<Filter> filter,
+        FilmStorage storage = FilmStorage::FULL);
+
+    // Creates a film whose pixels live in a file mapped into memory rather than on the heap, so its
+    // size is bounded by disk instead of RAM. The file is created sparse and the rows of every
+    // merged tile start writing back to disk as soon as the tile is merged, so the kernel can
+    // evict them without waiting on the disk. The file holds the raw pixel array and is left on
+    // disk. Returns nullptr if the file could not be created.
+    static std::unique_ptr<Film> CreateMappedFilm(uint width, uint height,
+        std::unique_ptr<Filter> filter, FilmStorage storage, const std::string &file_name);
+
+    // Returns the layout the film stores its pixels in.
+    FilmStorage GetStorage() const;
+
+    // Returns whether the film's pixels live in a mapped file.
+    bool IsMapped() const;
 
     // Gets the pixel at the given coordinates where (0, 0) is the top left corner. This is mainy
     // exposed for testing because I'm using stb_image to write to files. A more elegant solution
@@ -45,24 +241,141 @@ class Film {
     // around to writing my own image loading/saving module.
     Pixel GetPixel(uint x, uint y) const;
 
+    // Adds an extra output channel and returns its index. Channels must be added before any
+    // samples, and their names must be unique and can't be R, G, or B.
+    uint AddChannel(const std::string &name, ChannelMode mode);
+
+    // Returns the number of extra channels.
+    uint NumChannels() const;
+
+    // Gets the extra channel with the given index.
+    const FilmChannel &GetChannel(uint channel) const;
+
+    // Gets the final value of an extra channel at the given coordinates, with averaged channels
+    // divided by the pixel's weight.
+    float GetChannelValue(uint channel, uint x, uint y) const;
+
+    // Gets a run of full rows starting at first_row as Pixels in row-major order. Films stored at
+    // full precision return their own pixels, while compact films expand the rows into scratch.
+    const Pixel *GetRows(uint first_row, uint num_rows, std::vector<Pixel> *scratch) const;
+
     // Clears the film back to its original state.
     void ClearFilm();
 
-    // Adds a sample's contribution to a given pixel (supplied in continuous coordinates).
+    // Adds a sample's contribution to the pixels around it (supplied in continuous coordinates).
+    // Compact films accumulate the sample in a small FilmTile first, so renders that care about
+    // speed or precision should go through FilmTiles instead. channel_values is as in
+    // FilmTile::AddSample().
     // TODO(brkho): Abstract over RGB with a class/struct.
-    void AddSample(float x, float y, float r, float g, float b, float weight);
+    void AddSample(float x, float y, float r, float g, float b, float weight,
+        const float *channel_values = nullptr);
+
+    // Creates an empty FilmTile taking samples in the given pixel bounds, which are clamped to the
+    // film.
+    std::unique_ptr<FilmTile> GetFilmTile(const Point2i &pixel_min, const Point2i &pixel_max) const;
+
+    // Gets the bounds of the pixels a FilmTile taking samples in the given pixel bounds stores,
+    // without creating the tile.
+    void GetSplatBounds(const Point2i &pixel_min, const Point2i &pixel_max, Point2i *splat_min,
+        Point2i *splat_max) const;
+
+    // Adds the samples accumulated in a FilmTile to the film. Merging is not commutative in
+    // floating point, so tiles must be merged in a fixed order for the output to be deterministic.
+    void MergeFilmTile(const FilmTile &tile);
+
+    // Writes the film's accumulated pixels to a checkpoint file along with a fingerprint of the
+    // render settings and the number of tiles merged so far. The file is written next to the
+    // destination and renamed into place, so a job killed mid-write never leaves a torn checkpoint.
+    // Checkpoints use the native byte order and are not meant to move between architectures.
+    bool SaveCheckpoint(const std::string &name, uint64_t fingerprint, uint tiles_merged) const;
+
+    // Returns the contents SaveCheckpoint() would write, which copies the film's pixels. This lets
+    // a render snapshot the film while merges are held off and write it out after they resume.
+    std::vector<char> GetCheckpointData(uint64_t fingerprint, uint tiles_merged) const;
+
+    // Writes checkpoint contents from GetCheckpointData() to a file, in the same way as
+    // SaveCheckpoint().
+    static bool WriteCheckpoint(const std::string &name, const std::vector<char> &data);
+
+    // Restores the film's pixels from a checkpoint file and outputs the number of tiles it had
+    // merged. Returns false, leaving the film cleared, if the file is missing, truncated, was
+    // written for a different film size or fingerprint, or claims more than max_tiles_merged
+    // tiles.
+    bool LoadCheckpoint(const std::string &name, uint64_t fingerprint, uint *tiles_merged,
+        uint max_tiles_merged = std::numeric_limits<uint>::max());
+
+    // Converts the image to interleaved 8-bit RGB values, which must have room for width * height
+    // pixels. The conversion is vectorized and spread across the threads given in the settings.
+    void ToneMap(const ToneMapSettings &settings, uint8_t *output) const;
+
+    // Converts the image to interleaved 16-bit RGB values, which must have room for width * height
+    // pixels.
+    void ToneMap(const ToneMapSettings &settings, uint16_t *output) const;
+
+    // Tone maps the image and saves it with the given encoder. Returns false if the file could not
+    // be written.
+    bool Save(const std::string &name, const ImageEncoder &encoder,
+        const ToneMapSettings &settings = ToneMapSettings()) const;
 
     // Saves the image as a .png after performing tone mapping from HDR to LDR.
-    void SaveAsPng(std::string name) const;
+    void SaveAsPng(std::string name, const ToneMapSettings &settings = ToneMapSettings()) const;
+
+    // Saves the image in high dynamic range as a .exr with the given channel type and compression.
+    // The extra channels are saved alongside the color as full floats. Returns false if the file
+    // could not be written.
+    bool SaveAsExr(const std::string &name, ExrPixelType pixel_type = ExrPixelType::HALF,
+        ExrCompression compression = ExrCompression::RLE) const;
+
+    // Saves the image in high dynamic range as a .pfm. Returns false if the file could not be
+    // written.
+    bool SaveAsPfm(const std::string &name) const;
 
-    // Saves the image in high dynamic range as a .exr.
-    // void SaveAsExr(std::string name);
+    // Streams the image to the given writer one row at a time. Pixels are divided by their weight
+    // but otherwise written as linear radiance, and only a single row is converted at once. The
+    // extra channels are written too if the writer was set up with the film's channel names.
+    bool WriteImage(ImageWriter *writer) const;
 
   protected:
     // Unique pointer to the reconstruction filter function.
     std::unique_ptr<Filter> filter;
-    // Unique pointer to the array of Pixel data.
-    std::unique_ptr<Pixel[]> pixels;
+    // The table of the filter's weights, shared with the film's tiles.
+    std::shared_ptr<const FilterTable> filter_table;
+    // The layout the film stores its pixels in.
+    FilmStorage storage;
+    // The heap memory holding the pixels, or nullptr if they live in a mapped file. This comes from
+    // calloc(), which hands large films untouched zero pages, so memory is only committed for
+    // pixels that are written.
+    std::unique_ptr<char, void (*)(void *)> heap_pixels;
+    // The file holding the pixels, or nullptr if they live on the heap.
+    std::unique_ptr<MappedFile> mapped_file;
+    // The array of Pixel data, or nullptr if the film is compact.
+    Pixel *pixels;
+    // The array of CompactPixel data, or nullptr if the film is full precision.
+    CompactPixel *compact_pixels;
+    // The extra channels.
+    std::vector<FilmChannel> channels;
+    // The modes of the extra channels, in the same order as channels.
+    std::vector<ChannelMode> channel_modes;
+    // The indices of the extra channels that are averaged.
+    std::vector<uint> averaged_channels;
+    // The extra channel values, one plane of width * height values per channel. These always live
+    // on the heap at full precision.
+    std::vector<float> channel_values;
+    // Whether each pixel holds a color set with FilmTile::SetPixel(), which merged tiles no longer
+    // add to. This stays empty until a tile sets a pixel.
+    std::vector<bool> set_pixels;
+
+    // Film constructor that takes the file to keep the pixels in, or nullptr to allocate them on
+    // the heap.
+    Film(uint width, uint height, std::unique_ptr<Filter> filter, FilmStorage storage,
+        std::unique_ptr<MappedFile> mapped_file);
+
+    // Returns the size in bytes of a pixel in the film's layout.
+    uint PixelSize() const;
+
+    // Returns the raw bytes of the film's pixels in its layout.
+    char *PixelData();
+    const char *PixelData() const;
 };
 
 }
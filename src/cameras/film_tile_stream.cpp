@@ -0,0 +1,87 @@
+#include "cameras/film_tile_stream.h"
+
+namespace liang {
+
+FilmTileStream::FilmTileStream(const Film &film, uint render_tile_size, TiledImageWriter *writer) :
+    render_tile_size{render_tile_size}, writer{writer}, num_buffered_tiles{0} {
+  assert(writer->width == film.width && writer->height == film.height);
+  assert(render_tile_size > 0);
+  uint tiles_x = writer->NumTilesX();
+  pending_tiles.resize(tiles_x * writer->NumTilesY(), 0);
+  buffers.resize(pending_tiles.size());
+  // Count the render tiles whose pixels, including the border they splat onto, overlap each
+  // output tile.
+  for (uint y = 0; y < film.height; y += render_tile_size) {
+    for (uint x = 0; x < film.width; x += render_tile_size) {
+      Point2i splat_min, splat_max;
+      film.GetSplatBounds(Point2i(x, y), Point2i(x + render_tile_size, y + render_tile_size),
+          &splat_min, &splat_max);
+      for (uint tile_y = splat_min.y / writer->tile_size;
+          tile_y <= (splat_max.y - 1) / writer->tile_size; tile_y++) {
+        for (uint tile_x = splat_min.x / writer->tile_size;
+            tile_x <= (splat_max.x - 1) / writer->tile_size; tile_x++) {
+          pending_tiles[tile_y * tiles_x + tile_x]++;
+        }
+      }
+    }
+  }
+}
+
+bool FilmTileStream::AddTile(const FilmTile &tile) {
+  assert(tile.pixel_min.x % render_tile_size == 0 && tile.pixel_min.y % render_tile_size == 0);
+  uint tile_size = writer->tile_size;
+  uint tiles_x = writer->NumTilesX();
+  int tile_width = tile.splat_max.x - tile.splat_min.x;
+  const Pixel *tile_pixels = tile.GetPixels();
+  bool ok = true;
+  for (uint tile_y = tile.splat_min.y / tile_size; tile_y <= (tile.splat_max.y - 1) / tile_size;
+      tile_y++) {
+    for (uint tile_x = tile.splat_min.x / tile_size; tile_x <= (tile.splat_max.x - 1) / tile_size;
+        tile_x++) {
+      uint tile_index = tile_y * tiles_x + tile_x;
+      assert(pending_tiles[tile_index] > 0);
+      int min_x = tile_x * tile_size;
+      int min_y = tile_y * tile_size;
+      int max_x = std::min(min_x + (int)tile_size, (int)writer->width);
+      int max_y = std::min(min_y + (int)tile_size, (int)writer->height);
+      std::vector<Pixel> &buffer = buffers[tile_index];
+      if (buffer.empty()) {
+        buffer.resize((max_x - min_x) * (max_y - min_y), Pixel());
+        num_buffered_tiles++;
+      }
+      for (int y = std::max(min_y, tile.splat_min.y); y < std::min(max_y, tile.splat_max.y); y++) {
+        for (int x = std::max(min_x, tile.splat_min.x); x < std::min(max_x, tile.splat_max.x);
+            x++) {
+          AddPixel(tile_pixels[(y - tile.splat_min.y) * tile_width + (x - tile.splat_min.x)],
+              &buffer[(y - min_y) * (max_x - min_x) + (x - min_x)]);
+        }
+      }
+      if (--pending_tiles[tile_index] == 0) {
+        ok = FinishTile(tile_x, tile_y) && ok;
+      }
+    }
+  }
+  return ok;
+}
+
+uint FilmTileStream::NumBufferedTiles() const {
+  return num_buffered_tiles;
+}
+
+bool FilmTileStream::FinishTile(uint tile_x, uint tile_y) {
+  std::vector<Pixel> &buffer = buffers[tile_y * writer->NumTilesX() + tile_x];
+  rgb.resize(buffer.size() * 3);
+  for (size_t i = 0; i < buffer.size(); i++) {
+    const Pixel &pixel = buffer[i];
+    float inverse_weight = pixel.weight_sum > 0.f ? 1.f / pixel.weight_sum : 0.f;
+    rgb[i * 3] = pixel.r * inverse_weight;
+    rgb[i * 3 + 1] = pixel.g * inverse_weight;
+    rgb[i * 3 + 2] = pixel.b * inverse_weight;
+  }
+  // Swap with an empty vector, since clear() keeps the capacity.
+  std::vector<Pixel>().swap(buffer);
+  num_buffered_tiles--;
+  return writer->WriteTile(tile_x, tile_y, rgb.data());
+}
+
+}
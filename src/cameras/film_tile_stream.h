@@ -0,0 +1,60 @@
+// This header defines the FilmTileStream, which assembles finished FilmTiles into the final image
+// and streams it to a tiled image file without ever holding the whole film. The image is divided
+// into the writer's tiles, each of which is only accumulated while some of the FilmTiles that
+// splat onto it are still outstanding. Once the last of them has been added, the tile is written
+// and its memory is released, so the memory used is proportional to the frontier of the render
+// rather than to the size of the image.
+//
+// Tiles are added in the order given, and pixels are summed in that order just like
+// Film::MergeFilmTile(), so adding tiles in the same order as a Film merges them writes exactly
+// the pixels Film::WriteImage() would. Only color is streamed; the film's extra channels are not.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CAMERAS_FILM_TILE_STREAM_H
+#define LIANG_CAMERAS_FILM_TILE_STREAM_H
+
+#include "cameras/film.h"
+#include "core/liang.h"
+#include "images/tiled_image_writer.h"
+
+namespace liang {
+
+class FilmTileStream {
+  public:
+    // The size of the square tiles the film is rendered in. Only tiles of this size, aligned to
+    // it, may be added.
+    const uint render_tile_size;
+
+    // FilmTileStream constructor that takes the film the FilmTiles come from, the size of the
+    // square tiles the film is rendered in, and the writer to stream the image to, which must
+    // match the film's dimensions. Every render tile in the film must be added exactly once.
+    FilmTileStream(const Film &film, uint render_tile_size, TiledImageWriter *writer);
+
+    // Adds a finished FilmTile, writing and releasing every output tile it completes. Returns false
+    // if a write failed.
+    bool AddTile(const FilmTile &tile);
+
+    // Returns the number of output tiles currently being accumulated.
+    uint NumBufferedTiles() const;
+
+  private:
+    // The writer the image is streamed to.
+    TiledImageWriter *writer;
+    // The number of FilmTiles still to be added that splat onto each output tile, in scanline
+    // order.
+    std::vector<uint> pending_tiles;
+    // The accumulated pixels of each output tile, which are only allocated while it is pending.
+    std::vector<std::vector<Pixel>> buffers;
+    // The number of output tiles currently being accumulated.
+    uint num_buffered_tiles;
+    // Scratch space for the RGB values of the tile being written.
+    std::vector<float> rgb;
+
+    // Writes an output tile whose FilmTiles have all been added and releases its pixels.
+    bool FinishTile(uint tile_x, uint tile_y);
+};
+
+}
+
+#endif  // LIANG_CAMERAS_FILM_TILE_STREAM_H
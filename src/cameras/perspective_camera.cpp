@@ -1,6 +1,10 @@
 #include "cameras/camera.h"
 #include "cameras/perspective_camera.h"
 
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+
 namespace liang {
 
 PerspectiveCamera::PerspectiveCamera(Transform world_to_camera, std::shared_ptr<Film> film,
@@ -12,13 +16,121 @@ PerspectiveCamera::PerspectiveCamera(Transform world_to_camera, std::shared_ptr<
   Transform ndc_to_raster = ScaleTransform((float)film->width, (float)film->height, 1.f);
   screen_to_raster = ndc_to_raster * translated_to_ndc * screen_to_translated;
   raster_to_camera = camera_to_screen.Inverse() * screen_to_raster.Inverse();
+  camera_to_raster = screen_to_raster * camera_to_screen;
+  // Raster points at a depth of 0 all land on the near plane, where the perspective divide is the
+  // same for every point, so the mapping is linear. The deltas are measured across the whole film
+  // to keep their rounding error small.
+  Point3f camera_origin = Point3f(0.f, 0.f, 0.f);
+  camera_base = raster_to_camera(Point3f(0.f, 0.f, 0.f)) - camera_origin;
+  camera_dx = (raster_to_camera(Point3f((float)film->width, 0.f, 0.f)) - camera_origin -
+      camera_base) / (float)film->width;
+  camera_dy = (raster_to_camera(Point3f(0.f, (float)film->height, 0.f)) - camera_origin -
+      camera_base) / (float)film->height;
+  world_origin = camera_to_world(camera_origin);
+  world_base = camera_to_world(camera_base);
+  world_dx = camera_to_world(camera_dx);
+  world_dy = camera_to_world(camera_dy);
 }
 
 float PerspectiveCamera::GenerateRay(const Point2f &film_location, Ray3f *ray) const {
-  Point3f film_posititon = raster_to_camera(Point3f(film_location.x, film_location.y, 0.f));
-  *ray = liang::Ray3f(Point3f(0.f, 0.f, 0.f), Normalize(Vector3f(film_posititon.x,
-      film_posititon.y, film_posititon.z)));
-  *ray = (world_to_camera.Inverse())(*ray);
+  *ray = Ray3f(world_origin, Direction(film_location.x, film_location.y));
+  return 1.f;
+}
+
+float PerspectiveCamera::GenerateRayDifferential(const Point2f &film_location,
+    RayDifferential *ray) const {
+  *ray = RayDifferential(world_origin, Direction(film_location.x, film_location.y));
+  ray->rx_origin = world_origin;
+  ray->rx_direction = Direction(film_location.x + 1.f, film_location.y);
+  ray->ry_origin = world_origin;
+  ray->ry_direction = Direction(film_location.x, film_location.y + 1.f);
+  ray->has_differentials = true;
   return 1.f;
+}
+
+bool PerspectiveCamera::ProjectToRaster(const Point3f &point, Point2f *film_location) const {
+  return ProjectCameraPoint(world_to_camera(point), film_location);
+}
+
+bool PerspectiveCamera::ProjectDirectionToRaster(const Vector3f &direction,
+    Point2f *film_location) const {
+  // A direction lands where the point one unit along it from the camera does.
+  Vector3f camera_direction = world_to_camera(direction);
+  return ProjectCameraPoint(Point3f(camera_direction.x, camera_direction.y, camera_direction.z),
+      film_location);
+}
+
+const Transform &PerspectiveCamera::GetCameraToRaster() const {
+  return camera_to_raster;
+}
+
+bool PerspectiveCamera::ProjectCameraPoint(const Point3f &point, Point2f *film_location) const {
+  if (point.z < NEAR_PLANE) {
+    return false;
   }
+  Point3f raster = camera_to_raster(point);
+  *film_location = Point2f(raster.x, raster.y);
+  return raster.x >= 0.f && raster.x < (float)film->width && raster.y >= 0.f &&
+      raster.y < (float)film->height;
+}
+
+// The direction through a film location is normalized in camera space before it is transformed to
+// world space, so both directions are built from the same film location and the world direction is
+// scaled by the inverse length of the camera direction. The operations are ordered exactly as in
+// GenerateRays() so that the two agree bit for bit.
+Vector3f PerspectiveCamera::Direction(float x, float y) const {
+  float camera_x = camera_base.x + x * camera_dx.x + y * camera_dy.x;
+  float camera_y = camera_base.y + x * camera_dx.y + y * camera_dy.y;
+  float camera_z = camera_base.z + x * camera_dx.z + y * camera_dy.z;
+  float inverse_length = 1.f / std::sqrt(camera_x * camera_x + camera_y * camera_y +
+      camera_z * camera_z);
+  return Vector3f(
+      (world_base.x + x * world_dx.x + y * world_dy.x) * inverse_length,
+      (world_base.y + x * world_dx.y + y * world_dy.y) * inverse_length,
+      (world_base.z + x * world_dx.z + y * world_dy.z) * inverse_length);
+}
+
+#ifdef __SSE2__
+// Returns base + x * dx + y * dy for four film locations at once.
+static inline __m128 Interpolate4(float base, float dx, float dy, __m128 x, __m128 y) {
+  return _mm_add_ps(_mm_add_ps(_mm_set1_ps(base), _mm_mul_ps(x, _mm_set1_ps(dx))),
+      _mm_mul_ps(y, _mm_set1_ps(dy)));
+}
+#endif
+
+void PerspectiveCamera::GenerateRays(const Point2f *film_locations, uint count, Ray3f *rays,
+    float *weights) const {
+  uint i = 0;
+#ifdef __SSE2__
+  for (; i + 4 <= count; i += 4) {
+    const Point2f *locations = film_locations + i;
+    __m128 x = _mm_setr_ps(locations[0].x, locations[1].x, locations[2].x, locations[3].x);
+    __m128 y = _mm_setr_ps(locations[0].y, locations[1].y, locations[2].y, locations[3].y);
+    __m128 camera_x = Interpolate4(camera_base.x, camera_dx.x, camera_dy.x, x, y);
+    __m128 camera_y = Interpolate4(camera_base.y, camera_dx.y, camera_dy.y, x, y);
+    __m128 camera_z = Interpolate4(camera_base.z, camera_dx.z, camera_dy.z, x, y);
+    __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(camera_x, camera_x),
+        _mm_mul_ps(camera_y, camera_y)), _mm_mul_ps(camera_z, camera_z));
+    // A true division rather than _mm_rsqrt_ps(), whose approximation would not match
+    // GenerateRay().
+    __m128 inverse_length = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(length_squared));
+    float direction[3][4];
+    _mm_storeu_ps(direction[0], _mm_mul_ps(
+        Interpolate4(world_base.x, world_dx.x, world_dy.x, x, y), inverse_length));
+    _mm_storeu_ps(direction[1], _mm_mul_ps(
+        Interpolate4(world_base.y, world_dx.y, world_dy.y, x, y), inverse_length));
+    _mm_storeu_ps(direction[2], _mm_mul_ps(
+        Interpolate4(world_base.z, world_dx.z, world_dy.z, x, y), inverse_length));
+    for (uint lane = 0; lane < 4; lane++) {
+      rays[i + lane] = Ray3f(world_origin, Vector3f(direction[0][lane], direction[1][lane],
+          direction[2][lane]));
+      weights[i + lane] = 1.f;
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    weights[i] = GenerateRay(film_locations[i], &rays[i]);
+  }
+}
+
 }
@@ -1,6 +1,12 @@
 // This header defines the PerspectiveCamera, an ideal and non-photorealistic Camera implementation
 // based on a Perspective transform.
 //
+// Every ray starts at the camera's position and passes through the near plane, where raster space
+// maps linearly onto camera space. So rather than pushing every film location through the full
+// raster to world chain of transforms, the camera precomputes where the raster origin lands and how
+// far a step of one pixel moves in camera and world space. A ray is then a handful of multiply-adds
+// and a normalization, which GenerateRays() does four rays at a time with SSE.
+//
 // Author: brian@brkho.com
 
 #ifndef LIANG_CAMERAS_PERSPECTIVE_CAMERA_H
@@ -30,6 +36,25 @@ class PerspectiveCamera : public Camera {
     // how much we should weight the generated ray.
     float GenerateRay(const Point2f &film_location, Ray3f *ray) const;
 
+    // Generates a ray given a point on the film along with its differentials. The offset rays share
+    // the main ray's origin and their directions step by the cached per-pixel deltas.
+    float GenerateRayDifferential(const Point2f &film_location, RayDifferential *ray) const;
+
+    // Generates a ray for each of count points on the film. The rays are bit identical to the ones
+    // GenerateRay() returns.
+    void GenerateRays(const Point2f *film_locations, uint count, Ray3f *rays,
+        float *weights) const;
+
+    // Projects a world space point in front of the near plane onto the film.
+    bool ProjectToRaster(const Point3f &point, Point2f *film_location) const;
+
+    // Projects a world space direction onto the film.
+    bool ProjectDirectionToRaster(const Vector3f &direction, Point2f *film_location) const;
+
+    // Returns the transform from camera space to raster space. Points in front of the camera land
+    // on the film location whose ray passes through them.
+    const Transform &GetCameraToRaster() const;
+
   private:
     // Transform from camera space to screen space.
     Transform camera_to_screen;
@@ -39,6 +64,24 @@ class PerspectiveCamera : public Camera {
 
     // Transforms from raster space to camera space.
     Transform raster_to_camera;
+
+    // Transform from camera space to raster space.
+    Transform camera_to_raster;
+
+    // The position of the camera in world space, where every ray starts.
+    Point3f world_origin;
+    // The point on the near plane at the raster origin, as a vector from the camera in camera
+    // space, and how far it moves per pixel along x and y.
+    Vector3f camera_base, camera_dx, camera_dy;
+    // The same vectors in world space.
+    Vector3f world_base, world_dx, world_dy;
+
+    // Returns the normalized world space direction of the ray through the given film location.
+    Vector3f Direction(float x, float y) const;
+
+    // Projects a camera space point onto the film. Returns false if it is behind the near plane or
+    // lands outside the film.
+    bool ProjectCameraPoint(const Point3f &point, Point2f *film_location) const;
 };
 
 }
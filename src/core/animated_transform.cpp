@@ -0,0 +1,184 @@
+#include "core/animated_transform.h"
+
+namespace liang {
+
+// The number of steps LinearBounds() samples the motion of a box in.
+static const uint NUM_BOUNDS_STEPS = 64;
+
+// Decomposes the top three rows of an affine matrix into a translation, a rotation, and a 3x3
+// scale that reproduce it when applied in the reverse order. The rotation is found by polar
+// decomposition, averaging the matrix with its inverse transpose until it stops changing, and the
+// scale is whatever remains.
+static void Decompose(const float matrix[12], Vector3f *translation, Quaternion *rotation,
+    float scale[9]) {
+  *translation = Vector3f(matrix[3], matrix[7], matrix[11]);
+  float values[16] = {matrix[0], matrix[1], matrix[2], 0.f, matrix[4], matrix[5], matrix[6], 0.f,
+      matrix[8], matrix[9], matrix[10], 0.f, 0.f, 0.f, 0.f, 1.f};
+  Matrix4x4 linear(values);
+  Matrix4x4 r = linear;
+  for (uint iteration = 0; iteration < 100; iteration++) {
+    Matrix4x4 r_inverse_transpose = r.Inverse().Transpose();
+    float norm = 0.f;
+    for (uint i = 0; i < 3; i++) {
+      float row_norm = 0.f;
+      for (uint j = 0; j < 3; j++) {
+        float next = 0.5f * (r.Get(i, j) + r_inverse_transpose.Get(i, j));
+        row_norm += std::abs(next - r.Get(i, j));
+        r.Set(i, j, next);
+      }
+      norm = std::max(norm, row_norm);
+    }
+    if (norm <= 0.0001f) {
+      break;
+    }
+  }
+  *rotation = Quaternion(r);
+  Matrix4x4 remainder = r.Inverse() * linear;
+  for (uint i = 0; i < 3; i++) {
+    for (uint j = 0; j < 3; j++) {
+      scale[i * 3 + j] = remainder.Get(i, j);
+    }
+  }
+}
+
+// Inverts a 3x3 matrix in row-major order with its cofactors.
+static void Invert3x3(const float m[9], float inverse[9]) {
+  float cofactors[9] = {
+      m[4] * m[8] - m[5] * m[7], m[5] * m[6] - m[3] * m[8], m[3] * m[7] - m[4] * m[6],
+      m[2] * m[7] - m[1] * m[8], m[0] * m[8] - m[2] * m[6], m[1] * m[6] - m[0] * m[7],
+      m[1] * m[5] - m[2] * m[4], m[2] * m[3] - m[0] * m[5], m[0] * m[4] - m[1] * m[3]};
+  float det = m[0] * cofactors[0] + m[1] * cofactors[1] + m[2] * cofactors[2];
+  assert(det != 0.f);
+  float inverse_det = 1.f / det;
+  // The inverse is the transpose of the cofactors over the determinant.
+  for (uint i = 0; i < 3; i++) {
+    for (uint j = 0; j < 3; j++) {
+      inverse[i * 3 + j] = cofactors[j * 3 + i] * inverse_det;
+    }
+  }
+}
+
+AnimatedTransform::AnimatedTransform(const AffineTransform &start_transform, float start_time,
+    const AffineTransform &end_transform, float end_time) : start_time{start_time},
+    end_time{end_time}, start_transform{start_transform}, end_transform{end_transform},
+    animated{!(start_transform == end_transform)} {
+  assert(start_time <= end_time);
+  assert(!start_transform.SwapsHandedness() && !end_transform.SwapsHandedness());
+  const AffineTransform *keyframes[2] = {&start_transform, &end_transform};
+  for (uint i = 0; i < 2; i++) {
+    Decompose(keyframes[i]->matrix, &translations[i], &rotations[i], scales[i]);
+  }
+}
+
+bool AnimatedTransform::IsAnimated() const {
+  return animated;
+}
+
+// The transform is T * R * S, and its inverse is S^-1 * R^T * T^-1. Only the scale needs a real
+// inversion, and it is just 3x3.
+AffineTransform AnimatedTransform::Interpolate(float time) const {
+  if (!animated || time <= start_time) {
+    return start_transform;
+  }
+  if (time >= end_time) {
+    return end_transform;
+  }
+  float t = (time - start_time) / (end_time - start_time);
+  Vector3f translation = translations[0] * (1.f - t) + translations[1] * t;
+  AffineTransform rotation = Slerp(rotations[0], rotations[1], t).ToTransform();
+  const float *r = rotation.matrix;
+  float scale[9], scale_inverse[9];
+  for (uint i = 0; i < 9; i++) {
+    scale[i] = scales[0][i] * (1.f - t) + scales[1][i] * t;
+  }
+  Invert3x3(scale, scale_inverse);
+  AffineTransform interpolated;
+  for (uint i = 0; i < 3; i++) {
+    for (uint j = 0; j < 3; j++) {
+      interpolated.matrix[i * 4 + j] = r[i * 4] * scale[j] + r[i * 4 + 1] * scale[3 + j] +
+          r[i * 4 + 2] * scale[6 + j];
+      interpolated.matrix_inverse[i * 4 + j] = scale_inverse[i * 3] * r[j * 4] +
+          scale_inverse[i * 3 + 1] * r[j * 4 + 1] + scale_inverse[i * 3 + 2] * r[j * 4 + 2];
+    }
+    const float *inverse_row = interpolated.matrix_inverse + i * 4;
+    interpolated.matrix[i * 4 + 3] = translation[i];
+    interpolated.matrix_inverse[i * 4 + 3] = -(inverse_row[0] * translation.x +
+        inverse_row[1] * translation.y + inverse_row[2] * translation.z);
+  }
+  return interpolated;
+}
+
+Point3f AnimatedTransform::operator()(float time, const Point3f &p) const {
+  return animated ? Interpolate(time)(p) : start_transform(p);
+}
+
+Ray3f AnimatedTransform::operator()(const Ray3f &r) const {
+  return animated ? Interpolate(r.time)(r) : start_transform(r);
+}
+
+RayDifferential AnimatedTransform::operator()(const RayDifferential &r) const {
+  return animated ? Interpolate(r.time)(r) : start_transform(r);
+}
+
+// The bounds at every sample must lie within the linear bounds, which then also contain the
+// straight line motion between samples. The true motion only strays from those lines by a small
+// fraction of the distance a corner moves in a step, so padding by half that distance covers it.
+void AnimatedTransform::LinearBounds(const AABB3f &box, float time_0, float time_1,
+    AABB3f *bounds_0, AABB3f *bounds_1) const {
+  assert(time_0 <= time_1);
+  // Without a change in rotation, every point moves in a straight line between the keyframes, so
+  // the bounds at the two ends already contain the motion.
+  bool rotates = rotations[0].v.x != rotations[1].v.x || rotations[0].v.y != rotations[1].v.y ||
+      rotations[0].v.z != rotations[1].v.z || rotations[0].w != rotations[1].w;
+  if (!rotates && time_0 >= start_time && time_1 <= end_time) {
+    *bounds_0 = Interpolate(time_0)(box);
+    *bounds_1 = Interpolate(time_1)(box);
+    return;
+  }
+  Point3f box_corners[8];
+  for (uint i = 0; i < 8; i++) {
+    box_corners[i] = box.Corner(i);
+  }
+  std::vector<AABB3f> samples;
+  samples.reserve(NUM_BOUNDS_STEPS + 1);
+  Point3f previous_corners[8], corners[8];
+  float max_step = 0.f;
+  for (uint step = 0; step <= NUM_BOUNDS_STEPS; step++) {
+    float s = (float)step / NUM_BOUNDS_STEPS;
+    AffineTransform transform = Interpolate(time_0 * (1.f - s) + time_1 * s);
+    for (uint i = 0; i < 8; i++) {
+      corners[i] = transform(box_corners[i]);
+    }
+    AABB3f sample(corners[0]);
+    for (uint i = 0; i < 8; i++) {
+      sample = Union(sample, AABB3f(corners[i]));
+      if (step > 0) {
+        max_step = std::max(max_step, Distance(corners[i], previous_corners[i]));
+      }
+      previous_corners[i] = corners[i];
+    }
+    samples.push_back(sample);
+  }
+  // Widen the boxes at the two ends by the furthest any sample pokes out of their interpolation.
+  const AABB3f &first = samples.front();
+  const AABB3f &last = samples.back();
+  Vector3f min_deficit, max_deficit;
+  for (uint step = 0; step <= NUM_BOUNDS_STEPS; step++) {
+    float s = (float)step / NUM_BOUNDS_STEPS;
+    for (int axis = 0; axis < 3; axis++) {
+      float min = first.min_point[axis] * (1.f - s) + last.min_point[axis] * s;
+      float max = first.max_point[axis] * (1.f - s) + last.max_point[axis] * s;
+      min_deficit[axis] = std::max(min_deficit[axis], min - samples[step].min_point[axis]);
+      max_deficit[axis] = std::max(max_deficit[axis], samples[step].max_point[axis] - max);
+    }
+  }
+  Vector3f pad(0.5f * max_step, 0.5f * max_step, 0.5f * max_step);
+  *bounds_0 = first;
+  *bounds_1 = last;
+  for (AABB3f *bounds : {bounds_0, bounds_1}) {
+    bounds->min_point -= min_deficit + pad;
+    bounds->max_point += max_deficit + pad;
+  }
+}
+
+}
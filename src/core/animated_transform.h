@@ -0,0 +1,72 @@
+// This header defines the AnimatedTransform, a transform that moves between two keyframes over
+// time for motion blur. As in pbrt, each keyframe is decomposed into a translation, a rotation,
+// and a scale, which are interpolated separately: the translation and scale linearly, and the
+// rotation spherically. Interpolating the matrices directly would instead shear and shrink
+// anything that rotates.
+//
+// The keyframes are affine, like every other transform that places geometry. The interpolated
+// transform is assembled directly from its parts, and so is its inverse, which undoes them in the
+// reverse order. This keeps interpolating cheap enough to do for every ray.
+//
+// The transform holds still at its first keyframe before the first keyframe's time, and at its
+// last keyframe after the last one's.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_ANIMATED_TRANSFORM_H
+#define LIANG_CORE_ANIMATED_TRANSFORM_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "core/quaternion.h"
+#include "core/transform.h"
+
+namespace liang {
+
+class AnimatedTransform {
+  public:
+    // The times of the two keyframes.
+    const float start_time, end_time;
+
+    // Constructor taking the two keyframes and their times. The keyframes can't swap handedness,
+    // and the end time can't come before the start time.
+    AnimatedTransform(const AffineTransform &start_transform, float start_time,
+        const AffineTransform &end_transform, float end_time);
+
+    // Returns whether the keyframes differ, meaning the transform moves at all.
+    bool IsAnimated() const;
+
+    // Returns the transform at the given time.
+    AffineTransform Interpolate(float time) const;
+
+    // Transforms a point by the transform at the given time.
+    Point3f operator()(float time, const Point3f &p) const;
+
+    // Transforms a ray by the transform at the ray's time.
+    Ray3f operator()(const Ray3f &r) const;
+
+    // Transforms a ray differential by the transform at the ray's time.
+    RayDifferential operator()(const RayDifferential &r) const;
+
+    // Bounds a box as it moves from time_0 to time_1 with two boxes, one at each time, such that
+    // at any time in between the moving box lies inside the linear interpolation of the two. The
+    // motion is sampled along the way, and the boxes are padded by how far it can stray between
+    // samples.
+    void LinearBounds(const AABB3f &box, float time_0, float time_1, AABB3f *bounds_0,
+        AABB3f *bounds_1) const;
+
+  private:
+    // The two keyframes.
+    AffineTransform start_transform, end_transform;
+    // Whether the keyframes differ.
+    bool animated;
+    // The translation, rotation, and scale each keyframe decomposes into. The scales are 3x3
+    // matrices in row-major order.
+    Vector3f translations[2];
+    Quaternion rotations[2];
+    float scales[2][9];
+};
+
+}
+
+#endif  // LIANG_CORE_ANIMATED_TRANSFORM_H
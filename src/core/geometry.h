@@ -508,10 +508,12 @@ class Ray3f {
     Vector3f direction;
     // The maximum value for t recorded.
     mutable float max_t;
+    // The time the ray is cast at, which animated geometry is placed at when intersecting it.
+    float time;
 
-    // Construct a ray given an origin, a direction, and a max t value.
-    Ray3f(Point3f origin, Vector3f direction, float max_t) : origin{origin}, direction{direction},
-        max_t{max_t} {
+    // Construct a ray given an origin, a direction, a max t value, and optionally a time.
+    Ray3f(Point3f origin, Vector3f direction, float max_t, float time = 0.f) : origin{origin},
+        direction{direction}, max_t{max_t}, time{time} {
       assert(max_t >= 0.0);
     }
 
@@ -535,6 +537,48 @@ class Ray3f {
     }
 };
 
+// A RayDifferential is a Ray3f that optionally carries two offset rays, shifted by a pixel along
+// the x and y axes of the film. Where the offset rays land relative to the main ray tells later
+// stages how large a footprint the ray covers, for choosing texture mip levels or geometric LOD.
+class RayDifferential : public Ray3f {
+  public:
+    // Whether the offset rays have been set.
+    bool has_differentials;
+    // The origin and direction of the ray offset along the x axis of the film.
+    Point3f rx_origin;
+    Vector3f rx_direction;
+    // The origin and direction of the ray offset along the y axis of the film.
+    Point3f ry_origin;
+    Vector3f ry_direction;
+
+    // Construct a ray differential without offset rays given an origin, a direction, and a max t
+    // value.
+    RayDifferential(Point3f origin, Vector3f direction, float max_t) :
+        Ray3f(origin, direction, max_t), has_differentials{false} {}
+
+    // Construct a ray differential without offset rays given an origin and a direction,
+    // initializing max t to infinity.
+    RayDifferential(Point3f origin, Vector3f direction) : Ray3f(origin, direction),
+        has_differentials{false} {}
+
+    // Construct a ray differential without offset rays from a ray.
+    RayDifferential(const Ray3f &ray) : Ray3f(ray), has_differentials{false} {}
+
+    // Default constructor for a ray differential without offset rays that initializes the ray as
+    // Ray3f does.
+    RayDifferential() : has_differentials{false} {}
+
+    // Scales the offsets of the offset rays from the main ray. When a pixel takes several samples,
+    // each covers a smaller part of it, so the offsets are usually scaled by the inverse square
+    // root of the number of samples.
+    void ScaleDifferentials(float scale) {
+      rx_origin = origin + (rx_origin - origin) * scale;
+      ry_origin = origin + (ry_origin - origin) * scale;
+      rx_direction = direction + (rx_direction - direction) * scale;
+      ry_direction = direction + (ry_direction - direction) * scale;
+    }
+};
+
 // An axis-aligned bounding box described by two points.
 template <typename T>
 class AABB3 {
@@ -0,0 +1,312 @@
+// This is a header only library defining wide versions of the core geometry classes, which hold
+// one value per lane of a wide float from core/simd.h in structure of arrays form. A Point3fx4
+// holds four points as one Floatx4 of x components, one of y components, and one of z components,
+// so kernels written against it handle four points with the instructions the scalar code would
+// spend on one. Comparisons produce lane masks, and Select() blends two wide values by a mask so
+// kernels can branch per lane without leaving SIMD registers.
+//
+// The operators mirror those of core/geometry.h and compute the same results lane by lane, except
+// that Cross() stays in single precision. There are no validity asserts, since padding lanes are
+// free to hold anything.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_GEOMETRY_WIDE_H
+#define LIANG_CORE_GEOMETRY_WIDE_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "core/simd.h"
+
+namespace liang {
+
+// A Vector3 per lane of the wide float F.
+template <typename F>
+class Vector3x {
+  public:
+    // The components of every lane's vector.
+    F x, y, z;
+
+    // Default constructor initializing every lane to the zero vector.
+    Vector3x() : x{0.f}, y{0.f}, z{0.f} {}
+
+    // Constructor taking the wide components.
+    Vector3x(const F &x, const F &y, const F &z) : x{x}, y{y}, z{z} {}
+
+    // Constructor initializing every lane to the same vector.
+    explicit Vector3x(const Vector3f &vec) : x{vec.x}, y{vec.y}, z{vec.z} {}
+
+    // Constructor gathering F::WIDTH consecutive vectors into the lanes.
+    explicit Vector3x(const Vector3f *vecs) {
+      float xs[F::WIDTH], ys[F::WIDTH], zs[F::WIDTH];
+      for (uint i = 0; i < F::WIDTH; i++) {
+        xs[i] = vecs[i].x;
+        ys[i] = vecs[i].y;
+        zs[i] = vecs[i].z;
+      }
+      x = F::Load(xs);
+      y = F::Load(ys);
+      z = F::Load(zs);
+    }
+
+    // Returns the vector in the given lane.
+    Vector3f Lane(int i) const {
+      return Vector3f(x[i], y[i], z[i]);
+    }
+
+    // Addition operator overload for two Vector3xs.
+    Vector3x<F> operator+(const Vector3x<F> &other) const {
+      return Vector3x<F>(x + other.x, y + other.y, z + other.z);
+    }
+
+    // Subtraction operator overload for two Vector3xs.
+    Vector3x<F> operator-(const Vector3x<F> &other) const {
+      return Vector3x<F>(x - other.x, y - other.y, z - other.z);
+    }
+
+    // Multiplication operator overload for scaling every lane by a wide or scalar float.
+    Vector3x<F> operator*(const F &scalar) const {
+      return Vector3x<F>(x * scalar, y * scalar, z * scalar);
+    }
+
+    // Division operator overload for scaling every lane by the inverse of a wide or scalar float.
+    Vector3x<F> operator/(const F &scalar) const {
+      F inverse = F(1.f) / scalar;
+      return Vector3x<F>(x * inverse, y * inverse, z * inverse);
+    }
+
+    // Negation operator overload.
+    Vector3x<F> operator-() const {
+      return Vector3x<F>(-x, -y, -z);
+    }
+
+    // Returns the squared length of every lane's vector.
+    F LengthSquared() const {
+      return x * x + y * y + z * z;
+    }
+
+    // Returns the length of every lane's vector.
+    F Length() const {
+      return Sqrt(LengthSquared());
+    }
+};
+
+// Returns the dot product of two Vector3xs per lane.
+template <typename F>
+inline F Dot(const Vector3x<F> &vec1, const Vector3x<F> &vec2) {
+  return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
+}
+
+// Returns the cross product of two Vector3xs per lane. Unlike the scalar version, this is computed
+// in single precision.
+template <typename F>
+inline Vector3x<F> Cross(const Vector3x<F> &vec1, const Vector3x<F> &vec2) {
+  return Vector3x<F>((vec1.y * vec2.z) - (vec1.z * vec2.y), (vec1.z * vec2.x) - (vec1.x * vec2.z),
+      (vec1.x * vec2.y) - (vec1.y * vec2.x));
+}
+
+// Returns the component-wise absolute value of a Vector3x.
+template <typename F>
+inline Vector3x<F> Abs(const Vector3x<F> &vec) {
+  return Vector3x<F>(Abs(vec.x), Abs(vec.y), Abs(vec.z));
+}
+
+// Normalizes every lane of a Vector3x so its length is 1.
+template <typename F>
+inline Vector3x<F> Normalize(const Vector3x<F> &vec) {
+  return vec / vec.Length();
+}
+
+// Picks each lane's vector from vec1 where the mask is set and from vec2 where it is not.
+template <typename F>
+inline Vector3x<F> Select(const typename F::Mask &mask, const Vector3x<F> &vec1,
+    const Vector3x<F> &vec2) {
+  return Vector3x<F>(Select(mask, vec1.x, vec2.x), Select(mask, vec1.y, vec2.y),
+      Select(mask, vec1.z, vec2.z));
+}
+
+// A Point3 per lane of the wide float F.
+template <typename F>
+class Point3x {
+  public:
+    // The components of every lane's point.
+    F x, y, z;
+
+    // Default constructor initializing every lane to the origin.
+    Point3x() : x{0.f}, y{0.f}, z{0.f} {}
+
+    // Constructor taking the wide components.
+    Point3x(const F &x, const F &y, const F &z) : x{x}, y{y}, z{z} {}
+
+    // Constructor initializing every lane to the same point.
+    explicit Point3x(const Point3f &point) : x{point.x}, y{point.y}, z{point.z} {}
+
+    // Constructor gathering F::WIDTH consecutive points into the lanes.
+    explicit Point3x(const Point3f *points) {
+      float xs[F::WIDTH], ys[F::WIDTH], zs[F::WIDTH];
+      for (uint i = 0; i < F::WIDTH; i++) {
+        xs[i] = points[i].x;
+        ys[i] = points[i].y;
+        zs[i] = points[i].z;
+      }
+      x = F::Load(xs);
+      y = F::Load(ys);
+      z = F::Load(zs);
+    }
+
+    // Returns the point in the given lane.
+    Point3f Lane(int i) const {
+      return Point3f(x[i], y[i], z[i]);
+    }
+
+    // Addition operator overload to offset every lane's point by a Vector3x.
+    Point3x<F> operator+(const Vector3x<F> &vec) const {
+      return Point3x<F>(x + vec.x, y + vec.y, z + vec.z);
+    }
+
+    // Subtraction operator overload to offset every lane's point by the negation of a Vector3x.
+    Point3x<F> operator-(const Vector3x<F> &vec) const {
+      return Point3x<F>(x - vec.x, y - vec.y, z - vec.z);
+    }
+
+    // Subtraction operator overload to get the Vector3x between two Point3xs.
+    Vector3x<F> operator-(const Point3x<F> &other) const {
+      return Vector3x<F>(x - other.x, y - other.y, z - other.z);
+    }
+};
+
+// Returns the component-wise minimum of two Point3xs.
+template <typename F>
+inline Point3x<F> Min(const Point3x<F> &p1, const Point3x<F> &p2) {
+  return Point3x<F>(Min(p1.x, p2.x), Min(p1.y, p2.y), Min(p1.z, p2.z));
+}
+
+// Returns the component-wise maximum of two Point3xs.
+template <typename F>
+inline Point3x<F> Max(const Point3x<F> &p1, const Point3x<F> &p2) {
+  return Point3x<F>(Max(p1.x, p2.x), Max(p1.y, p2.y), Max(p1.z, p2.z));
+}
+
+// Linearly interpolates between two Point3xs with a separate t per lane (0.0 = p1, 1.0 = p2).
+template <typename F>
+inline Point3x<F> Lerp(const Point3x<F> &p1, const Point3x<F> &p2, const F &t) {
+  F t_inv = F(1.f) - t;
+  return Point3x<F>(p1.x * t_inv + p2.x * t, p1.y * t_inv + p2.y * t, p1.z * t_inv + p2.z * t);
+}
+
+// Picks each lane's point from p1 where the mask is set and from p2 where it is not.
+template <typename F>
+inline Point3x<F> Select(const typename F::Mask &mask, const Point3x<F> &p1,
+    const Point3x<F> &p2) {
+  return Point3x<F>(Select(mask, p1.x, p2.x), Select(mask, p1.y, p2.y), Select(mask, p1.z, p2.z));
+}
+
+// A Normal3 per lane of the wide float F.
+template <typename F>
+class Normal3x : public Vector3x<F> {
+  public:
+    // Default constructor initializing every lane to the zero vector.
+    Normal3x() : Vector3x<F>() {}
+
+    // Constructor taking the wide components.
+    Normal3x(const F &x, const F &y, const F &z) : Vector3x<F>(x, y, z) {}
+
+    // Constructor initializing every lane to the same normal.
+    explicit Normal3x(const Normal3f &normal) : Vector3x<F>(normal) {}
+
+    // Returns the normal in the given lane.
+    Normal3f Lane(int i) const {
+      return Normal3f(this->x[i], this->y[i], this->z[i]);
+    }
+};
+
+// An AABB3 per lane of the wide float F.
+template <typename F>
+class AABB3x {
+  public:
+    // The minimum and maximum points of every lane's box.
+    Point3x<F> min_point, max_point;
+
+    // Default constructor initializing every lane to an empty box, which no ray intersects. This
+    // is what unused lanes should hold.
+    AABB3x() : min_point{F(std::numeric_limits<float>::infinity()),
+        F(std::numeric_limits<float>::infinity()), F(std::numeric_limits<float>::infinity())},
+        max_point{F(-std::numeric_limits<float>::infinity()),
+        F(-std::numeric_limits<float>::infinity()), F(-std::numeric_limits<float>::infinity())} {}
+
+    // Constructor taking the wide minimum and maximum points.
+    AABB3x(const Point3x<F> &min_point, const Point3x<F> &max_point) : min_point{min_point},
+        max_point{max_point} {}
+
+    // Constructor gathering up to F::WIDTH consecutive boxes into the lanes, leaving the rest
+    // empty.
+    AABB3x(const AABB3f *boxes, uint num_boxes) : AABB3x() {
+      assert(num_boxes <= F::WIDTH);
+      float values[6][F::WIDTH];
+      min_point.x.Store(values[0]);
+      min_point.y.Store(values[1]);
+      min_point.z.Store(values[2]);
+      max_point.x.Store(values[3]);
+      max_point.y.Store(values[4]);
+      max_point.z.Store(values[5]);
+      for (uint i = 0; i < num_boxes; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+          values[axis][i] = boxes[i].min_point[axis];
+          values[axis + 3][i] = boxes[i].max_point[axis];
+        }
+      }
+      min_point = Point3x<F>(F::Load(values[0]), F::Load(values[1]), F::Load(values[2]));
+      max_point = Point3x<F>(F::Load(values[3]), F::Load(values[4]), F::Load(values[5]));
+    }
+
+    // Returns the box in the given lane.
+    AABB3f Lane(int i) const {
+      AABB3f box(min_point.Lane(i));
+      box.max_point = max_point.Lane(i);
+      return box;
+    }
+
+    // Returns the mask of lanes whose box is empty.
+    typename F::Mask IsEmpty() const {
+      return (min_point.x > max_point.x) | (min_point.y > max_point.y) |
+          (min_point.z > max_point.z);
+    }
+};
+
+// Intersects a ray with every lane's box using the slab test, given the reciprocal of the ray's
+// direction. Returns the mask of lanes whose box the ray enters between 0 and its max t, and fills
+// in the t at which it enters each of them. A ray starting inside a box enters it at 0.
+template <typename F>
+inline typename F::Mask IntersectBoxes(const AABB3x<F> &boxes, const Ray3f &ray,
+    const Vector3f &inverse_direction, F *t_near) {
+  F near(0.f);
+  F far(ray.max_t);
+  const F *min_components[3] = {&boxes.min_point.x, &boxes.min_point.y, &boxes.min_point.z};
+  const F *max_components[3] = {&boxes.max_point.x, &boxes.max_point.y, &boxes.max_point.z};
+  for (int axis = 0; axis < 3; axis++) {
+    F origin(ray.origin[axis]);
+    F inverse(inverse_direction[axis]);
+    F t0 = (*min_components[axis] - origin) * inverse;
+    F t1 = (*max_components[axis] - origin) * inverse;
+    // A ray parallel to the slab that starts on one of its planes makes a NaN here, so rays
+    // grazing a face may count as either hitting or missing the box.
+    near = Max(near, Min(t0, t1));
+    far = Min(far, Max(t0, t1));
+  }
+  *t_near = near;
+  return (near <= far) & ~boxes.IsEmpty();
+}
+
+// Some type declarations for common usages of the wide geometry classes.
+typedef Vector3x<Floatx4> Vector3fx4;
+typedef Vector3x<Floatx8> Vector3fx8;
+typedef Point3x<Floatx4> Point3fx4;
+typedef Point3x<Floatx8> Point3fx8;
+typedef Normal3x<Floatx4> Normal3fx4;
+typedef Normal3x<Floatx8> Normal3fx8;
+typedef AABB3x<Floatx4> AABB3fx4;
+typedef AABB3x<Floatx8> AABB3fx8;
+
+}
+
+#endif  // LIANG_CORE_GEOMETRY_WIDE_H
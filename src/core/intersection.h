@@ -0,0 +1,63 @@
+// This header defines the Intersection, the record of where a ray first hits the scene. Shapes
+// fill in the geometric information and the primitive that owns the shape tags it with its id.
+// For rays that carry differentials, the intersection also records how far the hit point moves
+// from one pixel to the next, which is the ray's footprint on the surface.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_INTERSECTION_H
+#define LIANG_CORE_INTERSECTION_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+
+namespace liang {
+
+struct Intersection {
+  // The parametric distance along the ray to the hit.
+  float t;
+  // The world space shading normal at the hit, interpolated from the vertex normals.
+  Normal3f normal;
+  // The id of the primitive that was hit.
+  uint primitive_id;
+  // Whether dpdx and dpdy have been computed.
+  bool has_differentials;
+  // How far the hit point moves on the surface for a step of one pixel along the x and y axes of
+  // the film.
+  Vector3f dpdx, dpdy;
+};
+
+// Computes the differentials of an intersection by intersecting the ray's offset rays with the
+// plane tangent to the surface at the hit. The differentials are left unset if the ray has none or
+// an offset ray runs parallel to the plane.
+inline void ComputeDifferentials(const RayDifferential &ray, Intersection *intersection) {
+  intersection->has_differentials = false;
+  if (!ray.has_differentials) {
+    return;
+  }
+  Point3f point = ray(intersection->t);
+  const Normal3f &normal = intersection->normal;
+  float rx_cosine = Dot(normal, ray.rx_direction);
+  float ry_cosine = Dot(normal, ray.ry_direction);
+  if (rx_cosine == 0.f || ry_cosine == 0.f) {
+    return;
+  }
+  float tx = Dot(normal, point - ray.rx_origin) / rx_cosine;
+  float ty = Dot(normal, point - ray.ry_origin) / ry_cosine;
+  intersection->dpdx = ray.rx_origin + ray.rx_direction * tx - point;
+  intersection->dpdy = ray.ry_origin + ray.ry_direction * ty - point;
+  intersection->has_differentials = true;
+}
+
+// Returns the width of the footprint of the ray on the surface, the larger of the distances the
+// hit point moves per pixel, or 0 if the intersection has no differentials.
+inline float FootprintWidth(const Intersection &intersection) {
+  if (!intersection.has_differentials) {
+    return 0.f;
+  }
+  return std::max(intersection.dpdx.Length(), intersection.dpdy.Length());
+}
+
+}
+
+#endif  // LIANG_CORE_INTERSECTION_H
@@ -9,7 +9,10 @@
 #include <algorithm>
 #include <assert.h>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -0,0 +1,59 @@
+#include "core/quaternion.h"
+
+namespace liang {
+
+// Picks the largest of w, x, y, and z to divide by, which keeps the conversion stable for any
+// rotation.
+Quaternion::Quaternion(const Matrix4x4 &m) {
+  float trace = m.Get(0, 0) + m.Get(1, 1) + m.Get(2, 2);
+  if (trace > 0.f) {
+    float s = 2.f * std::sqrt(trace + 1.f);
+    w = 0.25f * s;
+    v = Vector3f(m.Get(2, 1) - m.Get(1, 2), m.Get(0, 2) - m.Get(2, 0),
+        m.Get(1, 0) - m.Get(0, 1)) / s;
+  } else if (m.Get(0, 0) > m.Get(1, 1) && m.Get(0, 0) > m.Get(2, 2)) {
+    float s = 2.f * std::sqrt(1.f + m.Get(0, 0) - m.Get(1, 1) - m.Get(2, 2));
+    w = (m.Get(2, 1) - m.Get(1, 2)) / s;
+    v = Vector3f(0.25f * s, (m.Get(0, 1) + m.Get(1, 0)) / s, (m.Get(0, 2) + m.Get(2, 0)) / s);
+  } else if (m.Get(1, 1) > m.Get(2, 2)) {
+    float s = 2.f * std::sqrt(1.f + m.Get(1, 1) - m.Get(0, 0) - m.Get(2, 2));
+    w = (m.Get(0, 2) - m.Get(2, 0)) / s;
+    v = Vector3f((m.Get(0, 1) + m.Get(1, 0)) / s, 0.25f * s, (m.Get(1, 2) + m.Get(2, 1)) / s);
+  } else {
+    float s = 2.f * std::sqrt(1.f + m.Get(2, 2) - m.Get(0, 0) - m.Get(1, 1));
+    w = (m.Get(1, 0) - m.Get(0, 1)) / s;
+    v = Vector3f((m.Get(0, 2) + m.Get(2, 0)) / s, (m.Get(1, 2) + m.Get(2, 1)) / s, 0.25f * s);
+  }
+}
+
+AffineTransform Quaternion::ToTransform() const {
+  float xx = v.x * v.x, yy = v.y * v.y, zz = v.z * v.z;
+  float xy = v.x * v.y, xz = v.x * v.z, yz = v.y * v.z;
+  float wx = v.x * w, wy = v.y * w, wz = v.z * w;
+  float values[16] = {
+      1.f - 2.f * (yy + zz), 2.f * (xy - wz), 2.f * (xz + wy), 0.f,
+      2.f * (xy + wz), 1.f - 2.f * (xx + zz), 2.f * (yz - wx), 0.f,
+      2.f * (xz - wy), 2.f * (yz + wx), 1.f - 2.f * (xx + yy), 0.f,
+      0.f, 0.f, 0.f, 1.f};
+  Matrix4x4 m(values);
+  // The inverse of a rotation is its transpose.
+  return AffineTransform(m, m.Transpose());
+}
+
+Quaternion Slerp(const Quaternion &q1, const Quaternion &q2, float t) {
+  assert(t >= 0.f && t <= 1.f);
+  // q and -q are the same rotation, so flip q2 onto q1's side to take the shorter arc.
+  float cos_theta = Dot(q1, q2);
+  Quaternion target = cos_theta < 0.f ? -q2 : q2;
+  cos_theta = std::abs(cos_theta);
+  // Nearly parallel quaternions would divide by almost 0 below, so interpolate them linearly.
+  if (cos_theta > 0.9995f) {
+    return Normalize(q1 * (1.f - t) + target * t);
+  }
+  float theta = std::acos(std::min(cos_theta, 1.f));
+  float theta_t = theta * t;
+  Quaternion perpendicular = Normalize(target - q1 * cos_theta);
+  return q1 * std::cos(theta_t) + perpendicular * std::sin(theta_t);
+}
+
+}
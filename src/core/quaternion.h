@@ -0,0 +1,82 @@
+// This header defines the Quaternion class, which represents rotations in a form that can be
+// smoothly interpolated. Like the geometry files, this is heavily based off the class in pbrt.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_QUATERNION_H
+#define LIANG_CORE_QUATERNION_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "core/transform.h"
+
+namespace liang {
+
+class Quaternion {
+  public:
+    // The imaginary and real parts of the quaternion.
+    Vector3f v;
+    float w;
+
+    // Default constructor initializing the quaternion to the identity rotation.
+    Quaternion() : v{0.f, 0.f, 0.f}, w{1.f} {}
+
+    // Constructor initializing the quaternion with the provided imaginary and real parts.
+    Quaternion(const Vector3f &v, float w) : v{v}, w{w} {}
+
+    // Constructor initializing the quaternion to the rotation in the upper 3x3 of the matrix,
+    // which must be orthonormal.
+    explicit Quaternion(const Matrix4x4 &m);
+
+    // Addition operator overload for two quaternions.
+    Quaternion operator+(const Quaternion &that) const {
+      return Quaternion(v + that.v, w + that.w);
+    }
+
+    // Subtraction operator overload for two quaternions.
+    Quaternion operator-(const Quaternion &that) const {
+      return Quaternion(v - that.v, w - that.w);
+    }
+
+    // Multiplication operator overload for scaling a quaternion.
+    Quaternion operator*(float scalar) const {
+      return Quaternion(v * scalar, w * scalar);
+    }
+
+    // Division operator overload for scaling a quaternion by the inverse of a value.
+    Quaternion operator/(float scalar) const {
+      assert(scalar != 0.f);
+      return Quaternion(v / scalar, w / scalar);
+    }
+
+    // Negation operator overload.
+    Quaternion operator-() const {
+      return Quaternion(v * -1.f, -w);
+    }
+
+    // Returns the transform that applies the rotation the normalized quaternion represents.
+    AffineTransform ToTransform() const;
+
+    // Pretty prints a Quaternion.
+    std::string ToString() const {
+      return "(v: " + v.ToString() + ", w: " + std::to_string(w) + ")";
+    }
+};
+
+// Returns the dot product of two quaternions.
+inline float Dot(const Quaternion &q1, const Quaternion &q2) {
+  return Dot(q1.v, q2.v) + q1.w * q2.w;
+}
+
+// Normalizes a quaternion so it has unit length.
+inline Quaternion Normalize(const Quaternion &q) {
+  return q / std::sqrt(Dot(q, q));
+}
+
+// Spherically interpolates between two normalized quaternions (0.0 = q1, 1.0 = q2), which rotates
+// at a constant rate along the shortest arc between them.
+Quaternion Slerp(const Quaternion &q1, const Quaternion &q2, float t);
+
+}
+
+#endif  // LIANG_CORE_QUATERNION_H
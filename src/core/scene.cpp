@@ -12,4 +12,16 @@ bool Scene::Intersect(Ray3f ray) const {
   return primitive->Intersect(ray);
 }
 
+bool Scene::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  return primitive->Intersect(ray, intersection);
+}
+
+bool Scene::Intersect(const RayDifferential &ray, Intersection *intersection) const {
+  if (!primitive->Intersect(ray, intersection)) {
+    return false;
+  }
+  ComputeDifferentials(ray, intersection);
+  return true;
+}
+
 }
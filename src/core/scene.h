@@ -24,6 +24,14 @@ class Scene {
     // Intersects a ray with the scene and return true if there is an intersection.
     bool Intersect(Ray3f ray) const;
 
+    // Intersects a ray with the scene and fills in the closest intersection, shortening the ray to
+    // it. Returns false if the ray hits nothing.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
+    // Intersects a ray differential with the scene like the above, and also computes the
+    // differentials of the closest intersection.
+    bool Intersect(const RayDifferential &ray, Intersection *intersection) const;
+
   private:
     // TODO(brkho): Add some lights.
     // The primitives the AggregatePrimitive contains.
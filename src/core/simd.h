@@ -0,0 +1,761 @@
+// This is a header only library defining wide floats and lane masks, the building blocks of the
+// wide geometry types in core/geometry_wide.h. A Floatx4 holds four floats and a Floatx8 eight,
+// and arithmetic on them works on every lane at once. Comparisons return masks holding a bool per
+// lane, which Select() uses to blend two wide floats without branching.
+//
+// Floatx4 is backed by SSE2 and Floatx8 by AVX when the build targets them. x86-64 builds always
+// have SSE2, but AVX needs configuring with -DLIANG_NATIVE_ARCH=ON, which adds -march=native, on
+// a machine that has it. Otherwise Floatx8 is made of two Floatx4 halves, and Floatx4 falls back
+// to plain arrays on builds without SSE2. The kernels written with them give the same
+// results either way. Arithmetic follows IEEE rules lane by lane, so each lane computes exactly
+// what the same scalar code would.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_SIMD_H
+#define LIANG_CORE_SIMD_H
+
+#include "core/liang.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace liang {
+
+#ifdef __SSE2__
+// A bool for each of four lanes.
+class Maskx4 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 4;
+
+    // The lanes of the mask, each of which has either every bit set or none.
+    __m128 bits;
+
+    // Default constructor initializing every lane to false.
+    Maskx4() : bits{_mm_setzero_ps()} {}
+
+    // Constructor initializing every lane to the same value.
+    explicit Maskx4(bool value) : bits{_mm_castsi128_ps(_mm_set1_epi32(value ? -1 : 0))} {}
+
+    // Constructor initializing each lane to the provided value.
+    Maskx4(bool a, bool b, bool c, bool d) : bits{_mm_castsi128_ps(_mm_setr_epi32(-(int)a,
+        -(int)b, -(int)c, -(int)d))} {}
+
+    // Constructor wrapping the result of an SSE comparison.
+    explicit Maskx4(__m128 bits) : bits{bits} {}
+
+    // Accessing a lane via integer index for reading.
+    bool operator[](int i) const {
+      assert(i >= 0 && i < 4);
+      return (Bits() >> i) & 1;
+    }
+
+    // Returns the lanes as the low four bits of an integer, with lane 0 as the lowest bit.
+    int Bits() const {
+      return _mm_movemask_ps(bits);
+    }
+};
+
+// Lane-wise logical and.
+inline Maskx4 operator&(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(_mm_and_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical or.
+inline Maskx4 operator|(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(_mm_or_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical exclusive or.
+inline Maskx4 operator^(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(_mm_xor_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical not.
+inline Maskx4 operator~(const Maskx4 &mask) {
+  return Maskx4(_mm_xor_ps(mask.bits, Maskx4(true).bits));
+}
+
+// Four floats operated on together.
+class Floatx4 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 4;
+    // The type of the masks comparisons return.
+    typedef Maskx4 Mask;
+
+    // The values of the lanes.
+    __m128 v;
+
+    // Default constructor initializing every lane to 0.
+    Floatx4() : v{_mm_setzero_ps()} {}
+
+    // Constructor initializing every lane to the same value. This is implicit so scalars mix
+    // freely with wide floats in expressions.
+    Floatx4(float value) : v{_mm_set1_ps(value)} {}
+
+    // Constructor initializing each lane to the provided value.
+    Floatx4(float a, float b, float c, float d) : v{_mm_setr_ps(a, b, c, d)} {}
+
+    // Constructor wrapping an SSE register.
+    explicit Floatx4(__m128 v) : v{v} {}
+
+    // Loads the lanes from four consecutive floats, which need not be aligned.
+    static Floatx4 Load(const float *values) {
+      return Floatx4(_mm_loadu_ps(values));
+    }
+
+    // Stores the lanes to four consecutive floats, which need not be aligned.
+    void Store(float *values) const {
+      _mm_storeu_ps(values, v);
+    }
+
+    // Accessing a lane via integer index for reading.
+    float operator[](int i) const {
+      assert(i >= 0 && i < 4);
+      float values[4];
+      Store(values);
+      return values[i];
+    }
+};
+
+// Lane-wise addition.
+inline Floatx4 operator+(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_add_ps(a.v, b.v));
+}
+
+// Lane-wise subtraction.
+inline Floatx4 operator-(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_sub_ps(a.v, b.v));
+}
+
+// Lane-wise multiplication.
+inline Floatx4 operator*(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_mul_ps(a.v, b.v));
+}
+
+// Lane-wise division.
+inline Floatx4 operator/(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_div_ps(a.v, b.v));
+}
+
+// Lane-wise negation, which only flips the sign bits.
+inline Floatx4 operator-(const Floatx4 &a) {
+  return Floatx4(_mm_xor_ps(a.v, _mm_set1_ps(-0.f)));
+}
+
+// Lane-wise less than comparison.
+inline Maskx4 operator<(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmplt_ps(a.v, b.v));
+}
+
+// Lane-wise less than or equal comparison.
+inline Maskx4 operator<=(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmple_ps(a.v, b.v));
+}
+
+// Lane-wise greater than comparison.
+inline Maskx4 operator>(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmpgt_ps(a.v, b.v));
+}
+
+// Lane-wise greater than or equal comparison.
+inline Maskx4 operator>=(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmpge_ps(a.v, b.v));
+}
+
+// Lane-wise equality comparison.
+inline Maskx4 operator==(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmpeq_ps(a.v, b.v));
+}
+
+// Lane-wise inequality comparison.
+inline Maskx4 operator!=(const Floatx4 &a, const Floatx4 &b) {
+  return Maskx4(_mm_cmpneq_ps(a.v, b.v));
+}
+
+// Lane-wise minimum. Like std::min(), this returns the first argument if either is NaN.
+inline Floatx4 Min(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_min_ps(b.v, a.v));
+}
+
+// Lane-wise maximum. Like std::max(), this returns the first argument if either is NaN.
+inline Floatx4 Max(const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_max_ps(b.v, a.v));
+}
+
+// Lane-wise square root.
+inline Floatx4 Sqrt(const Floatx4 &a) {
+  return Floatx4(_mm_sqrt_ps(a.v));
+}
+
+// Lane-wise absolute value.
+inline Floatx4 Abs(const Floatx4 &a) {
+  return Floatx4(_mm_andnot_ps(_mm_set1_ps(-0.f), a.v));
+}
+
+// Picks each lane from a where the mask is set and from b where it is not.
+inline Floatx4 Select(const Maskx4 &mask, const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(_mm_or_ps(_mm_and_ps(mask.bits, a.v), _mm_andnot_ps(mask.bits, b.v)));
+}
+#else
+// A bool for each of four lanes.
+class Maskx4 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 4;
+
+    // The lanes of the mask.
+    bool lanes[4];
+
+    // Default constructor initializing every lane to false.
+    Maskx4() : lanes{false, false, false, false} {}
+
+    // Constructor initializing every lane to the same value.
+    explicit Maskx4(bool value) : lanes{value, value, value, value} {}
+
+    // Constructor initializing each lane to the provided value.
+    Maskx4(bool a, bool b, bool c, bool d) : lanes{a, b, c, d} {}
+
+    // Accessing a lane via integer index for reading.
+    bool operator[](int i) const {
+      assert(i >= 0 && i < 4);
+      return lanes[i];
+    }
+
+    // Returns the lanes as the low four bits of an integer, with lane 0 as the lowest bit.
+    int Bits() const {
+      return (int)lanes[0] | (int)lanes[1] << 1 | (int)lanes[2] << 2 | (int)lanes[3] << 3;
+    }
+};
+
+// Lane-wise logical and.
+inline Maskx4 operator&(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(a[0] && b[0], a[1] && b[1], a[2] && b[2], a[3] && b[3]);
+}
+
+// Lane-wise logical or.
+inline Maskx4 operator|(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(a[0] || b[0], a[1] || b[1], a[2] || b[2], a[3] || b[3]);
+}
+
+// Lane-wise logical exclusive or.
+inline Maskx4 operator^(const Maskx4 &a, const Maskx4 &b) {
+  return Maskx4(a[0] != b[0], a[1] != b[1], a[2] != b[2], a[3] != b[3]);
+}
+
+// Lane-wise logical not.
+inline Maskx4 operator~(const Maskx4 &mask) {
+  return Maskx4(!mask[0], !mask[1], !mask[2], !mask[3]);
+}
+
+// Four floats operated on together.
+class Floatx4 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 4;
+    // The type of the masks comparisons return.
+    typedef Maskx4 Mask;
+
+    // The values of the lanes.
+    float v[4];
+
+    // Default constructor initializing every lane to 0.
+    Floatx4() : v{0.f, 0.f, 0.f, 0.f} {}
+
+    // Constructor initializing every lane to the same value. This is implicit so scalars mix
+    // freely with wide floats in expressions.
+    Floatx4(float value) : v{value, value, value, value} {}
+
+    // Constructor initializing each lane to the provided value.
+    Floatx4(float a, float b, float c, float d) : v{a, b, c, d} {}
+
+    // Loads the lanes from four consecutive floats.
+    static Floatx4 Load(const float *values) {
+      return Floatx4(values[0], values[1], values[2], values[3]);
+    }
+
+    // Stores the lanes to four consecutive floats.
+    void Store(float *values) const {
+      std::copy(v, v + 4, values);
+    }
+
+    // Accessing a lane via integer index for reading.
+    float operator[](int i) const {
+      assert(i >= 0 && i < 4);
+      return v[i];
+    }
+};
+
+// Applies a binary operation to every lane of two wide floats.
+template <typename Result, typename Operation>
+inline Result ForEachLane(const Floatx4 &a, const Floatx4 &b, Operation operation) {
+  return Result(operation(a[0], b[0]), operation(a[1], b[1]), operation(a[2], b[2]),
+      operation(a[3], b[3]));
+}
+
+// Lane-wise addition.
+inline Floatx4 operator+(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return x + y; });
+}
+
+// Lane-wise subtraction.
+inline Floatx4 operator-(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return x - y; });
+}
+
+// Lane-wise multiplication.
+inline Floatx4 operator*(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return x * y; });
+}
+
+// Lane-wise division.
+inline Floatx4 operator/(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return x / y; });
+}
+
+// Lane-wise negation.
+inline Floatx4 operator-(const Floatx4 &a) {
+  return Floatx4(-a[0], -a[1], -a[2], -a[3]);
+}
+
+// Lane-wise less than comparison.
+inline Maskx4 operator<(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x < y; });
+}
+
+// Lane-wise less than or equal comparison.
+inline Maskx4 operator<=(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x <= y; });
+}
+
+// Lane-wise greater than comparison.
+inline Maskx4 operator>(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x > y; });
+}
+
+// Lane-wise greater than or equal comparison.
+inline Maskx4 operator>=(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x >= y; });
+}
+
+// Lane-wise equality comparison.
+inline Maskx4 operator==(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x == y; });
+}
+
+// Lane-wise inequality comparison.
+inline Maskx4 operator!=(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Maskx4>(a, b, [](float x, float y) { return x != y; });
+}
+
+// Lane-wise minimum. Like std::min(), this returns the first argument if either is NaN.
+inline Floatx4 Min(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return std::min(x, y); });
+}
+
+// Lane-wise maximum. Like std::max(), this returns the first argument if either is NaN.
+inline Floatx4 Max(const Floatx4 &a, const Floatx4 &b) {
+  return ForEachLane<Floatx4>(a, b, [](float x, float y) { return std::max(x, y); });
+}
+
+// Lane-wise square root.
+inline Floatx4 Sqrt(const Floatx4 &a) {
+  return Floatx4(std::sqrt(a[0]), std::sqrt(a[1]), std::sqrt(a[2]), std::sqrt(a[3]));
+}
+
+// Lane-wise absolute value.
+inline Floatx4 Abs(const Floatx4 &a) {
+  return Floatx4(std::abs(a[0]), std::abs(a[1]), std::abs(a[2]), std::abs(a[3]));
+}
+
+// Picks each lane from a where the mask is set and from b where it is not.
+inline Floatx4 Select(const Maskx4 &mask, const Floatx4 &a, const Floatx4 &b) {
+  return Floatx4(mask[0] ? a[0] : b[0], mask[1] ? a[1] : b[1], mask[2] ? a[2] : b[2],
+      mask[3] ? a[3] : b[3]);
+}
+#endif
+
+#ifdef __AVX__
+// A bool for each of eight lanes.
+class Maskx8 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 8;
+
+    // The lanes of the mask, each of which has either every bit set or none.
+    __m256 bits;
+
+    // Default constructor initializing every lane to false.
+    Maskx8() : bits{_mm256_setzero_ps()} {}
+
+    // Constructor initializing every lane to the same value.
+    explicit Maskx8(bool value) : bits{_mm256_castsi256_ps(_mm256_set1_epi32(value ? -1 : 0))} {}
+
+    // Constructor joining two masks of four lanes, with low as lanes 0 to 3.
+    Maskx8(const Maskx4 &low, const Maskx4 &high) : bits{_mm256_insertf128_ps(
+        _mm256_castps128_ps256(low.bits), high.bits, 1)} {}
+
+    // Constructor wrapping the result of an AVX comparison.
+    explicit Maskx8(__m256 bits) : bits{bits} {}
+
+    // Accessing a lane via integer index for reading.
+    bool operator[](int i) const {
+      assert(i >= 0 && i < 8);
+      return (Bits() >> i) & 1;
+    }
+
+    // Returns the lanes as the low eight bits of an integer, with lane 0 as the lowest bit.
+    int Bits() const {
+      return _mm256_movemask_ps(bits);
+    }
+};
+
+// Lane-wise logical and.
+inline Maskx8 operator&(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(_mm256_and_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical or.
+inline Maskx8 operator|(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(_mm256_or_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical exclusive or.
+inline Maskx8 operator^(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(_mm256_xor_ps(a.bits, b.bits));
+}
+
+// Lane-wise logical not.
+inline Maskx8 operator~(const Maskx8 &mask) {
+  return Maskx8(_mm256_xor_ps(mask.bits, Maskx8(true).bits));
+}
+
+// Eight floats operated on together.
+class Floatx8 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 8;
+    // The type of the masks comparisons return.
+    typedef Maskx8 Mask;
+
+    // The values of the lanes.
+    __m256 v;
+
+    // Default constructor initializing every lane to 0.
+    Floatx8() : v{_mm256_setzero_ps()} {}
+
+    // Constructor initializing every lane to the same value. This is implicit so scalars mix
+    // freely with wide floats in expressions.
+    Floatx8(float value) : v{_mm256_set1_ps(value)} {}
+
+    // Constructor initializing each lane to the provided value.
+    Floatx8(float a, float b, float c, float d, float e, float f, float g, float h) :
+        v{_mm256_setr_ps(a, b, c, d, e, f, g, h)} {}
+
+    // Constructor joining two wide floats of four lanes, with low as lanes 0 to 3.
+    Floatx8(const Floatx4 &low, const Floatx4 &high) : v{_mm256_insertf128_ps(
+        _mm256_castps128_ps256(low.v), high.v, 1)} {}
+
+    // Constructor wrapping an AVX register.
+    explicit Floatx8(__m256 v) : v{v} {}
+
+    // Loads the lanes from eight consecutive floats, which need not be aligned.
+    static Floatx8 Load(const float *values) {
+      return Floatx8(_mm256_loadu_ps(values));
+    }
+
+    // Stores the lanes to eight consecutive floats, which need not be aligned.
+    void Store(float *values) const {
+      _mm256_storeu_ps(values, v);
+    }
+
+    // Accessing a lane via integer index for reading.
+    float operator[](int i) const {
+      assert(i >= 0 && i < 8);
+      float values[8];
+      Store(values);
+      return values[i];
+    }
+};
+
+// Lane-wise addition.
+inline Floatx8 operator+(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_add_ps(a.v, b.v));
+}
+
+// Lane-wise subtraction.
+inline Floatx8 operator-(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_sub_ps(a.v, b.v));
+}
+
+// Lane-wise multiplication.
+inline Floatx8 operator*(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_mul_ps(a.v, b.v));
+}
+
+// Lane-wise division.
+inline Floatx8 operator/(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_div_ps(a.v, b.v));
+}
+
+// Lane-wise negation, which only flips the sign bits.
+inline Floatx8 operator-(const Floatx8 &a) {
+  return Floatx8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)));
+}
+
+// Lane-wise less than comparison.
+inline Maskx8 operator<(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+}
+
+// Lane-wise less than or equal comparison.
+inline Maskx8 operator<=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ));
+}
+
+// Lane-wise greater than comparison.
+inline Maskx8 operator>(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ));
+}
+
+// Lane-wise greater than or equal comparison.
+inline Maskx8 operator>=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ));
+}
+
+// Lane-wise equality comparison.
+inline Maskx8 operator==(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ));
+}
+
+// Lane-wise inequality comparison.
+inline Maskx8 operator!=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(_mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ));
+}
+
+// Lane-wise minimum. Like std::min(), this returns the first argument if either is NaN.
+inline Floatx8 Min(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_min_ps(b.v, a.v));
+}
+
+// Lane-wise maximum. Like std::max(), this returns the first argument if either is NaN.
+inline Floatx8 Max(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_max_ps(b.v, a.v));
+}
+
+// Lane-wise square root.
+inline Floatx8 Sqrt(const Floatx8 &a) {
+  return Floatx8(_mm256_sqrt_ps(a.v));
+}
+
+// Lane-wise absolute value.
+inline Floatx8 Abs(const Floatx8 &a) {
+  return Floatx8(_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v));
+}
+
+// Picks each lane from a where the mask is set and from b where it is not.
+inline Floatx8 Select(const Maskx8 &mask, const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(_mm256_blendv_ps(b.v, a.v, mask.bits));
+}
+#else
+// A bool for each of eight lanes, kept as two masks of four lanes.
+class Maskx8 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 8;
+
+    // Lanes 0 to 3 and lanes 4 to 7 of the mask.
+    Maskx4 low, high;
+
+    // Default constructor initializing every lane to false.
+    Maskx8() : low{}, high{} {}
+
+    // Constructor initializing every lane to the same value.
+    explicit Maskx8(bool value) : low{value}, high{value} {}
+
+    // Constructor joining two masks of four lanes, with low as lanes 0 to 3.
+    Maskx8(const Maskx4 &low, const Maskx4 &high) : low{low}, high{high} {}
+
+    // Accessing a lane via integer index for reading.
+    bool operator[](int i) const {
+      assert(i >= 0 && i < 8);
+      return i < 4 ? low[i] : high[i - 4];
+    }
+
+    // Returns the lanes as the low eight bits of an integer, with lane 0 as the lowest bit.
+    int Bits() const {
+      return low.Bits() | high.Bits() << 4;
+    }
+};
+
+// Lane-wise logical and.
+inline Maskx8 operator&(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(a.low & b.low, a.high & b.high);
+}
+
+// Lane-wise logical or.
+inline Maskx8 operator|(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(a.low | b.low, a.high | b.high);
+}
+
+// Lane-wise logical exclusive or.
+inline Maskx8 operator^(const Maskx8 &a, const Maskx8 &b) {
+  return Maskx8(a.low ^ b.low, a.high ^ b.high);
+}
+
+// Lane-wise logical not.
+inline Maskx8 operator~(const Maskx8 &mask) {
+  return Maskx8(~mask.low, ~mask.high);
+}
+
+// Eight floats operated on together, kept as two wide floats of four lanes.
+class Floatx8 {
+  public:
+    // The number of lanes.
+    static const uint WIDTH = 8;
+    // The type of the masks comparisons return.
+    typedef Maskx8 Mask;
+
+    // Lanes 0 to 3 and lanes 4 to 7.
+    Floatx4 low, high;
+
+    // Default constructor initializing every lane to 0.
+    Floatx8() : low{}, high{} {}
+
+    // Constructor initializing every lane to the same value. This is implicit so scalars mix
+    // freely with wide floats in expressions.
+    Floatx8(float value) : low{value}, high{value} {}
+
+    // Constructor initializing each lane to the provided value.
+    Floatx8(float a, float b, float c, float d, float e, float f, float g, float h) :
+        low{a, b, c, d}, high{e, f, g, h} {}
+
+    // Constructor joining two wide floats of four lanes, with low as lanes 0 to 3.
+    Floatx8(const Floatx4 &low, const Floatx4 &high) : low{low}, high{high} {}
+
+    // Loads the lanes from eight consecutive floats, which need not be aligned.
+    static Floatx8 Load(const float *values) {
+      return Floatx8(Floatx4::Load(values), Floatx4::Load(values + 4));
+    }
+
+    // Stores the lanes to eight consecutive floats, which need not be aligned.
+    void Store(float *values) const {
+      low.Store(values);
+      high.Store(values + 4);
+    }
+
+    // Accessing a lane via integer index for reading.
+    float operator[](int i) const {
+      assert(i >= 0 && i < 8);
+      return i < 4 ? low[i] : high[i - 4];
+    }
+};
+
+// Lane-wise addition.
+inline Floatx8 operator+(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(a.low + b.low, a.high + b.high);
+}
+
+// Lane-wise subtraction.
+inline Floatx8 operator-(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(a.low - b.low, a.high - b.high);
+}
+
+// Lane-wise multiplication.
+inline Floatx8 operator*(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(a.low * b.low, a.high * b.high);
+}
+
+// Lane-wise division.
+inline Floatx8 operator/(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(a.low / b.low, a.high / b.high);
+}
+
+// Lane-wise negation.
+inline Floatx8 operator-(const Floatx8 &a) {
+  return Floatx8(-a.low, -a.high);
+}
+
+// Lane-wise less than comparison.
+inline Maskx8 operator<(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low < b.low, a.high < b.high);
+}
+
+// Lane-wise less than or equal comparison.
+inline Maskx8 operator<=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low <= b.low, a.high <= b.high);
+}
+
+// Lane-wise greater than comparison.
+inline Maskx8 operator>(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low > b.low, a.high > b.high);
+}
+
+// Lane-wise greater than or equal comparison.
+inline Maskx8 operator>=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low >= b.low, a.high >= b.high);
+}
+
+// Lane-wise equality comparison.
+inline Maskx8 operator==(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low == b.low, a.high == b.high);
+}
+
+// Lane-wise inequality comparison.
+inline Maskx8 operator!=(const Floatx8 &a, const Floatx8 &b) {
+  return Maskx8(a.low != b.low, a.high != b.high);
+}
+
+// Lane-wise minimum. Like std::min(), this returns the first argument if either is NaN.
+inline Floatx8 Min(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(Min(a.low, b.low), Min(a.high, b.high));
+}
+
+// Lane-wise maximum. Like std::max(), this returns the first argument if either is NaN.
+inline Floatx8 Max(const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(Max(a.low, b.low), Max(a.high, b.high));
+}
+
+// Lane-wise square root.
+inline Floatx8 Sqrt(const Floatx8 &a) {
+  return Floatx8(Sqrt(a.low), Sqrt(a.high));
+}
+
+// Lane-wise absolute value.
+inline Floatx8 Abs(const Floatx8 &a) {
+  return Floatx8(Abs(a.low), Abs(a.high));
+}
+
+// Picks each lane from a where the mask is set and from b where it is not.
+inline Floatx8 Select(const Maskx8 &mask, const Floatx8 &a, const Floatx8 &b) {
+  return Floatx8(Select(mask.low, a.low, b.low), Select(mask.high, a.high, b.high));
+}
+#endif
+
+// Returns whether any lane of the mask is set.
+template <typename Mask>
+inline bool Any(const Mask &mask) {
+  return mask.Bits() != 0;
+}
+
+// Returns whether every lane of the mask is set.
+template <typename Mask>
+inline bool All(const Mask &mask) {
+  return mask.Bits() == (1 << Mask::WIDTH) - 1;
+}
+
+// Returns whether no lane of the mask is set.
+template <typename Mask>
+inline bool None(const Mask &mask) {
+  return mask.Bits() == 0;
+}
+
+}
+
+#endif  // LIANG_CORE_SIMD_H
@@ -1,8 +1,441 @@
 #include "core/transform.h"
+#include "utils/cpu_features.h"
 #include "utils/math.h"
 
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+#ifdef LIANG_AVX_DISPATCH
+#include <immintrin.h>
+#endif
+
 namespace liang {
 
+// The SIMD kernels below are vectorized across independent results, and compute each one with the
+// same operations in the same order as the scalar code. This keeps them bit-identical to it, so a
+// render does not depend on which instruction set the machine it ran on has.
+
+// The operands of the products summed by Matrix4x4::Inverse() for each cofactor. Column c of the
+// transposed cofactor matrix is a sum of six products of three matrix elements, and element
+// COFACTOR_OPERANDS[c][k][f][r] is the index of factor f of product k in row r of the column.
+static const uint8_t COFACTOR_OPERANDS[4][6][3][4] = {
+  {
+    {{5, 4, 4, 4}, {10, 10, 9, 9}, {15, 15, 15, 14}},
+    {{5, 4, 4, 4}, {11, 11, 11, 10}, {14, 14, 13, 13}},
+    {{9, 8, 8, 8}, {6, 6, 5, 5}, {15, 15, 15, 14}},
+    {{9, 8, 8, 8}, {7, 7, 7, 6}, {14, 14, 13, 13}},
+    {{13, 12, 12, 12}, {6, 6, 5, 5}, {11, 11, 11, 10}},
+    {{13, 12, 12, 12}, {7, 7, 7, 6}, {10, 10, 9, 9}}
+  },
+  {
+    {{1, 0, 0, 0}, {10, 10, 9, 9}, {15, 15, 15, 14}},
+    {{1, 0, 0, 0}, {11, 11, 11, 10}, {14, 14, 13, 13}},
+    {{9, 8, 8, 8}, {2, 2, 1, 1}, {15, 15, 15, 14}},
+    {{9, 8, 8, 8}, {3, 3, 3, 2}, {14, 14, 13, 13}},
+    {{13, 12, 12, 12}, {2, 2, 1, 1}, {11, 11, 11, 10}},
+    {{13, 12, 12, 12}, {3, 3, 3, 2}, {10, 10, 9, 9}}
+  },
+  {
+    {{1, 0, 0, 0}, {6, 6, 5, 5}, {15, 15, 15, 14}},
+    {{1, 0, 0, 0}, {7, 7, 7, 6}, {14, 14, 13, 13}},
+    {{5, 4, 4, 4}, {2, 2, 1, 1}, {15, 15, 15, 14}},
+    {{5, 4, 4, 4}, {3, 3, 3, 2}, {14, 14, 13, 13}},
+    {{13, 12, 12, 12}, {2, 2, 1, 1}, {7, 7, 7, 6}},
+    {{13, 12, 12, 12}, {3, 3, 3, 2}, {6, 6, 5, 5}}
+  },
+  {
+    {{1, 0, 0, 0}, {6, 6, 5, 5}, {11, 11, 11, 10}},
+    {{1, 0, 0, 0}, {7, 7, 7, 6}, {10, 10, 9, 9}},
+    {{5, 4, 4, 4}, {2, 2, 1, 1}, {11, 11, 11, 10}},
+    {{5, 4, 4, 4}, {3, 3, 3, 2}, {10, 10, 9, 9}},
+    {{9, 8, 8, 8}, {2, 2, 1, 1}, {7, 7, 7, 6}},
+    {{9, 8, 8, 8}, {3, 3, 3, 2}, {6, 6, 5, 5}}
+  }
+};
+
+// Whether each product of the cofactors in rows 0 and 2 of even columns is subtracted. The rest of
+// the cofactors have every sign flipped.
+static const bool COFACTOR_SUBTRACTS[6] = {false, true, true, false, false, true};
+
+// Multiplies two row-major matrices.
+static void MultiplyScalar(const float *a, const float *b, float *result) {
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result[i * 4 + j] = a[i * 4] * b[j] + a[i * 4 + 1] * b[4 + j] + a[i * 4 + 2] * b[8 + j] +
+          a[i * 4 + 3] * b[12 + j];
+    }
+  }
+}
+
+// Computes the transposed cofactor matrix of a row-major matrix, which is its inverse scaled by
+// the determinant. Adapted from GLU's MESA implementation.
+static void InverseCofactorsScalar(const float *matrix, float *inverse_values) {
+  inverse_values[0] = matrix[5] * matrix[10] * matrix[15] - matrix[5] * matrix[11] * matrix[14] -
+      matrix[9] * matrix[6] * matrix[15] + matrix[9] * matrix[7] * matrix[14] + matrix[13] *
+      matrix[6] * matrix[11] - matrix[13] * matrix[7] * matrix[10];
+  inverse_values[4] = -matrix[4] * matrix[10] * matrix[15] + matrix[4] * matrix[11] * matrix[14] +
+      matrix[8] * matrix[6] * matrix[15] - matrix[8] * matrix[7] * matrix[14] - matrix[12] *
+      matrix[6] * matrix[11] + matrix[12] * matrix[7] * matrix[10];
+  inverse_values[8] = matrix[4] * matrix[9] * matrix[15] - matrix[4] * matrix[11] * matrix[13] -
+      matrix[8] * matrix[5] * matrix[15] + matrix[8] * matrix[7] * matrix[13] + matrix[12] *
+      matrix[5] * matrix[11] - matrix[12] * matrix[7] * matrix[9];
+  inverse_values[12] = -matrix[4] * matrix[9] * matrix[14] + matrix[4] * matrix[10] * matrix[13] +
+      matrix[8] * matrix[5] * matrix[14] - matrix[8] * matrix[6] * matrix[13] - matrix[12] *
+      matrix[5] * matrix[10] + matrix[12] * matrix[6] * matrix[9];
+  inverse_values[1] = -matrix[1] * matrix[10] * matrix[15] + matrix[1] * matrix[11] * matrix[14] +
+      matrix[9] * matrix[2] * matrix[15] - matrix[9] * matrix[3] * matrix[14] - matrix[13] *
+      matrix[2] * matrix[11] + matrix[13] * matrix[3] * matrix[10];
+  inverse_values[5] = matrix[0] * matrix[10] * matrix[15] - matrix[0] * matrix[11] * matrix[14] -
+      matrix[8] * matrix[2] * matrix[15] + matrix[8] * matrix[3] * matrix[14] + matrix[12] *
+      matrix[2] * matrix[11] - matrix[12] * matrix[3] * matrix[10];
+  inverse_values[9] = -matrix[0] * matrix[9] * matrix[15] + matrix[0] * matrix[11] * matrix[13] +
+      matrix[8] * matrix[1] * matrix[15] - matrix[8] * matrix[3] * matrix[13] - matrix[12] *
+      matrix[1] * matrix[11] + matrix[12] * matrix[3] * matrix[9];
+  inverse_values[13] = matrix[0] * matrix[9] * matrix[14] - matrix[0] * matrix[10] * matrix[13] -
+      matrix[8] * matrix[1] * matrix[14] + matrix[8] * matrix[2] * matrix[13] + matrix[12] *
+      matrix[1] * matrix[10] - matrix[12] * matrix[2] * matrix[9];
+  inverse_values[2] = matrix[1] * matrix[6] * matrix[15] - matrix[1] * matrix[7] * matrix[14] -
+      matrix[5] * matrix[2] * matrix[15] + matrix[5] * matrix[3] * matrix[14] + matrix[13] *
+      matrix[2] * matrix[7] - matrix[13] * matrix[3] * matrix[6];
+  inverse_values[6] = -matrix[0] * matrix[6] * matrix[15] + matrix[0] * matrix[7] * matrix[14] +
+      matrix[4] * matrix[2] * matrix[15] - matrix[4] * matrix[3] * matrix[14] - matrix[12] *
+      matrix[2] * matrix[7] + matrix[12] * matrix[3] * matrix[6];
+  inverse_values[10] = matrix[0] * matrix[5] * matrix[15] - matrix[0] * matrix[7] * matrix[13] -
+      matrix[4] * matrix[1] * matrix[15] + matrix[4] * matrix[3] * matrix[13] + matrix[12] *
+      matrix[1] * matrix[7] - matrix[12] * matrix[3] * matrix[5];
+  inverse_values[14] = -matrix[0] * matrix[5] * matrix[14] + matrix[0] * matrix[6] * matrix[13] +
+      matrix[4] * matrix[1] * matrix[14] - matrix[4] * matrix[2] * matrix[13] - matrix[12] *
+      matrix[1] * matrix[6] + matrix[12] * matrix[2] * matrix[5];
+  inverse_values[3] = -matrix[1] * matrix[6] * matrix[11] + matrix[1] * matrix[7] * matrix[10] +
+      matrix[5] * matrix[2] * matrix[11] - matrix[5] * matrix[3] * matrix[10] - matrix[9] *
+      matrix[2] * matrix[7] + matrix[9] * matrix[3] * matrix[6];
+  inverse_values[7] = matrix[0] * matrix[6] * matrix[11] - matrix[0] * matrix[7] * matrix[10] -
+      matrix[4] * matrix[2] * matrix[11] + matrix[4] * matrix[3] * matrix[10] + matrix[8] *
+      matrix[2] * matrix[7] - matrix[8] * matrix[3] * matrix[6];
+  inverse_values[11] = -matrix[0] * matrix[5] * matrix[11] + matrix[0] * matrix[7] * matrix[9] +
+      matrix[4] * matrix[1] * matrix[11] - matrix[4] * matrix[3] * matrix[9] - matrix[8] *
+      matrix[1] * matrix[7] + matrix[8] * matrix[3] * matrix[5];
+  inverse_values[15] = matrix[0] * matrix[5] * matrix[10] - matrix[0] * matrix[6] * matrix[9] -
+      matrix[4] * matrix[1] * matrix[10] + matrix[4] * matrix[2] * matrix[9] + matrix[8] *
+      matrix[1] * matrix[6] - matrix[8] * matrix[2] * matrix[5];
+}
+
+// Transforms a point by a row-major matrix.
+static inline Point3f TransformPoint(const float *m, const Point3f &p) {
+  float x = m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3];
+  float y = m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7];
+  float z = m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11];
+  float w = m[12] * p.x + m[13] * p.y + m[14] * p.z + m[15];
+  float divisor = 1.0f / w;
+  return w == 1 ? Point3f(x, y, z) : Point3f(x * divisor, y * divisor, z * divisor);
+}
+
+// Transforms a vector by a row-major matrix.
+static inline Vector3f TransformVector(const float *m, const Vector3f &v) {
+  return Vector3f(m[0] * v.x + m[1] * v.y + m[2] * v.z, m[4] * v.x + m[5] * v.y + m[6] * v.z,
+      m[8] * v.x + m[9] * v.y + m[10] * v.z);
+}
+
+// Transforms count points by a row-major matrix.
+static void TransformPointsScalar(const float *matrix, const Point3f *points, uint count,
+    Point3f *result) {
+  for (uint i = 0; i < count; i++) {
+    result[i] = TransformPoint(matrix, points[i]);
+  }
+}
+
+// Transforms count vectors by a row-major matrix.
+static void TransformVectorsScalar(const float *matrix, const Vector3f *vectors, uint count,
+    Vector3f *result) {
+  for (uint i = 0; i < count; i++) {
+    result[i] = TransformVector(matrix, vectors[i]);
+  }
+}
+
+#ifdef __SSE2__
+// Loads the matrix elements at the given indices.
+static inline __m128 Gather4(const float *matrix, const uint8_t indices[4]) {
+  return _mm_setr_ps(matrix[indices[0]], matrix[indices[1]], matrix[indices[2]],
+      matrix[indices[3]]);
+}
+
+// Returns the dot product of a matrix row's first three elements with four vectors at once.
+static inline __m128 RowTimesVector4(const float *row, __m128 x, __m128 y, __m128 z) {
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), x),
+      _mm_mul_ps(_mm_set1_ps(row[1]), y)), _mm_mul_ps(_mm_set1_ps(row[2]), z));
+}
+
+// Returns the dot product of a matrix row with four points at once.
+static inline __m128 RowTimesPoint4(const float *row, __m128 x, __m128 y, __m128 z) {
+  return _mm_add_ps(RowTimesVector4(row, x, y, z), _mm_set1_ps(row[3]));
+}
+
+static void MultiplySse2(const float *a, const float *b, float *result) {
+  __m128 b_rows[4] = {_mm_loadu_ps(b), _mm_loadu_ps(b + 4), _mm_loadu_ps(b + 8),
+      _mm_loadu_ps(b + 12)};
+  for (uint i = 0; i < 4; i++) {
+    const float *a_row = a + i * 4;
+    __m128 row = _mm_mul_ps(_mm_set1_ps(a_row[0]), b_rows[0]);
+    for (uint k = 1; k < 4; k++) {
+      row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a_row[k]), b_rows[k]));
+    }
+    _mm_storeu_ps(result + i * 4, row);
+  }
+}
+
+static void InverseCofactorsSse2(const float *matrix, float *inverse_values) {
+  for (uint column = 0; column < 4; column++) {
+    // The sign is applied to the first factor of each product, like the scalar code does.
+    __m128 column_signs = column % 2 == 0 ? _mm_setr_ps(0.f, -0.f, 0.f, -0.f) :
+        _mm_setr_ps(-0.f, 0.f, -0.f, 0.f);
+    __m128 sum = _mm_setzero_ps();
+    for (uint k = 0; k < 6; k++) {
+      const uint8_t (*operands)[4] = COFACTOR_OPERANDS[column][k];
+      __m128 signs = COFACTOR_SUBTRACTS[k] ? _mm_xor_ps(column_signs, _mm_set1_ps(-0.f)) :
+          column_signs;
+      __m128 product = _mm_mul_ps(_mm_mul_ps(_mm_xor_ps(Gather4(matrix, operands[0]), signs),
+          Gather4(matrix, operands[1])), Gather4(matrix, operands[2]));
+      sum = k == 0 ? product : _mm_add_ps(sum, product);
+    }
+    float cofactors[4];
+    _mm_storeu_ps(cofactors, sum);
+    for (uint row = 0; row < 4; row++) {
+      inverse_values[row * 4 + column] = cofactors[row];
+    }
+  }
+}
+
+static void TransformPointsSse2(const float *matrix, const Point3f *points, uint count,
+    Point3f *result) {
+  uint i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const Point3f *p = points + i;
+    __m128 x = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+    __m128 y = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+    __m128 z = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+    __m128 w = RowTimesPoint4(matrix + 12, x, y, z);
+    __m128 divisor = _mm_div_ps(_mm_set1_ps(1.f), w);
+    // Only points whose w is not 1 are divided, like Transform::operator() does.
+    __m128 unit_w = _mm_cmpeq_ps(w, _mm_set1_ps(1.f));
+    float transformed[3][4];
+    for (uint row = 0; row < 3; row++) {
+      __m128 coordinate = RowTimesPoint4(matrix + row * 4, x, y, z);
+      _mm_storeu_ps(transformed[row], _mm_or_ps(_mm_and_ps(unit_w, coordinate),
+          _mm_andnot_ps(unit_w, _mm_mul_ps(coordinate, divisor))));
+    }
+    for (uint lane = 0; lane < 4; lane++) {
+      result[i + lane] = Point3f(transformed[0][lane], transformed[1][lane],
+          transformed[2][lane]);
+    }
+  }
+  TransformPointsScalar(matrix, points + i, count - i, result + i);
+}
+
+static void TransformVectorsSse2(const float *matrix, const Vector3f *vectors, uint count,
+    Vector3f *result) {
+  uint i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const Vector3f *v = vectors + i;
+    __m128 x = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+    __m128 y = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+    __m128 z = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+    float transformed[3][4];
+    for (uint row = 0; row < 3; row++) {
+      _mm_storeu_ps(transformed[row], RowTimesVector4(matrix + row * 4, x, y, z));
+    }
+    for (uint lane = 0; lane < 4; lane++) {
+      result[i + lane] = Vector3f(transformed[0][lane], transformed[1][lane],
+          transformed[2][lane]);
+    }
+  }
+  TransformVectorsScalar(matrix, vectors + i, count - i, result + i);
+}
+#endif
+
+#ifdef LIANG_AVX_DISPATCH
+// Returns a register whose low half is filled with low and whose high half is filled with high.
+static inline LIANG_TARGET_AVX __m256 Set2x4(float low, float high) {
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(low)), _mm_set1_ps(high), 1);
+}
+
+// Returns the dot product of a matrix row's first three elements with eight vectors at once.
+static inline LIANG_TARGET_AVX __m256 RowTimesVector8(const float *row, __m256 x, __m256 y,
+    __m256 z) {
+  return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(row[0]), x),
+      _mm256_mul_ps(_mm256_set1_ps(row[1]), y)), _mm256_mul_ps(_mm256_set1_ps(row[2]), z));
+}
+
+// Returns the dot product of a matrix row with eight points at once.
+static inline LIANG_TARGET_AVX __m256 RowTimesPoint8(const float *row, __m256 x, __m256 y,
+    __m256 z) {
+  return _mm256_add_ps(RowTimesVector8(row, x, y, z), _mm256_set1_ps(row[3]));
+}
+
+// Multiplies two rows of a at a time, with the rows of b repeated in both halves of a register.
+static LIANG_TARGET_AVX void MultiplyAvx(const float *a, const float *b, float *result) {
+  __m256 b_rows[4];
+  for (uint k = 0; k < 4; k++) {
+    __m128 b_row = _mm_loadu_ps(b + k * 4);
+    b_rows[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(b_row), b_row, 1);
+  }
+  for (uint i = 0; i < 4; i += 2) {
+    const float *a_rows = a + i * 4;
+    __m256 rows = _mm256_mul_ps(Set2x4(a_rows[0], a_rows[4]), b_rows[0]);
+    for (uint k = 1; k < 4; k++) {
+      rows = _mm256_add_ps(rows, _mm256_mul_ps(Set2x4(a_rows[k], a_rows[4 + k]), b_rows[k]));
+    }
+    _mm256_storeu_ps(result + i * 4, rows);
+  }
+}
+
+// Computes two columns of cofactors at a time.
+static LIANG_TARGET_AVX void InverseCofactorsAvx(const float *matrix, float *inverse_values) {
+  __m256 column_signs = _mm256_setr_ps(0.f, -0.f, 0.f, -0.f, -0.f, 0.f, -0.f, 0.f);
+  for (uint column = 0; column < 4; column += 2) {
+    __m256 sum = _mm256_setzero_ps();
+    for (uint k = 0; k < 6; k++) {
+      __m256 factors[3];
+      for (uint f = 0; f < 3; f++) {
+        const uint8_t *low = COFACTOR_OPERANDS[column][k][f];
+        const uint8_t *high = COFACTOR_OPERANDS[column + 1][k][f];
+        factors[f] = _mm256_setr_ps(matrix[low[0]], matrix[low[1]], matrix[low[2]],
+            matrix[low[3]], matrix[high[0]], matrix[high[1]], matrix[high[2]], matrix[high[3]]);
+      }
+      __m256 signs = COFACTOR_SUBTRACTS[k] ? _mm256_xor_ps(column_signs, _mm256_set1_ps(-0.f)) :
+          column_signs;
+      __m256 product = _mm256_mul_ps(_mm256_mul_ps(_mm256_xor_ps(factors[0], signs), factors[1]),
+          factors[2]);
+      sum = k == 0 ? product : _mm256_add_ps(sum, product);
+    }
+    float cofactors[8];
+    _mm256_storeu_ps(cofactors, sum);
+    for (uint row = 0; row < 4; row++) {
+      inverse_values[row * 4 + column] = cofactors[row];
+      inverse_values[row * 4 + column + 1] = cofactors[4 + row];
+    }
+  }
+}
+
+static LIANG_TARGET_AVX void TransformPointsAvx(const float *matrix, const Point3f *points,
+    uint count, Point3f *result) {
+  uint i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const Point3f *p = points + i;
+    __m256 x = _mm256_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x, p[4].x, p[5].x, p[6].x, p[7].x);
+    __m256 y = _mm256_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y, p[4].y, p[5].y, p[6].y, p[7].y);
+    __m256 z = _mm256_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z, p[4].z, p[5].z, p[6].z, p[7].z);
+    __m256 w = RowTimesPoint8(matrix + 12, x, y, z);
+    __m256 divisor = _mm256_div_ps(_mm256_set1_ps(1.f), w);
+    __m256 unit_w = _mm256_cmp_ps(w, _mm256_set1_ps(1.f), _CMP_EQ_OQ);
+    float transformed[3][8];
+    for (uint row = 0; row < 3; row++) {
+      __m256 coordinate = RowTimesPoint8(matrix + row * 4, x, y, z);
+      _mm256_storeu_ps(transformed[row], _mm256_blendv_ps(_mm256_mul_ps(coordinate, divisor),
+          coordinate, unit_w));
+    }
+    for (uint lane = 0; lane < 8; lane++) {
+      result[i + lane] = Point3f(transformed[0][lane], transformed[1][lane],
+          transformed[2][lane]);
+    }
+  }
+  TransformPointsScalar(matrix, points + i, count - i, result + i);
+}
+
+static LIANG_TARGET_AVX void TransformVectorsAvx(const float *matrix, const Vector3f *vectors,
+    uint count, Vector3f *result) {
+  uint i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const Vector3f *v = vectors + i;
+    __m256 x = _mm256_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x, v[4].x, v[5].x, v[6].x, v[7].x);
+    __m256 y = _mm256_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y, v[4].y, v[5].y, v[6].y, v[7].y);
+    __m256 z = _mm256_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z, v[4].z, v[5].z, v[6].z, v[7].z);
+    float transformed[3][8];
+    for (uint row = 0; row < 3; row++) {
+      _mm256_storeu_ps(transformed[row], RowTimesVector8(matrix + row * 4, x, y, z));
+    }
+    for (uint lane = 0; lane < 8; lane++) {
+      result[i + lane] = Vector3f(transformed[0][lane], transformed[1][lane],
+          transformed[2][lane]);
+    }
+  }
+  TransformVectorsScalar(matrix, vectors + i, count - i, result + i);
+}
+#endif
+
+// The implementations of the matrix kernels for one instruction set.
+struct TransformKernels {
+  // Multiplies two row-major matrices.
+  void (*multiply)(const float *a, const float *b, float *result);
+  // Computes the transposed cofactor matrix of a row-major matrix.
+  void (*inverse_cofactors)(const float *matrix, float *inverse_values);
+  // Transforms count points by a row-major matrix.
+  void (*transform_points)(const float *matrix, const Point3f *points, uint count,
+      Point3f *result);
+  // Transforms count vectors by a row-major matrix.
+  void (*transform_vectors)(const float *matrix, const Vector3f *vectors, uint count,
+      Vector3f *result);
+};
+
+static const TransformKernels SCALAR_KERNELS = {MultiplyScalar, InverseCofactorsScalar,
+    TransformPointsScalar, TransformVectorsScalar};
+#ifdef __SSE2__
+static const TransformKernels SSE2_KERNELS = {MultiplySse2, InverseCofactorsSse2,
+    TransformPointsSse2, TransformVectorsSse2};
+#endif
+#ifdef LIANG_AVX_DISPATCH
+static const TransformKernels AVX_KERNELS = {MultiplyAvx, InverseCofactorsAvx,
+    TransformPointsAvx, TransformVectorsAvx};
+#endif
+
+// Returns the kernels for the instruction set currently dispatched to.
+static const TransformKernels &GetTransformKernels() {
+  switch (GetSimdLevel()) {
+#ifdef LIANG_AVX_DISPATCH
+    case SimdLevel::AVX:
+      return AVX_KERNELS;
+#endif
+#ifdef __SSE2__
+    case SimdLevel::SSE2:
+      return SSE2_KERNELS;
+#endif
+    default:
+      return SCALAR_KERNELS;
+  }
+}
+
+// Inverts an affine matrix given as its top three rows in row-major order. The linear part is
+// inverted through its adjugate, and the translation is then moved back through that inverse.
+static void InvertAffine(const float *m, float *inverse) {
+  float det = m[0] * (m[5] * m[10] - m[6] * m[9]) + m[1] * (m[6] * m[8] - m[4] * m[10]) +
+      m[2] * (m[4] * m[9] - m[5] * m[8]);
+  assert(std::abs(det) > 0.000001);
+  float inverse_det = 1.f / det;
+  inverse[0] = (m[5] * m[10] - m[6] * m[9]) * inverse_det;
+  inverse[1] = (m[2] * m[9] - m[1] * m[10]) * inverse_det;
+  inverse[2] = (m[1] * m[6] - m[2] * m[5]) * inverse_det;
+  inverse[4] = (m[6] * m[8] - m[4] * m[10]) * inverse_det;
+  inverse[5] = (m[0] * m[10] - m[2] * m[8]) * inverse_det;
+  inverse[6] = (m[2] * m[4] - m[0] * m[6]) * inverse_det;
+  inverse[8] = (m[4] * m[9] - m[5] * m[8]) * inverse_det;
+  inverse[9] = (m[1] * m[8] - m[0] * m[9]) * inverse_det;
+  inverse[10] = (m[0] * m[5] - m[1] * m[4]) * inverse_det;
+  for (int i = 0; i < 3; i++) {
+    inverse[i * 4 + 3] = -(inverse[i * 4] * m[3] + inverse[i * 4 + 1] * m[7] +
+        inverse[i * 4 + 2] * m[11]);
+  }
+}
+
+// Multiplies two affine matrices given as their top three rows in row-major order.
+static void MultiplyAffine(const float *a, const float *b, float *result) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      float sum = a[i * 4] * b[j] + a[i * 4 + 1] * b[4 + j] + a[i * 4 + 2] * b[8 + j];
+      // Only the translation column picks up the implicit 1 at the bottom of b.
+      result[i * 4 + j] = j == 3 ? sum + a[i * 4 + 3] : sum;
+    }
+  }
+}
+
 Matrix4x4::Matrix4x4() : matrix{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1} {}
 
 Matrix4x4::Matrix4x4(const float m[4][4]) {
@@ -38,12 +471,7 @@ float Matrix4x4::operator[](int i) const {
 
 Matrix4x4 Matrix4x4::operator*(const Matrix4x4 &that) const {
   Matrix4x4 new_matrix;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      new_matrix.Set(i, j, this->Get(i, 0) * that.Get(0, j) + this->Get(i, 1) * that.Get(1, j) +
-          this->Get(i, 2) * that.Get(2, j) + this->Get(i, 3) * that.Get(3, j));
-    }
-  }
+  GetTransformKernels().multiply(matrix, that.matrix, new_matrix.matrix);
   return new_matrix;
 }
 
@@ -84,57 +512,9 @@ Matrix4x4 Matrix4x4::Transpose() const {
   return Matrix4x4(transposed_values);
 }
 
-// Adapted from GLU's MESA implementation.
 Matrix4x4 Matrix4x4::Inverse() const {
   float inverse_values[16];
-  inverse_values[0] = matrix[5] * matrix[10] * matrix[15] - matrix[5] * matrix[11] * matrix[14] -
-      matrix[9] * matrix[6] * matrix[15] + matrix[9] * matrix[7] * matrix[14] + matrix[13] *
-      matrix[6] * matrix[11] - matrix[13] * matrix[7] * matrix[10];
-  inverse_values[4] = -matrix[4] * matrix[10] * matrix[15] + matrix[4] * matrix[11] * matrix[14] +
-      matrix[8] * matrix[6] * matrix[15] - matrix[8] * matrix[7] * matrix[14] - matrix[12] *
-      matrix[6] * matrix[11] + matrix[12] * matrix[7] * matrix[10];
-  inverse_values[8] = matrix[4] * matrix[9] * matrix[15] - matrix[4] * matrix[11] * matrix[13] -
-      matrix[8] * matrix[5] * matrix[15] + matrix[8] * matrix[7] * matrix[13] + matrix[12] *
-      matrix[5] * matrix[11] - matrix[12] * matrix[7] * matrix[9];
-  inverse_values[12] = -matrix[4] * matrix[9] * matrix[14] + matrix[4] * matrix[10] * matrix[13] +
-      matrix[8] * matrix[5] * matrix[14] - matrix[8] * matrix[6] * matrix[13] - matrix[12] *
-      matrix[5] * matrix[10] + matrix[12] * matrix[6] * matrix[9];
-  inverse_values[1] = -matrix[1] * matrix[10] * matrix[15] + matrix[1] * matrix[11] * matrix[14] +
-      matrix[9] * matrix[2] * matrix[15] - matrix[9] * matrix[3] * matrix[14] - matrix[13] *
-      matrix[2] * matrix[11] + matrix[13] * matrix[3] * matrix[10];
-  inverse_values[5] = matrix[0] * matrix[10] * matrix[15] - matrix[0] * matrix[11] * matrix[14] -
-      matrix[8] * matrix[2] * matrix[15] + matrix[8] * matrix[3] * matrix[14] + matrix[12] *
-      matrix[2] * matrix[11] - matrix[12] * matrix[3] * matrix[10];
-  inverse_values[9] = -matrix[0] * matrix[9] * matrix[15] + matrix[0] * matrix[11] * matrix[13] +
-      matrix[8] * matrix[1] * matrix[15] - matrix[8] * matrix[3] * matrix[13] - matrix[12] *
-      matrix[1] * matrix[11] + matrix[12] * matrix[3] * matrix[9];
-  inverse_values[13] = matrix[0] * matrix[9] * matrix[14] - matrix[0] * matrix[10] * matrix[13] -
-      matrix[8] * matrix[1] * matrix[14] + matrix[8] * matrix[2] * matrix[13] + matrix[12] *
-      matrix[1] * matrix[10] - matrix[12] * matrix[2] * matrix[9];
-  inverse_values[2] = matrix[1] * matrix[6] * matrix[15] - matrix[1] * matrix[7] * matrix[14] -
-      matrix[5] * matrix[2] * matrix[15] + matrix[5] * matrix[3] * matrix[14] + matrix[13] *
-      matrix[2] * matrix[7] - matrix[13] * matrix[3] * matrix[6];
-  inverse_values[6] = -matrix[0] * matrix[6] * matrix[15] + matrix[0] * matrix[7] * matrix[14] +
-      matrix[4] * matrix[2] * matrix[15] - matrix[4] * matrix[3] * matrix[14] - matrix[12] *
-      matrix[2] * matrix[7] + matrix[12] * matrix[3] * matrix[6];
-  inverse_values[10] = matrix[0] * matrix[5] * matrix[15] - matrix[0] * matrix[7] * matrix[13] -
-      matrix[4] * matrix[1] * matrix[15] + matrix[4] * matrix[3] * matrix[13] + matrix[12] *
-      matrix[1] * matrix[7] - matrix[12] * matrix[3] * matrix[5];
-  inverse_values[14] = -matrix[0] * matrix[5] * matrix[14] + matrix[0] * matrix[6] * matrix[13] +
-      matrix[4] * matrix[1] * matrix[14] - matrix[4] * matrix[2] * matrix[13] - matrix[12] *
-      matrix[1] * matrix[6] + matrix[12] * matrix[2] * matrix[5];
-  inverse_values[3] = -matrix[1] * matrix[6] * matrix[11] + matrix[1] * matrix[7] * matrix[10] +
-      matrix[5] * matrix[2] * matrix[11] - matrix[5] * matrix[3] * matrix[10] - matrix[9] *
-      matrix[2] * matrix[7] + matrix[9] * matrix[3] * matrix[6];
-  inverse_values[7] = matrix[0] * matrix[6] * matrix[11] - matrix[0] * matrix[7] * matrix[10] -
-      matrix[4] * matrix[2] * matrix[11] + matrix[4] * matrix[3] * matrix[10] + matrix[8] *
-      matrix[2] * matrix[7] - matrix[8] * matrix[3] * matrix[6];
-  inverse_values[11] = -matrix[0] * matrix[5] * matrix[11] + matrix[0] * matrix[7] * matrix[9] +
-      matrix[4] * matrix[1] * matrix[11] - matrix[4] * matrix[3] * matrix[9] - matrix[8] *
-      matrix[1] * matrix[7] + matrix[8] * matrix[3] * matrix[5];
-  inverse_values[15] = matrix[0] * matrix[5] * matrix[10] - matrix[0] * matrix[6] * matrix[9] -
-      matrix[4] * matrix[1] * matrix[10] + matrix[4] * matrix[2] * matrix[9] + matrix[8] *
-      matrix[1] * matrix[6] - matrix[8] * matrix[2] * matrix[5];
+  GetTransformKernels().inverse_cofactors(matrix, inverse_values);
   float det = matrix[0] * inverse_values[0] + matrix[1] * inverse_values[4] + matrix[2] *
       inverse_values[8] + matrix[3] * inverse_values[12];
   // TODO(brkho): Use a more numerically stable method here.
@@ -171,6 +551,11 @@ bool Transform::SwapsHandedness() const {
   return det < 0;
 }
 
+bool Transform::IsAffine() const {
+  return matrix.Get(3, 0) == 0.f && matrix.Get(3, 1) == 0.f && matrix.Get(3, 2) == 0.f &&
+      matrix.Get(3, 3) == 1.f;
+}
+
 bool Transform::operator==(const Transform &that) const {
   return matrix == that.matrix && matrix_inverse == that.matrix_inverse;
 }
@@ -269,7 +654,25 @@ Vector3<T> Transform::operator()(const Vector3<T> &v) const {
 
 
 Ray3f Transform::operator()(const Ray3f &r) const {
-  return Ray3f((*this)(r.origin), (*this)(r.direction), r.max_t);
+  return Ray3f((*this)(r.origin), (*this)(r.direction), r.max_t, r.time);
+}
+
+RayDifferential Transform::operator()(const RayDifferential &r) const {
+  RayDifferential transformed((*this)(static_cast<const Ray3f &>(r)));
+  transformed.has_differentials = r.has_differentials;
+  transformed.rx_origin = (*this)(r.rx_origin);
+  transformed.rx_direction = (*this)(r.rx_direction);
+  transformed.ry_origin = (*this)(r.ry_origin);
+  transformed.ry_direction = (*this)(r.ry_direction);
+  return transformed;
+}
+
+void Transform::TransformPoints(const Point3f *points, uint count, Point3f *result) const {
+  GetTransformKernels().transform_points(matrix.matrix, points, count, result);
+}
+
+void Transform::TransformVectors(const Vector3f *vectors, uint count, Vector3f *result) const {
+  GetTransformKernels().transform_vectors(matrix.matrix, vectors, count, result);
 }
 
 Transform Transform::operator*(const Transform &that) const {
@@ -280,4 +683,108 @@ std::string Transform::ToString() const {
   return "{\n" + matrix.ToString() + ",\n" + matrix_inverse.ToString() + "\n}";
 }
 
+AffineTransform::AffineTransform() : matrix{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0},
+    matrix_inverse{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0} {}
+
+AffineTransform::AffineTransform(const Transform &transform) {
+  assert(transform.IsAffine());
+  for (int i = 0; i < 12; i++) {
+    matrix[i] = transform.matrix[i];
+    matrix_inverse[i] = transform.matrix_inverse[i];
+  }
+}
+
+AffineTransform::AffineTransform(const Matrix4x4 &m) {
+  assert(m.Get(3, 0) == 0.f && m.Get(3, 1) == 0.f && m.Get(3, 2) == 0.f && m.Get(3, 3) == 1.f);
+  for (int i = 0; i < 12; i++) {
+    matrix[i] = m[i];
+  }
+  InvertAffine(matrix, matrix_inverse);
+}
+
+AffineTransform::AffineTransform(const Matrix4x4 &m, const Matrix4x4 &m_inverse) {
+  assert(m.Get(3, 0) == 0.f && m.Get(3, 1) == 0.f && m.Get(3, 2) == 0.f && m.Get(3, 3) == 1.f);
+  for (int i = 0; i < 12; i++) {
+    matrix[i] = m[i];
+    matrix_inverse[i] = m_inverse[i];
+  }
+}
+
+AffineTransform AffineTransform::Inverse() const {
+  AffineTransform inverse;
+  for (int i = 0; i < 12; i++) {
+    inverse.matrix[i] = matrix_inverse[i];
+    inverse.matrix_inverse[i] = matrix[i];
+  }
+  return inverse;
+}
+
+bool AffineTransform::SwapsHandedness() const {
+  float det = matrix[0] * (matrix[5] * matrix[10] - matrix[6] * matrix[9]) - matrix[1] *
+      (matrix[4] * matrix[10] - matrix[6] * matrix[8]) + matrix[2] * (matrix[4] * matrix[9] -
+      matrix[5] * matrix[8]);
+  return det < 0;
+}
+
+bool AffineTransform::operator==(const AffineTransform &that) const {
+  for (int i = 0; i < 12; i++) {
+    if (std::abs(matrix[i] - that.matrix[i]) > 0.000001 ||
+        std::abs(matrix_inverse[i] - that.matrix_inverse[i]) > 0.000001) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+Point3<T> AffineTransform::operator()(const Point3<T> &p) const {
+  T x = matrix[0] * p.x + matrix[1] * p.y + matrix[2] * p.z + matrix[3];
+  T y = matrix[4] * p.x + matrix[5] * p.y + matrix[6] * p.z + matrix[7];
+  T z = matrix[8] * p.x + matrix[9] * p.y + matrix[10] * p.z + matrix[11];
+  return Point3<T>(x, y, z);
+}
+
+template <typename T>
+Vector3<T> AffineTransform::operator()(const Vector3<T> &v) const {
+  T x = matrix[0] * v.x + matrix[1] * v.y + matrix[2] * v.z;
+  T y = matrix[4] * v.x + matrix[5] * v.y + matrix[6] * v.z;
+  T z = matrix[8] * v.x + matrix[9] * v.y + matrix[10] * v.z;
+  return Vector3<T>(x, y, z);
+}
+
+Ray3f AffineTransform::operator()(const Ray3f &r) const {
+  return Ray3f((*this)(r.origin), (*this)(r.direction), r.max_t, r.time);
+}
+
+RayDifferential AffineTransform::operator()(const RayDifferential &r) const {
+  RayDifferential transformed((*this)(static_cast<const Ray3f &>(r)));
+  transformed.has_differentials = r.has_differentials;
+  transformed.rx_origin = (*this)(r.rx_origin);
+  transformed.rx_direction = (*this)(r.rx_direction);
+  transformed.ry_origin = (*this)(r.ry_origin);
+  transformed.ry_direction = (*this)(r.ry_direction);
+  return transformed;
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform &that) const {
+  AffineTransform composed;
+  MultiplyAffine(matrix, that.matrix, composed.matrix);
+  MultiplyAffine(that.matrix_inverse, matrix_inverse, composed.matrix_inverse);
+  return composed;
+}
+
+Transform AffineTransform::ToTransform() const {
+  float values[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  float inverse_values[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  for (int i = 0; i < 12; i++) {
+    values[i] = matrix[i];
+    inverse_values[i] = matrix_inverse[i];
+  }
+  return Transform(Matrix4x4(values), Matrix4x4(inverse_values));
+}
+
+std::string AffineTransform::ToString() const {
+  return ToTransform().ToString();
+}
+
 }
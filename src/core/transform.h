@@ -56,6 +56,9 @@ class Matrix4x4 {
     // Private member variable storing the data. This should only be accessed using Matrix4x4
     // methods to eliminate indexing errors.
     float matrix[16];
+
+    // Transform hands the data straight to its batch kernels.
+    friend class Transform;
 };
 
 // A 3D transformation backed by a Matrix4x4 used to transform points, vecttors, normals, rays, and
@@ -81,6 +84,10 @@ class Transform {
     // Returns whether the transform swaps the handedness of the coordinate space.
     bool SwapsHandedness() const;
 
+    // Returns whether the bottom row of the matrix is exactly (0, 0, 0, 1), meaning the transform
+    // can be represented by an AffineTransform.
+    bool IsAffine() const;
+
     // Tests if two transforms are equal by comparing their matrices.
     bool operator==(const Transform &that) const;
 
@@ -111,6 +118,19 @@ class Transform {
     // Transforms a ray by transforming its origin and direction.
     Ray3f operator()(const Ray3f &r) const;
 
+    // Transforms a ray differential by transforming the main ray and both offset rays.
+    RayDifferential operator()(const RayDifferential &r) const;
+
+    // Transforms count points into result, which may be the same array as points. This gives the
+    // same results as transforming each point on its own, but uses the widest SIMD instructions
+    // the CPU supports.
+    void TransformPoints(const Point3f *points, uint count, Point3f *result) const;
+
+    // Transforms count vectors into result, which may be the same array as vectors. This gives
+    // the same results as transforming each vector on its own, but uses the widest SIMD
+    // instructions the CPU supports.
+    void TransformVectors(const Vector3f *vectors, uint count, Vector3f *result) const;
+
     // Transforms a bounding box by transforming each one of its corners and computing a new
     // bounding box that encompasses the resulting points.
     template <typename T>
@@ -131,6 +151,92 @@ class Transform {
   private:
     // The matrix backing the transform and its inverse.
     Matrix4x4 matrix, matrix_inverse;
+
+    // AffineTransform copies the matrices of the Transform it is converted from.
+    friend class AffineTransform;
+};
+
+// A 3D transformation restricted to affine maps, whose matrices always have a bottom row of
+// (0, 0, 0, 1). Only the top three rows of the matrix and its inverse are stored, and points are
+// transformed without computing w or dividing by it, which gives the same results as a Transform
+// with the same matrix. Shapes are placed with these, leaving the projective Transform to cameras.
+class AffineTransform {
+  public:
+    // Default constructor initializing the transform to the identity matrix.
+    AffineTransform();
+
+    // Constructor converting an affine Transform, reusing its inverse rather than computing one.
+    explicit AffineTransform(const Transform &transform);
+
+    // Constructor initializing the transform with an affine matrix. The inverse is then explicitly
+    // computed.
+    explicit AffineTransform(const Matrix4x4 &m);
+
+    // Constructor initializing the transform with an affine matrix and its inverse.
+    AffineTransform(const Matrix4x4 &m, const Matrix4x4 &m_inverse);
+
+    // Returns a transform that is the inverse of the current one.
+    AffineTransform Inverse() const;
+
+    // Returns whether the transform swaps the handedness of the coordinate space.
+    bool SwapsHandedness() const;
+
+    // Tests if two transforms are equal by comparing their matrices.
+    bool operator==(const AffineTransform &that) const;
+
+    // Transforms a point by multiplying the point with the matrix.
+    template <typename T>
+    Point3<T> operator()(const Point3<T> &p) const;
+
+    // Transforms a vector by multiplying the vector with the matrix. Vectors are not affected by
+    // translation.
+    template <typename T>
+    Vector3<T> operator()(const Vector3<T> &v) const;
+
+    // Transforms a normal by multiplying with the transpose of the inverse of the matrix.
+    template <typename T>
+    Normal3<T> operator()(const Normal3<T> &n) const {
+      T x = matrix_inverse[0] * n.x + matrix_inverse[4] * n.y + matrix_inverse[8] * n.z;
+      T y = matrix_inverse[1] * n.x + matrix_inverse[5] * n.y + matrix_inverse[9] * n.z;
+      T z = matrix_inverse[2] * n.x + matrix_inverse[6] * n.y + matrix_inverse[10] * n.z;
+      return Normal3<T>(x, y, z);
+    }
+
+    // Transforms a ray by transforming its origin and direction.
+    Ray3f operator()(const Ray3f &r) const;
+
+    // Transforms a ray differential by transforming the main ray and both offset rays.
+    RayDifferential operator()(const RayDifferential &r) const;
+
+    // Transforms a bounding box by transforming each one of its corners and computing a new
+    // bounding box that encompasses the resulting points.
+    template <typename T>
+    AABB3<T> operator()(const AABB3<T> &b) const {
+      AABB3<T> new_box = AABB3<T>((*this)(b.Corner(0)));
+      for (int i = 1; i < 8; i++) {
+        new_box = Union(new_box, AABB3<T>((*this)(b.Corner(i))));
+      }
+      return new_box;
+    }
+
+    // Composes two transforms, applying that and then this.
+    AffineTransform operator*(const AffineTransform &that) const;
+
+    // Returns the equivalent projective Transform, for composing with cameras.
+    Transform ToTransform() const;
+
+    // Pretty prints an AffineTransform.
+    std::string ToString() const;
+
+  private:
+    // The top three rows of the matrix backing the transform and of its inverse in row-major
+    // order.
+    float matrix[12], matrix_inverse[12];
+
+    // TransformCache hashes and compares the bits of the matrices.
+    friend class TransformCache;
+    // AnimatedTransform decomposes its keyframes and builds interpolated transforms in place.
+    friend class AnimatedTransform;
 };
 
 // Returns a transform that translates in the given direction.
@@ -0,0 +1,55 @@
+#include "core/transform_cache.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+// Returns the bits of a float, with -0 folded into 0 so that the two compare and hash alike.
+static uint32_t CanonicalBits(float value) {
+  uint32_t bits = 0;
+  if (value != 0.f) {
+    std::memcpy(&bits, &value, sizeof(float));
+  }
+  return bits;
+}
+
+uint64_t TransformCache::Hash(const AffineTransform &transform) {
+  uint64_t hash = 0;
+  for (uint i = 0; i < 12; i++) {
+    hash = MixBits(hash ^ (((uint64_t)CanonicalBits(transform.matrix[i]) << 32) |
+        CanonicalBits(transform.matrix_inverse[i])));
+  }
+  return hash;
+}
+
+bool TransformCache::Identical(const AffineTransform &a, const AffineTransform &b) {
+  for (uint i = 0; i < 12; i++) {
+    if (CanonicalBits(a.matrix[i]) != CanonicalBits(b.matrix[i]) ||
+        CanonicalBits(a.matrix_inverse[i]) != CanonicalBits(b.matrix_inverse[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TransformCache::TransformCache() : mutex{}, transforms{}, index{} {}
+
+const AffineTransform *TransformCache::Intern(const AffineTransform &transform) {
+  uint64_t hash = Hash(transform);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto range = index.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (Identical(transforms[it->second], transform)) {
+      return &transforms[it->second];
+    }
+  }
+  index.emplace(hash, (uint)transforms.size());
+  transforms.push_back(transform);
+  return &transforms.back();
+}
+
+uint TransformCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return transforms.size();
+}
+
+}
@@ -0,0 +1,56 @@
+// This header defines the TransformCache, which interns the transforms shapes are placed with.
+// Shapes only keep a pointer to their object to world transform, so something has to own the
+// transform for as long as the shapes exist. The cache owns one copy of every distinct transform
+// it is given and hands out pointers to it, so the many meshes of a scene that share a placement
+// also share a single transform.
+//
+// Transforms are only shared if they are bit-identical, except that -0 and 0 count as the same.
+// Ones that are merely equal within the tolerance of AffineTransform::operator==() are kept apart,
+// since sharing them would move shapes.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_CORE_TRANSFORM_CACHE_H
+#define LIANG_CORE_TRANSFORM_CACHE_H
+
+#include "core/liang.h"
+#include "core/transform.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace liang {
+
+class TransformCache {
+  public:
+    // TransformCache constructor that starts the cache out empty.
+    TransformCache();
+
+    // Returns the cache's copy of the given transform, adding one if no bit-identical transform
+    // is in the cache yet. The pointer stays valid for as long as the cache exists. This can be
+    // called from several threads at once.
+    const AffineTransform *Intern(const AffineTransform &transform);
+
+    // Returns the number of distinct transforms in the cache.
+    uint Size() const;
+
+  private:
+    // Hashes the bits of a transform's matrices, treating -0 as 0.
+    static uint64_t Hash(const AffineTransform &transform);
+
+    // Returns whether two transforms have bit-identical matrices, treating -0 as 0.
+    static bool Identical(const AffineTransform &a, const AffineTransform &b);
+
+    // Guards the transforms and the index.
+    mutable std::mutex mutex;
+    // The interned transforms. A deque never moves its elements as it grows, which keeps the
+    // pointers handed out valid.
+    std::deque<AffineTransform> transforms;
+    // The indices into transforms of the transforms with each hash.
+    std::unordered_multimap<uint64_t, uint> index;
+};
+
+}
+
+#endif  // LIANG_CORE_TRANSFORM_CACHE_H
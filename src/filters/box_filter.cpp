@@ -2,9 +2,9 @@
 
 namespace liang {
 
-BoxFilter::BoxFilter(float radius) : Filter(radius) {}
+BoxFilter::BoxFilter(float radius) : SeparableFilter(radius) {}
 
-float BoxFilter::Evaluate(const Point2f &location) const {
+float BoxFilter::Evaluate1D(float /* offset */) const {
   return 1.f;
 }
 
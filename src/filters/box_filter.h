@@ -9,17 +9,17 @@
 
 #include "core/geometry.h"
 #include "core/liang.h"
-#include "filters/filter.h"
+#include "filters/separable_filter.h"
 
 namespace liang {
 
-class BoxFilter : public Filter {
+class BoxFilter : public SeparableFilter {
   public:
     // BoxFilter constructor that takes a radius and precomputes its inverse.
     BoxFilter(float radius);
 
     // Equal weighting, so always return 1.
-    float Evaluate(const Point2f &location) const;
+    float Evaluate1D(float offset) const;
 };
 
 }
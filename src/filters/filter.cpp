@@ -4,4 +4,8 @@ namespace liang {
 
 Filter::Filter(float radius) : radius{radius}, radius_inverse{1.f / radius} {}
 
+float Filter::GetRadius() const {
+  return radius;
+}
+
 }
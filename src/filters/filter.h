@@ -17,9 +17,14 @@ class Filter {
     // Filter constructor that takes a radius and precomputes its inverse.
     Filter(float radius);
 
+    virtual ~Filter() {}
+
     // Takes a point relative to (0, 0) and returns it contribution based on the filter.
     virtual float Evaluate(const Point2f &location) const = 0;
 
+    // Gets the radius of the filter.
+    float GetRadius() const;
+
   protected:
     // The radius/extent of the filter. All points further than the radius will have 0 contribution.
     float radius;
@@ -0,0 +1,26 @@
+#include "filters/filter_table.h"
+#include "filters/separable_filter.h"
+
+namespace liang {
+
+FilterTable::FilterTable(const Filter &filter) : radius{filter.GetRadius()},
+    index_scale{WIDTH / filter.GetRadius()}, separable{false} {
+  const SeparableFilter *separable_filter = dynamic_cast<const SeparableFilter *>(&filter);
+  if (separable_filter) {
+    separable = true;
+    axis_weights.resize(WIDTH);
+    for (uint i = 0; i < WIDTH; i++) {
+      axis_weights[i] = separable_filter->Evaluate1D((i + 0.5f) * radius / WIDTH);
+    }
+    return;
+  }
+  weights.resize(WIDTH * WIDTH);
+  for (uint y = 0; y < WIDTH; y++) {
+    for (uint x = 0; x < WIDTH; x++) {
+      Point2f location = Point2f((x + 0.5f) * radius / WIDTH, (y + 0.5f) * radius / WIDTH);
+      weights[y * WIDTH + x] = filter.Evaluate(location);
+    }
+  }
+}
+
+}
@@ -0,0 +1,61 @@
+// This header defines the FilterTable, a precomputed table of a Filter's weights. The Film splats
+// every sample onto all the pixels within the filter's radius, and reading the weights out of a
+// table keeps that down to a lookup per pixel instead of a virtual call. Filters are assumed to be
+// symmetric about both axes, so only one quadrant of the filter is stored. SeparableFilters only
+// store a single axis, and the weight of a pixel is the product of its row and column weights.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_FILTERS_FILTER_TABLE_H
+#define LIANG_FILTERS_FILTER_TABLE_H
+
+#include "core/liang.h"
+#include "filters/filter.h"
+
+namespace liang {
+
+class FilterTable {
+  public:
+    // The number of entries along each axis of the table.
+    static const uint WIDTH = 16;
+
+    // FilterTable constructor that tabulates the given filter at the center of every entry.
+    FilterTable(const Filter &filter);
+
+    // Gets the radius of the tabulated filter.
+    float GetRadius() const { return radius; }
+
+    // Returns whether the tabulated filter is separable, in which case GetAxisWeight() may be used.
+    bool IsSeparable() const { return separable; }
+
+    // Returns the table index along either axis of an offset from the center of the filter. The
+    // offset must be within the radius.
+    uint OffsetToIndex(float offset) const {
+      return std::min((uint)(std::abs(offset) * index_scale), WIDTH - 1);
+    }
+
+    // Gets the weight at the given table indices.
+    float GetWeight(uint x_index, uint y_index) const {
+      return separable ? axis_weights[x_index] * axis_weights[y_index] :
+          weights[y_index * WIDTH + x_index];
+    }
+
+    // Gets the weight of a separable filter along a single axis at the given table index.
+    float GetAxisWeight(uint index) const { return axis_weights[index]; }
+
+  private:
+    // The radius of the tabulated filter.
+    float radius;
+    // Converts an offset from the center of the filter to a table index.
+    float index_scale;
+    // Whether the tabulated filter is separable.
+    bool separable;
+    // The weights along a single axis of a separable filter.
+    std::vector<float> axis_weights;
+    // The weights of a filter that is not separable in row-major order.
+    std::vector<float> weights;
+};
+
+}
+
+#endif  // LIANG_FILTERS_FILTER_TABLE_H
@@ -0,0 +1,12 @@
+#include "filters/gaussian_filter.h"
+
+namespace liang {
+
+GaussianFilter::GaussianFilter(float radius, float alpha) : SeparableFilter(radius), alpha{alpha},
+    edge_value{std::exp(-alpha * radius * radius)} {}
+
+float GaussianFilter::Evaluate1D(float offset) const {
+  return std::max(0.f, std::exp(-alpha * offset * offset) - edge_value);
+}
+
+}
@@ -0,0 +1,34 @@
+// This header defines the GaussianFilter, a reconstruction filter that weights samples by a
+// Gaussian bump. The Gaussian is shifted down by its value at the radius so that it falls off to
+// exactly 0 at the edge of the filter. It gives slightly blurry but ringing-free images.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_FILTERS_GAUSSIAN_FILTER_H
+#define LIANG_FILTERS_GAUSSIAN_FILTER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "filters/separable_filter.h"
+
+namespace liang {
+
+class GaussianFilter : public SeparableFilter {
+  public:
+    // GaussianFilter constructor that takes a radius and the falloff rate alpha, where larger
+    // values of alpha give a narrower Gaussian.
+    GaussianFilter(float radius, float alpha);
+
+    // Returns the shifted Gaussian at the given offset.
+    float Evaluate1D(float offset) const;
+
+  private:
+    // The falloff rate of the Gaussian.
+    float alpha;
+    // The value of the Gaussian at the radius, which is subtracted from every weight.
+    float edge_value;
+};
+
+}
+
+#endif  // LIANG_FILTERS_GAUSSIAN_FILTER_H
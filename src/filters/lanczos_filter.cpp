@@ -0,0 +1,25 @@
+#include "filters/lanczos_filter.h"
+#include "utils/math.h"
+
+namespace liang {
+
+// Returns the normalized sinc function sin(pi x) / (pi x).
+static float Sinc(float x) {
+  x = std::abs(x);
+  if (x < 1e-5f) {
+    return 1.f;
+  }
+  return std::sin(PI * x) / (PI * x);
+}
+
+LanczosFilter::LanczosFilter(float radius, float tau) : SeparableFilter(radius), tau{tau} {}
+
+float LanczosFilter::Evaluate1D(float offset) const {
+  offset = std::abs(offset);
+  if (offset > radius) {
+    return 0.f;
+  }
+  return Sinc(offset) * Sinc(offset / tau);
+}
+
+}
@@ -0,0 +1,32 @@
+// This header defines the LanczosFilter, a windowed sinc reconstruction filter. The sinc is the
+// ideal low-pass filter, and windowing it with a wider sinc brings it to 0 at the radius. Like
+// the MitchellFilter, it sharpens edges with negative lobes.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_FILTERS_LANCZOS_FILTER_H
+#define LIANG_FILTERS_LANCZOS_FILTER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "filters/separable_filter.h"
+
+namespace liang {
+
+class LanczosFilter : public SeparableFilter {
+  public:
+    // LanczosFilter constructor that takes a radius and tau, the number of cycles of the sinc
+    // that pass before the window falls to 0.
+    LanczosFilter(float radius, float tau = 3.f);
+
+    // Returns the windowed sinc at the given offset.
+    float Evaluate1D(float offset) const;
+
+  private:
+    // The number of cycles of the sinc that pass before the window falls to 0.
+    float tau;
+};
+
+}
+
+#endif  // LIANG_FILTERS_LANCZOS_FILTER_H
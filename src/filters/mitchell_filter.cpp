@@ -0,0 +1,21 @@
+#include "filters/mitchell_filter.h"
+
+namespace liang {
+
+MitchellFilter::MitchellFilter(float radius, float b, float c) : SeparableFilter(radius), b{b},
+    c{c} {}
+
+float MitchellFilter::Evaluate1D(float offset) const {
+  float x = std::abs(2.f * offset * radius_inverse);
+  if (x > 2.f) {
+    return 0.f;
+  } else if (x > 1.f) {
+    return ((-b - 6.f * c) * x * x * x + (6.f * b + 30.f * c) * x * x +
+        (-12.f * b - 48.f * c) * x + (8.f * b + 24.f * c)) * (1.f / 6.f);
+  } else {
+    return ((12.f - 9.f * b - 6.f * c) * x * x * x + (-18.f + 12.f * b + 6.f * c) * x * x +
+        (6.f - 2.f * b)) * (1.f / 6.f);
+  }
+}
+
+}
@@ -0,0 +1,34 @@
+// This header defines the MitchellFilter, the piecewise cubic reconstruction filter of Mitchell and
+// Netravali. Its negative lobes sharpen edges, at the cost of some ringing for extreme values of
+// the parameters. Mitchell and Netravali recommend choosing B and C along the line B + 2C = 1.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_FILTERS_MITCHELL_FILTER_H
+#define LIANG_FILTERS_MITCHELL_FILTER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "filters/separable_filter.h"
+
+namespace liang {
+
+class MitchellFilter : public SeparableFilter {
+  public:
+    // MitchellFilter constructor that takes a radius and the B and C parameters of the cubic. This
+    // defaults to B = C = 1/3, the values Mitchell and Netravali found to look best.
+    MitchellFilter(float radius, float b = 1.f / 3.f, float c = 1.f / 3.f);
+
+    // Returns the cubic at the given offset, with the radius scaled to the cubic's extent of 2.
+    float Evaluate1D(float offset) const;
+
+  private:
+    // The B parameter of the cubic.
+    float b;
+    // The C parameter of the cubic.
+    float c;
+};
+
+}
+
+#endif  // LIANG_FILTERS_MITCHELL_FILTER_H
@@ -0,0 +1,11 @@
+#include "filters/separable_filter.h"
+
+namespace liang {
+
+SeparableFilter::SeparableFilter(float radius) : Filter(radius) {}
+
+float SeparableFilter::Evaluate(const Point2f &location) const {
+  return Evaluate1D(location.x) * Evaluate1D(location.y);
+}
+
+}
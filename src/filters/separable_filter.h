@@ -0,0 +1,31 @@
+// This header defines the SeparableFilter interface, a Filter whose weight is the product of a
+// one dimensional filter along each axis. Implementations only define Evaluate1D(). The Film's
+// FilterTable stores a single axis of a separable filter, so splatting a sample costs a table
+// lookup per row and column and a multiply per pixel.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_FILTERS_SEPARABLE_FILTER_H
+#define LIANG_FILTERS_SEPARABLE_FILTER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "filters/filter.h"
+
+namespace liang {
+
+class SeparableFilter : public Filter {
+  public:
+    // SeparableFilter constructor that takes a radius and precomputes its inverse.
+    SeparableFilter(float radius);
+
+    // Returns the product of the one dimensional filter along each axis.
+    float Evaluate(const Point2f &location) const;
+
+    // Takes an offset from 0 along a single axis and returns its contribution.
+    virtual float Evaluate1D(float offset) const = 0;
+};
+
+}
+
+#endif  // LIANG_FILTERS_SEPARABLE_FILTER_H
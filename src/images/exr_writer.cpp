@@ -0,0 +1,335 @@
+#include "images/exr_writer.h"
+#include "utils/half.h"
+
+#include <algorithm>
+
+namespace liang {
+
+// The magic number at the start of every EXR file.
+static const uint32_t EXR_MAGIC = 20000630;
+// Version 2 of the format, with no flags set, for a single part scanline file.
+static const uint32_t EXR_VERSION = 2;
+// The version flag marking a single part tiled file.
+static const uint32_t EXR_TILED_FLAG = 0x200;
+// The line orders of the blocks in a file. Tiled files written in any order use random y.
+static const char EXR_INCREASING_Y = 0;
+static const char EXR_RANDOM_Y = 2;
+// The shortest run RLE encodes as a run rather than as literal bytes.
+static const int RLE_MIN_RUN = 3;
+// The longest run or literal sequence RLE encodes at once.
+static const int RLE_MAX_RUN = 127;
+
+// Appends an unsigned integer in little endian byte order.
+template <typename T>
+static void AppendLittleEndian(std::vector<char> *bytes, T value) {
+  for (uint i = 0; i < sizeof(T); i++) {
+    bytes->push_back((char)((value >> (8 * i)) & 0xff));
+  }
+}
+
+// Appends the bits of a float in little endian byte order.
+static void AppendFloat(std::vector<char> *bytes, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  AppendLittleEndian(bytes, bits);
+}
+
+// Appends a null terminated string.
+static void AppendString(std::vector<char> *bytes, const std::string &value) {
+  bytes->insert(bytes->end(), value.begin(), value.end());
+  bytes->push_back('\0');
+}
+
+// Appends a header attribute with the given name, type, and value.
+static void AppendAttribute(std::vector<char> *header, const std::string &name,
+    const std::string &type, const std::vector<char> &value) {
+  AppendString(header, name);
+  AppendString(header, type);
+  AppendLittleEndian(header, (uint32_t)value.size());
+  header->insert(header->end(), value.begin(), value.end());
+}
+
+// Appends a box2i attribute covering the whole image.
+static void AppendBox(std::vector<char> *header, const std::string &name, uint width,
+    uint height) {
+  std::vector<char> box;
+  AppendLittleEndian(&box, (uint32_t)0);
+  AppendLittleEndian(&box, (uint32_t)0);
+  AppendLittleEndian(&box, (uint32_t)(width - 1));
+  AppendLittleEndian(&box, (uint32_t)(height - 1));
+  AppendAttribute(header, name, "box2i", box);
+}
+
+// Returns the channels of a file with R, G, and B channels of the given type and extra float
+// channels with the given names. Channels must be listed in the byte order of their names, which
+// is also the order they appear in blocks.
+static std::vector<ExrChannel> ChannelLayout(ExrPixelType pixel_type,
+    const std::vector<std::string> &extra_channels) {
+  std::vector<ExrChannel> layout = {{"R", pixel_type, 0}, {"G", pixel_type, 1},
+      {"B", pixel_type, 2}};
+  for (uint channel = 0; channel < extra_channels.size(); channel++) {
+    assert(!extra_channels[channel].empty());
+    layout.push_back({extra_channels[channel], ExrPixelType::FLOAT, 3 + channel});
+  }
+  std::sort(layout.begin(), layout.end(), [](const ExrChannel &a, const ExrChannel &b) {
+    return a.name < b.name;
+  });
+  for (uint i = 1; i < layout.size(); i++) {
+    assert(layout[i - 1].name != layout[i].name);
+  }
+  return layout;
+}
+
+// Appends the header of a single part file with the given channels. The file is tiled with the
+// given tile size unless it is 0.
+static void AppendHeader(std::vector<char> *header, uint width, uint height,
+    const std::vector<ExrChannel> &layout, ExrCompression compression, uint tile_size) {
+  AppendLittleEndian(header, EXR_MAGIC);
+  AppendLittleEndian(header, tile_size > 0 ? EXR_VERSION | EXR_TILED_FLAG : EXR_VERSION);
+  std::vector<char> channels;
+  for (const ExrChannel &channel : layout) {
+    AppendString(&channels, channel.name);
+    AppendLittleEndian(&channels, (uint32_t)channel.pixel_type);
+    // The linear flag followed by three reserved bytes.
+    AppendLittleEndian(&channels, (uint32_t)0);
+    // The x and y sampling rates.
+    AppendLittleEndian(&channels, (uint32_t)1);
+    AppendLittleEndian(&channels, (uint32_t)1);
+  }
+  channels.push_back('\0');
+  AppendAttribute(header, "channels", "chlist", channels);
+  AppendAttribute(header, "compression", "compression", {(char)compression});
+  AppendBox(header, "dataWindow", width, height);
+  AppendBox(header, "displayWindow", width, height);
+  AppendAttribute(header, "lineOrder", "lineOrder",
+      {tile_size > 0 ? EXR_RANDOM_Y : EXR_INCREASING_Y});
+  std::vector<char> aspect_ratio;
+  AppendFloat(&aspect_ratio, 1.f);
+  AppendAttribute(header, "pixelAspectRatio", "float", aspect_ratio);
+  std::vector<char> window_center;
+  AppendFloat(&window_center, 0.f);
+  AppendFloat(&window_center, 0.f);
+  AppendAttribute(header, "screenWindowCenter", "v2f", window_center);
+  std::vector<char> window_width;
+  AppendFloat(&window_width, 1.f);
+  AppendAttribute(header, "screenWindowWidth", "float", window_width);
+  if (tile_size > 0) {
+    std::vector<char> tiles;
+    AppendLittleEndian(&tiles, (uint32_t)tile_size);
+    AppendLittleEndian(&tiles, (uint32_t)tile_size);
+    // A single resolution level, rounding down.
+    tiles.push_back('\0');
+    AppendAttribute(header, "tiles", "tiledesc", tiles);
+  }
+  header->push_back('\0');
+}
+
+// Appends the channels of num_rows rows of interleaved RGB triples to the data of a block, along
+// with the extra channels, which hold width * num_rows values of each channel in turn. Each row
+// is stored as all of its values of each channel in the order of the layout.
+static void AppendRows(std::vector<char> *block, const float *rgb, const float *channel_values,
+    const std::vector<ExrChannel> &layout, uint width, uint num_rows) {
+  for (uint y = 0; y < num_rows; y++) {
+    const float *row = rgb + (size_t)y * width * 3;
+    for (const ExrChannel &channel : layout) {
+      const float *values = channel.source < 3 ? row + channel.source :
+          channel_values + ((size_t)(channel.source - 3) * num_rows + y) * width;
+      uint stride = channel.source < 3 ? 3 : 1;
+      for (uint x = 0; x < width; x++) {
+        float value = values[x * stride];
+        if (channel.pixel_type == ExrPixelType::HALF) {
+          AppendLittleEndian(block, FloatToHalf(value));
+        } else {
+          AppendFloat(block, value);
+        }
+      }
+    }
+  }
+}
+
+// Returns the data to store for a block, which is the compressed data unless compression failed
+// to shrink it.
+static const std::vector<char> &CompressBlock(const std::vector<char> &block,
+    ExrCompression compression, std::vector<char> *compressed, std::vector<char> *scratch) {
+  if (compression == ExrCompression::RLE) {
+    ExrRleCompress(block, compressed, scratch);
+    if (compressed->size() < block.size()) {
+      return *compressed;
+    }
+  }
+  return block;
+}
+
+ExrWriter::ExrWriter(const std::string &name, uint width, uint height, ExrPixelType pixel_type,
+    ExrCompression compression, const std::vector<std::string> &channels) :
+    ImageWriter(width, height, channels), file{name, std::ios::binary | std::ios::trunc},
+    layout{ChannelLayout(pixel_type, channels)}, compression{compression}, ok{true} {
+  assert(width > 0 && height > 0);
+  std::vector<char> header;
+  AppendHeader(&header, width, height, layout, compression, 0);
+  file.write(header.data(), header.size());
+  // Reserve the offset table, which is filled in once every block has been written.
+  offset_table_position = file.tellp();
+  std::vector<char> offset_table(height * sizeof(uint64_t), 0);
+  file.write(offset_table.data(), offset_table.size());
+  ok = file.good();
+}
+
+ExrWriter::~ExrWriter() {
+  if (file.is_open()) {
+    Close();
+  }
+}
+
+bool ExrWriter::WriteRow(const float *rgb, const float *channel_values) {
+  assert(channel_values || channels.empty());
+  if (!ok || offsets.size() >= height) {
+    ok = false;
+    return false;
+  }
+  block.clear();
+  AppendRows(&block, rgb, channel_values, layout, width, 1);
+  const std::vector<char> &data = CompressBlock(block, compression, &compressed, &scratch);
+  std::vector<char> block_header;
+  AppendLittleEndian(&block_header, (uint32_t)offsets.size());
+  AppendLittleEndian(&block_header, (uint32_t)data.size());
+  offsets.push_back((uint64_t)file.tellp());
+  file.write(block_header.data(), block_header.size());
+  file.write(data.data(), data.size());
+  ok = file.good();
+  return ok;
+}
+
+bool ExrWriter::Close() {
+  if (!file.is_open()) {
+    return false;
+  }
+  ok = ok && offsets.size() == height;
+  std::vector<char> offset_table;
+  for (uint64_t offset : offsets) {
+    AppendLittleEndian(&offset_table, offset);
+  }
+  file.seekp(offset_table_position);
+  file.write(offset_table.data(), offset_table.size());
+  ok = ok && file.good();
+  file.close();
+  return ok;
+}
+
+TiledExrWriter::TiledExrWriter(const std::string &name, uint width, uint height, uint tile_size,
+    ExrPixelType pixel_type, ExrCompression compression) :
+    TiledImageWriter(width, height, tile_size), file{name, std::ios::binary | std::ios::trunc},
+    layout{ChannelLayout(pixel_type, std::vector<std::string>())}, compression{compression},
+    tiles_written{0}, ok{true} {
+  assert(width > 0 && height > 0 && tile_size > 0);
+  std::vector<char> header;
+  AppendHeader(&header, width, height, layout, compression, tile_size);
+  file.write(header.data(), header.size());
+  // Reserve the offset table. Missing tiles keep an offset of 0 until they are written.
+  offset_table_position = file.tellp();
+  written.resize(NumTilesX() * NumTilesY(), false);
+  std::vector<char> offset_table(written.size() * sizeof(uint64_t), 0);
+  file.write(offset_table.data(), offset_table.size());
+  file.flush();
+  ok = file.good();
+}
+
+TiledExrWriter::~TiledExrWriter() {
+  if (file.is_open()) {
+    Close();
+  }
+}
+
+bool TiledExrWriter::WriteTile(uint tile_x, uint tile_y, const float *rgb) {
+  uint tile_index = tile_y * NumTilesX() + tile_x;
+  if (!ok || tile_x >= NumTilesX() || tile_y >= NumTilesY() || written[tile_index]) {
+    ok = false;
+    return false;
+  }
+  uint tile_width = std::min(tile_size, width - tile_x * tile_size);
+  uint tile_height = std::min(tile_size, height - tile_y * tile_size);
+  block.clear();
+  AppendRows(&block, rgb, nullptr, layout, tile_width, tile_height);
+  const std::vector<char> &data = CompressBlock(block, compression, &compressed, &scratch);
+  std::vector<char> block_header;
+  AppendLittleEndian(&block_header, (uint32_t)tile_x);
+  AppendLittleEndian(&block_header, (uint32_t)tile_y);
+  // The resolution level of the tile along each axis.
+  AppendLittleEndian(&block_header, (uint32_t)0);
+  AppendLittleEndian(&block_header, (uint32_t)0);
+  AppendLittleEndian(&block_header, (uint32_t)data.size());
+  file.seekp(0, std::ios::end);
+  uint64_t offset = (uint64_t)file.tellp();
+  file.write(block_header.data(), block_header.size());
+  file.write(data.data(), data.size());
+  // Point the offset table at the tile only once the tile is complete, so a reader polling the
+  // file never follows an offset to a partial tile.
+  std::vector<char> offset_bytes;
+  AppendLittleEndian(&offset_bytes, offset);
+  file.flush();
+  file.seekp(offset_table_position + (std::streamoff)(tile_index * sizeof(uint64_t)));
+  file.write(offset_bytes.data(), offset_bytes.size());
+  file.flush();
+  written[tile_index] = true;
+  tiles_written++;
+  ok = file.good();
+  return ok;
+}
+
+bool TiledExrWriter::Close() {
+  if (!file.is_open()) {
+    return false;
+  }
+  ok = ok && tiles_written == written.size();
+  file.close();
+  return ok;
+}
+
+void ExrRleCompress(const std::vector<char> &data, std::vector<char> *compressed,
+    std::vector<char> *scratch) {
+  // Split the data into its even bytes followed by its odd bytes, which groups the similar high
+  // bytes of neighboring values together.
+  size_t size = data.size();
+  scratch->resize(size);
+  size_t half_size = (size + 1) / 2;
+  for (size_t i = 0; i < size; i++) {
+    (*scratch)[i % 2 == 0 ? i / 2 : half_size + i / 2] = data[i];
+  }
+  // Replace every byte but the first with its difference from the previous byte.
+  unsigned char previous = size > 0 ? (unsigned char)(*scratch)[0] : 0;
+  for (size_t i = 1; i < size; i++) {
+    unsigned char current = (unsigned char)(*scratch)[i];
+    (*scratch)[i] = (char)(unsigned char)(current - previous + 128);
+    previous = current;
+  }
+  // Encode runs of at least RLE_MIN_RUN equal bytes as a count and the byte, and everything else
+  // as a negated count followed by the bytes themselves.
+  compressed->clear();
+  const char *in = scratch->data();
+  const char *end = in + size;
+  const char *run_start = in;
+  const char *run_end = in + 1;
+  while (run_start < end) {
+    while (run_end < end && *run_start == *run_end && run_end - run_start - 1 < RLE_MAX_RUN) {
+      run_end++;
+    }
+    if (run_end - run_start >= RLE_MIN_RUN) {
+      compressed->push_back((char)((run_end - run_start) - 1));
+      compressed->push_back(*run_start);
+      run_start = run_end;
+    } else {
+      while (run_end < end &&
+          ((run_end + 1 >= end || *run_end != *(run_end + 1)) ||
+          (run_end + 2 >= end || *(run_end + 1) != *(run_end + 2))) &&
+          run_end - run_start < RLE_MAX_RUN) {
+        run_end++;
+      }
+      compressed->push_back((char)(run_start - run_end));
+      compressed->insert(compressed->end(), run_start, run_end);
+      run_start = run_end;
+    }
+    run_end++;
+  }
+}
+
+}
@@ -0,0 +1,140 @@
+// This header defines the ExrWriter, which streams an image to an OpenEXR file one scanline at a
+// time. Images are written as a single part scanline file with R, G, and B channels stored as
+// either half or full floats, and every scanline is its own block so nothing but the current row
+// is ever held in memory. The offset table is filled in by Close() once every block's position is
+// known. Extra channels, such as depth or primitive IDs, are always stored as full floats so
+// their values survive exactly.
+//
+// It also defines the TiledExrWriter, which writes a single part tiled file whose tiles can arrive
+// in any order. Each tile's entry in the offset table is filled in as soon as the tile is written,
+// so a viewer that tolerates missing tiles can watch the image fill in while it renders.
+//
+// Two of the lossless EXR compression schemes are supported: none at all, and RLE, which is fast
+// to encode and works well on the flat regions common in renders. Following the format, a block
+// that RLE does not shrink is stored uncompressed.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_EXR_WRITER_H
+#define LIANG_IMAGES_EXR_WRITER_H
+
+#include "core/liang.h"
+#include "images/image_writer.h"
+#include "images/tiled_image_writer.h"
+
+#include <fstream>
+
+namespace liang {
+
+// The types the channels of an EXR file can be stored as. The values match the file format.
+enum class ExrPixelType : uint32_t {
+  HALF = 1,
+  FLOAT = 2
+};
+
+// The compression schemes supported by the ExrWriter. The values match the file format.
+enum class ExrCompression : uint8_t {
+  NONE = 0,
+  RLE = 1
+};
+
+// A channel of an EXR file and where its values come from.
+struct ExrChannel {
+  // The name of the channel in the file.
+  std::string name;
+  // The type the channel is stored as.
+  ExrPixelType pixel_type;
+  // The index of the color component the channel holds, or 3 plus the index of the extra channel.
+  uint source;
+};
+
+class ExrWriter : public ImageWriter {
+  public:
+    // ExrWriter constructor that takes the name of the file to write, the dimensions of the image,
+    // the type to store the color channels as, the compression scheme, and the names of any extra
+    // channels. This opens the file and writes the header.
+    ExrWriter(const std::string &name, uint width, uint height,
+        ExrPixelType pixel_type = ExrPixelType::HALF,
+        ExrCompression compression = ExrCompression::RLE,
+        const std::vector<std::string> &channels = std::vector<std::string>());
+
+    // Closes the file if Close() has not been called yet.
+    ~ExrWriter();
+
+    // Encodes and writes the next scanline.
+    bool WriteRow(const float *rgb, const float *channel_values = nullptr);
+
+    // Fills in the offset table and closes the file.
+    bool Close();
+
+  private:
+    // The file being written.
+    std::ofstream file;
+    // The channels of the file in the order they are stored.
+    std::vector<ExrChannel> layout;
+    // The compression scheme of the blocks.
+    ExrCompression compression;
+    // The position of the offset table in the file.
+    std::streampos offset_table_position;
+    // The position in the file of every block written so far.
+    std::vector<uint64_t> offsets;
+    // Whether every write so far succeeded.
+    bool ok;
+    // The uncompressed data of the current block.
+    std::vector<char> block;
+    // Scratch space for compressing the current block.
+    std::vector<char> scratch;
+    // The compressed data of the current block.
+    std::vector<char> compressed;
+};
+
+class TiledExrWriter : public TiledImageWriter {
+  public:
+    // TiledExrWriter constructor that takes the name of the file to write, the dimensions of the
+    // image and its tiles, the type to store the channels as, and the compression scheme. This
+    // opens the file and writes the header along with an empty offset table.
+    TiledExrWriter(const std::string &name, uint width, uint height, uint tile_size,
+        ExrPixelType pixel_type = ExrPixelType::HALF,
+        ExrCompression compression = ExrCompression::RLE);
+
+    // Closes the file if Close() has not been called yet.
+    ~TiledExrWriter();
+
+    // Encodes and appends a tile, then points its entry in the offset table at it. Every tile may
+    // only be written once.
+    bool WriteTile(uint tile_x, uint tile_y, const float *rgb);
+
+    // Closes the file.
+    bool Close();
+
+  private:
+    // The file being written.
+    std::ofstream file;
+    // The channels of the file in the order they are stored.
+    std::vector<ExrChannel> layout;
+    // The compression scheme of the blocks.
+    ExrCompression compression;
+    // The position of the offset table in the file.
+    std::streampos offset_table_position;
+    // Whether each tile has been written, in scanline order.
+    std::vector<bool> written;
+    // The number of tiles written so far.
+    uint tiles_written;
+    // Whether every write so far succeeded.
+    bool ok;
+    // The uncompressed data of the current block.
+    std::vector<char> block;
+    // Scratch space for compressing the current block.
+    std::vector<char> scratch;
+    // The compressed data of the current block.
+    std::vector<char> compressed;
+};
+
+// Compresses data with the RLE scheme used by OpenEXR. The bytes are first split into the even and
+// odd bytes of the data and delta encoded, and the result is then run length encoded.
+void ExrRleCompress(const std::vector<char> &data, std::vector<char> *compressed,
+    std::vector<char> *scratch);
+
+}
+
+#endif  // LIANG_IMAGES_EXR_WRITER_H
@@ -0,0 +1,41 @@
+#include "images/image_encoder.h"
+#include "utils/parallel.h"
+
+#include <fstream>
+
+namespace liang {
+
+const uint StripEncoder::STRIP_HEIGHT;
+
+bool StripEncoder::Encode(const std::string &name, const uint8_t *rgb, uint width, uint height,
+    uint num_threads) const {
+  std::ofstream file(name, std::ios::binary | std::ios::trunc);
+  for (const std::vector<char> &part : EncodeParts(rgb, width, height, num_threads)) {
+    file.write(part.data(), part.size());
+  }
+  return file.good();
+}
+
+std::vector<char> StripEncoder::EncodeToMemory(const uint8_t *rgb, uint width, uint height,
+    uint num_threads) const {
+  std::vector<char> output;
+  for (const std::vector<char> &part : EncodeParts(rgb, width, height, num_threads)) {
+    output.insert(output.end(), part.begin(), part.end());
+  }
+  return output;
+}
+
+std::vector<std::vector<char>> StripEncoder::EncodeParts(const uint8_t *rgb, uint width,
+    uint height, uint num_threads) const {
+  uint num_strips = (height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+  std::vector<std::vector<char>> parts(num_strips + 1);
+  EncodeHeader(width, height, &parts[0]);
+  ParallelFor(num_strips, num_threads, [&](uint strip) {
+    uint first_row = strip * STRIP_HEIGHT;
+    uint rows = std::min(STRIP_HEIGHT, height - first_row);
+    EncodeStrip(rgb + (size_t)first_row * width * 3, width, rows, &parts[strip + 1]);
+  });
+  return parts;
+}
+
+}
@@ -0,0 +1,56 @@
+// This header defines the ImageEncoder interface, an abstraction over the formats tone mapped
+// images can be saved in, and the StripEncoder, a base for formats whose rows can be encoded
+// independently of each other. A StripEncoder splits the image into strips of rows, encodes them
+// in parallel, and writes them out in order, which lets fast formats keep up with large frames.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_IMAGE_ENCODER_H
+#define LIANG_IMAGES_IMAGE_ENCODER_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+class ImageEncoder {
+  public:
+    virtual ~ImageEncoder() {}
+
+    // Encodes an image given as interleaved 8-bit RGB values from the top row down and writes it to
+    // the given file, using up to num_threads threads (0 uses every thread the system has).
+    // Returns false if the file could not be written.
+    virtual bool Encode(const std::string &name, const uint8_t *rgb, uint width, uint height,
+        uint num_threads = 0) const = 0;
+};
+
+class StripEncoder : public ImageEncoder {
+  public:
+    // The number of rows in each independently encoded strip.
+    static const uint STRIP_HEIGHT = 64;
+
+    // Encodes the strips in parallel and writes them after the header.
+    bool Encode(const std::string &name, const uint8_t *rgb, uint width, uint height,
+        uint num_threads = 0) const;
+
+    // Encodes the image to memory instead of to a file.
+    std::vector<char> EncodeToMemory(const uint8_t *rgb, uint width, uint height,
+        uint num_threads = 0) const;
+
+  protected:
+    // Appends the header of an image with the given dimensions.
+    virtual void EncodeHeader(uint width, uint height, std::vector<char> *output) const = 0;
+
+    // Appends the encoding of rows of the image, given as interleaved RGB values. The encoding
+    // must not depend on any other rows.
+    virtual void EncodeStrip(const uint8_t *rgb, uint width, uint rows,
+        std::vector<char> *output) const = 0;
+
+  private:
+    // Encodes the header and every strip of the image.
+    std::vector<std::vector<char>> EncodeParts(const uint8_t *rgb, uint width, uint height,
+        uint num_threads) const;
+};
+
+}
+
+#endif  // LIANG_IMAGES_IMAGE_ENCODER_H
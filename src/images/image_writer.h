@@ -0,0 +1,44 @@
+// This header defines the ImageWriter interface, an abstraction over image formats that can be
+// written to disk one row at a time. Streaming rows means the Film never has to build a converted
+// copy of the whole image, only of the row being written. Besides color, a writer may store any
+// number of named extra channels, such as depth or normals, if its format supports them.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_IMAGE_WRITER_H
+#define LIANG_IMAGES_IMAGE_WRITER_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+class ImageWriter {
+  public:
+    // Width of the image.
+    const uint width;
+    // Height of the image.
+    const uint height;
+    // Names of the extra channels stored along with color.
+    const std::vector<std::string> channels;
+
+    // ImageWriter constructor that takes the dimensions of the image and the names of any extra
+    // channels.
+    ImageWriter(uint width, uint height,
+        const std::vector<std::string> &channels = std::vector<std::string>()) :
+        width{width}, height{height}, channels{channels} {}
+
+    virtual ~ImageWriter() {}
+
+    // Writes the next row of the image, starting from the top, given as width interleaved RGB
+    // triples. If the writer has extra channels, channel_values holds width values of each channel
+    // in turn. Returns false if the write failed.
+    virtual bool WriteRow(const float *rgb, const float *channel_values = nullptr) = 0;
+
+    // Finishes the file once every row has been written. Returns false if the file could not be
+    // opened, any write failed, or rows are missing.
+    virtual bool Close() = 0;
+};
+
+}
+
+#endif  // LIANG_IMAGES_IMAGE_WRITER_H
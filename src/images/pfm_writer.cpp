@@ -0,0 +1,51 @@
+#include "images/pfm_writer.h"
+
+namespace liang {
+
+PfmWriter::PfmWriter(const std::string &name, uint width, uint height) :
+    ImageWriter(width, height), file{name, std::ios::binary | std::ios::trunc}, header_size{0},
+    rows_written{0}, ok{true}, row(width * 3 * sizeof(float)) {
+  assert(width > 0 && height > 0);
+  // A negative scale marks the data as little endian.
+  std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) +
+      "\n-1.0\n";
+  file.write(header.data(), header.size());
+  header_size = header.size();
+  ok = file.good();
+}
+
+PfmWriter::~PfmWriter() {
+  if (file.is_open()) {
+    Close();
+  }
+}
+
+bool PfmWriter::WriteRow(const float *rgb, const float * /* channel_values */) {
+  if (!ok || rows_written >= height) {
+    ok = false;
+    return false;
+  }
+  for (uint i = 0; i < width * 3; i++) {
+    uint32_t bits;
+    std::memcpy(&bits, &rgb[i], sizeof(float));
+    for (uint byte = 0; byte < sizeof(float); byte++) {
+      row[i * sizeof(float) + byte] = (char)((bits >> (8 * byte)) & 0xff);
+    }
+  }
+  file.seekp(header_size + (std::streamoff)(height - 1 - rows_written) * row.size());
+  file.write(row.data(), row.size());
+  rows_written++;
+  ok = file.good();
+  return ok;
+}
+
+bool PfmWriter::Close() {
+  if (!file.is_open()) {
+    return false;
+  }
+  ok = ok && rows_written == height;
+  file.close();
+  return ok;
+}
+
+}
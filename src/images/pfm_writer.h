@@ -0,0 +1,48 @@
+// This header defines the PfmWriter, which streams an image to a Portable Float Map. PFM is an
+// uncompressed float RGB format that almost every image tool can read, which makes it handy for
+// debugging and for pipelines without an EXR library. The format stores rows from the bottom of
+// the image up, so the writer seeks to each row's place in the file as it arrives.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_PFM_WRITER_H
+#define LIANG_IMAGES_PFM_WRITER_H
+
+#include "core/liang.h"
+#include "images/image_writer.h"
+
+#include <fstream>
+
+namespace liang {
+
+class PfmWriter : public ImageWriter {
+  public:
+    // PfmWriter constructor that takes the name of the file to write and the dimensions of the
+    // image. This opens the file and writes the header. PFM has no room for extra channels.
+    PfmWriter(const std::string &name, uint width, uint height);
+
+    // Closes the file if Close() has not been called yet.
+    ~PfmWriter();
+
+    // Writes the next row in its place near the end of the file.
+    bool WriteRow(const float *rgb, const float *channel_values = nullptr);
+
+    // Closes the file.
+    bool Close();
+
+  private:
+    // The file being written.
+    std::ofstream file;
+    // The size of the header in bytes.
+    std::streamoff header_size;
+    // The number of rows written so far.
+    uint rows_written;
+    // Whether every write so far succeeded.
+    bool ok;
+    // The current row in little endian byte order.
+    std::vector<char> row;
+};
+
+}
+
+#endif  // LIANG_IMAGES_PFM_WRITER_H
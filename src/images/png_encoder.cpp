@@ -0,0 +1,13 @@
+#include "images/png_encoder.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace liang {
+
+bool PngEncoder::Encode(const std::string &name, const uint8_t *rgb, uint width, uint height,
+    uint /* num_threads */) const {
+  return stbi_write_png(name.c_str(), width, height, 3, rgb, width * 3) != 0;
+}
+
+}
@@ -0,0 +1,24 @@
+// This header defines the PngEncoder, which saves images as PNGs through stb_image_write. PNG
+// gives the smallest files of the encoders, but deflate is slow and stb compresses the whole image
+// on a single thread, so prefer the TgaEncoder or PpmEncoder when throughput matters.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_PNG_ENCODER_H
+#define LIANG_IMAGES_PNG_ENCODER_H
+
+#include "core/liang.h"
+#include "images/image_encoder.h"
+
+namespace liang {
+
+class PngEncoder : public ImageEncoder {
+  public:
+    // Encodes the image with stb_image_write. The number of threads is ignored.
+    bool Encode(const std::string &name, const uint8_t *rgb, uint width, uint height,
+        uint num_threads = 0) const;
+};
+
+}
+
+#endif  // LIANG_IMAGES_PNG_ENCODER_H
@@ -0,0 +1,15 @@
+#include "images/ppm_encoder.h"
+
+namespace liang {
+
+void PpmEncoder::EncodeHeader(uint width, uint height, std::vector<char> *output) const {
+  std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+  output->insert(output->end(), header.begin(), header.end());
+}
+
+void PpmEncoder::EncodeStrip(const uint8_t *rgb, uint width, uint rows,
+    std::vector<char> *output) const {
+  output->insert(output->end(), (const char *)rgb, (const char *)rgb + (size_t)width * rows * 3);
+}
+
+}
@@ -0,0 +1,26 @@
+// This header defines the PpmEncoder, which saves images as binary PPMs. PPM is raw RGB behind a
+// short text header, so encoding is little more than a copy. It is meant for intermediates and
+// previews where encoding speed matters more than file size.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_PPM_ENCODER_H
+#define LIANG_IMAGES_PPM_ENCODER_H
+
+#include "core/liang.h"
+#include "images/image_encoder.h"
+
+namespace liang {
+
+class PpmEncoder : public StripEncoder {
+  protected:
+    // Appends the text header.
+    void EncodeHeader(uint width, uint height, std::vector<char> *output) const;
+
+    // Appends the rows as is.
+    void EncodeStrip(const uint8_t *rgb, uint width, uint rows, std::vector<char> *output) const;
+};
+
+}
+
+#endif  // LIANG_IMAGES_PPM_ENCODER_H
@@ -0,0 +1,70 @@
+#include "images/tga_encoder.h"
+
+namespace liang {
+
+// The most pixels a single TGA packet can hold.
+static const uint MAX_PACKET_LENGTH = 128;
+
+// Returns whether two RGB pixels are equal.
+static bool PixelsEqual(const uint8_t *pixel1, const uint8_t *pixel2) {
+  return pixel1[0] == pixel2[0] && pixel1[1] == pixel2[1] && pixel1[2] == pixel2[2];
+}
+
+// Appends an RGB pixel in the BGR order TGA stores.
+static void AppendPixel(const uint8_t *pixel, std::vector<char> *output) {
+  output->push_back((char)pixel[2]);
+  output->push_back((char)pixel[1]);
+  output->push_back((char)pixel[0]);
+}
+
+void TgaEncoder::EncodeHeader(uint width, uint height, std::vector<char> *output) const {
+  assert(width <= 0xffff && height <= 0xffff);
+  char header[18] = {};
+  // Run length encoded truecolor.
+  header[2] = 10;
+  header[12] = (char)(width & 0xff);
+  header[13] = (char)(width >> 8);
+  header[14] = (char)(height & 0xff);
+  header[15] = (char)(height >> 8);
+  header[16] = 24;
+  // Store rows from the top down.
+  header[17] = 0x20;
+  output->insert(output->end(), header, header + sizeof(header));
+}
+
+void TgaEncoder::EncodeStrip(const uint8_t *rgb, uint width, uint rows,
+    std::vector<char> *output) const {
+  // The worst case is a packet header for every 128 literal pixels.
+  output->reserve(output->size() + (size_t)rows * (width * 3 + width / MAX_PACKET_LENGTH + 1));
+  for (uint y = 0; y < rows; y++) {
+    const uint8_t *row = rgb + (size_t)y * width * 3;
+    uint x = 0;
+    while (x < width) {
+      uint run = 1;
+      while (x + run < width && run < MAX_PACKET_LENGTH &&
+          PixelsEqual(&row[x * 3], &row[(x + run) * 3])) {
+        run++;
+      }
+      if (run > 1) {
+        output->push_back((char)(0x80 | (run - 1)));
+        AppendPixel(&row[x * 3], output);
+        x += run;
+        continue;
+      }
+      // Gather literal pixels until the next pair of equal pixels, which starts a run.
+      uint literal = 1;
+      while (x + literal < width && literal < MAX_PACKET_LENGTH &&
+          !(x + literal + 1 < width &&
+          PixelsEqual(&row[(x + literal) * 3], &row[(x + literal + 1) * 3]))) {
+        literal++;
+      }
+      output->push_back((char)(literal - 1));
+      for (uint i = 0; i < literal; i++) {
+        AppendPixel(&row[(x + i) * 3], output);
+      }
+      x += literal;
+    }
+  }
+}
+
+}
@@ -0,0 +1,27 @@
+// This header defines the TgaEncoder, which saves images as run length encoded truecolor TGAs.
+// Runs never cross the end of a row, as the format recommends, so strips of rows can be encoded
+// independently. RLE is far cheaper than deflate and still shrinks the flat backgrounds of renders
+// considerably, which makes TGA a good fit for dailies and previews.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_TGA_ENCODER_H
+#define LIANG_IMAGES_TGA_ENCODER_H
+
+#include "core/liang.h"
+#include "images/image_encoder.h"
+
+namespace liang {
+
+class TgaEncoder : public StripEncoder {
+  protected:
+    // Appends the 18 byte header of a top to bottom RLE truecolor image.
+    void EncodeHeader(uint width, uint height, std::vector<char> *output) const;
+
+    // Appends the rows as run length encoded packets of BGR pixels.
+    void EncodeStrip(const uint8_t *rgb, uint width, uint rows, std::vector<char> *output) const;
+};
+
+}
+
+#endif  // LIANG_IMAGES_TGA_ENCODER_H
@@ -0,0 +1,47 @@
+// This header defines the TiledImageWriter interface, an abstraction over image formats that store
+// the image as a grid of square tiles which can be written in any order. This lets a renderer
+// write out each part of the image as soon as it is final and then forget about it.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_TILED_IMAGE_WRITER_H
+#define LIANG_IMAGES_TILED_IMAGE_WRITER_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+class TiledImageWriter {
+  public:
+    // Width of the image.
+    const uint width;
+    // Height of the image.
+    const uint height;
+    // The width and height of the tiles. Tiles on the right and bottom edges are clipped to the
+    // image.
+    const uint tile_size;
+
+    // TiledImageWriter constructor that takes the dimensions of the image and of its tiles.
+    TiledImageWriter(uint width, uint height, uint tile_size) : width{width}, height{height},
+        tile_size{tile_size} {}
+
+    virtual ~TiledImageWriter() {}
+
+    // Returns the number of tiles along the x axis.
+    uint NumTilesX() const { return (width + tile_size - 1) / tile_size; }
+
+    // Returns the number of tiles along the y axis.
+    uint NumTilesY() const { return (height + tile_size - 1) / tile_size; }
+
+    // Writes the tile in the given column and row, given as interleaved RGB triples in row-major
+    // order over the tile clipped to the image. Returns false if the write failed.
+    virtual bool WriteTile(uint tile_x, uint tile_y, const float *rgb) = 0;
+
+    // Finishes the file once every tile has been written. Returns false if the file could not be
+    // opened, any write failed, or tiles are missing.
+    virtual bool Close() = 0;
+};
+
+}
+
+#endif  // LIANG_IMAGES_TILED_IMAGE_WRITER_H
@@ -0,0 +1,23 @@
+#include "images/tone_map.h"
+
+namespace liang {
+
+float LinearToSrgb(float linear) {
+  if (linear <= 0.0031308f) {
+    return 12.92f * linear;
+  }
+  return 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+}
+
+SrgbTable::SrgbTable() {
+  for (uint i = 0; i <= SIZE; i++) {
+    values[i] = LinearToSrgb((float)i / SIZE);
+  }
+}
+
+const SrgbTable &GetSrgbTable() {
+  static const SrgbTable table;
+  return table;
+}
+
+}
@@ -0,0 +1,83 @@
+// This header defines the settings and color curves used to convert the Film's high dynamic range
+// radiance into displayable 8 or 16-bit values. The conversion normalizes each pixel by its
+// weight, scales it by the exposure, clamps it to [0, 1], optionally encodes it with the sRGB
+// transfer curve, and rounds it to the nearest integer value.
+//
+// The sRGB curve involves a pow() per channel, so it is evaluated through an SrgbTable instead, a
+// table of the curve that is linearly interpolated. The curve bends hardest just above its linear
+// toe, and at this table size the interpolation error there is still a fraction of a 16-bit step.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_IMAGES_TONE_MAP_H
+#define LIANG_IMAGES_TONE_MAP_H
+
+#include "core/liang.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace liang {
+
+// Settings for converting radiance to displayable values.
+struct ToneMapSettings {
+  // The exposure adjustment in stops, where every stop doubles the brightness.
+  float exposure;
+  // Whether to encode values with the sRGB transfer curve instead of leaving them linear.
+  bool srgb;
+  // The number of threads to convert with (0 uses every thread the system has).
+  uint num_threads;
+
+  // ToneMapSettings constructor that defaults to no exposure adjustment and sRGB output.
+  ToneMapSettings(float exposure = 0.f, bool srgb = true, uint num_threads = 0) :
+      exposure{exposure}, srgb{srgb}, num_threads{num_threads} {}
+};
+
+// Encodes a linear value in [0, 1] with the sRGB transfer curve.
+float LinearToSrgb(float linear);
+
+class SrgbTable {
+  public:
+    // The number of intervals the table splits [0, 1] into.
+    static const uint SIZE = 16384;
+
+    // SrgbTable constructor that tabulates the sRGB curve.
+    SrgbTable();
+
+    // Encodes a linear value in [0, 1] with the sRGB curve by interpolating the table.
+    float Encode(float linear) const {
+      float position = linear * SIZE;
+      uint index = std::min((uint)position, SIZE - 1);
+      float fraction = position - index;
+      return values[index] + (values[index + 1] - values[index]) * fraction;
+    }
+
+#ifdef __SSE2__
+    // Encodes four linear values in [0, 1] at once. Only the table reads are done per lane, and the
+    // result matches Encode() exactly.
+    __m128 Encode4(__m128 linear) const {
+      __m128 position = _mm_mul_ps(linear, _mm_set1_ps((float)SIZE));
+      __m128i index = _mm_cvttps_epi32(_mm_min_ps(position, _mm_set1_ps((float)(SIZE - 1))));
+      __m128 fraction = _mm_sub_ps(position, _mm_cvtepi32_ps(index));
+      int32_t indices[4];
+      _mm_storeu_si128((__m128i *)indices, index);
+      __m128 low = _mm_setr_ps(values[indices[0]], values[indices[1]], values[indices[2]],
+          values[indices[3]]);
+      __m128 high = _mm_setr_ps(values[indices[0] + 1], values[indices[1] + 1],
+          values[indices[2] + 1], values[indices[3] + 1]);
+      return _mm_add_ps(low, _mm_mul_ps(_mm_sub_ps(high, low), fraction));
+    }
+#endif
+
+  private:
+    // The curve at SIZE + 1 evenly spaced points from 0 to 1.
+    float values[SIZE + 1];
+};
+
+// Gets the table shared by every conversion.
+const SrgbTable &GetSrgbTable();
+
+}
+
+#endif  // LIANG_IMAGES_TONE_MAP_H
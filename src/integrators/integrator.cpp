@@ -0,0 +1,418 @@
+#include "integrators/integrator.h"
+#include "utils/parallel.h"
+#include "utils/rng.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace liang {
+
+// The stages a checkpoint goes through on its way to disk while rendering.
+enum CheckpointState {
+  // No checkpoint is in flight.
+  NO_CHECKPOINT,
+  // The film has been copied and is waiting for a thread to write it.
+  CHECKPOINT_COPIED,
+  // A thread is writing the copy to disk.
+  CHECKPOINT_WRITING
+};
+
+// Mixes the bits of a float into a hash.
+static uint64_t MixFloat(uint64_t hash, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  return MixBits(hash ^ bits);
+}
+
+// Fills in what a camera ray saw for the AOVs, given whether it hit anything and, if it did, the
+// first hit. The camera ray counts as the first ray traced.
+static void RecordFirstHit(bool hit, const Intersection &intersection, AovSample *aov) {
+  aov->hit = hit;
+  if (hit) {
+    aov->depth = intersection.t;
+    aov->normal = intersection.normal;
+    aov->primitive_id = intersection.primitive_id;
+  }
+  aov->ray_count = 1;
+}
+
+// Returns the index of the film channel with the given name, adding it if the film doesn't have
+// it yet.
+static uint FindOrAddChannel(Film *film, const std::string &name, ChannelMode mode) {
+  for (uint channel = 0; channel < film->NumChannels(); channel++) {
+    if (film->GetChannel(channel).name == name) {
+      assert(film->GetChannel(channel).mode == mode);
+      return channel;
+    }
+  }
+  return film->AddChannel(name, mode);
+}
+
+Integrator::Integrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler,
+    uint num_threads, bool pin_threads) : camera{camera}, sampler{sampler},
+    num_threads{num_threads}, pin_threads{pin_threads},
+    tile_order{std::make_shared<ScanlineTileOrder>()}, checkpoint_name{},
+    checkpoint_interval{0.0}, visibility_buffer{}, reprojection_cache{} {}
+
+void Integrator::Render(const Scene &scene) {
+  std::shared_ptr<Film> film = camera->GetFilm();
+  uint64_t fingerprint = CheckpointFingerprint();
+  uint first_tile = 0;
+  if (!checkpoint_name.empty() &&
+      !film->LoadCheckpoint(checkpoint_name, fingerprint, &first_tile, NumTiles())) {
+    first_tile = 0;
+  }
+  if (reprojection_cache) {
+    assert(!camera->HasMotionBlur());
+    reprojection_cache->BeginFrame(*camera);
+  }
+  auto last_checkpoint = std::chrono::steady_clock::now();
+  // Checkpoints are copied while merges are held off, but written to disk after the merging
+  // thread lets go of them so other threads never wait on the file. Only one checkpoint is on its
+  // way to disk at a time.
+  std::vector<char> checkpoint_data;
+  std::atomic<int> checkpoint_state(NO_CHECKPOINT);
+  uint tiles_merged = RenderTiles(scene, first_tile, reprojection_cache.get(),
+      [&](const FilmTile &tile, uint merged_count, bool last_in_batch) {
+    film->MergeFilmTile(tile);
+    auto now = std::chrono::steady_clock::now();
+    if (last_in_batch && !checkpoint_name.empty() && checkpoint_state == NO_CHECKPOINT &&
+        std::chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_interval) {
+      checkpoint_data = film->GetCheckpointData(fingerprint, merged_count);
+      checkpoint_state = CHECKPOINT_COPIED;
+      last_checkpoint = now;
+    }
+  }, [&]() {
+    int copied = CHECKPOINT_COPIED;
+    if (checkpoint_state.compare_exchange_strong(copied, CHECKPOINT_WRITING)) {
+      Film::WriteCheckpoint(checkpoint_name, checkpoint_data);
+      checkpoint_state = NO_CHECKPOINT;
+    }
+  });
+  if (!checkpoint_name.empty()) {
+    film->SaveCheckpoint(checkpoint_name, fingerprint, tiles_merged);
+  }
+  if (reprojection_cache) {
+    reprojection_cache->EndFrame(*film);
+  }
+}
+
+bool Integrator::Render(const Scene &scene, FilmTileStream *stream) {
+  // The stream counts the tiles that reach each output tile by the render tile size.
+  assert(stream->render_tile_size == TILE_SIZE);
+  bool ok = true;
+  RenderTiles(scene, 0, nullptr, [&](const FilmTile &tile, uint /* merged_count */,
+      bool /* last_in_batch */) {
+    ok = stream->AddTile(tile) && ok;
+  });
+  return ok;
+}
+
+void Integrator::SetTileOrder(std::shared_ptr<const TileOrder> tile_order) {
+  this->tile_order = tile_order;
+}
+
+void Integrator::SetAovs(const std::vector<Aov> &aovs) {
+  std::shared_ptr<Film> film = camera->GetFilm();
+  this->aovs = aovs;
+  aov_channels.clear();
+  for (Aov aov : aovs) {
+    switch (aov) {
+      case Aov::DEPTH:
+        aov_channels.push_back(FindOrAddChannel(film.get(), "Z", ChannelMode::AVERAGE));
+        break;
+      case Aov::NORMAL:
+      {
+        // The components are added together so they occupy consecutive channels.
+        uint x_channel = FindOrAddChannel(film.get(), "N.X", ChannelMode::AVERAGE);
+        uint y_channel = FindOrAddChannel(film.get(), "N.Y", ChannelMode::AVERAGE);
+        uint z_channel = FindOrAddChannel(film.get(), "N.Z", ChannelMode::AVERAGE);
+        assert(y_channel == x_channel + 1 && z_channel == x_channel + 2);
+        aov_channels.push_back(x_channel);
+        break;
+      }
+      case Aov::PRIMITIVE_ID:
+        aov_channels.push_back(FindOrAddChannel(film.get(), "id", ChannelMode::FIRST));
+        break;
+      case Aov::RAY_COUNT:
+        aov_channels.push_back(FindOrAddChannel(film.get(), "rays", ChannelMode::SUM));
+        break;
+    }
+  }
+}
+
+void Integrator::SetVisibilityBuffer(
+    std::shared_ptr<const VisibilityBuffer> visibility_buffer) {
+  this->visibility_buffer = visibility_buffer;
+}
+
+void Integrator::SetReprojectionCache(std::shared_ptr<ReprojectionCache> reprojection_cache) {
+  this->reprojection_cache = reprojection_cache;
+}
+
+void Integrator::SetCheckpoint(const std::string &checkpoint_name, double interval_seconds) {
+  this->checkpoint_name = checkpoint_name;
+  checkpoint_interval = interval_seconds;
+}
+
+uint64_t Integrator::CheckpointFingerprint() const {
+  std::shared_ptr<Film> film = camera->GetFilm();
+  uint64_t hash = MixBits(((uint64_t)film->width << 32) | film->height);
+  hash = MixBits(hash ^ TILE_SIZE);
+  for (Aov aov : aovs) {
+    hash = MixBits(hash ^ ((uint64_t)aov + 1));
+  }
+  for (uint tile_index : TileDispatchOrder()) {
+    hash = MixBits(hash ^ tile_index);
+  }
+  if (visibility_buffer) {
+    hash = MixBits(hash ^ visibility_buffer->NumTriangles());
+  }
+  if (reprojection_cache) {
+    hash = MixBits(hash ^ reprojection_cache->max_age);
+  }
+  // Like the sampler below, the camera is fingerprinted by the rays it generates, which captures
+  // its placement and its projection alike.
+  Point2f probe_locations[3] = {Point2f(0.5f, 0.5f),
+      Point2f(film->width * 0.5f, film->height * 0.5f),
+      Point2f(film->width - 0.5f, film->height - 0.5f)};
+  for (const Point2f &film_location : probe_locations) {
+    Ray3f ray;
+    hash = MixFloat(hash, camera->GenerateRay(film_location, &ray));
+    for (int axis = 0; axis < 3; axis++) {
+      hash = MixFloat(MixFloat(hash, ray.origin[axis]), ray.direction[axis]);
+    }
+  }
+  if (camera->HasMotionBlur()) {
+    float shutter[2] = {camera->GetShutterOpen(), camera->GetShutterClose()};
+    uint64_t shutter_bits;
+    std::memcpy(&shutter_bits, shutter, sizeof(shutter_bits));
+    hash = MixBits(hash ^ shutter_bits);
+  }
+  // Samplers don't expose their seed, so fingerprint the values of the first couple of samples
+  // instead, which captures the seed and the type of the sampler alike.
+  std::unique_ptr<Sampler> probe = sampler->Clone();
+  hash = MixBits(hash ^ probe->samples_per_pixel);
+  probe->StartPixel(Point2i(0, 0));
+  do {
+    Point2f sample = probe->Get2D();
+    uint32_t x_bits, y_bits;
+    std::memcpy(&x_bits, &sample.x, sizeof(float));
+    std::memcpy(&y_bits, &sample.y, sizeof(float));
+    hash = MixBits(hash ^ (((uint64_t)x_bits << 32) | y_bits));
+  } while (probe->GetSampleIndex() < 1 && probe->StartNextSample());
+  return hash;
+}
+
+uint Integrator::NumTiles() const {
+  uint tiles_x, tiles_y;
+  GetTileCounts(&tiles_x, &tiles_y);
+  return tiles_x * tiles_y;
+}
+
+std::vector<uint> Integrator::TileDispatchOrder() const {
+  uint tiles_x, tiles_y;
+  GetTileCounts(&tiles_x, &tiles_y);
+  std::vector<uint> order = tile_order->Order(tiles_x, tiles_y);
+  assert(order.size() == tiles_x * tiles_y);
+  return order;
+}
+
+std::shared_ptr<Film> Integrator::GetFilm() const {
+  return camera->GetFilm();
+}
+
+std::unique_ptr<FilmTile> Integrator::GetFilmTile(uint tile_index) const {
+  uint tiles_x, tiles_y;
+  GetTileCounts(&tiles_x, &tiles_y);
+  assert(tile_index < tiles_x * tiles_y);
+  Point2i tile_min = Point2i((tile_index % tiles_x) * TILE_SIZE,
+      (tile_index / tiles_x) * TILE_SIZE);
+  return camera->GetFilm()->GetFilmTile(tile_min, tile_min + Vector2i(TILE_SIZE, TILE_SIZE));
+}
+
+void Integrator::GetTileCounts(uint *tiles_x, uint *tiles_y) const {
+  std::shared_ptr<Film> film = camera->GetFilm();
+  *tiles_x = (film->width + TILE_SIZE - 1) / TILE_SIZE;
+  *tiles_y = (film->height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+float Integrator::ShadeCameraRay(const RayDifferential &ray, const Scene &scene,
+    AovSample *aov) const {
+  RayDifferential first_hit_ray = ray;
+  Intersection intersection;
+  RecordFirstHit(scene.Intersect(first_hit_ray, &intersection), intersection, aov);
+  return ShadeFirstHit(ray, aov->hit ? &intersection : nullptr, scene, &aov->ray_count);
+}
+
+float Integrator::ShadeFirstHit(const RayDifferential &ray,
+    const Intersection * /* intersection */, const Scene &scene, uint *ray_count) const {
+  // Li() traces the camera ray again, and whatever else it traces goes uncounted.
+  (*ray_count)++;
+  return Li(ray, scene);
+}
+
+float Integrator::ShadeRasterizedRay(const RayDifferential &ray, const Point2f &film_location,
+    const Scene &scene, AovSample *aov) const {
+  RayDifferential first_hit_ray = ray;
+  Intersection intersection;
+  RecordFirstHit(visibility_buffer->Intersect(first_hit_ray, film_location, scene,
+      &intersection), intersection, aov);
+  return ShadeFirstHit(ray, aov->hit ? &intersection : nullptr, scene, &aov->ray_count);
+}
+
+float Integrator::ShadeAovs(const RayDifferential &ray, const Point2f &film_location,
+    float ray_weight, const Scene &scene, std::vector<float> *channel_values) const {
+  std::fill(channel_values->begin(), channel_values->end(), 0.f);
+  // Rays the camera can't generate are recorded as misses that traced nothing.
+  AovSample aov = {false, 0.f, Normal3f(), 0, 0};
+  float radiance = 0.f;
+  if (ray_weight > 0.f) {
+    radiance = ray_weight * (visibility_buffer ?
+        ShadeRasterizedRay(ray, film_location, scene, &aov) : ShadeCameraRay(ray, scene, &aov));
+  }
+  StoreAovs(aov, channel_values);
+  return radiance;
+}
+
+void Integrator::StoreAovs(const AovSample &aov, std::vector<float> *channel_values) const {
+  for (uint i = 0; i < aovs.size(); i++) {
+    float *values = channel_values->data() + aov_channels[i];
+    switch (aovs[i]) {
+      case Aov::DEPTH:
+        values[0] = aov.hit ? aov.depth : 0.f;
+        break;
+      case Aov::NORMAL:
+        if (aov.hit) {
+          values[0] = aov.normal.x;
+          values[1] = aov.normal.y;
+          values[2] = aov.normal.z;
+        }
+        break;
+      case Aov::PRIMITIVE_ID:
+        values[0] = aov.hit ? (float)aov.primitive_id : -1.f;
+        break;
+      case Aov::RAY_COUNT:
+        values[0] = (float)aov.ray_count;
+        break;
+    }
+  }
+}
+
+bool Integrator::ReuseReprojectedPixel(const Scene &scene, uint x, uint y,
+    ReprojectionCache *cache, FilmTile *tile, std::vector<float> *channel_values) const {
+  Point2f center((float)x + 0.5f, (float)y + 0.5f);
+  RayDifferential ray;
+  if (camera->GenerateRayDifferential(center, &ray) == 0.f) {
+    return false;
+  }
+  // Reprojection is only used without motion blur, so the shutter captures a single instant.
+  ray.time = camera->SampleTime(0.f);
+  RayDifferential first_hit_ray = ray;
+  Intersection intersection;
+  bool hit = visibility_buffer ?
+      visibility_buffer->Intersect(first_hit_ray, center, scene, &intersection) :
+      scene.Intersect(first_hit_ray, &intersection);
+  float distance = hit ? intersection.t : 0.f;
+  uint primitive_id = hit ? intersection.primitive_id : 0;
+  const CachedPixel *reprojected = cache->GetReprojected(x, y);
+  if (!reprojected || !cache->Validate(*reprojected, ray, hit, distance, primitive_id)) {
+    cache->RecordPixel(x, y, ray, hit, distance, primitive_id, 0);
+    return false;
+  }
+  cache->RecordPixel(x, y, ray, hit, distance, primitive_id, reprojected->age + 1);
+  AovSample aov = {hit, distance, hit ? intersection.normal : Normal3f(), primitive_id, 1};
+  std::fill(channel_values->begin(), channel_values->end(), 0.f);
+  StoreAovs(aov, channel_values);
+  // Splatting the color through the filter would blend it with the neighbors again every frame,
+  // so it is written back as is.
+  tile->SetPixel(x, y, reprojected->r, reprojected->g, reprojected->b, reprojected->weight_sum,
+      aovs.empty() ? nullptr : channel_values->data());
+  return true;
+}
+
+std::unique_ptr<FilmTile> Integrator::RenderTile(const Scene &scene, uint tile_index,
+    Sampler *tile_sampler) const {
+  return RenderTile(scene, tile_index, tile_sampler, nullptr);
+}
+
+std::unique_ptr<FilmTile> Integrator::RenderTile(const Scene &scene, uint tile_index,
+    Sampler *tile_sampler, ReprojectionCache *cache) const {
+  std::unique_ptr<FilmTile> tile = GetFilmTile(tile_index);
+  // Without AOVs, samples take the same path as they would without channel support at all.
+  std::vector<float> channel_values(aovs.empty() ? 0 : camera->GetFilm()->NumChannels());
+  // Each sample covers a smaller part of the pixel the more samples the pixel takes.
+  float differential_scale = 1.f / std::sqrt((float)tile_sampler->samples_per_pixel);
+  for (int y = tile->pixel_min.y; y < tile->pixel_max.y; y++) {
+    for (int x = tile->pixel_min.x; x < tile->pixel_max.x; x++) {
+      if (cache && ReuseReprojectedPixel(scene, x, y, cache, tile.get(), &channel_values)) {
+        continue;
+      }
+      tile_sampler->StartPixel(Point2i(x, y));
+      do {
+        Point2f film_location = tile_sampler->GetFilmLocation();
+        RayDifferential ray;
+        float ray_weight = camera->GenerateRayDifferential(film_location, &ray);
+        ray.ScaleDifferentials(differential_scale);
+        // Only draw a time sample with the shutter open, so renders without motion blur consume
+        // the same sample dimensions they always have.
+        ray.time = camera->SampleTime(camera->HasMotionBlur() ? tile_sampler->Get1D() : 0.f);
+        if (aovs.empty() && !visibility_buffer) {
+          float radiance = ray_weight > 0.f ? ray_weight * Li(ray, scene) : 0.f;
+          tile->AddSample(film_location.x, film_location.y, radiance, radiance, radiance, 1.f);
+        } else {
+          float radiance = ShadeAovs(ray, film_location, ray_weight, scene, &channel_values);
+          tile->AddSample(film_location.x, film_location.y, radiance, radiance, radiance, 1.f,
+              aovs.empty() ? nullptr : channel_values.data());
+        }
+      } while (!tile_sampler->IsConverged(tile->GetPixel(x, y)) &&
+          tile_sampler->StartNextSample());
+    }
+  }
+  return tile;
+}
+
+std::unique_ptr<FilmTile> Integrator::RenderTile(const Scene &scene, uint tile_index) const {
+  std::unique_ptr<Sampler> tile_sampler = sampler->Clone();
+  return RenderTile(scene, tile_index, tile_sampler.get());
+}
+
+uint Integrator::RenderTiles(const Scene &scene, uint first_tile, ReprojectionCache *cache,
+    const std::function<void(const FilmTile &, uint, bool)> &merge,
+    const std::function<void()> &after_merge) const {
+  std::vector<uint> order = TileDispatchOrder();
+  uint num_tiles = order.size();
+  // Finished tiles wait here until every tile dispatched before them has been merged. This keeps
+  // the merge order fixed without holding on to more than a few tiles.
+  std::vector<std::unique_ptr<FilmTile>> finished_tiles(num_tiles);
+  uint next_tile_to_merge = first_tile;
+  std::mutex merge_mutex;
+  assert(first_tile <= num_tiles);
+  assert(!visibility_buffer || !camera->HasMotionBlur());
+  ParallelFor(num_tiles - first_tile, num_threads, [&](uint i) {
+    uint dispatch_index = first_tile + i;
+    // Both the sampler and the tile are allocated here so that they are first touched by the
+    // thread that renders the tile.
+    std::unique_ptr<Sampler> tile_sampler = sampler->Clone();
+    std::unique_ptr<FilmTile> tile = RenderTile(scene, order[dispatch_index], tile_sampler.get(),
+        cache);
+    {
+      std::lock_guard<std::mutex> lock(merge_mutex);
+      finished_tiles[dispatch_index] = std::move(tile);
+      while (next_tile_to_merge < num_tiles && finished_tiles[next_tile_to_merge]) {
+        uint merged_index = next_tile_to_merge++;
+        bool last_in_batch = next_tile_to_merge == num_tiles ||
+            !finished_tiles[next_tile_to_merge];
+        merge(*finished_tiles[merged_index], next_tile_to_merge, last_in_batch);
+        finished_tiles[merged_index].reset();
+      }
+    }
+    if (after_merge) {
+      after_merge();
+    }
+  }, pin_threads);
+  return next_tile_to_merge;
+}
+
+}
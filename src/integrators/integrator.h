@@ -0,0 +1,231 @@
+// This header defines the Integrator interface. An Integrator drives the main rendering loop: it
+// asks the Sampler for film locations, casts camera rays through them, and records the radiance
+// it computes for each ray on the camera's Film. Implementations only need to define Li(), the
+// radiance arriving at the film along a single camera ray.
+//
+// The film is rendered in square tiles spread across threads, dispatched in the order given by a
+// TileOrder. Every sample is seeded by its pixel and sample index and tiles are merged into the
+// film in dispatch order, so the output is bit identical regardless of the number of threads or
+// the order in which tiles finish. Threads can optionally be pinned to NUMA nodes, in which case
+// each FilmTile is allocated by the pinned thread that renders it and so lives in memory local to
+// that node.
+//
+// Along with color, an Integrator can record arbitrary output variables (AOVs) such as depth,
+// normals, and primitive IDs in extra channels of the film. They are written in the same pass as
+// color, so compositors get their masks without a second render.
+//
+// Given a VisibilityBuffer, an Integrator renders in a hybrid mode that finds the first hit of
+// every camera ray in the rasterized buffer instead of tracing it, and then shades that hit with
+// ShadeFirstHit(). Ray tracing is left to whatever the integrator does past the first hit.
+//
+// Given a ReprojectionCache, Render() reuses the colors of pixels whose view is unchanged since
+// the previous frame rendered with the same cache, and only samples the rest of the film.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_INTEGRATOR_H
+#define LIANG_INTEGRATORS_INTEGRATOR_H
+
+#include "cameras/camera.h"
+#include "cameras/film_tile_stream.h"
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "core/scene.h"
+#include "integrators/reprojection_cache.h"
+#include "integrators/tile_order.h"
+#include "integrators/visibility_buffer.h"
+#include "samplers/sampler.h"
+
+#include <functional>
+
+namespace liang {
+
+// The arbitrary output variables an Integrator can record in the film along with color.
+enum class Aov {
+  // The distance along the camera ray to the first hit, averaged over the pixel and saved as "Z".
+  DEPTH,
+  // The interpolated shading normal at the first hit, averaged over the pixel and saved as "N.X",
+  // "N.Y", and "N.Z".
+  NORMAL,
+  // The ID of the primitive first hit by the pixel's first sample, or -1 if it missed, saved as
+  // "id".
+  PRIMITIVE_ID,
+  // The total number of rays traced for the pixel's samples, saved as "rays".
+  RAY_COUNT
+};
+
+// What a camera ray saw, for recording in the AOV channels.
+struct AovSample {
+  // Whether the camera ray hit anything. The other geometric fields are only valid if it did.
+  bool hit;
+  // The distance along the camera ray to the first hit.
+  float depth;
+  // The shading normal at the first hit.
+  Normal3f normal;
+  // The ID of the primitive first hit.
+  uint primitive_id;
+  // The number of rays traced to shade the camera ray, including the camera ray itself.
+  uint ray_count;
+};
+
+class Integrator {
+  public:
+    // The width and height in pixels of the tiles the film is split into.
+    static const uint TILE_SIZE = 16;
+
+    // Integrator constructor that takes the camera to render from, the sampler that generates the
+    // samples in every pixel, the number of threads to render with (0 uses every thread the
+    // system has), and whether to pin the threads to NUMA nodes.
+    Integrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler,
+        uint num_threads = 0, bool pin_threads = false);
+
+    virtual ~Integrator() {}
+
+    // Renders the scene to the camera's film.
+    void Render(const Scene &scene);
+
+    // Renders the scene straight to a stream built for the camera's film and TILE_SIZE, which is
+    // asserted, without touching the film's pixels. Checkpoints are not taken. Returns false if the stream failed to
+    // write a tile.
+    bool Render(const Scene &scene, FilmTileStream *stream);
+
+    // Sets the order in which tiles are dispatched to the rendering threads. This defaults to
+    // scanline order.
+    void SetTileOrder(std::shared_ptr<const TileOrder> tile_order);
+
+    // Sets the AOVs to record, adding their channels to the film unless it already has them.
+    // None are recorded by default.
+    void SetAovs(const std::vector<Aov> &aovs);
+
+    // Finds the first hit of camera rays in the given visibility buffer, which must have been
+    // rasterized from this integrator's camera and the meshes of the scene being rendered. The
+    // buffer holds a single instant, so it can't be used while the camera has motion blur. Pass
+    // nullptr to trace camera rays again.
+    void SetVisibilityBuffer(std::shared_ptr<const VisibilityBuffer> visibility_buffer);
+
+    // Reuses the colors of the frame last rendered with the given cache wherever they reproject
+    // onto the same surface, and stores this frame in the cache for the next one. Only
+    // Render(scene) uses the cache, and not while the camera has motion blur, since a pixel's
+    // center ray can't stand in for a shutter's worth of motion. Pass nullptr to render every
+    // pixel in full again.
+    void SetReprojectionCache(std::shared_ptr<ReprojectionCache> reprojection_cache);
+
+    // Enables checkpointing. While rendering, the film is written to the given file whenever at
+    // least interval_seconds have passed since the last checkpoint, and once more at the end. If
+    // the file already holds a checkpoint of the same render, Render() resumes from it.
+    void SetCheckpoint(const std::string &checkpoint_name, double interval_seconds);
+
+    // Returns a fingerprint of the render settings that determine the image: the film size, the
+    // tiling, the tile order, the AOVs, the sampler, the camera and its shutter, and whether
+    // camera rays are rasterized or pixels are reprojected. Checkpoints only resume renders with
+    // the same fingerprint. The scene isn't fingerprinted, so the caller must make sure a
+    // checkpoint is only resumed with the scene it was rendered with.
+    uint64_t CheckpointFingerprint() const;
+
+    // Returns the number of tiles the film is split into. Tiles are indexed in scanline order.
+    uint NumTiles() const;
+
+    // Returns the tile indices in the order they are dispatched and merged in.
+    std::vector<uint> TileDispatchOrder() const;
+
+    // Gets the film being rendered to.
+    std::shared_ptr<Film> GetFilm() const;
+
+    // Creates an empty FilmTile covering the tile with the given index.
+    std::unique_ptr<FilmTile> GetFilmTile(uint tile_index) const;
+
+    // Renders the tile with the given index into a new FilmTile, taking samples from the given
+    // sampler. This does not touch the film, so it is safe to call from multiple threads.
+    std::unique_ptr<FilmTile> RenderTile(const Scene &scene, uint tile_index,
+        Sampler *tile_sampler) const;
+
+    // Renders the tile with the given index into a new FilmTile using a clone of the integrator's
+    // sampler.
+    std::unique_ptr<FilmTile> RenderTile(const Scene &scene, uint tile_index) const;
+
+    // Returns the radiance arriving at the film along the given camera ray. Until we have a
+    // spectrum class, this is a single grayscale value. Camera rays carry differentials scaled to
+    // the spacing of the pixel's samples.
+    virtual float Li(const RayDifferential &ray, const Scene &scene) const = 0;
+
+    // Returns the radiance arriving at the film along the given camera ray like Li(), and fills in
+    // what the ray saw for the AOVs. By default, this traces the ray to its first hit and hands
+    // the hit to ShadeFirstHit().
+    virtual float ShadeCameraRay(const RayDifferential &ray, const Scene &scene,
+        AovSample *aov) const;
+
+    // Returns the radiance arriving at the film along the given camera ray, whose first hit has
+    // already been found by tracing it or in the visibility buffer, and adds the number of rays
+    // traced to shade it to ray_count. The intersection is nullptr if the ray misses. By default,
+    // this ignores the hit and calls Li(), which traces the camera ray a second time, so
+    // integrators should override it to shade the hit they are given and count the rays they
+    // trace past it.
+    virtual float ShadeFirstHit(const RayDifferential &ray, const Intersection *intersection,
+        const Scene &scene, uint *ray_count) const;
+
+  protected:
+    // The camera to render from.
+    std::shared_ptr<const Camera> camera;
+    // The sampler generating the samples in every pixel. This is cloned for every tile.
+    std::shared_ptr<Sampler> sampler;
+    // The number of threads to render with.
+    uint num_threads;
+    // Whether to pin the rendering threads to NUMA nodes.
+    bool pin_threads;
+    // The order in which tiles are dispatched to the rendering threads.
+    std::shared_ptr<const TileOrder> tile_order;
+    // The file to checkpoint to, or empty if checkpointing is disabled.
+    std::string checkpoint_name;
+    // The minimum number of seconds between checkpoints.
+    double checkpoint_interval;
+    // The AOVs to record.
+    std::vector<Aov> aovs;
+    // The film channel each AOV starts at, in the same order as aovs.
+    std::vector<uint> aov_channels;
+    // The buffer camera rays find their first hit in, or nullptr if they are traced.
+    std::shared_ptr<const VisibilityBuffer> visibility_buffer;
+    // The cache of the previous frame's colors, or nullptr if every pixel is rendered in full.
+    std::shared_ptr<ReprojectionCache> reprojection_cache;
+
+    // Gets the number of tiles the film is split into along each axis.
+    void GetTileCounts(uint *tiles_x, uint *tiles_y) const;
+
+    // Shades a camera ray through the given film location by finding its first hit in the
+    // visibility buffer, and fills in what it saw for the AOVs.
+    float ShadeRasterizedRay(const RayDifferential &ray, const Point2f &film_location,
+        const Scene &scene, AovSample *aov) const;
+
+    // Shades a camera ray through the given film location with the given weight and stores the
+    // values of the AOVs it saw in channel_values, which holds a value for every film channel.
+    // Channels that aren't AOVs are 0.
+    float ShadeAovs(const RayDifferential &ray, const Point2f &film_location, float ray_weight,
+        const Scene &scene, std::vector<float> *channel_values) const;
+
+    // Stores the values of the AOVs in what a camera ray saw in channel_values.
+    void StoreAovs(const AovSample &aov, std::vector<float> *channel_values) const;
+
+    // Traces the ray through the center of the given pixel and records what it saw in the cache.
+    // If it sees what the pixel reprojected from the previous frame saw, sets the pixel of the
+    // tile to the previous color and returns true. Otherwise, returns false and the pixel
+    // needs to be rendered in full.
+    bool ReuseReprojectedPixel(const Scene &scene, uint x, uint y, ReprojectionCache *cache,
+        FilmTile *tile, std::vector<float> *channel_values) const;
+
+    // Renders a tile like RenderTile(), reusing the colors of pixels from the cache if it isn't
+    // nullptr.
+    std::unique_ptr<FilmTile> RenderTile(const Scene &scene, uint tile_index,
+        Sampler *tile_sampler, ReprojectionCache *cache) const;
+
+    // Renders the tiles from the given dispatch index on, handing each finished tile to merge in
+    // dispatch order along with the number of tiles merged including it and whether it is the last
+    // tile that is ready to merge for now. Merges are made one at a time under a lock, and each
+    // thread calls after_merge, if given, once it lets go of the lock after finishing a tile.
+    // Pixels are reused from the cache if it isn't nullptr. Returns the number of tiles merged.
+    uint RenderTiles(const Scene &scene, uint first_tile, ReprojectionCache *cache,
+        const std::function<void(const FilmTile &, uint, bool)> &merge,
+        const std::function<void()> &after_merge = nullptr) const;
+};
+
+}
+
+#endif  // LIANG_INTEGRATORS_INTEGRATOR_H
@@ -0,0 +1,260 @@
+#include "integrators/render_farm.h"
+#include "utils/socket.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace liang {
+
+const int RenderCoordinator::DEFAULT_WORKER_TIMEOUT_MS;
+
+// How long the coordinator waits for a connection before checking whether the render finished.
+static const int ACCEPT_TIMEOUT_MS = 100;
+
+// The kinds of message exchanged between the coordinator and its workers.
+enum FarmMessageType : uint32_t {
+  // Sent by a worker when it connects, with its render's fingerprint as the value.
+  HELLO_MESSAGE = 1,
+  // Sent by the coordinator to turn away a worker set up for a different render.
+  REJECT_MESSAGE = 2,
+  // Sent by the coordinator to hand out a tile, with the tile index as the value.
+  TILE_MESSAGE = 3,
+  // Sent by a worker with a finished tile, with the number of pixels as the value. This is
+  // followed by the tile's bounds, its pixels, and then its extra channel values.
+  RESULT_MESSAGE = 4,
+  // Sent by the coordinator once every tile has been merged.
+  DONE_MESSAGE = 5,
+  // Sent by a worker while it renders a tile, to show it is still alive.
+  HEARTBEAT_MESSAGE = 6
+};
+
+// The fixed size header that starts every message.
+struct FarmMessage {
+  // The FarmMessageType of the message.
+  uint32_t type;
+  // The position of the tile in the dispatch order, for TILE and RESULT messages.
+  uint32_t dispatch_index;
+  // The value of the message, which depends on its type.
+  uint64_t value;
+};
+
+// The pixel bounds of a tile sent with a RESULT message.
+struct TileBounds {
+  int32_t min_x;
+  int32_t min_y;
+  int32_t max_x;
+  int32_t max_y;
+};
+
+// The state of a farm render shared by the threads serving each worker.
+struct FarmState {
+  // The tile indices in dispatch order.
+  std::vector<uint> order;
+  // The dispatch indices of the tiles not yet handed to a worker, including tiles whose worker
+  // disconnected before finishing them.
+  std::deque<uint> pending;
+  // Finished tiles waiting for the tiles dispatched before them to be merged.
+  std::vector<std::unique_ptr<FilmTile>> finished_tiles;
+  // The dispatch index of the next tile to merge into the film.
+  uint next_tile_to_merge;
+  // Guards everything above.
+  std::mutex mutex;
+  // Signalled when a tile is requeued or the last tile is merged.
+  std::condition_variable changed;
+};
+
+// Sends a message that carries no payload.
+static bool SendMessage(int socket, uint32_t type, uint32_t dispatch_index, uint64_t value) {
+  FarmMessage message = {type, dispatch_index, value};
+  return SendAll(socket, &message, sizeof(message));
+}
+
+// Receives the result of the tile at the given dispatch index from a worker, skipping the
+// heartbeats sent while it renders. Returns nullptr if the connection failed or timed out, or the
+// worker sent something other than the expected tile.
+static std::unique_ptr<FilmTile> ReceiveTile(int socket, const Integrator &integrator,
+    const FarmState &state, uint dispatch_index) {
+  FarmMessage message;
+  TileBounds bounds;
+  do {
+    if (!ReceiveAll(socket, &message, sizeof(message))) {
+      return nullptr;
+    }
+  } while (message.type == HEARTBEAT_MESSAGE && message.dispatch_index == dispatch_index);
+  if (message.type != RESULT_MESSAGE ||
+      message.dispatch_index != dispatch_index ||
+      !ReceiveAll(socket, &bounds, sizeof(bounds))) {
+    return nullptr;
+  }
+  std::unique_ptr<FilmTile> tile = integrator.GetFilmTile(state.order[dispatch_index]);
+  if (message.value != tile->NumPixels() || bounds.min_x != tile->pixel_min.x ||
+      bounds.min_y != tile->pixel_min.y || bounds.max_x != tile->pixel_max.x ||
+      bounds.max_y != tile->pixel_max.y ||
+      !ReceiveAll(socket, tile->GetPixels(), tile->NumPixels() * sizeof(Pixel)) ||
+      !ReceiveAll(socket, tile->GetChannelValues(), tile->NumChannelValues() * sizeof(float))) {
+    return nullptr;
+  }
+  return tile;
+}
+
+// Hands out tiles to the worker on the other end of the socket until every tile is merged. If the
+// worker disconnects, misbehaves, or sends nothing, not even a heartbeat, for timeout_ms
+// milliseconds, its tile is put back in the queue for another worker.
+static void ServeWorker(int socket, const Integrator &integrator, Film *film, FarmState *state,
+    uint64_t fingerprint, int timeout_ms) {
+  uint num_tiles = state->order.size();
+  FarmMessage hello;
+  if (!SetReceiveTimeout(socket, timeout_ms) || !ReceiveAll(socket, &hello, sizeof(hello)) ||
+      hello.type != HELLO_MESSAGE || hello.value != fingerprint) {
+    SendMessage(socket, REJECT_MESSAGE, 0, 0);
+    CloseSocket(socket);
+    return;
+  }
+  while (true) {
+    uint dispatch_index;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->changed.wait(lock, [&] {
+        return !state->pending.empty() || state->next_tile_to_merge == num_tiles;
+      });
+      if (state->pending.empty()) {
+        break;
+      }
+      dispatch_index = state->pending.front();
+      state->pending.pop_front();
+    }
+    std::unique_ptr<FilmTile> tile;
+    if (SendMessage(socket, TILE_MESSAGE, dispatch_index, state->order[dispatch_index])) {
+      tile = ReceiveTile(socket, integrator, *state, dispatch_index);
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!tile) {
+      state->pending.push_front(dispatch_index);
+      state->changed.notify_all();
+      CloseSocket(socket);
+      return;
+    }
+    state->finished_tiles[dispatch_index] = std::move(tile);
+    while (state->next_tile_to_merge < num_tiles &&
+        state->finished_tiles[state->next_tile_to_merge]) {
+      film->MergeFilmTile(*state->finished_tiles[state->next_tile_to_merge]);
+      state->finished_tiles[state->next_tile_to_merge].reset();
+      state->next_tile_to_merge++;
+    }
+    if (state->next_tile_to_merge == num_tiles) {
+      state->changed.notify_all();
+    }
+  }
+  SendMessage(socket, DONE_MESSAGE, 0, 0);
+  CloseSocket(socket);
+}
+
+RenderCoordinator::RenderCoordinator(std::shared_ptr<const Integrator> integrator, uint16_t port,
+    int worker_timeout_ms) : integrator{integrator}, listen_socket{-1}, port{0},
+    worker_timeout_ms{worker_timeout_ms} {
+  listen_socket = ListenOnLocalhost(port, &this->port);
+  if (listen_socket < 0) {
+    this->port = 0;
+  }
+}
+
+RenderCoordinator::~RenderCoordinator() {
+  CloseSocket(listen_socket);
+}
+
+uint16_t RenderCoordinator::GetPort() const {
+  return port;
+}
+
+bool RenderCoordinator::Run() {
+  if (listen_socket < 0) {
+    return false;
+  }
+  std::shared_ptr<Film> film = integrator->GetFilm();
+  uint64_t fingerprint = integrator->CheckpointFingerprint();
+  FarmState state;
+  state.order = integrator->TileDispatchOrder();
+  uint num_tiles = state.order.size();
+  for (uint dispatch_index = 0; dispatch_index < num_tiles; dispatch_index++) {
+    state.pending.push_back(dispatch_index);
+  }
+  state.finished_tiles.resize(num_tiles);
+  state.next_tile_to_merge = 0;
+  std::vector<std::thread> threads;
+  auto serve = [&](int socket) {
+    threads.emplace_back(ServeWorker, socket, std::cref(*integrator), film.get(), &state,
+        fingerprint, worker_timeout_ms);
+  };
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      if (state.next_tile_to_merge == num_tiles) {
+        break;
+      }
+    }
+    int socket = AcceptConnection(listen_socket, ACCEPT_TIMEOUT_MS);
+    if (socket >= 0) {
+      serve(socket);
+    }
+  }
+  // Workers that connected after the last tile was handed out are told the render is done.
+  int socket;
+  while ((socket = AcceptConnection(listen_socket, 0)) >= 0) {
+    serve(socket);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  return true;
+}
+
+bool RunRenderWorker(const Integrator &integrator, const Scene &scene, const std::string &host,
+    uint16_t port, int heartbeat_interval_ms) {
+  int socket = ConnectToHost(host, port);
+  if (socket < 0) {
+    return false;
+  }
+  bool done = false;
+  FarmMessage message;
+  if (SendMessage(socket, HELLO_MESSAGE, 0, integrator.CheckpointFingerprint())) {
+    while (ReceiveAll(socket, &message, sizeof(message))) {
+      if (message.type == DONE_MESSAGE) {
+        done = true;
+        break;
+      }
+      if (message.type != TILE_MESSAGE || message.value >= integrator.NumTiles()) {
+        break;
+      }
+      // The tile renders on its own thread so that heartbeats keep going out while it does.
+      std::future<std::unique_ptr<FilmTile>> rendering = std::async(std::launch::async, [&] {
+        return integrator.RenderTile(scene, message.value);
+      });
+      bool alive = true;
+      while (rendering.wait_for(std::chrono::milliseconds(heartbeat_interval_ms)) !=
+          std::future_status::ready) {
+        alive = alive && SendMessage(socket, HEARTBEAT_MESSAGE, message.dispatch_index, 0);
+      }
+      std::unique_ptr<FilmTile> tile = rendering.get();
+      if (!alive) {
+        break;
+      }
+      TileBounds bounds = {tile->pixel_min.x, tile->pixel_min.y, tile->pixel_max.x,
+          tile->pixel_max.y};
+      if (!SendMessage(socket, RESULT_MESSAGE, message.dispatch_index, tile->NumPixels()) ||
+          !SendAll(socket, &bounds, sizeof(bounds)) ||
+          !SendAll(socket, tile->GetPixels(), tile->NumPixels() * sizeof(Pixel)) ||
+          !SendAll(socket, tile->GetChannelValues(),
+          tile->NumChannelValues() * sizeof(float))) {
+        break;
+      }
+    }
+  }
+  CloseSocket(socket);
+  return done;
+}
+
+}
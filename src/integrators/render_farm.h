@@ -0,0 +1,70 @@
+// This header defines a render farm that splits a render across processes. A RenderCoordinator
+// hands out tile indices over TCP to any number of workers, each of which builds the same scene
+// and integrator, renders the tiles it is given with Integrator::RenderTile(), and sends back the
+// finished FilmTiles. The coordinator merges them into its film in dispatch order, so the output
+// is bit identical to rendering the same integrator in a single process.
+//
+// Workers introduce themselves with the integrator's checkpoint fingerprint, and a worker set up
+// for a different render is turned away. While a worker renders a tile it sends heartbeats, so
+// tiles may take as long as they need. A tile lost to a worker that disconnects, or that sends
+// neither heartbeats nor results for longer than the coordinator's worker timeout, is handed to
+// the next worker that asks. Messages use the native byte order, so the coordinator and workers
+// must run on the same architecture, which in practice means on the same machine over localhost.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_RENDER_FARM_H
+#define LIANG_INTEGRATORS_RENDER_FARM_H
+
+#include "core/liang.h"
+#include "core/scene.h"
+#include "integrators/integrator.h"
+
+namespace liang {
+
+// How often a worker sends a heartbeat by default while it renders a tile.
+const int DEFAULT_HEARTBEAT_INTERVAL_MS = 1000;
+
+class RenderCoordinator {
+  public:
+    // How long the coordinator waits by default for a worker to send anything, including a
+    // heartbeat, before giving up on it.
+    static const int DEFAULT_WORKER_TIMEOUT_MS = 10000;
+
+    // RenderCoordinator constructor that takes the integrator whose film is assembled, the port
+    // to listen on, where 0 lets the system pick a free port, and how long to wait for a worker
+    // to send anything before its tile is handed to another worker. The timeout should be several
+    // times the heartbeat interval of the workers.
+    RenderCoordinator(std::shared_ptr<const Integrator> integrator, uint16_t port = 0,
+        int worker_timeout_ms = DEFAULT_WORKER_TIMEOUT_MS);
+
+    ~RenderCoordinator();
+
+    // Returns the port workers should connect to, or 0 if the socket could not be opened.
+    uint16_t GetPort() const;
+
+    // Hands out tiles to workers until every tile has been merged into the integrator's film.
+    // Returns false without rendering anything if the listening socket could not be opened.
+    bool Run();
+
+  private:
+    // The integrator whose film is assembled.
+    std::shared_ptr<const Integrator> integrator;
+    // The socket workers connect to, or -1 if it could not be opened.
+    int listen_socket;
+    // The port the listening socket is bound to.
+    uint16_t port;
+    // How long to wait for a worker to send anything before giving up on it.
+    int worker_timeout_ms;
+};
+
+// Connects to the coordinator at the given host and port and renders the tiles it hands out with
+// the given integrator until none remain, sending a heartbeat every heartbeat_interval_ms
+// milliseconds while a tile renders. Returns false if the connection failed or the coordinator
+// turned the worker away.
+bool RunRenderWorker(const Integrator &integrator, const Scene &scene, const std::string &host,
+    uint16_t port, int heartbeat_interval_ms = DEFAULT_HEARTBEAT_INTERVAL_MS);
+
+}
+
+#endif  // LIANG_INTEGRATORS_RENDER_FARM_H
@@ -0,0 +1,115 @@
+#include "integrators/reprojection_cache.h"
+
+namespace liang {
+
+// The reprojected index of pixels that nothing reprojected onto.
+static const uint NO_PIXEL = 0xffffffff;
+
+ReprojectionCache::ReprojectionCache(float depth_tolerance, uint max_age) :
+    depth_tolerance{depth_tolerance}, max_age{max_age}, width{0}, height{0}, previous_frame{},
+    current_frame{}, reprojected{}, num_reused_pixels{0} {
+  assert(depth_tolerance >= 0.f);
+}
+
+void ReprojectionCache::BeginFrame(const Camera &camera) {
+  std::shared_ptr<Film> film = camera.GetFilm();
+  if (film->width != width || film->height != height) {
+    width = film->width;
+    height = film->height;
+    previous_frame.clear();
+  }
+  current_frame.assign(width * height, CachedPixel());
+  reprojected.assign(width * height, NO_PIXEL);
+  // Forward project every pixel of the last frame, keeping the closest one that lands on each
+  // pixel of the new frame. Pixels nothing lands on were disoccluded.
+  std::vector<float> closest(reprojected.size(), std::numeric_limits<float>::infinity());
+  for (uint i = 0; i < previous_frame.size(); i++) {
+    const CachedPixel &pixel = previous_frame[i];
+    if (!pixel.valid || pixel.age >= max_age) {
+      continue;
+    }
+    Point2f film_location;
+    float distance = std::numeric_limits<float>::infinity();
+    if (pixel.hit) {
+      Point3f point = pixel.origin + pixel.direction * pixel.distance;
+      if (!camera.ProjectToRaster(point, &film_location)) {
+        continue;
+      }
+      Ray3f ray;
+      camera.GenerateRay(film_location, &ray);
+      distance = (point - ray.origin).Length();
+    } else if (!camera.ProjectDirectionToRaster(pixel.direction, &film_location)) {
+      continue;
+    }
+    uint target = (uint)film_location.y * width + (uint)film_location.x;
+    // Misses only fill pixels that no hit landed on.
+    if (distance < closest[target] || reprojected[target] == NO_PIXEL) {
+      closest[target] = distance;
+      reprojected[target] = i;
+    }
+  }
+}
+
+const CachedPixel *ReprojectionCache::GetReprojected(uint x, uint y) const {
+  assert(x < width && y < height);
+  uint index = reprojected[y * width + x];
+  return index == NO_PIXEL ? nullptr : &previous_frame[index];
+}
+
+bool ReprojectionCache::Validate(const CachedPixel &reprojected, const Ray3f &ray, bool hit,
+    float distance, uint primitive_id) const {
+  if (hit != reprojected.hit) {
+    return false;
+  }
+  if (!hit) {
+    return true;
+  }
+  Point3f point = reprojected.origin + reprojected.direction * reprojected.distance;
+  float expected_distance = (point - ray.origin).Length();
+  return primitive_id == reprojected.primitive_id &&
+      std::abs(distance - expected_distance) <= depth_tolerance * expected_distance;
+}
+
+void ReprojectionCache::RecordPixel(uint x, uint y, const Ray3f &ray, bool hit, float distance,
+    uint primitive_id, uint age) {
+  assert(x < width && y < height);
+  CachedPixel &pixel = current_frame[y * width + x];
+  pixel.valid = true;
+  pixel.hit = hit;
+  pixel.primitive_id = primitive_id;
+  pixel.origin = ray.origin;
+  pixel.direction = ray.direction;
+  pixel.distance = distance;
+  pixel.age = age;
+}
+
+void ReprojectionCache::EndFrame(const Film &film) {
+  assert(film.width == width && film.height == height);
+  num_reused_pixels = 0;
+  for (uint y = 0; y < height; y++) {
+    for (uint x = 0; x < width; x++) {
+      CachedPixel &pixel = current_frame[y * width + x];
+      if (!pixel.valid) {
+        continue;
+      }
+      Pixel film_pixel = film.GetPixel(x, y);
+      float inverse_weight = film_pixel.weight_sum > 0.f ? 1.f / film_pixel.weight_sum : 0.f;
+      pixel.r = film_pixel.r * inverse_weight;
+      pixel.g = film_pixel.g * inverse_weight;
+      pixel.b = film_pixel.b * inverse_weight;
+      pixel.weight_sum = film_pixel.weight_sum;
+      if (pixel.age > 0) {
+        num_reused_pixels++;
+      }
+    }
+  }
+  previous_frame.swap(current_frame);
+  current_frame.clear();
+  reprojected.clear();
+}
+
+uint ReprojectionCache::NumReusedPixels() const {
+  return num_reused_pixels;
+}
+
+}
@@ -0,0 +1,100 @@
+// This header defines the ReprojectionCache, which carries the shading of one frame over to the
+// next for sequences where only the camera moves through a static scene. After a frame renders,
+// the cache keeps what the center of every pixel saw along with the pixel's final color. When the
+// next frame starts, those hits are reprojected into the new camera, and each pixel that received
+// one traces a single ray through its center to check that it sees the same primitive at the same
+// depth. Pixels that pass reuse the old color instead of taking all of their samples, and only
+// pixels that were disoccluded or fail the check are rendered in full.
+//
+// Reused colors drift as they are carried from frame to frame, so a pixel is rendered in full
+// again once its color has been reused for max_age frames in a row. Pixels whose center misses
+// the scene are reprojected by their direction, as if they saw something infinitely far away.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_REPROJECTION_CACHE_H
+#define LIANG_INTEGRATORS_REPROJECTION_CACHE_H
+
+#include "cameras/camera.h"
+#include "cameras/film.h"
+#include "core/geometry.h"
+#include "core/liang.h"
+
+namespace liang {
+
+// What the center of a pixel saw in a rendered frame.
+struct CachedPixel {
+  // Whether the pixel has been recorded this frame. The other fields are only valid if it has.
+  bool valid;
+  // Whether the ray through the pixel's center hit anything.
+  bool hit;
+  // The ID of the primitive hit.
+  uint primitive_id;
+  // The origin of the ray through the pixel's center.
+  Point3f origin;
+  // The normalized direction of the ray through the pixel's center.
+  Vector3f direction;
+  // The distance along the ray to the hit.
+  float distance;
+  // The final color of the pixel.
+  float r, g, b;
+  // The weight the pixel's color was accumulated with.
+  float weight_sum;
+  // The number of frames in a row the color has been reused for.
+  uint age;
+};
+
+class ReprojectionCache {
+  public:
+    // The relative difference in depth up to which a reprojected hit is still considered the same.
+    const float depth_tolerance;
+    // The number of frames in a row a pixel's color can be reused before it is rendered again.
+    const uint max_age;
+
+    // ReprojectionCache constructor that takes the depth tolerance and the maximum age.
+    ReprojectionCache(float depth_tolerance = 0.01f, uint max_age = 8);
+
+    // Starts a frame seen through the given camera by reprojecting the last finished frame into
+    // it. This is called by Integrator::Render().
+    void BeginFrame(const Camera &camera);
+
+    // Returns the pixel of the last frame that reprojected onto the given pixel of the current
+    // frame, or nullptr if none did.
+    const CachedPixel *GetReprojected(uint x, uint y) const;
+
+    // Returns whether a ray through the center of the current frame's pixel sees the same thing as
+    // the reprojected pixel, given the ray and its first hit. The hit's fields are only read if
+    // hit is true.
+    bool Validate(const CachedPixel &reprojected, const Ray3f &ray, bool hit, float distance,
+        uint primitive_id) const;
+
+    // Records what the center of the given pixel of the current frame saw, along with the age of
+    // its color: 0 if the pixel was rendered in full, or one more than the age of the reprojected
+    // pixel whose color it reused. Different threads may record different pixels concurrently.
+    void RecordPixel(uint x, uint y, const Ray3f &ray, bool hit, float distance,
+        uint primitive_id, uint age);
+
+    // Finishes the current frame by storing the final colors of its pixels from the given film.
+    // The frame is then reprojected into the next one.
+    void EndFrame(const Film &film);
+
+    // Returns the number of pixels of the last finished frame that reused a reprojected color.
+    uint NumReusedPixels() const;
+
+  private:
+    // The width and height of the frames in pixels.
+    uint width, height;
+    // The pixels of the last finished frame.
+    std::vector<CachedPixel> previous_frame;
+    // The pixels of the frame being rendered.
+    std::vector<CachedPixel> current_frame;
+    // For every pixel of the frame being rendered, the index of the pixel of the last frame that
+    // reprojected onto it, or NO_PIXEL.
+    std::vector<uint> reprojected;
+    // The number of pixels of the last finished frame that reused a reprojected color.
+    uint num_reused_pixels;
+};
+
+}
+
+#endif  // LIANG_INTEGRATORS_REPROJECTION_CACHE_H
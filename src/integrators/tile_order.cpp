@@ -0,0 +1,114 @@
+#include "integrators/tile_order.h"
+
+namespace liang {
+
+// Returns the smallest power of two that is at least n.
+static uint RoundUpPowerOfTwo(uint n) {
+  uint power = 1;
+  while (power < n) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// Returns the even bits of a Morton code compacted into the low bits.
+static uint CompactBits(uint v) {
+  v &= 0x55555555;
+  v = (v ^ (v >> 1)) & 0x33333333;
+  v = (v ^ (v >> 2)) & 0x0f0f0f0f;
+  v = (v ^ (v >> 4)) & 0x00ff00ff;
+  v = (v ^ (v >> 8)) & 0x0000ffff;
+  return v;
+}
+
+// Converts a distance along the Hilbert curve filling a side x side square (side must be a power
+// of two) into x and y coordinates. Adapted from the iterative algorithm on Wikipedia.
+static void HilbertToXY(uint side, uint distance, uint *x, uint *y) {
+  *x = 0;
+  *y = 0;
+  for (uint s = 1; s < side; s *= 2) {
+    uint rx = 1 & (distance / 2);
+    uint ry = 1 & (distance ^ rx);
+    if (ry == 0) {
+      if (rx == 1) {
+        *x = s - 1 - *x;
+        *y = s - 1 - *y;
+      }
+      std::swap(*x, *y);
+    }
+    *x += s * rx;
+    *y += s * ry;
+    distance /= 4;
+  }
+}
+
+std::vector<uint> ScanlineTileOrder::Order(uint tiles_x, uint tiles_y) const {
+  std::vector<uint> order(tiles_x * tiles_y);
+  for (uint i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  return order;
+}
+
+std::vector<uint> MortonTileOrder::Order(uint tiles_x, uint tiles_y) const {
+  // Walk the curve over the enclosing power of two square and skip tiles outside the grid.
+  uint side = RoundUpPowerOfTwo(std::max(tiles_x, tiles_y));
+  std::vector<uint> order;
+  order.reserve(tiles_x * tiles_y);
+  for (uint code = 0; code < side * side; code++) {
+    uint x = CompactBits(code);
+    uint y = CompactBits(code >> 1);
+    if (x < tiles_x && y < tiles_y) {
+      order.push_back(y * tiles_x + x);
+    }
+  }
+  return order;
+}
+
+std::vector<uint> HilbertTileOrder::Order(uint tiles_x, uint tiles_y) const {
+  uint side = RoundUpPowerOfTwo(std::max(tiles_x, tiles_y));
+  std::vector<uint> order;
+  order.reserve(tiles_x * tiles_y);
+  for (uint distance = 0; distance < side * side; distance++) {
+    uint x, y;
+    HilbertToXY(side, distance, &x, &y);
+    if (x < tiles_x && y < tiles_y) {
+      order.push_back(y * tiles_x + x);
+    }
+  }
+  return order;
+}
+
+std::vector<uint> SpiralTileOrder::Order(uint tiles_x, uint tiles_y) const {
+  // Walk a square spiral (right, down, left, up with growing leg lengths) around the center tile
+  // and keep the tiles that fall inside the grid until every tile has been visited.
+  std::vector<uint> order;
+  uint num_tiles = tiles_x * tiles_y;
+  order.reserve(num_tiles);
+  int x = ((int)tiles_x - 1) / 2;
+  int y = ((int)tiles_y - 1) / 2;
+  const int dx[4] = {1, 0, -1, 0};
+  const int dy[4] = {0, 1, 0, -1};
+  int leg_length = 1;
+  int direction = 0;
+  if (num_tiles > 0) {
+    order.push_back(y * tiles_x + x);
+  }
+  while (order.size() < num_tiles) {
+    // Every leg length is used for two legs of the spiral.
+    for (int leg = 0; leg < 2; leg++) {
+      for (int step = 0; step < leg_length; step++) {
+        x += dx[direction];
+        y += dy[direction];
+        if (x >= 0 && y >= 0 && x < (int)tiles_x && y < (int)tiles_y) {
+          order.push_back(y * tiles_x + x);
+        }
+      }
+      direction = (direction + 1) % 4;
+    }
+    leg_length++;
+  }
+  return order;
+}
+
+}
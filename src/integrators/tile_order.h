@@ -0,0 +1,57 @@
+// This header defines the TileOrder interface, the policy deciding the order in which an
+// Integrator dispatches the tiles of the film to its threads. Tiles that are rendered around the
+// same time share caches, so orders that keep consecutive tiles close together on screen (and
+// therefore close together in the scene) reuse more of the geometry that is already in cache than
+// plain scanline order, which jumps across the whole image at the end of every row of tiles.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_TILE_ORDER_H
+#define LIANG_INTEGRATORS_TILE_ORDER_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+class TileOrder {
+  public:
+    virtual ~TileOrder() {}
+
+    // Returns every tile index of a grid of tiles_x by tiles_y tiles exactly once, in the order
+    // the tiles should be dispatched. Tile indices are in scanline order (y * tiles_x + x).
+    virtual std::vector<uint> Order(uint tiles_x, uint tiles_y) const = 0;
+};
+
+// Dispatches tiles row by row from the top left corner.
+class ScanlineTileOrder : public TileOrder {
+  public:
+    // Returns the tile indices in scanline order.
+    std::vector<uint> Order(uint tiles_x, uint tiles_y) const;
+};
+
+// Dispatches tiles along a Morton (Z-order) curve, which recursively visits quadrants.
+class MortonTileOrder : public TileOrder {
+  public:
+    // Returns the tile indices in Morton order.
+    std::vector<uint> Order(uint tiles_x, uint tiles_y) const;
+};
+
+// Dispatches tiles along a Hilbert curve. Unlike the Morton curve, consecutive tiles on a Hilbert
+// curve are always adjacent, so this has the best locality of the orders.
+class HilbertTileOrder : public TileOrder {
+  public:
+    // Returns the tile indices in Hilbert order.
+    std::vector<uint> Order(uint tiles_x, uint tiles_y) const;
+};
+
+// Dispatches tiles in a spiral from the center of the image outwards. This is meant for previews
+// since the center of the frame (usually the most interesting part) finishes first.
+class SpiralTileOrder : public TileOrder {
+  public:
+    // Returns the tile indices in a spiral starting at the center tile.
+    std::vector<uint> Order(uint tiles_x, uint tiles_y) const;
+};
+
+}
+
+#endif  // LIANG_INTEGRATORS_TILE_ORDER_H
@@ -0,0 +1,302 @@
+#include "integrators/visibility_buffer.h"
+#include "utils/parallel.h"
+
+namespace liang {
+
+const uint VisibilityBuffer::NO_TRIANGLE;
+const uint VisibilityBuffer::TILE_SIZE;
+
+// The number of triangles a thread projects at a time.
+static const uint PROJECT_BATCH_SIZE = 4096;
+
+// A triangle, or the part of one in front of the near plane, projected onto the film.
+struct RasterTriangle {
+  // The raster space x and y of each vertex, with the reciprocal of its camera space depth as z.
+  Point3f vertices[3];
+  // The barycentric coordinates of each vertex with respect to the second and third vertices of
+  // the original triangle.
+  Point2f barycentrics[3];
+  // The index of the original triangle.
+  uint triangle;
+};
+
+// A camera space vertex of a triangle being clipped against the near plane.
+struct ClipVertex {
+  // The position of the vertex in camera space.
+  Point3f position;
+  // The barycentric coordinates of the vertex with respect to the second and third vertices of
+  // the original triangle.
+  Point2f barycentric;
+};
+
+// Returns twice the signed area of the triangle formed by the edge from a to b and the point.
+static inline float EdgeFunction(const Point3f &a, const Point3f &b, float x, float y) {
+  return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// Clips a camera space triangle against the near plane, projects what is left onto the film, and
+// appends it to raster_triangles as one or two triangles.
+static void ClipAndProject(const ClipVertex *vertices, uint triangle, float near_plane,
+    const Transform &camera_to_raster, std::vector<RasterTriangle> *raster_triangles) {
+  // Clipping a triangle against a plane leaves at most four vertices.
+  ClipVertex clipped[4];
+  uint num_clipped = 0;
+  for (uint i = 0; i < 3; i++) {
+    const ClipVertex &a = vertices[i];
+    const ClipVertex &b = vertices[(i + 1) % 3];
+    bool a_inside = a.position.z >= near_plane;
+    bool b_inside = b.position.z >= near_plane;
+    if (a_inside) {
+      clipped[num_clipped++] = a;
+    }
+    if (a_inside != b_inside) {
+      float t = (near_plane - a.position.z) / (b.position.z - a.position.z);
+      clipped[num_clipped++] = {
+          Point3f(a.position.x + t * (b.position.x - a.position.x),
+              a.position.y + t * (b.position.y - a.position.y), near_plane),
+          Point2f(a.barycentric.x + t * (b.barycentric.x - a.barycentric.x),
+              a.barycentric.y + t * (b.barycentric.y - a.barycentric.y))};
+    }
+  }
+  if (num_clipped < 3) {
+    return;
+  }
+  Point3f projected[4];
+  for (uint i = 0; i < num_clipped; i++) {
+    Point3f raster = camera_to_raster(clipped[i].position);
+    projected[i] = Point3f(raster.x, raster.y, 1.f / clipped[i].position.z);
+  }
+  // Fan out from the first vertex.
+  for (uint i = 1; i + 1 < num_clipped; i++) {
+    raster_triangles->push_back({{projected[0], projected[i], projected[i + 1]},
+        {clipped[0].barycentric, clipped[i].barycentric, clipped[i + 1].barycentric}, triangle});
+  }
+}
+
+// Gets the range of pixels whose centers fall inside the raster space bounds of a triangle,
+// clamped to the film. Returns false if there are none.
+static bool GetPixelBounds(const RasterTriangle &triangle, uint width, uint height,
+    int *min_x, int *min_y, int *max_x, int *max_y) {
+  const Point3f *v = triangle.vertices;
+  float low_x = std::min(v[0].x, std::min(v[1].x, v[2].x));
+  float low_y = std::min(v[0].y, std::min(v[1].y, v[2].y));
+  float high_x = std::max(v[0].x, std::max(v[1].x, v[2].x));
+  float high_y = std::max(v[0].y, std::max(v[1].y, v[2].y));
+  // Reject triangles entirely off the film before converting, since projected vertices near the
+  // near plane can be too large for an int.
+  if (high_x < 0.f || high_y < 0.f || low_x > (float)width || low_y > (float)height) {
+    return false;
+  }
+  *min_x = std::max(0, (int)std::ceil(std::max(low_x, 0.f) - 0.5f));
+  *min_y = std::max(0, (int)std::ceil(std::max(low_y, 0.f) - 0.5f));
+  *max_x = std::min((int)width - 1, (int)std::floor(std::min(high_x, (float)width) - 0.5f));
+  *max_y = std::min((int)height - 1, (int)std::floor(std::min(high_y, (float)height) - 0.5f));
+  return *min_x <= *max_x && *min_y <= *max_y;
+}
+
+// Rasterizes a triangle into the samples of the pixels in the given bounds, keeping whichever of
+// it and what the pixel already saw is closer.
+static void RasterizeTriangle(const RasterTriangle &triangle, int min_x, int min_y, int max_x,
+    int max_y, uint width, VisibilitySample *samples) {
+  const Point3f *v = triangle.vertices;
+  const Point2f *b = triangle.barycentrics;
+  float area = EdgeFunction(v[0], v[1], v[2].x, v[2].y);
+  if (area == 0.f) {
+    return;
+  }
+  float inverse_area = 1.f / area;
+  for (int y = min_y; y <= max_y; y++) {
+    float center_y = y + 0.5f;
+    for (int x = min_x; x <= max_x; x++) {
+      float center_x = x + 0.5f;
+      // Dividing by the signed area makes the weights positive inside triangles of either
+      // winding, so back faces are rasterized just like the ray tracer sees them.
+      float l0 = EdgeFunction(v[1], v[2], center_x, center_y) * inverse_area;
+      float l1 = EdgeFunction(v[2], v[0], center_x, center_y) * inverse_area;
+      float l2 = EdgeFunction(v[0], v[1], center_x, center_y) * inverse_area;
+      if (l0 < 0.f || l1 < 0.f || l2 < 0.f) {
+        continue;
+      }
+      // The reciprocal of depth is linear in raster space, so it is interpolated directly and
+      // the barycentrics are corrected for perspective with it.
+      float depth = 1.f / (l0 * v[0].z + l1 * v[1].z + l2 * v[2].z);
+      VisibilitySample &sample = samples[y * width + x];
+      if (!(depth < sample.depth)) {
+        continue;
+      }
+      float w0 = l0 * v[0].z * depth;
+      float w1 = l1 * v[1].z * depth;
+      float w2 = l2 * v[2].z * depth;
+      sample.triangle = triangle.triangle;
+      sample.b1 = w0 * b[0].x + w1 * b[1].x + w2 * b[2].x;
+      sample.b2 = w0 * b[0].y + w1 * b[1].y + w2 * b[2].y;
+      sample.depth = depth;
+    }
+  }
+}
+
+VisibilityBuffer::VisibilityBuffer(std::shared_ptr<const PerspectiveCamera> camera,
+    const std::vector<RasterMesh> &meshes, uint num_threads) : width{camera->GetFilm()->width},
+    height{camera->GetFilm()->height}, world_to_camera{camera->GetWorldToCamera()}, triangles{},
+    triangle_ids{}, primitives{}, samples(width * height, {NO_TRIANGLE, 0.f, 0.f, std::numeric_limits<float>::infinity()}) {
+  // Number the triangles of every mesh consecutively. first_triangles has an extra entry at the
+  // end so that every mesh's triangles end where the next mesh's begin.
+  std::vector<uint> first_triangles;
+  std::vector<Transform> object_to_camera;
+  for (const RasterMesh &raster_mesh : meshes) {
+    first_triangles.push_back(primitives.size());
+    object_to_camera.push_back(
+        camera->GetWorldToCamera() * raster_mesh.mesh->object_to_world->ToTransform());
+    std::vector<std::shared_ptr<Triangle>> mesh_triangles = CreateTriangles(raster_mesh.mesh);
+    std::vector<std::shared_ptr<GeometricPrimitive>> mesh_primitives =
+        CreateGeometricPrimitives(mesh_triangles, raster_mesh.id);
+    triangles.insert(triangles.end(), mesh_triangles.begin(), mesh_triangles.end());
+    triangle_ids.resize(triangles.size(), raster_mesh.id);
+    primitives.insert(primitives.end(), mesh_primitives.begin(), mesh_primitives.end());
+  }
+  first_triangles.push_back(primitives.size());
+
+  // Project the triangles in batches. Every batch keeps its triangles in order, so the tiles see
+  // them in the same order no matter which thread projected them.
+  Transform camera_to_raster = camera->GetCameraToRaster();
+  uint num_triangles = primitives.size();
+  uint num_batches = (num_triangles + PROJECT_BATCH_SIZE - 1) / PROJECT_BATCH_SIZE;
+  std::vector<std::vector<RasterTriangle>> batches(num_batches);
+  ParallelFor(num_batches, num_threads, [&](uint batch) {
+    uint begin = batch * PROJECT_BATCH_SIZE;
+    uint end = std::min(begin + PROJECT_BATCH_SIZE, num_triangles);
+    uint mesh_index = std::upper_bound(first_triangles.begin(), first_triangles.end(), begin) -
+        first_triangles.begin() - 1;
+    std::vector<Point3f> positions;
+    for (uint run_begin = begin; run_begin < end;) {
+      while (run_begin >= first_triangles[mesh_index + 1]) {
+        mesh_index++;
+      }
+      // Gather the vertices of the batch's triangles from this mesh and move them to camera space
+      // all at once.
+      uint run_end = std::min(end, first_triangles[mesh_index + 1]);
+      const Mesh &mesh = *meshes[mesh_index].mesh;
+      const uint *elements = mesh.elements.get() + (run_begin - first_triangles[mesh_index]) * 3;
+      positions.resize((run_end - run_begin) * 3);
+      for (uint i = 0; i < positions.size(); i++) {
+        positions[i] = mesh.vertices.get()[elements[i]].position;
+      }
+      object_to_camera[mesh_index].TransformPoints(positions.data(), positions.size(),
+          positions.data());
+      for (uint triangle = run_begin; triangle < run_end; triangle++) {
+        ClipVertex vertices[3];
+        for (uint i = 0; i < 3; i++) {
+          vertices[i].position = positions[(triangle - run_begin) * 3 + i];
+        }
+        vertices[0].barycentric = Point2f(0.f, 0.f);
+        vertices[1].barycentric = Point2f(1.f, 0.f);
+        vertices[2].barycentric = Point2f(0.f, 1.f);
+        ClipAndProject(vertices, triangle, camera->NEAR_PLANE, camera_to_raster, &batches[batch]);
+      }
+      run_begin = run_end;
+    }
+  });
+
+  // Bin the triangles by the tiles their bounds overlap.
+  uint tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+  uint tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+  std::vector<std::vector<const RasterTriangle *>> bins(tiles_x * tiles_y);
+  for (const std::vector<RasterTriangle> &batch : batches) {
+    for (const RasterTriangle &triangle : batch) {
+      int min_x, min_y, max_x, max_y;
+      if (!GetPixelBounds(triangle, width, height, &min_x, &min_y, &max_x, &max_y)) {
+        continue;
+      }
+      for (uint tile_y = min_y / TILE_SIZE; tile_y <= max_y / TILE_SIZE; tile_y++) {
+        for (uint tile_x = min_x / TILE_SIZE; tile_x <= max_x / TILE_SIZE; tile_x++) {
+          bins[tile_y * tiles_x + tile_x].push_back(&triangle);
+        }
+      }
+    }
+  }
+
+  // Tiles cover disjoint pixels, so they are rasterized in parallel without any locking.
+  ParallelFor(tiles_x * tiles_y, num_threads, [&](uint tile) {
+    int tile_min_x = (tile % tiles_x) * TILE_SIZE;
+    int tile_min_y = (tile / tiles_x) * TILE_SIZE;
+    int tile_max_x = std::min(tile_min_x + (int)TILE_SIZE, (int)width) - 1;
+    int tile_max_y = std::min(tile_min_y + (int)TILE_SIZE, (int)height) - 1;
+    for (const RasterTriangle *triangle : bins[tile]) {
+      int min_x, min_y, max_x, max_y;
+      GetPixelBounds(*triangle, width, height, &min_x, &min_y, &max_x, &max_y);
+      RasterizeTriangle(*triangle, std::max(min_x, tile_min_x), std::max(min_y, tile_min_y),
+          std::min(max_x, tile_max_x), std::min(max_y, tile_max_y), width, samples.data());
+    }
+  });
+}
+
+const VisibilitySample &VisibilityBuffer::GetSample(int x, int y) const {
+  assert(x >= 0 && x < (int)width && y >= 0 && y < (int)height);
+  return samples[y * width + x];
+}
+
+uint VisibilityBuffer::NumTriangles() const {
+  return primitives.size();
+}
+
+bool VisibilityBuffer::Intersect(const RayDifferential &ray, const Point2f &film_location,
+    const Scene &scene, Intersection *intersection) const {
+  int pixel_x = std::min(std::max((int)std::floor(film_location.x), 0), (int)width - 1);
+  int pixel_y = std::min(std::max((int)std::floor(film_location.y), 0), (int)height - 1);
+  // The center of the pixel sees exactly what was rasterized there.
+  const VisibilitySample &center = samples[pixel_y * width + pixel_x];
+  if (film_location.x == pixel_x + 0.5f && film_location.y == pixel_y + 0.5f) {
+    if (center.triangle == NO_TRIANGLE) {
+      return false;
+    }
+    if (SampleHit(ray, center, intersection)) {
+      return true;
+    }
+  }
+  uint candidates[9];
+  uint num_candidates = 0;
+  for (int y = std::max(pixel_y - 1, 0); y <= std::min(pixel_y + 1, (int)height - 1); y++) {
+    for (int x = std::max(pixel_x - 1, 0); x <= std::min(pixel_x + 1, (int)width - 1); x++) {
+      uint triangle = samples[y * width + x].triangle;
+      if (triangle != NO_TRIANGLE &&
+          std::find(candidates, candidates + num_candidates, triangle) ==
+          candidates + num_candidates) {
+        candidates[num_candidates++] = triangle;
+      }
+    }
+  }
+  if (num_candidates == 0) {
+    return false;
+  }
+  // Each hit shortens the ray, so the last candidate hit is the closest.
+  bool hit = false;
+  for (uint i = 0; i < num_candidates; i++) {
+    hit = primitives[candidates[i]]->Intersect(ray, intersection) || hit;
+  }
+  if (!hit) {
+    return scene.Intersect(ray, intersection);
+  }
+  ComputeDifferentials(ray, intersection);
+  return true;
+}
+
+bool VisibilityBuffer::SampleHit(const RayDifferential &ray, const VisibilitySample &sample,
+    Intersection *intersection) const {
+  // The depth is measured along the camera's z axis, so it is reached where the ray has advanced
+  // that far along it.
+  float origin_z = world_to_camera(ray.origin).z;
+  float direction_z = world_to_camera(ray.direction).z;
+  float t = (sample.depth - origin_z) / direction_z;
+  if (!(t > 0.f && t < ray.max_t)) {
+    return false;
+  }
+  ray.max_t = t;
+  intersection->t = t;
+  intersection->normal = triangles[sample.triangle]->ShadingNormal(1.f - sample.b1 - sample.b2,
+      sample.b1, sample.b2);
+  intersection->primitive_id = triangle_ids[sample.triangle];
+  ComputeDifferentials(ray, intersection);
+  return true;
+}
+
+}
@@ -0,0 +1,98 @@
+// This header defines the VisibilityBuffer, which finds the primary hits of a PerspectiveCamera by
+// rasterizing triangle meshes instead of tracing a ray per sample. The film is split into tiles
+// that are rasterized in parallel against a z-buffer, and every pixel records the triangle seen
+// through its center along with the barycentric coordinates and depth of the hit.
+//
+// An Integrator given a visibility buffer looks up the first hit of each camera ray in it, which
+// leaves ray tracing to secondary effects. A ray through the center of a pixel takes the hit
+// stored for the pixel as is, without intersecting anything. Rays elsewhere in the pixel are only
+// intersected with the triangles seen by the pixel and its eight neighbors, and fall back to
+// tracing the scene when they hit none of them. If the pixel and all of its neighbors saw nothing,
+// the ray is taken to miss without being traced. Like any rasterizer, this can miss triangles small
+// enough to fall between pixel centers, and geometry closer to the camera than its near plane.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_VISIBILITY_BUFFER_H
+#define LIANG_INTEGRATORS_VISIBILITY_BUFFER_H
+
+#include "cameras/perspective_camera.h"
+#include "core/geometry.h"
+#include "core/intersection.h"
+#include "core/liang.h"
+#include "core/scene.h"
+#include "primitives/geometric_primitive.h"
+#include "shapes/mesh.h"
+
+namespace liang {
+
+// A mesh to rasterize along with the id its primitives are tagged with in the scene.
+struct RasterMesh {
+  // The mesh to rasterize.
+  std::shared_ptr<Mesh> mesh;
+  // The id the mesh's GeometricPrimitives were created with.
+  uint id;
+};
+
+// What the center of a pixel sees.
+struct VisibilitySample {
+  // The index of the triangle seen, counting the triangles of every mesh in order, or
+  // NO_TRIANGLE if the pixel sees nothing.
+  uint triangle;
+  // The barycentric coordinates of the hit with respect to the triangle's second and third
+  // vertices. The first vertex's is 1 - b1 - b2.
+  float b1, b2;
+  // The depth of the hit along the camera's z axis.
+  float depth;
+};
+
+class VisibilityBuffer {
+  public:
+    // The triangle index of pixels that see nothing.
+    static const uint NO_TRIANGLE = 0xffffffff;
+    // The width and height in pixels of the tiles the film is rasterized in.
+    static const uint TILE_SIZE = 32;
+
+    // VisibilityBuffer constructor that rasterizes the given meshes as seen by the camera into a
+    // buffer the size of its film, using the given number of threads (0 uses every thread the
+    // system has). The meshes should be the ones the scene was built from.
+    VisibilityBuffer(std::shared_ptr<const PerspectiveCamera> camera,
+        const std::vector<RasterMesh> &meshes, uint num_threads = 0);
+
+    // Returns what the center of the given pixel sees.
+    const VisibilitySample &GetSample(int x, int y) const;
+
+    // Returns the number of triangles across every mesh.
+    uint NumTriangles() const;
+
+    // Finds the closest intersection of a camera ray through the given film location. Rays through
+    // a pixel center take the pixel's stored hit. Others are intersected with the triangles seen
+    // around them, tracing the scene only if they hit none of them. Fills in the intersection,
+    // including its differentials, and returns whether there is one.
+    bool Intersect(const RayDifferential &ray, const Point2f &film_location, const Scene &scene,
+        Intersection *intersection) const;
+
+  private:
+    // The width and height of the buffer in pixels.
+    uint width, height;
+    // The transform from world space to the camera space the depths are measured in.
+    Transform world_to_camera;
+    // Every triangle, counting the triangles of every mesh in order.
+    std::vector<std::shared_ptr<Triangle>> triangles;
+    // The id of the mesh of every triangle.
+    std::vector<uint> triangle_ids;
+    // A primitive for every triangle, tagged with the id of its mesh.
+    std::vector<std::shared_ptr<GeometricPrimitive>> primitives;
+    // The samples of every pixel in scanline order.
+    std::vector<VisibilitySample> samples;
+
+    // Fills in the intersection of a camera ray with the hit stored in a sample, which must have
+    // a triangle, without intersecting anything. Returns false if the hit isn't in the ray's
+    // range.
+    bool SampleHit(const RayDifferential &ray, const VisibilitySample &sample,
+        Intersection *intersection) const;
+};
+
+}
+
+#endif  // LIANG_INTEGRATORS_VISIBILITY_BUFFER_H
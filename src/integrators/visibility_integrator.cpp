@@ -0,0 +1,18 @@
+#include "integrators/visibility_integrator.h"
+
+namespace liang {
+
+VisibilityIntegrator::VisibilityIntegrator(std::shared_ptr<const Camera> camera,
+    std::shared_ptr<Sampler> sampler, uint num_threads, bool pin_threads) :
+    Integrator(camera, sampler, num_threads, pin_threads) {}
+
+float VisibilityIntegrator::Li(const RayDifferential &ray, const Scene &scene) const {
+  return scene.Intersect(ray) ? 1.f : 0.f;
+}
+
+float VisibilityIntegrator::ShadeFirstHit(const RayDifferential & /* ray */,
+    const Intersection *intersection, const Scene & /* scene */, uint * /* ray_count */) const {
+  return intersection ? 1.f : 0.f;
+}
+
+}
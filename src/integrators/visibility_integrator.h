@@ -0,0 +1,34 @@
+// This header defines the VisibilityIntegrator, the simplest possible Integrator. Camera rays that
+// hit anything in the scene have a radiance of 1 and all others have a radiance of 0, which yields
+// a white silhouette of the scene on a black background.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_INTEGRATORS_VISIBILITY_INTEGRATOR_H
+#define LIANG_INTEGRATORS_VISIBILITY_INTEGRATOR_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "core/scene.h"
+#include "integrators/integrator.h"
+
+namespace liang {
+
+class VisibilityIntegrator : public Integrator {
+  public:
+    // VisibilityIntegrator constructor that takes the camera, the sampler, the number of threads
+    // to render with, and whether to pin the threads to NUMA nodes.
+    VisibilityIntegrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler,
+        uint num_threads = 0, bool pin_threads = false);
+
+    // Returns 1 if the ray intersects the scene, else 0.
+    float Li(const RayDifferential &ray, const Scene &scene) const;
+
+    // Returns 1 if the camera ray's first hit was found, else 0, without tracing anything more.
+    float ShadeFirstHit(const RayDifferential &ray, const Intersection *intersection,
+        const Scene &scene, uint *ray_count) const;
+};
+
+}
+
+#endif  // LIANG_INTEGRATORS_VISIBILITY_INTEGRATOR_H
@@ -8,14 +8,31 @@
 #include "core/liang.h"
 #include "core/scene.h"
 #include "core/transform.h"
+#include "core/transform_cache.h"
 #include "filters/filter.h"
 #include "filters/box_filter.h"
+#include "filters/mitchell_filter.h"
+#include "integrators/render_farm.h"
+#include "integrators/reprojection_cache.h"
+#include "integrators/tile_order.h"
+#include "integrators/visibility_buffer.h"
+#include "integrators/visibility_integrator.h"
 #include "primitives/aggregate_primitive.h"
 #include "primitives/geometric_primitive.h"
 #include "primitives/primitive.h"
+#include "samplers/adaptive_sampler.h"
+#include "samplers/random_sampler.h"
+#include "samplers/sobol_sampler.h"
 #include "utils/math.h"
 
-std::shared_ptr<liang::Mesh> CreateUnitCube(liang::Transform *object_to_world) {
+#include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Owns the transforms of the meshes created below.
+static liang::TransformCache transform_cache;
+
+std::shared_ptr<liang::Mesh> CreateUnitCube(const liang::AffineTransform *object_to_world) {
   std::shared_ptr<liang::TriangleVertex> vertices(new liang::TriangleVertex[36]);
   vertices.get()[0] = {liang::Point3f(-0.5, -0.5, -0.5), liang::Normal3f(0.0, 0.0, -1.0)};
   vertices.get()[1] = {liang::Point3f(0.5, -0.5, -0.5), liang::Normal3f(0.0, 0.0, -1.0)};
@@ -62,46 +79,143 @@ std::shared_ptr<liang::Mesh> CreateUnitCube(liang::Transform *object_to_world) {
 }
 
 std::shared_ptr<liang::Mesh> CreateUnitCube() {
-  liang::Transform *object_to_world = new liang::Transform();
-  return CreateUnitCube(object_to_world);
+  return CreateUnitCube(transform_cache.Intern(liang::AffineTransform()));
 }
 
 std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives(
-    liang::Transform *object_to_world) {
+    const liang::AffineTransform *object_to_world) {
   std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(object_to_world);
   auto triangles = liang::CreateTriangles(mesh);
   return liang::CreateGeometricPrimitives(triangles);
 }
 
 std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives() {
-  liang::Transform *object_to_world = new liang::Transform();
-  return CreateUnitCubePrimitives(object_to_world);
+  return CreateUnitCubePrimitives(transform_cache.Intern(liang::AffineTransform()));
+}
+
+// Renders the same frame with each tile order and prints how long each one took.
+void BenchmarkTileOrders(const liang::Scene &scene) {
+  std::vector<std::pair<std::string, std::shared_ptr<liang::TileOrder>>> tile_orders = {
+      {"scanline", std::make_shared<liang::ScanlineTileOrder>()},
+      {"morton", std::make_shared<liang::MortonTileOrder>()},
+      {"hilbert", std::make_shared<liang::HilbertTileOrder>()},
+      {"spiral", std::make_shared<liang::SpiralTileOrder>()}};
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(2.01f, 2.0f, 2.f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 1.f, 0.f));
+  for (auto &tile_order : tile_orders) {
+    auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+    auto film = std::make_shared<liang::Film>(1024, 1024, std::move(filter));
+    auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, film, 45.f,
+        liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+    auto sampler = std::make_shared<liang::RandomSampler>(4);
+    liang::VisibilityIntegrator integrator(camera, sampler);
+    integrator.SetTileOrder(tile_order.second);
+    auto start = std::chrono::steady_clock::now();
+    integrator.Render(scene);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << tile_order.first << ": " << elapsed.count() << "s" << std::endl;
+  }
+}
+
+// Sets up the integrator for the frame rendered by the render farm. The coordinator and every
+// worker call this, so they all agree on the render.
+std::shared_ptr<liang::Integrator> CreateFarmIntegrator() {
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(2.01f, 2.0f, 2.f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 1.f, 0.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(1024, 1024, std::move(filter));
+  auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  auto sampler = std::make_shared<liang::AdaptiveSampler>(
+      std::unique_ptr<liang::Sampler>(new liang::SobolSampler(64)), 8, 0.05f);
+  return std::make_shared<liang::VisibilityIntegrator>(camera, sampler);
+}
+
+// Renders the farm frame with a coordinator and the given number of worker processes forked from
+// this one, all talking over localhost, and saves the result to farm.png and farm.exr. More
+// workers can join from other shells with --render-worker and the printed port.
+int RunRenderFarm(const liang::Scene &scene, uint num_workers) {
+  std::shared_ptr<liang::Integrator> integrator = CreateFarmIntegrator();
+  liang::RenderCoordinator coordinator(integrator);
+  uint16_t port = coordinator.GetPort();
+  if (port == 0) {
+    std::cerr << "Could not open the coordinator socket." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Coordinator listening on port " << port << std::endl;
+  // Workers are forked before the coordinator starts any threads.
+  std::vector<pid_t> workers;
+  for (uint i = 0; i < num_workers; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      bool success = liang::RunRenderWorker(*CreateFarmIntegrator(), scene, "127.0.0.1", port);
+      std::exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (pid > 0) {
+      workers.push_back(pid);
+    }
+  }
+  auto start = std::chrono::steady_clock::now();
+  coordinator.Run();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Rendered in " << elapsed.count() << "s" << std::endl;
+  for (pid_t pid : workers) {
+    waitpid(pid, nullptr, 0);
+  }
+  integrator->GetFilm()->SaveAsPng("farm.png");
+  integrator->GetFilm()->SaveAsExr("farm.exr");
+  return EXIT_SUCCESS;
 }
 
-// Main point of entry for the code.
-int main(int /* argc */, char* /* argv */ []) {
-  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims = CreateUnitCubePrimitives();
+// Main point of entry for the code. Pass --benchmark-tile-orders to compare the tile orders
+// instead of rendering the turntable, --render-farm <workers> to render a frame with a coordinator
+// and worker processes, or --render-worker <port> to join a running coordinator. Pass
+// --rasterize-primary to render the turntable with primary hits from a visibility buffer, and
+// --reproject to reuse the pixels of each frame of the turntable in the next.
+int main(int argc, char *argv[]) {
+  std::shared_ptr<liang::Mesh> mesh = CreateUnitCube();
+  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims =
+      liang::CreateGeometricPrimitives(liang::CreateTriangles(mesh));
   std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
   liang::Scene scene(std::make_shared<liang::AggregatePrimitive>(prims));
+  if (argc > 1 && std::string(argv[1]) == "--benchmark-tile-orders") {
+    BenchmarkTileOrders(scene);
+    return EXIT_SUCCESS;
+  }
+  if (argc > 2 && std::string(argv[1]) == "--render-farm") {
+    return RunRenderFarm(scene, std::stoul(argv[2]));
+  }
+  if (argc > 2 && std::string(argv[1]) == "--render-worker") {
+    bool success = liang::RunRenderWorker(*CreateFarmIntegrator(), scene, "127.0.0.1",
+        std::stoul(argv[2]));
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  bool rasterize_primary = false;
+  std::shared_ptr<liang::ReprojectionCache> reprojection_cache;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--rasterize-primary") {
+      rasterize_primary = true;
+    } else if (std::string(argv[i]) == "--reproject") {
+      reprojection_cache = std::make_shared<liang::ReprojectionCache>();
+    }
+  }
   int index = 0;
   for (float theta = 0.f; theta < 2 * PI; theta += (PI / 10.f)) {
     liang::Transform world_to_camera = liang::LookAtTransform(
         liang::Vector3f(std::sin(theta) * 2.f + 0.01f, 2.0f, std::cos(theta) * 2.f),
         liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 1.f, 0.f));
-    auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+    auto filter = std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f));
     auto film = std::make_shared<liang::Film>(512, 512, std::move(filter));
-    liang::PerspectiveCamera camera = liang::PerspectiveCamera(world_to_camera, film, 45.f,
+    auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, film, 45.f,
         liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
-    for (float i = 0.f; i < film->height; i++) {
-      for (float j = 0.f; j < film->width; j++) {
-        liang::Ray3f ray = liang::Ray3f();
-        camera.GenerateRay(liang::Point2f(i, j), &ray);
-        bool intersected = scene.Intersect(ray);
-        if (intersected) {
-          film->AddSample(i, j, 1.f, 1.f, 1.f, 1.f);
-        }
-      }
+    auto sampler = std::make_shared<liang::AdaptiveSampler>(
+        std::unique_ptr<liang::Sampler>(new liang::SobolSampler(64)), 8, 0.05f);
+    liang::VisibilityIntegrator integrator(camera, sampler);
+    if (rasterize_primary) {
+      integrator.SetVisibilityBuffer(std::make_shared<liang::VisibilityBuffer>(camera,
+          std::vector<liang::RasterMesh>{{mesh, 0}}));
     }
+    integrator.SetReprojectionCache(reprojection_cache);
+    integrator.Render(scene);
     std::string name = index < 10 ? "0" + std::to_string(index) : std::to_string(index);
     film->SaveAsPng("gif/" + name + ".png");
     index++;
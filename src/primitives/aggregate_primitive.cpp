@@ -13,6 +13,17 @@ AABB3f AggregatePrimitive::WorldBounds() const {
   return world_bounds;
 }
 
+void AggregatePrimitive::MotionBounds(float time_0, float time_1, AABB3f *bounds_0,
+    AABB3f *bounds_1) const {
+  primitives[0]->MotionBounds(time_0, time_1, bounds_0, bounds_1);
+  for (auto &primitive : primitives) {
+    AABB3f primitive_bounds_0 = world_bounds, primitive_bounds_1 = world_bounds;
+    primitive->MotionBounds(time_0, time_1, &primitive_bounds_0, &primitive_bounds_1);
+    *bounds_0 = Union(*bounds_0, primitive_bounds_0);
+    *bounds_1 = Union(*bounds_1, primitive_bounds_1);
+  }
+}
+
 // This is slow. Acceleration data structures should override this function.
 bool AggregatePrimitive::Intersect(Ray3f ray) const {
   for (auto primitive : primitives) {
@@ -23,4 +34,13 @@ bool AggregatePrimitive::Intersect(Ray3f ray) const {
   return false;
 }
 
+// Every hit shortens the ray, so later primitives only report hits closer than the best so far.
+bool AggregatePrimitive::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  bool hit = false;
+  for (auto &primitive : primitives) {
+    hit = primitive->Intersect(ray, intersection) || hit;
+  }
+  return hit;
+}
+
 }
@@ -25,10 +25,16 @@ class AggregatePrimitive : public Primitive {
     // primitives the AggregatePrimitive contains.
     AABB3f WorldBounds() const;
 
+    // Gets the union of the motion bounds of every contained primitive.
+    void MotionBounds(float time_0, float time_1, AABB3f *bounds_0, AABB3f *bounds_1) const;
+
     // Intersects a ray with the primitive and return true if there is an intersection.
     bool Intersect(Ray3f ray) const;
 
-  private:
+    // Intersects a ray with every contained primitive and fills in the closest intersection.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
+  protected:
     // The primitives the AggregatePrimitive contains.
     std::vector<std::shared_ptr<Primitive>> primitives;
 
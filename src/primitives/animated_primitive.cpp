@@ -0,0 +1,39 @@
+#include "primitives/animated_primitive.h"
+
+namespace liang {
+
+AnimatedPrimitive::AnimatedPrimitive(std::shared_ptr<Primitive> primitive,
+    const AnimatedTransform *primitive_to_world) : primitive{primitive},
+    primitive_to_world{primitive_to_world} {}
+
+AABB3f AnimatedPrimitive::WorldBounds() const {
+  AABB3f bounds_0 = primitive->WorldBounds(), bounds_1 = bounds_0;
+  MotionBounds(primitive_to_world->start_time, primitive_to_world->end_time, &bounds_0,
+      &bounds_1);
+  return Union(bounds_0, bounds_1);
+}
+
+void AnimatedPrimitive::MotionBounds(float time_0, float time_1, AABB3f *bounds_0,
+    AABB3f *bounds_1) const {
+  primitive_to_world->LinearBounds(primitive->WorldBounds(), time_0, time_1, bounds_0, bounds_1);
+}
+
+bool AnimatedPrimitive::Intersect(Ray3f ray) const {
+  return primitive->Intersect(primitive_to_world->Interpolate(ray.time).Inverse()(ray));
+}
+
+// The ray's direction is transformed without being normalized, so t means the same thing in both
+// spaces and the shortened max_t carries straight back to the world space ray.
+bool AnimatedPrimitive::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  AffineTransform transform = primitive_to_world->Interpolate(ray.time);
+  Ray3f primitive_ray = transform.Inverse()(ray);
+  if (!primitive->Intersect(primitive_ray, intersection)) {
+    return false;
+  }
+  Vector3f normal = Normalize(transform(intersection->normal));
+  intersection->normal = Normal3f(normal.x, normal.y, normal.z);
+  ray.max_t = primitive_ray.max_t;
+  return true;
+}
+
+}
@@ -0,0 +1,49 @@
+// This header defines the AnimatedPrimitive, a Primitive that moves another Primitive around the
+// scene with an AnimatedTransform for motion blur. Rays are carried into the contained primitive's
+// space by the transform at the ray's time, so the contained primitive is built once and never
+// has to move itself.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_PRIMITIVES_ANIMATED_PRIMITIVE_H
+#define LIANG_PRIMITIVES_ANIMATED_PRIMITIVE_H
+
+#include "core/animated_transform.h"
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "primitives/primitive.h"
+
+namespace liang {
+
+class AnimatedPrimitive : public Primitive {
+  public:
+    // Constructor taking the primitive to move and the transform from its space to world space,
+    // which must outlive the AnimatedPrimitive. What the contained primitive calls world space is
+    // the space the transform moves around.
+    AnimatedPrimitive(std::shared_ptr<Primitive> primitive,
+        const AnimatedTransform *primitive_to_world);
+
+    // Gets the world space bounding box of everywhere the primitive goes between the keyframes.
+    AABB3f WorldBounds() const;
+
+    // Gets the world space bounding boxes of the primitive moving from time_0 to time_1.
+    void MotionBounds(float time_0, float time_1, AABB3f *bounds_0, AABB3f *bounds_1) const;
+
+    // Intersects a ray with the primitive where it is at the ray's time and return true if there
+    // is an intersection.
+    bool Intersect(Ray3f ray) const;
+
+    // Intersects a ray with the primitive where it is at the ray's time and fills in the closest
+    // intersection so far.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
+  private:
+    // The primitive being moved.
+    std::shared_ptr<Primitive> primitive;
+    // The transform from the contained primitive's space to world space.
+    const AnimatedTransform *primitive_to_world;
+};
+
+}
+
+#endif  // LIANG_PRIMITIVES_ANIMATED_PRIMITIVE_H
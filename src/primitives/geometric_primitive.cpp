@@ -2,7 +2,8 @@
 
 namespace liang {
 
-GeometricPrimitive::GeometricPrimitive(std::shared_ptr<Shape> shape) : shape{shape} {}
+GeometricPrimitive::GeometricPrimitive(std::shared_ptr<Shape> shape, uint id) : shape{shape},
+    id{id} {}
 
 AABB3f GeometricPrimitive::WorldBounds() const {
   return shape->WorldBounds();
@@ -12,11 +13,19 @@ bool GeometricPrimitive::Intersect(Ray3f ray) const {
   return shape->Intersect(ray);
 }
 
+bool GeometricPrimitive::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  if (!shape->Intersect(ray, intersection)) {
+    return false;
+  }
+  intersection->primitive_id = id;
+  return true;
+}
+
 std::vector<std::shared_ptr<GeometricPrimitive>> CreateGeometricPrimitives(
-    std::vector<std::shared_ptr<Triangle>> triangles) {
+    std::vector<std::shared_ptr<Triangle>> triangles, uint id) {
   std::vector<std::shared_ptr<GeometricPrimitive>> prims;
   for (std::shared_ptr<Triangle> triangle : triangles) {
-    prims.push_back(std::make_shared<GeometricPrimitive>(triangle));
+    prims.push_back(std::make_shared<GeometricPrimitive>(triangle, id));
   }
   return prims;
 }
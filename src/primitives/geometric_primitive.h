@@ -16,8 +16,10 @@ namespace liang {
 
 class GeometricPrimitive : public Primitive {
   public:
-    // Constuctor initializing the GeometricPrimitive with a pointer to the shape it contains.
-    GeometricPrimitive(std::shared_ptr<Shape> shape);
+    // Constuctor initializing the GeometricPrimitive with a pointer to the shape it contains and
+    // the id it tags intersections with. Ids are up to whoever builds the scene, and are usually
+    // shared by every primitive of a mesh so they can be used as object masks.
+    GeometricPrimitive(std::shared_ptr<Shape> shape, uint id = 0);
 
     // Gets the world space bounding box of the geometric data contained inside the primitive.
     AABB3f WorldBounds() const;
@@ -25,15 +27,20 @@ class GeometricPrimitive : public Primitive {
     // Intersects a ray with the primitive and return true if there is an intersection.
     bool Intersect(Ray3f ray) const;
 
+    // Intersects a ray with the primitive and fills in the closest intersection so far.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
   private:
     // The Shape the GeometricPrimitive contains.
     std::shared_ptr<Shape> shape;
+    // The id intersections with the primitive are tagged with.
+    uint id;
 };
 
 // Creates and returns a vector of GeometricPrimitive pointers created from a vector of Triangle
-// pointers.
+// pointers, all with the given id.
 std::vector<std::shared_ptr<GeometricPrimitive>> CreateGeometricPrimitives(
-    std::vector<std::shared_ptr<Triangle>> triangles);
+    std::vector<std::shared_ptr<Triangle>> triangles, uint id = 0);
   
 }
 
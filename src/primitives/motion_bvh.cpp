@@ -0,0 +1,234 @@
+#include "primitives/motion_bvh.h"
+
+namespace liang {
+
+// The number of bins centroids are sorted into when looking for the best split.
+static const uint NUM_BINS = 12;
+// The depth past which nodes are split at the median instead of by the surface area heuristic.
+// This bounds the depth of the tree, and with it the traversal stack, by MAX_SAH_DEPTH plus the
+// log of the number of primitives.
+static const uint MAX_SAH_DEPTH = 32;
+// The size of the traversal stack, which is enough for any tree of up to 2^32 primitives.
+static const uint STACK_SIZE = 64;
+
+struct MotionBVHBuildPrimitive {
+  // The bounds of the primitive at shutter open and at shutter close.
+  AABB3f bounds_open, bounds_close;
+  // The center of everywhere the primitive goes during the shutter.
+  Point3f centroid;
+  // The index of the primitive among those the MotionBVH was built with.
+  uint index;
+};
+
+// Returns the surface area of the linear interpolation of two boxes averaged over the
+// interpolation. The area is quadratic in the interpolation parameter, which Simpson's rule
+// integrates exactly.
+static float AverageSurfaceArea(const AABB3f &bounds_0, const AABB3f &bounds_1) {
+  AABB3f middle(Lerp(bounds_0.min_point, bounds_1.min_point, 0.5f));
+  middle.max_point = Lerp(bounds_0.max_point, bounds_1.max_point, 0.5f);
+  return (bounds_0.SurfaceArea() + 4.f * middle.SurfaceArea() + bounds_1.SurfaceArea()) / 6.f;
+}
+
+// Returns whether a ray enters the box between its origin and its max_t, given the reciprocal of
+// its direction.
+static bool IntersectBounds(const Point3f &min_point, const Point3f &max_point, const Ray3f &ray,
+    const Vector3f &inverse_direction) {
+  float t_near = 0.f;
+  float t_far = ray.max_t;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (min_point[axis] - ray.origin[axis]) * inverse_direction[axis];
+    float t1 = (max_point[axis] - ray.origin[axis]) * inverse_direction[axis];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    // Written so that a NaN from a ray parallel to a slab leaves the interval alone.
+    t_near = t0 > t_near ? t0 : t_near;
+    t_far = t1 < t_far ? t1 : t_far;
+    if (t_near > t_far) {
+      return false;
+    }
+  }
+  return true;
+}
+
+MotionBVH::MotionBVH(std::vector<std::shared_ptr<Primitive>> primitives, float shutter_open,
+    float shutter_close) : AggregatePrimitive(primitives), shutter_open{shutter_open},
+    shutter_close{shutter_close}, nodes{} {
+  assert(shutter_open <= shutter_close);
+  std::vector<MotionBVHBuildPrimitive> build_primitives;
+  build_primitives.reserve(this->primitives.size());
+  for (uint i = 0; i < this->primitives.size(); i++) {
+    AABB3f bounds_open = world_bounds, bounds_close = world_bounds;
+    this->primitives[i]->MotionBounds(shutter_open, shutter_close, &bounds_open, &bounds_close);
+    AABB3f bounds = Union(bounds_open, bounds_close);
+    build_primitives.push_back({bounds_open, bounds_close,
+        Lerp(bounds.min_point, bounds.max_point, 0.5f), i});
+  }
+  std::vector<std::shared_ptr<Primitive>> ordered_primitives;
+  ordered_primitives.reserve(this->primitives.size());
+  Build(&build_primitives, 0, build_primitives.size(), 0, &ordered_primitives);
+  this->primitives.swap(ordered_primitives);
+}
+
+uint MotionBVH::Build(std::vector<MotionBVHBuildPrimitive> *build_primitives, uint start,
+    uint end, uint depth, std::vector<std::shared_ptr<Primitive>> *ordered_primitives) {
+  assert(start < end);
+  std::vector<MotionBVHBuildPrimitive> &build = *build_primitives;
+  AABB3f bounds_open = build[start].bounds_open;
+  AABB3f bounds_close = build[start].bounds_close;
+  AABB3f centroid_bounds(build[start].centroid);
+  for (uint i = start; i < end; i++) {
+    bounds_open = Union(bounds_open, build[i].bounds_open);
+    bounds_close = Union(bounds_close, build[i].bounds_close);
+    centroid_bounds = Union(centroid_bounds, AABB3f(build[i].centroid));
+  }
+  uint node_index = nodes.size();
+  nodes.push_back({bounds_open, bounds_close, 0, 0, 0});
+  uint num_primitives = end - start;
+  Vector3f extent = centroid_bounds.Diagonal();
+  uint axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+  // Primitives whose centroids all coincide can't be told apart, so they share a leaf.
+  if (num_primitives <= MAX_PRIMITIVES_IN_NODE || extent[axis] == 0.f) {
+    nodes[node_index].offset = ordered_primitives->size();
+    nodes[node_index].num_primitives = num_primitives;
+    for (uint i = start; i < end; i++) {
+      ordered_primitives->push_back(primitives[build[i].index]);
+    }
+    return node_index;
+  }
+
+  float axis_min = centroid_bounds.min_point[axis];
+  auto bin_of = [&](const MotionBVHBuildPrimitive &primitive) {
+    uint bin = (uint)(NUM_BINS * (primitive.centroid[axis] - axis_min) / extent[axis]);
+    return std::min(bin, NUM_BINS - 1);
+  };
+  uint mid = start;
+  if (depth < MAX_SAH_DEPTH) {
+    uint counts[NUM_BINS] = {};
+    std::vector<AABB3f> bins_open(NUM_BINS, bounds_open), bins_close(NUM_BINS, bounds_close);
+    for (uint i = start; i < end; i++) {
+      uint bin = bin_of(build[i]);
+      bins_open[bin] = counts[bin] ? Union(bins_open[bin], build[i].bounds_open) :
+          build[i].bounds_open;
+      bins_close[bin] = counts[bin] ? Union(bins_close[bin], build[i].bounds_close) :
+          build[i].bounds_close;
+      counts[bin]++;
+    }
+    // Sweep from both ends to find the area and count on either side of every split.
+    float below_costs[NUM_BINS - 1];
+    uint below_count = 0;
+    AABB3f below_open = bounds_open, below_close = bounds_close;
+    for (uint split = 0; split < NUM_BINS - 1; split++) {
+      if (counts[split]) {
+        below_open = below_count ? Union(below_open, bins_open[split]) : bins_open[split];
+        below_close = below_count ? Union(below_close, bins_close[split]) : bins_close[split];
+        below_count += counts[split];
+      }
+      below_costs[split] = below_count ? below_count * AverageSurfaceArea(below_open,
+          below_close) : 0.f;
+    }
+    float best_cost = std::numeric_limits<float>::infinity();
+    uint best_split = 0;
+    uint above_count = 0;
+    AABB3f above_open = bounds_open, above_close = bounds_close;
+    for (uint split = NUM_BINS - 1; split > 0; split--) {
+      if (counts[split]) {
+        above_open = above_count ? Union(above_open, bins_open[split]) : bins_open[split];
+        above_close = above_count ? Union(above_close, bins_close[split]) : bins_close[split];
+        above_count += counts[split];
+      }
+      float cost = below_costs[split - 1] + (above_count ? above_count *
+          AverageSurfaceArea(above_open, above_close) : 0.f);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = split - 1;
+      }
+    }
+    auto above_split = std::partition(build.begin() + start, build.begin() + end,
+        [&](const MotionBVHBuildPrimitive &primitive) {
+          return bin_of(primitive) <= best_split;
+        });
+    mid = above_split - build.begin();
+  }
+  // Past the SAH depth, or if every centroid landed in a single bin, split at the median.
+  if (mid == start || mid == end) {
+    mid = start + num_primitives / 2;
+    std::nth_element(build.begin() + start, build.begin() + mid, build.begin() + end,
+        [axis](const MotionBVHBuildPrimitive &a, const MotionBVHBuildPrimitive &b) {
+          return a.centroid[axis] < b.centroid[axis];
+        });
+  }
+  Build(build_primitives, start, mid, depth + 1, ordered_primitives);
+  // Building the second child grows nodes, so it has to finish before the parent is indexed.
+  uint second_child = Build(build_primitives, mid, end, depth + 1, ordered_primitives);
+  nodes[node_index].offset = second_child;
+  nodes[node_index].axis = axis;
+  return node_index;
+}
+
+template <typename Visit>
+void MotionBVH::Traverse(const Ray3f &ray, Visit visit) const {
+  float s = 0.f;
+  if (shutter_close > shutter_open) {
+    s = std::min(std::max((ray.time - shutter_open) / (shutter_close - shutter_open), 0.f), 1.f);
+  }
+  Vector3f inverse_direction(1.f / ray.direction.x, 1.f / ray.direction.y,
+      1.f / ray.direction.z);
+  uint stack[STACK_SIZE];
+  uint stack_size = 0;
+  uint current = 0;
+  while (true) {
+    const MotionBVHNode &node = nodes[current];
+    // ray.max_t shrinks as visit() finds hits, which culls nodes beyond the closest one.
+    if (IntersectBounds(Lerp(node.bounds_open.min_point, node.bounds_close.min_point, s),
+        Lerp(node.bounds_open.max_point, node.bounds_close.max_point, s), ray,
+        inverse_direction)) {
+      if (node.num_primitives > 0) {
+        for (uint i = 0; i < node.num_primitives; i++) {
+          if (visit(node.offset + i)) {
+            return;
+          }
+        }
+      } else {
+        // Visit the child on the side the ray comes from first.
+        assert(stack_size < STACK_SIZE);
+        if (ray.direction[node.axis] < 0.f) {
+          stack[stack_size++] = current + 1;
+          current = node.offset;
+        } else {
+          stack[stack_size++] = node.offset;
+          current = current + 1;
+        }
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      return;
+    }
+    current = stack[--stack_size];
+  }
+}
+
+bool MotionBVH::Intersect(Ray3f ray) const {
+  bool hit = false;
+  Traverse(ray, [&](uint index) {
+    hit = primitives[index]->Intersect(ray);
+    return hit;
+  });
+  return hit;
+}
+
+bool MotionBVH::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  bool hit = false;
+  Traverse(ray, [&](uint index) {
+    hit = primitives[index]->Intersect(ray, intersection) || hit;
+    return false;
+  });
+  return hit;
+}
+
+uint MotionBVH::NumNodes() const {
+  return nodes.size();
+}
+
+}
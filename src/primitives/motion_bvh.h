@@ -0,0 +1,82 @@
+// This header defines the MotionBVH, a bounding volume hierarchy over primitives that may move
+// while the shutter is open. Every node stores its bounds both at shutter open and at shutter
+// close, and a ray is tested against their linear interpolation at the ray's time. A node then
+// only covers where its primitives are at that moment instead of everywhere they go during the
+// shutter, which keeps fast moving primitives from bloating every node above them. Static
+// primitives have the same bounds at both ends, so a static scene gets an ordinary BVH.
+//
+// The tree is built top down, splitting each node with the surface area heuristic over binned
+// primitive centroids. The area of a box is averaged over the shutter, since that is how likely a
+// ray at a random time is to hit it. Rays cast outside the shutter are tested against the bounds
+// at the nearer end, which may miss primitives that have moved on.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_PRIMITIVES_MOTION_BVH_H
+#define LIANG_PRIMITIVES_MOTION_BVH_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "primitives/aggregate_primitive.h"
+#include "primitives/primitive.h"
+
+namespace liang {
+
+// A node of the MotionBVH, stored in depth first order.
+struct MotionBVHNode {
+  // The bounds of the node's primitives at shutter open and at shutter close.
+  AABB3f bounds_open, bounds_close;
+  // For leaves, the index of the first primitive. For interior nodes, the index of the second
+  // child, since the first child directly follows its parent.
+  uint offset;
+  // The number of primitives in a leaf, or 0 for interior nodes.
+  uint num_primitives;
+  // The axis an interior node's children are split along.
+  uint axis;
+};
+
+// A primitive's bounds and centroid, used while building the MotionBVH.
+struct MotionBVHBuildPrimitive;
+
+class MotionBVH : public AggregatePrimitive {
+  public:
+    // The number of primitives up to which a node is made a leaf.
+    static const uint MAX_PRIMITIVES_IN_NODE = 4;
+    // The times the shutter opens and closes at.
+    const float shutter_open, shutter_close;
+
+    // Constructor building the hierarchy over the primitives for a shutter open from
+    // shutter_open to shutter_close, which should match the camera's.
+    MotionBVH(std::vector<std::shared_ptr<Primitive>> primitives, float shutter_open,
+        float shutter_close);
+
+    // Intersects a ray with the primitives where they are at the ray's time and return true if
+    // there is an intersection.
+    bool Intersect(Ray3f ray) const;
+
+    // Intersects a ray with the primitives where they are at the ray's time and fills in the
+    // closest intersection.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
+    // Returns the number of nodes in the hierarchy.
+    uint NumNodes() const;
+
+  private:
+    // The nodes of the hierarchy in depth first order, starting with the root.
+    std::vector<MotionBVHNode> nodes;
+
+    // Builds the subtree over the primitives referred to by build_primitives between start and
+    // end, appending its nodes and moving its primitives into ordered_primitives in leaf order.
+    // Returns the index of the subtree's root.
+    uint Build(std::vector<MotionBVHBuildPrimitive> *build_primitives, uint start,
+        uint end, uint depth, std::vector<std::shared_ptr<Primitive>> *ordered_primitives);
+
+    // Visits every leaf whose bounds the ray passes through at its time, nearer ones first,
+    // calling visit with the index of each primitive in it. Stops early if visit returns true.
+    template <typename Visit>
+    void Traverse(const Ray3f &ray, Visit visit) const;
+};
+
+}
+
+#endif  // LIANG_PRIMITIVES_MOTION_BVH_H
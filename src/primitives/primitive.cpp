@@ -0,0 +1,11 @@
+#include "primitives/primitive.h"
+
+namespace liang {
+
+void Primitive::MotionBounds(float /* time_0 */, float /* time_1 */, AABB3f *bounds_0,
+    AABB3f *bounds_1) const {
+  *bounds_0 = WorldBounds();
+  *bounds_1 = *bounds_0;
+}
+
+}
@@ -7,6 +7,7 @@
 #define LIANG_PRIMITIVES_PRIMITIVE_H
 
 #include "core/geometry.h"
+#include "core/intersection.h"
 #include "core/liang.h"
 #include "core/transform.h"
 
@@ -17,8 +18,18 @@ class Primitive {
     // Gets the world space bounding box of the geometric data contained inside the primitive.
     virtual AABB3f WorldBounds() const = 0;
 
+    // Gets world space bounding boxes at time_0 and time_1 such that at any time in between, the
+    // primitive lies inside their linear interpolation. By default, the primitive is taken to stay
+    // put and both are WorldBounds().
+    virtual void MotionBounds(float time_0, float time_1, AABB3f *bounds_0,
+        AABB3f *bounds_1) const;
+
     // Intersects a ray with the primitive and return true if there is an intersection.
     virtual bool Intersect(Ray3f ray) const = 0;
+
+    // Intersects a ray with the primitive and returns true if there is an intersection closer than
+    // the ray's max_t, filling in the closest one and shortening the ray to it.
+    virtual bool Intersect(const Ray3f &ray, Intersection *intersection) const = 0;
 };
 
 }
@@ -0,0 +1,39 @@
+#include "samplers/adaptive_sampler.h"
+
+namespace liang {
+
+AdaptiveSampler::AdaptiveSampler(std::unique_ptr<Sampler> sampler, uint min_samples,
+    float error_target) : Sampler(sampler->samples_per_pixel), min_samples{min_samples},
+    error_target{error_target}, sampler{std::move(sampler)} {
+  assert(min_samples >= 2 && min_samples <= samples_per_pixel);
+  assert(error_target > 0.f);
+}
+
+void AdaptiveSampler::StartPixel(const Point2i &pixel) {
+  Sampler::StartPixel(pixel);
+  sampler->StartPixel(pixel);
+}
+
+bool AdaptiveSampler::StartNextSample() {
+  sampler->StartNextSample();
+  return Sampler::StartNextSample();
+}
+
+bool AdaptiveSampler::IsConverged(const Pixel &pixel) const {
+  return pixel.sample_count >= min_samples && PixelRelativeError(pixel) <= error_target;
+}
+
+float AdaptiveSampler::Get1D() {
+  return sampler->Get1D();
+}
+
+Point2f AdaptiveSampler::Get2D() {
+  return sampler->Get2D();
+}
+
+std::unique_ptr<Sampler> AdaptiveSampler::Clone() const {
+  return std::unique_ptr<Sampler>(new AdaptiveSampler(sampler->Clone(), min_samples,
+      error_target));
+}
+
+}
@@ -0,0 +1,56 @@
+// This header defines the AdaptiveSampler, a Sampler that wraps another Sampler and stops taking
+// samples in a pixel once the estimated error of the pixel falls below a target. Smooth regions of
+// the image converge after a handful of samples, so the remaining budget is spent on the noisy
+// pixels that actually need it.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_ADAPTIVE_SAMPLER_H
+#define LIANG_SAMPLERS_ADAPTIVE_SAMPLER_H
+
+#include "cameras/film.h"
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "samplers/sampler.h"
+
+namespace liang {
+
+class AdaptiveSampler : public Sampler {
+  public:
+    // The minimum number of samples taken in every pixel before its error estimate is trusted.
+    const uint min_samples;
+    // The relative standard error below which a pixel is considered converged.
+    const float error_target;
+
+    // AdaptiveSampler constructor that takes the sampler generating the actual sample values, the
+    // minimum number of samples per pixel, and the error target. The maximum number of samples per
+    // pixel is taken from the wrapped sampler.
+    AdaptiveSampler(std::unique_ptr<Sampler> sampler, uint min_samples, float error_target);
+
+    // Starts sampling the given pixel in both this and the wrapped sampler.
+    void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample in both this and the wrapped sampler.
+    bool StartNextSample();
+
+    // A pixel is converged once it has taken min_samples samples and its relative error is at most
+    // the error target.
+    bool IsConverged(const Pixel &pixel) const;
+
+    // Returns the next dimension of the current sample from the wrapped sampler.
+    float Get1D();
+
+    // Returns the next two dimensions of the current sample from the wrapped sampler.
+    Point2f Get2D();
+
+    // Returns a new AdaptiveSampler with the same settings wrapping a clone of the wrapped sampler.
+    std::unique_ptr<Sampler> Clone() const;
+
+  private:
+    // The sampler generating the actual sample values.
+    std::unique_ptr<Sampler> sampler;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_ADAPTIVE_SAMPLER_H
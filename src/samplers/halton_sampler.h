@@ -0,0 +1,53 @@
+// This header defines the HaltonSampler, a Sampler that draws each dimension of a pixel's samples
+// from the radical inverse of the sample index in a different prime base. Every pixel Owen
+// scrambles the digits of each dimension with its own seed, so pixels are decorrelated while the
+// samples inside a pixel keep the low discrepancy of the Halton sequence. Dimensions past the
+// precomputed bases reuse them with the sample index shuffled per dimension.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_HALTON_SAMPLER_H
+#define LIANG_SAMPLERS_HALTON_SAMPLER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "samplers/sampler.h"
+
+namespace liang {
+
+class HaltonSampler : public Sampler {
+  public:
+    // HaltonSampler constructor that takes the number of samples per pixel and a seed selecting
+    // the scrambles.
+    HaltonSampler(uint samples_per_pixel, uint64_t seed = 0);
+
+    // Starts sampling the given pixel at its first dimension.
+    void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample and returns to its first dimension.
+    bool StartNextSample();
+
+    // Returns the next dimension of the current sample as a float in [0, 1).
+    float Get1D();
+
+    // Returns the next two dimensions of the current sample as a point in [0, 1)^2.
+    Point2f Get2D();
+
+    // Returns a new HaltonSampler with the same number of samples per pixel and seed.
+    std::unique_ptr<Sampler> Clone() const;
+
+  private:
+    // Returns the next dimension of the current sample and advances to the one after it.
+    float NextDimension();
+
+    // The seed selecting the scrambles.
+    const uint64_t seed;
+    // The hash of the current pixel that seeds the scramble of each dimension.
+    uint64_t pixel_hash;
+    // The next dimension of the current sample.
+    uint dimension;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_HALTON_SAMPLER_H
@@ -0,0 +1,176 @@
+#include "samplers/low_discrepancy.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+// The bases of the Halton dimensions.
+static const uint HALTON_BASES[NUM_HALTON_DIMENSIONS] = {
+  2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+  59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+};
+
+// The number of bits in a Sobol sample, which is also the number of columns in each generator
+// matrix.
+static const uint SOBOL_BITS = 32;
+
+// The primitive polynomial and initial direction numbers defining a Sobol dimension.
+struct SobolPolynomial {
+  // The degree of the polynomial.
+  uint degree;
+  // The coefficients of the polynomial, not including the leading and trailing 1s.
+  uint coefficients;
+  // The first degree direction numbers, each of which is odd and less than 2^(its index + 1).
+  uint initial[6];
+};
+
+// The polynomials of every Sobol dimension but the first, from the table of Joe and Kuo.
+static const SobolPolynomial SOBOL_POLYNOMIALS[NUM_SOBOL_DIMENSIONS - 1] = {
+  {1, 0, {1}},
+  {2, 1, {1, 3}},
+  {3, 1, {1, 3, 1}},
+  {3, 2, {1, 1, 1}},
+  {4, 1, {1, 1, 3, 3}},
+  {4, 4, {1, 3, 5, 13}},
+  {5, 2, {1, 1, 5, 5, 17}},
+  {5, 4, {1, 1, 5, 5, 5}},
+  {5, 7, {1, 1, 7, 11, 19}},
+  {5, 11, {1, 1, 5, 1, 1}},
+  {5, 13, {1, 1, 1, 3, 11}},
+  {5, 14, {1, 3, 5, 5, 31}},
+  {6, 1, {1, 3, 3, 9, 7, 49}},
+  {6, 13, {1, 1, 1, 15, 21, 21}},
+  {6, 16, {1, 3, 1, 13, 27, 49}}
+};
+
+// The generator matrices of the Sobol dimensions. Column i of a matrix is stored as a 32-bit
+// integer whose most significant bit is the first row, and is the contribution of bit i of the
+// index to the sample.
+struct SobolMatrices {
+  uint32_t columns[NUM_SOBOL_DIMENSIONS][SOBOL_BITS];
+
+  // Builds the matrices from the direction numbers with the recurrence of Bratley and Fox.
+  SobolMatrices() {
+    for (uint i = 0; i < SOBOL_BITS; i++) {
+      columns[0][i] = 1u << (SOBOL_BITS - 1 - i);
+    }
+    for (uint dimension = 1; dimension < NUM_SOBOL_DIMENSIONS; dimension++) {
+      const SobolPolynomial &polynomial = SOBOL_POLYNOMIALS[dimension - 1];
+      uint32_t *v = columns[dimension];
+      uint s = polynomial.degree;
+      for (uint i = 0; i < SOBOL_BITS; i++) {
+        if (i < s) {
+          v[i] = polynomial.initial[i] << (SOBOL_BITS - 1 - i);
+          continue;
+        }
+        v[i] = v[i - s] ^ (v[i - s] >> s);
+        for (uint k = 1; k < s; k++) {
+          if ((polynomial.coefficients >> (s - 1 - k)) & 1) {
+            v[i] ^= v[i - k];
+          }
+        }
+      }
+    }
+  }
+};
+
+// Returns the generator matrices, which are built the first time they are needed.
+static const SobolMatrices &GetSobolMatrices() {
+  static const SobolMatrices matrices;
+  return matrices;
+}
+
+// Reverses the order of the bits of a 32-bit integer.
+static uint32_t ReverseBits(uint32_t v) {
+  v = (v << 16) | (v >> 16);
+  v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+  v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+  v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+  v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+  return v;
+}
+
+// Owen scrambles the bits of a sample, flipping each bit based on a hash of the bits above it. This
+// is the hash of Laine and Karras as improved by Vegdahl, applied to the reversed bits so that
+// carries propagate from the most significant bit down.
+static uint32_t OwenScramble(uint32_t v, uint32_t seed) {
+  v = ReverseBits(v);
+  v ^= v * 0x3d20adea;
+  v += seed;
+  v *= (seed >> 16) | 1;
+  v ^= v * 0x05526c56;
+  v ^= v * 0x53a22864;
+  return ReverseBits(v);
+}
+
+uint PermutationElement(uint index, uint length, uint32_t seed) {
+  assert(index < length);
+  uint32_t i = index;
+  uint32_t mask = length - 1;
+  mask |= mask >> 1;
+  mask |= mask >> 2;
+  mask |= mask >> 4;
+  mask |= mask >> 8;
+  mask |= mask >> 16;
+  // Hash within the smallest power of two covering the length until the hash lands in range.
+  do {
+    i ^= seed;
+    i *= 0xe170893d;
+    i ^= seed >> 16;
+    i ^= (i & mask) >> 4;
+    i ^= seed >> 8;
+    i *= 0x0929eb3f;
+    i ^= seed >> 23;
+    i ^= (i & mask) >> 1;
+    i *= 1 | seed >> 27;
+    i *= 0x6935fa69;
+    i ^= (i & mask) >> 11;
+    i *= 0x74dcb303;
+    i ^= (i & mask) >> 2;
+    i *= 0x9e501cc3;
+    i ^= (i & mask) >> 2;
+    i *= 0xc860a3df;
+    i &= mask;
+    i ^= i >> 5;
+  } while (i >= length);
+  return (i + seed) % length;
+}
+
+uint HaltonBase(uint dimension) {
+  assert(dimension < NUM_HALTON_DIMENSIONS);
+  return HALTON_BASES[dimension];
+}
+
+float ScrambledRadicalInverse(uint dimension, uint64_t index, uint32_t seed) {
+  uint base = HaltonBase(dimension);
+  float inverse_base = 1.f / base;
+  float inverse_base_power = 1.f;
+  uint64_t reversed_digits = 0;
+  // Keep going past the last nonzero digit of the index, since the scrambled digits after it are
+  // not zero. Stop once further digits are below float precision.
+  while (1.f - inverse_base_power < 1.f) {
+    uint64_t next = index / base;
+    uint digit = (uint)(index - next * base);
+    // Permute each digit based on the digits before it so the scramble is a nested Owen scramble.
+    uint32_t digit_seed = (uint32_t)MixBits(seed ^ reversed_digits);
+    digit = PermutationElement(digit, base, digit_seed);
+    reversed_digits = reversed_digits * base + digit;
+    inverse_base_power *= inverse_base;
+    index = next;
+  }
+  return std::min(ONE_MINUS_EPSILON, reversed_digits * inverse_base_power);
+}
+
+float SobolSample(uint dimension, uint32_t index, uint32_t seed) {
+  assert(dimension < NUM_SOBOL_DIMENSIONS);
+  const uint32_t *columns = GetSobolMatrices().columns[dimension];
+  uint32_t v = 0;
+  for (uint i = 0; index != 0; index >>= 1, i++) {
+    if (index & 1) {
+      v ^= columns[i];
+    }
+  }
+  v = OwenScramble(v, seed);
+  return std::min(ONE_MINUS_EPSILON, v * 2.3283064365386963e-10f);
+}
+
+}
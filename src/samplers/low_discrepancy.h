@@ -0,0 +1,39 @@
+// This header defines the building blocks shared by the stratified and low-discrepancy samplers:
+// pseudorandom permutations, the Owen-scrambled radical inverse behind the Halton sequence, and the
+// generator matrices and Owen scrambling behind the Sobol sequence. These are adapted from pbrt.
+// Every scramble is driven by a hash rather than stored tables, so each pixel can use its own
+// scramble without any per-pixel state.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_LOW_DISCREPANCY_H
+#define LIANG_SAMPLERS_LOW_DISCREPANCY_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+// The number of Halton dimensions, each of which uses one of the first primes as its base.
+const uint NUM_HALTON_DIMENSIONS = 32;
+
+// The number of Sobol dimensions with precomputed generator matrices.
+const uint NUM_SOBOL_DIMENSIONS = 16;
+
+// Returns the element at the given index of a pseudorandom permutation of [0, length) selected by
+// the given seed. This is Kensler's hash-based permutation, so it needs no storage.
+uint PermutationElement(uint index, uint length, uint32_t seed);
+
+// Returns the base of the given Halton dimension.
+uint HaltonBase(uint dimension);
+
+// Returns the radical inverse of the index in the base of the given Halton dimension, with its
+// digits Owen scrambled by the given seed. The result is in [0, 1).
+float ScrambledRadicalInverse(uint dimension, uint64_t index, uint32_t seed);
+
+// Returns the point at the given index of the given Sobol dimension, Owen scrambled by the given
+// seed. The result is in [0, 1).
+float SobolSample(uint dimension, uint32_t index, uint32_t seed);
+
+}
+
+#endif  // LIANG_SAMPLERS_LOW_DISCREPANCY_H
@@ -0,0 +1,34 @@
+#include "samplers/random_sampler.h"
+
+namespace liang {
+
+RandomSampler::RandomSampler(uint samples_per_pixel, uint64_t seed) : Sampler(samples_per_pixel),
+    seed{seed}, rng{} {}
+
+void RandomSampler::StartPixel(const Point2i &pixel) {
+  Sampler::StartPixel(pixel);
+  rng.SetSequence(SampleHash(seed));
+}
+
+bool RandomSampler::StartNextSample() {
+  bool has_next_sample = Sampler::StartNextSample();
+  rng.SetSequence(SampleHash(seed));
+  return has_next_sample;
+}
+
+float RandomSampler::Get1D() {
+  return rng.UniformFloat();
+}
+
+Point2f RandomSampler::Get2D() {
+  // Evaluate in a fixed order since the order of evaluation of function arguments is unspecified.
+  float x = rng.UniformFloat();
+  float y = rng.UniformFloat();
+  return Point2f(x, y);
+}
+
+std::unique_ptr<Sampler> RandomSampler::Clone() const {
+  return std::unique_ptr<Sampler>(new RandomSampler(samples_per_pixel, seed));
+}
+
+}
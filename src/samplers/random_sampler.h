@@ -0,0 +1,48 @@
+// This header defines the RandomSampler, a Sampler that returns independent uniform random values
+// for every dimension of every sample. This converges slowly, but it is a useful baseline. Every
+// sample draws from its own random stream seeded by its pixel and index, so results are
+// reproducible no matter which thread takes the sample.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_RANDOM_SAMPLER_H
+#define LIANG_SAMPLERS_RANDOM_SAMPLER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "samplers/sampler.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+class RandomSampler : public Sampler {
+  public:
+    // RandomSampler constructor that takes the number of samples per pixel and a seed selecting
+    // the random sequence.
+    RandomSampler(uint samples_per_pixel, uint64_t seed = 0);
+
+    // Starts sampling the given pixel and seeds the random stream of its first sample.
+    void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample and seeds its random stream.
+    bool StartNextSample();
+
+    // Returns a uniform random float in [0, 1).
+    float Get1D();
+
+    // Returns a uniform random point in [0, 1)^2.
+    Point2f Get2D();
+
+    // Returns a new RandomSampler with the same number of samples per pixel and seed.
+    std::unique_ptr<Sampler> Clone() const;
+
+  private:
+    // The seed selecting the random sequence.
+    const uint64_t seed;
+    // The random number generator backing the samples.
+    Rng rng;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_RANDOM_SAMPLER_H
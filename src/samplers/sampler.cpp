@@ -0,0 +1,51 @@
+#include "samplers/sampler.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+Sampler::Sampler(uint samples_per_pixel) : samples_per_pixel{samples_per_pixel}, current_pixel{},
+    sample_index{0} {
+  assert(samples_per_pixel > 0);
+}
+
+void Sampler::StartPixel(const Point2i &pixel) {
+  current_pixel = pixel;
+  sample_index = 0;
+}
+
+bool Sampler::StartNextSample() {
+  return ++sample_index < samples_per_pixel;
+}
+
+bool Sampler::IsConverged(const Pixel & /* pixel */) const {
+  return false;
+}
+
+// Offsets a pixel coordinate by a value in [0, 1) while staying strictly inside the pixel. Adding
+// an offset just under 1 to a large coordinate can otherwise round up to the next pixel.
+static float OffsetInPixel(int coordinate, float offset) {
+  float location = (float)coordinate + offset;
+  float pixel_end = (float)(coordinate + 1);
+  return location < pixel_end ? location : std::nextafter(pixel_end, (float)coordinate);
+}
+
+Point2f Sampler::GetFilmLocation() {
+  Point2f offset = Get2D();
+  return Point2f(OffsetInPixel(current_pixel.x, offset.x),
+      OffsetInPixel(current_pixel.y, offset.y));
+}
+
+uint Sampler::GetSampleIndex() const {
+  return sample_index;
+}
+
+uint64_t Sampler::SampleHash(uint64_t seed) const {
+  return MixBits(PixelHash(seed) + sample_index);
+}
+
+uint64_t Sampler::PixelHash(uint64_t seed) const {
+  uint64_t pixel_bits = ((uint64_t)(uint32_t)current_pixel.x << 32) | (uint32_t)current_pixel.y;
+  return MixBits(pixel_bits ^ MixBits(seed));
+}
+
+}
@@ -0,0 +1,72 @@
+// This header defines the Sampler interface. A Sampler generates the sample values used while
+// rendering a pixel, starting with the location on the film through which the camera ray is cast.
+// Each pixel takes up to samples_per_pixel samples, but a Sampler may decide a pixel has converged
+// and stop early. The values of a sample must only depend on its pixel and index in that pixel, so
+// that the output does not depend on how many threads render the image or in what order.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_SAMPLER_H
+#define LIANG_SAMPLERS_SAMPLER_H
+
+#include "cameras/film.h"
+#include "core/geometry.h"
+#include "core/liang.h"
+
+namespace liang {
+
+class Sampler {
+  public:
+    // The maximum number of samples taken in a single pixel.
+    const uint samples_per_pixel;
+
+    // Sampler constructor that takes the maximum number of samples taken in a single pixel.
+    Sampler(uint samples_per_pixel);
+
+    virtual ~Sampler() {}
+
+    // Starts sampling the given pixel, resetting the sample index to 0.
+    virtual void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample in the current pixel. Returns false if the pixel has already
+    // taken samples_per_pixel samples.
+    virtual bool StartNextSample();
+
+    // Returns whether the current pixel has converged given the statistics accumulated in it so
+    // far. By default, a pixel always takes all samples_per_pixel samples.
+    virtual bool IsConverged(const Pixel &pixel) const;
+
+    // Returns the next dimension of the current sample as a float in [0, 1).
+    virtual float Get1D() = 0;
+
+    // Returns the next two dimensions of the current sample as a point in [0, 1)^2.
+    virtual Point2f Get2D() = 0;
+
+    // Returns a new sampler with the same settings and seed. Each rendering thread samples with its
+    // own clone, since samplers are stateful.
+    virtual std::unique_ptr<Sampler> Clone() const = 0;
+
+    // Returns the location on the film (in raster space) of the current sample.
+    Point2f GetFilmLocation();
+
+    // Returns the index of the current sample in the current pixel.
+    uint GetSampleIndex() const;
+
+  protected:
+    // Returns a hash of the current pixel, sample index, and the given seed. Samplers use this to
+    // seed the random values of each sample independently of every other sample.
+    uint64_t SampleHash(uint64_t seed) const;
+
+    // Returns a hash of the current pixel and the given seed that is shared by every sample in the
+    // pixel. Samplers use this to decorrelate the sequences of neighboring pixels.
+    uint64_t PixelHash(uint64_t seed) const;
+
+    // The pixel currently being sampled.
+    Point2i current_pixel;
+    // The index of the current sample in the current pixel.
+    uint sample_index;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_SAMPLER_H
@@ -0,0 +1,47 @@
+#include "samplers/sobol_sampler.h"
+#include "samplers/low_discrepancy.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+SobolSampler::SobolSampler(uint samples_per_pixel, uint64_t seed) : Sampler(samples_per_pixel),
+    seed{seed}, pixel_hash{0}, dimension{0} {}
+
+void SobolSampler::StartPixel(const Point2i &pixel) {
+  Sampler::StartPixel(pixel);
+  pixel_hash = PixelHash(seed);
+  dimension = 0;
+}
+
+bool SobolSampler::StartNextSample() {
+  dimension = 0;
+  return Sampler::StartNextSample();
+}
+
+float SobolSampler::Get1D() {
+  return NextDimension();
+}
+
+Point2f SobolSampler::Get2D() {
+  // Evaluate in a fixed order since the order of evaluation of function arguments is unspecified.
+  float x = NextDimension();
+  float y = NextDimension();
+  return Point2f(x, y);
+}
+
+std::unique_ptr<Sampler> SobolSampler::Clone() const {
+  return std::unique_ptr<Sampler>(new SobolSampler(samples_per_pixel, seed));
+}
+
+float SobolSampler::NextDimension() {
+  uint32_t dimension_seed = (uint32_t)MixBits(pixel_hash + dimension);
+  uint index = sample_index;
+  if (dimension >= NUM_SOBOL_DIMENSIONS) {
+    index = PermutationElement(index, samples_per_pixel, (uint32_t)MixBits(dimension_seed));
+  }
+  float value = SobolSample(dimension % NUM_SOBOL_DIMENSIONS, index, dimension_seed);
+  dimension++;
+  return value;
+}
+
+}
@@ -0,0 +1,54 @@
+// This header defines the SobolSampler, a Sampler that draws the samples of a pixel from the
+// Sobol sequence, using precomputed generator matrices for its first dimensions. Every pixel Owen
+// scrambles each dimension with its own seed, which keeps the net properties of the sequence, so
+// the first two dimensions of any power of two samples in a pixel form a (0, m, 2)-net. Dimensions
+// past the precomputed matrices reuse them with the sample index shuffled per dimension. The
+// sequence is best used with a power of two samples per pixel.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_SOBOL_SAMPLER_H
+#define LIANG_SAMPLERS_SOBOL_SAMPLER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "samplers/sampler.h"
+
+namespace liang {
+
+class SobolSampler : public Sampler {
+  public:
+    // SobolSampler constructor that takes the number of samples per pixel and a seed selecting
+    // the scrambles.
+    SobolSampler(uint samples_per_pixel, uint64_t seed = 0);
+
+    // Starts sampling the given pixel at its first dimension.
+    void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample and returns to its first dimension.
+    bool StartNextSample();
+
+    // Returns the next dimension of the current sample as a float in [0, 1).
+    float Get1D();
+
+    // Returns the next two dimensions of the current sample as a point in [0, 1)^2.
+    Point2f Get2D();
+
+    // Returns a new SobolSampler with the same number of samples per pixel and seed.
+    std::unique_ptr<Sampler> Clone() const;
+
+  private:
+    // Returns the next dimension of the current sample and advances to the one after it.
+    float NextDimension();
+
+    // The seed selecting the scrambles.
+    const uint64_t seed;
+    // The hash of the current pixel that seeds the scramble of each dimension.
+    uint64_t pixel_hash;
+    // The next dimension of the current sample.
+    uint dimension;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_SOBOL_SAMPLER_H
@@ -0,0 +1,51 @@
+#include "samplers/stratified_sampler.h"
+#include "samplers/low_discrepancy.h"
+
+namespace liang {
+
+StratifiedSampler::StratifiedSampler(uint x_strata, uint y_strata, bool jitter, uint64_t seed)
+    : Sampler(x_strata * y_strata), x_strata{x_strata}, y_strata{y_strata}, jitter{jitter},
+    seed{seed}, pixel_hash{0}, dimension{0}, rng{} {}
+
+void StratifiedSampler::StartPixel(const Point2i &pixel) {
+  Sampler::StartPixel(pixel);
+  pixel_hash = PixelHash(seed);
+  dimension = 0;
+  rng.SetSequence(SampleHash(seed));
+}
+
+bool StratifiedSampler::StartNextSample() {
+  bool has_next_sample = Sampler::StartNextSample();
+  dimension = 0;
+  rng.SetSequence(SampleHash(seed));
+  return has_next_sample;
+}
+
+float StratifiedSampler::Get1D() {
+  uint stratum = PermutationElement(sample_index, samples_per_pixel, NextDimensionSeed());
+  dimension++;
+  return std::min(ONE_MINUS_EPSILON, (stratum + Jitter()) / samples_per_pixel);
+}
+
+Point2f StratifiedSampler::Get2D() {
+  uint stratum = PermutationElement(sample_index, samples_per_pixel, NextDimensionSeed());
+  dimension += 2;
+  // Evaluate in a fixed order since the order of evaluation of function arguments is unspecified.
+  float x = (stratum % x_strata + Jitter()) / x_strata;
+  float y = (stratum / x_strata + Jitter()) / y_strata;
+  return Point2f(std::min(ONE_MINUS_EPSILON, x), std::min(ONE_MINUS_EPSILON, y));
+}
+
+std::unique_ptr<Sampler> StratifiedSampler::Clone() const {
+  return std::unique_ptr<Sampler>(new StratifiedSampler(x_strata, y_strata, jitter, seed));
+}
+
+uint32_t StratifiedSampler::NextDimensionSeed() {
+  return (uint32_t)MixBits(pixel_hash + dimension);
+}
+
+float StratifiedSampler::Jitter() {
+  return jitter ? rng.UniformFloat() : 0.5f;
+}
+
+}
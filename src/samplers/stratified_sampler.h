@@ -0,0 +1,67 @@
+// This header defines the StratifiedSampler, a Sampler that splits every dimension of a pixel into
+// as many strata as there are samples and places exactly one sample in each stratum. Pairs of
+// dimensions are split into an x_strata by y_strata grid. Each dimension visits its strata in its
+// own pseudorandom order, selected by the pixel, so that the dimensions are not correlated with
+// each other or with neighboring pixels.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_SAMPLERS_STRATIFIED_SAMPLER_H
+#define LIANG_SAMPLERS_STRATIFIED_SAMPLER_H
+
+#include "core/geometry.h"
+#include "core/liang.h"
+#include "samplers/sampler.h"
+#include "utils/rng.h"
+
+namespace liang {
+
+class StratifiedSampler : public Sampler {
+  public:
+    // The number of strata along the first dimension of a pair.
+    const uint x_strata;
+    // The number of strata along the second dimension of a pair.
+    const uint y_strata;
+    // Whether samples are jittered randomly inside their strata instead of placed at the center.
+    const bool jitter;
+
+    // StratifiedSampler constructor that takes the number of strata along each dimension of a pair,
+    // whether to jitter the samples, and a seed selecting the random sequence. Each pixel takes
+    // x_strata * y_strata samples.
+    StratifiedSampler(uint x_strata, uint y_strata, bool jitter = true, uint64_t seed = 0);
+
+    // Starts sampling the given pixel and seeds the random stream of its first sample.
+    void StartPixel(const Point2i &pixel);
+
+    // Advances to the next sample and seeds its random stream.
+    bool StartNextSample();
+
+    // Returns a float in [0, 1) from the stratum of the next dimension assigned to this sample.
+    float Get1D();
+
+    // Returns a point in [0, 1)^2 from the cell of the grid assigned to this sample.
+    Point2f Get2D();
+
+    // Returns a new StratifiedSampler with the same strata, jitter, and seed.
+    std::unique_ptr<Sampler> Clone() const;
+
+  private:
+    // Returns the seed of the permutation of strata used by the next dimension.
+    uint32_t NextDimensionSeed();
+
+    // Returns the offset of the sample inside its stratum.
+    float Jitter();
+
+    // The seed selecting the random sequence.
+    const uint64_t seed;
+    // The hash of the current pixel that selects the order of its strata.
+    uint64_t pixel_hash;
+    // The next dimension of the current sample.
+    uint dimension;
+    // The random number generator jittering the samples.
+    Rng rng;
+};
+
+}
+
+#endif  // LIANG_SAMPLERS_STRATIFIED_SAMPLER_H
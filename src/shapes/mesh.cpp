@@ -3,7 +3,8 @@
 namespace liang {
 
 std::shared_ptr<Mesh> CreateMesh(uint num_vertices, const std::shared_ptr<TriangleVertex> vertices,
-    uint num_elements, const std::shared_ptr<uint> elements, const Transform *object_to_world) {
+    uint num_elements, const std::shared_ptr<uint> elements,
+    const AffineTransform *object_to_world) {
   assert(num_elements % 3 == 0);
   for (uint i = 0; i < num_elements; i++) {
     assert(elements.get()[i] < num_vertices);
@@ -40,6 +41,41 @@ AABB3f Triangle::WorldBounds() const {
 }
 
 bool Triangle::Intersect(Ray3f ray) const {
+  float t, b0, b1, b2;
+  return IntersectBarycentric(ray, &t, &b0, &b1, &b2);
+}
+
+bool Triangle::Intersect(const Ray3f &ray, Intersection *intersection) const {
+  float t, b0, b1, b2;
+  if (!IntersectBarycentric(ray, &t, &b0, &b1, &b2)) {
+    return false;
+  }
+  intersection->t = t;
+  intersection->normal = ShadingNormal(b0, b1, b2);
+  intersection->has_differentials = false;
+  ray.max_t = t;
+  return true;
+}
+
+Normal3f Triangle::ShadingNormal(float b0, float b1, float b2) const {
+  Normal3f n0 = GetVertex(0).normal;
+  Normal3f n1 = GetVertex(1).normal;
+  Normal3f n2 = GetVertex(2).normal;
+  Normal3f normal = Normal3f(b0 * n0.x + b1 * n1.x + b2 * n2.x, b0 * n0.y + b1 * n1.y + b2 * n2.y,
+      b0 * n0.z + b1 * n1.z + b2 * n2.z);
+  // Opposing vertex normals can cancel out, which leaves only the geometric normal to go by. Faces
+  // wind clockwise when seen from the front.
+  if (normal.x == 0.f && normal.y == 0.f && normal.z == 0.f) {
+    Vector3f geometric_normal = Cross(GetVertex(2).position - GetVertex(0).position,
+        GetVertex(1).position - GetVertex(0).position);
+    normal = Normal3f(geometric_normal.x, geometric_normal.y, geometric_normal.z);
+  }
+  Vector3f world_normal = Normalize((*object_to_world)(normal));
+  return Normal3f(world_normal.x, world_normal.y, world_normal.z);
+}
+
+bool Triangle::IntersectBarycentric(const Ray3f &ray, float *t, float *b0, float *b1,
+    float *b2) const {
   // Find a new coordinate space where the ray origin is (0, 0, 0).
   Transform translation = TranslationTransform(Point3f() - ray.origin);
   Point3f original_v0 = (*object_to_world)(GetVertex(0).position);
@@ -117,6 +153,11 @@ bool Triangle::Intersect(Ray3f ray) const {
       (determinant > 0 && (t_scaled <= 0 || t_scaled > ray.max_t * determinant))) {
     return false;
   }
+  float inverse_determinant = 1.f / determinant;
+  *t = t_scaled * inverse_determinant;
+  *b0 = e0 * inverse_determinant;
+  *b1 = e1 * inverse_determinant;
+  *b2 = e2 * inverse_determinant;
   return true;
 }
 
@@ -35,13 +35,14 @@ struct Mesh {
   // Pointer to a array of elements.
   const std::shared_ptr<uint> elements;
   // Object to world transform.
-  const Transform *object_to_world;
+  const AffineTransform *object_to_world;
 };
 
 // A nice wrapper around creating a shared pointer to a Mesh that performs some error checking on
 // the input.
 std::shared_ptr<Mesh> CreateMesh(uint num_vertices, const std::shared_ptr<TriangleVertex> vertices,
-    uint num_elements, const std::shared_ptr<uint> elements, const Transform *object_to_world);
+    uint num_elements, const std::shared_ptr<uint> elements,
+    const AffineTransform *object_to_world);
 
 class Triangle : public Shape {
   public:
@@ -57,6 +58,13 @@ class Triangle : public Shape {
     // Intersects the triangle with a ray and returns true if there is an intersection.
     bool Intersect(Ray3f ray) const;
 
+    // Intersects the triangle with a ray and fills in the closest intersection so far.
+    bool Intersect(const Ray3f &ray, Intersection *intersection) const;
+
+    // Returns the world space shading normal at the given barycentric coordinates, interpolated
+    // from the vertex normals.
+    Normal3f ShadingNormal(float b0, float b1, float b2) const;
+
   private:
     // The parent mesh that the triangle is a part of.
     const std::shared_ptr<Mesh> parent;
@@ -65,6 +73,10 @@ class Triangle : public Shape {
 
     // Gets the nth vertex of the triangle (0 <= n <= 2).
     TriangleVertex GetVertex(uint n) const;
+
+    // Intersects the triangle with a ray and outputs the t of the hit and its barycentric
+    // coordinates if there is an intersection.
+    bool IntersectBarycentric(const Ray3f &ray, float *t, float *b0, float *b1, float *b2) const;
 };
 
 // Creates a vector to a list of shared pointers to a Mesh's Triangles. This actually
@@ -2,7 +2,7 @@
 
 namespace liang {
 
-Shape::Shape(const Transform *object_to_world) : object_to_world{object_to_world},
+Shape::Shape(const AffineTransform *object_to_world) : object_to_world{object_to_world},
     swaps_handedness{object_to_world->SwapsHandedness()} {}
 
 }
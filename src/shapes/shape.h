@@ -7,6 +7,7 @@
 #define LIANG_SHAPES_SHAPE_H
 
 #include "core/geometry.h"
+#include "core/intersection.h"
 #include "core/liang.h"
 #include "core/transform.h"
 
@@ -15,7 +16,7 @@ namespace liang {
 class Shape {
   public:
     // Shape constructor that takes the transform from object space to world space.
-    Shape(const Transform *object_to_world);
+    Shape(const AffineTransform *object_to_world);
 
     // The bounds of the object in object space.
     virtual AABB3f ObjectBounds() const = 0;
@@ -26,11 +27,16 @@ class Shape {
     // Intersects the shape with a ray and returns true if there is an intersection.
     virtual bool Intersect(Ray3f ray) const = 0;
 
+    // Intersects the shape with a ray and returns true if there is an intersection closer than the
+    // ray's max_t. If so, this fills in the intersection's geometry and shortens the ray to the
+    // hit, so intersecting the same ray with every shape leaves the closest hit.
+    virtual bool Intersect(const Ray3f &ray, Intersection *intersection) const = 0;
+
   protected:
-    // The transform to get from object coordinates to world coordinates. Since Transforms store
+    // The transform to get from object coordinates to world coordinates. Since transforms store
     // their inverse matrices and have a fast function for computing the inverse, we avoid
     // explicitly storing the world to object transform.
-    const Transform *object_to_world;
+    const AffineTransform *object_to_world;
     // Whether the world-object transforms swap the handedness of the coordinate space.
     const bool swaps_handedness;
 };
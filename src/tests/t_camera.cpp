@@ -3,12 +3,15 @@
 #include "core/scene.h"
 #include "filters/filter.h"
 #include "filters/box_filter.h"
+#include "filters/mitchell_filter.h"
 #include "primitives/aggregate_primitive.h"
 #include "primitives/geometric_primitive.h"
 #include "primitives/primitive.h"
 #include "tests/util.h"
 #include "tests/test.h"
 
+#include <fstream>
+
 TEST(PerspectiveCameraTest, Creation) {
   liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(5.f, 5.f, 5.f),
       liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
@@ -34,6 +37,80 @@ TEST(PerspectiveCameraTest, GenerateRay) {
   Vector3FloatEquals(ray.direction, -0.724887, -0.686926, -0.051690);
 }
 
+TEST(PerspectiveCameraTest, Shutter) {
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(5.f, 5.f, 5.f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(32, 32, std::move(filter));
+  liang::PerspectiveCamera camera = liang::PerspectiveCamera(world_to_camera, film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  ASSERT_FALSE(camera.HasMotionBlur());
+  ASSERT_FLOAT_EQ(0.f, camera.SampleTime(0.7f));
+  camera.SetShutter(1.f, 3.f);
+  ASSERT_TRUE(camera.HasMotionBlur());
+  ASSERT_FLOAT_EQ(1.f, camera.GetShutterOpen());
+  ASSERT_FLOAT_EQ(3.f, camera.GetShutterClose());
+  ASSERT_FLOAT_EQ(1.f, camera.SampleTime(0.f));
+  ASSERT_FLOAT_EQ(2.f, camera.SampleTime(0.5f));
+  ASSERT_FLOAT_EQ(2.5f, camera.SampleTime(0.75f));
+}
+
+TEST(PerspectiveCameraTest, GenerateRays) {
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(5.01f, 5.0f, 0.f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(32, 24, std::move(filter));
+  liang::PerspectiveCamera camera = liang::PerspectiveCamera(world_to_camera, film, 60.f,
+      liang::Point2f(-1.f, -0.75f), liang::Point2f(1.f, 0.75f));
+  // An odd count exercises both the batched path and the leftover rays.
+  std::vector<liang::Point2f> film_locations;
+  for (uint i = 0; i < 11; i++) {
+    film_locations.push_back(liang::Point2f(i * 2.9f + 0.1f, 23.9f - i * 2.1f));
+  }
+  std::vector<liang::Ray3f> rays(film_locations.size());
+  std::vector<float> weights(film_locations.size());
+  camera.GenerateRays(film_locations.data(), film_locations.size(), rays.data(), weights.data());
+  for (uint i = 0; i < film_locations.size(); i++) {
+    liang::Ray3f ray;
+    ASSERT_EQ(camera.GenerateRay(film_locations[i], &ray), weights[i]);
+    Point3FloatEquals(rays[i].origin, ray.origin.x, ray.origin.y, ray.origin.z);
+    ASSERT_FLOAT_EQ(ray.direction.x, rays[i].direction.x);
+    ASSERT_FLOAT_EQ(ray.direction.y, rays[i].direction.y);
+    ASSERT_FLOAT_EQ(ray.direction.z, rays[i].direction.z);
+    ASSERT_NEAR(1.f, rays[i].direction.Length(), 0.00001);
+  }
+  // The center of the film looks straight at the target.
+  liang::Ray3f center;
+  camera.GenerateRay(liang::Point2f(16.f, 12.f), &center);
+  Vector3FloatEquals(center.direction,
+      -5.01f / std::sqrt(5.01f * 5.01f + 25.f), -5.f / std::sqrt(5.01f * 5.01f + 25.f), 0.f);
+}
+
+TEST(PerspectiveCameraTest, GenerateRayDifferential) {
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(5.01f, 5.0f, 0.f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(32, 32, std::move(filter));
+  liang::PerspectiveCamera camera = liang::PerspectiveCamera(world_to_camera, film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  liang::RayDifferential ray;
+  ASSERT_EQ(1.f, camera.GenerateRayDifferential(liang::Point2f(15.f, 18.f), &ray));
+  ASSERT_TRUE(ray.has_differentials);
+  liang::Ray3f main_ray, rx, ry;
+  camera.GenerateRay(liang::Point2f(15.f, 18.f), &main_ray);
+  camera.GenerateRay(liang::Point2f(16.f, 18.f), &rx);
+  camera.GenerateRay(liang::Point2f(15.f, 19.f), &ry);
+  ASSERT_EQ(main_ray.direction.x, ray.direction.x);
+  ASSERT_EQ(main_ray.direction.y, ray.direction.y);
+  ASSERT_EQ(main_ray.direction.z, ray.direction.z);
+  Point3FloatEquals(ray.rx_origin, 5.01, 5.0, 0.0);
+  Point3FloatEquals(ray.ry_origin, 5.01, 5.0, 0.0);
+  Vector3FloatEquals(ray.rx_direction, rx.direction.x, rx.direction.y, rx.direction.z);
+  Vector3FloatEquals(ray.ry_direction, ry.direction.x, ry.direction.y, ry.direction.z);
+  // Stepping down the film turns the ray toward -z, since raster y grows downward.
+  ASSERT_LT(ray.ry_direction.z, ray.direction.z);
+}
+
 TEST(FilmTest, Creation) {
   auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
   auto film = std::make_shared<liang::Film>(8, 16, std::move(filter));
@@ -51,12 +128,12 @@ TEST(FilmTest, Creation) {
 }
 
 TEST(FilmTest, AddSample) {
-  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
   auto film = std::make_shared<liang::Film>(2, 4, std::move(filter));
   for (uint x = 0; x < 2; x++) {
     for (uint y = 0; y < 4; y++) {
       float value = (float)y * 2.f + (float)x;
-      film->AddSample((float)x, (float)y, value, value, value, 1.f);
+      film->AddSample(x + 0.5f, y + 0.5f, value, value, value, 1.f);
     }
   }
   for (uint x = 0; x < 2; x++) {
@@ -74,11 +151,11 @@ TEST(FilmTest, AddSample) {
 }
 
 TEST(FilmTest, ClearFilm) {
-  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
   auto film = std::make_shared<liang::Film>(2, 4, std::move(filter));
   for (uint x = 0; x < 2; x++) {
     for (uint y = 0; y < 4; y++) {
-      film->AddSample((float)x, (float)y, 1.f, 1.f, 1.f, 1.f);
+      film->AddSample(x + 0.5f, y + 0.5f, 1.f, 1.f, 1.f, 1.f);
     }
   }
   for (uint x = 0; x < 2; x++) {
@@ -101,3 +178,312 @@ TEST(FilmTest, ClearFilm) {
     }
   }
 }
+
+TEST(FilmTest, PixelVariance) {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(2, 2, std::move(filter));
+  film->AddSample(0.5f, 0.5f, 1.f, 1.f, 1.f, 1.f);
+  ASSERT_EQ(0.f, liang::PixelVariance(film->GetPixel(0, 0)));
+  film->AddSample(0.5f, 0.5f, 3.f, 3.f, 3.f, 1.f);
+  liang::Pixel pixel = film->GetPixel(0, 0);
+  ASSERT_EQ(2u, pixel.sample_count);
+  ASSERT_NEAR(4.f, pixel.luminance_sum, 0.0001);
+  ASSERT_NEAR(2.f, liang::PixelVariance(pixel), 0.0001);
+  ASSERT_NEAR(0.5f, liang::PixelRelativeError(pixel), 0.0001);
+  ASSERT_EQ(0u, film->GetPixel(1, 0).sample_count);
+}
+
+TEST(FilmTest, SplatSample) {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(4, 4, std::move(filter));
+  // A sample at a pixel center reaches the centers of its neighbors exactly one pixel away.
+  film->AddSample(1.5f, 1.5f, 2.f, 2.f, 2.f, 1.f);
+  for (uint y = 0; y < 4; y++) {
+    for (uint x = 0; x < 4; x++) {
+      liang::Pixel pixel = film->GetPixel(x, y);
+      float expected_weight = x < 3 && y < 3 ? 1.f : 0.f;
+      ASSERT_EQ(expected_weight, pixel.weight_sum);
+      ASSERT_EQ(2.f * expected_weight, pixel.r);
+      ASSERT_EQ(x == 1 && y == 1 ? 1u : 0u, pixel.sample_count);
+    }
+  }
+  // Off center, the sample only reaches the pixels whose centers are within the radius.
+  film->ClearFilm();
+  film->AddSample(1.7f, 1.2f, 1.f, 1.f, 1.f, 1.f);
+  for (uint y = 0; y < 4; y++) {
+    for (uint x = 0; x < 4; x++) {
+      float expected_weight = (x == 1 || x == 2) && (y == 0 || y == 1) ? 1.f : 0.f;
+      ASSERT_EQ(expected_weight, film->GetPixel(x, y).weight_sum);
+    }
+  }
+}
+
+TEST(FilmTest, SplatSampleWideFilter) {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(40.f));
+  auto film = std::make_shared<liang::Film>(100, 100, std::move(filter));
+  // The sample reaches more pixels along each axis than fit in the stack lookups.
+  film->AddSample(50.5f, 50.5f, 1.f, 1.f, 1.f, 1.f);
+  for (uint y = 0; y < 100; y++) {
+    for (uint x = 0; x < 100; x++) {
+      bool reached = std::abs((int)x - 50) <= 40 && std::abs((int)y - 50) <= 40;
+      ASSERT_EQ(reached ? 1.f : 0.f, film->GetPixel(x, y).weight_sum);
+    }
+  }
+}
+
+TEST(FilmTest, MergeFilmTile) {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
+  auto film = std::make_shared<liang::Film>(4, 4, std::move(filter));
+  std::unique_ptr<liang::FilmTile> tile = film->GetFilmTile(liang::Point2i(2, 2),
+      liang::Point2i(6, 6));
+  Point2IntEquals(tile->pixel_min, 2, 2);
+  Point2IntEquals(tile->pixel_max, 4, 4);
+  tile->AddSample(3.5f, 2.5f, 1.f, 2.f, 3.f, 1.f);
+  ASSERT_EQ(1u, tile->GetPixel(3, 2).sample_count);
+  ASSERT_DEATH(tile->GetPixel(0, 2), ASSERTION_FAILURE);
+  film->AddSample(3.5f, 2.5f, 1.f, 1.f, 1.f, 1.f);
+  film->MergeFilmTile(*tile);
+  liang::Pixel pixel = film->GetPixel(3, 2);
+  ASSERT_EQ(2.f, pixel.r);
+  ASSERT_EQ(3.f, pixel.g);
+  ASSERT_EQ(4.f, pixel.b);
+  ASSERT_EQ(2.f, pixel.weight_sum);
+  ASSERT_EQ(2u, pixel.sample_count);
+  ASSERT_EQ(0.f, film->GetPixel(2, 2).weight_sum);
+}
+
+TEST(FilmTest, MergeFilmTileBorder) {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(8, 8, std::move(filter));
+  auto expected = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)));
+  std::unique_ptr<liang::FilmTile> tile = film->GetFilmTile(liang::Point2i(2, 2),
+      liang::Point2i(4, 4));
+  Point2IntEquals(tile->splat_min, 1, 1);
+  Point2IntEquals(tile->splat_max, 5, 5);
+  // Samples on the edge of the tile spill onto the border around it.
+  tile->AddSample(2.1f, 3.9f, 1.f, 1.f, 1.f, 1.f);
+  expected->AddSample(2.1f, 3.9f, 1.f, 1.f, 1.f, 1.f);
+  ASSERT_DEATH(tile->AddSample(1.9f, 2.5f, 1.f, 1.f, 1.f, 1.f), ASSERTION_FAILURE);
+  film->MergeFilmTile(*tile);
+  for (uint y = 0; y < 8; y++) {
+    for (uint x = 0; x < 8; x++) {
+      liang::Pixel pixel = film->GetPixel(x, y);
+      liang::Pixel expected_pixel = expected->GetPixel(x, y);
+      ASSERT_EQ(expected_pixel.weight_sum, pixel.weight_sum);
+      ASSERT_EQ(expected_pixel.sample_count, pixel.sample_count);
+    }
+  }
+  ASSERT_EQ(1.f, film->GetPixel(1, 3).weight_sum);
+  ASSERT_EQ(1.f, film->GetPixel(2, 4).weight_sum);
+}
+
+TEST(FilmTest, CompactStorage) {
+  ASSERT_EQ(16u, sizeof(liang::CompactPixel));
+  auto film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)));
+  auto compact_film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)), liang::FilmStorage::COMPACT);
+  ASSERT_EQ(liang::FilmStorage::COMPACT, compact_film->GetStorage());
+  // Every pixel is covered by up to four overlapping tiles, each with many samples.
+  for (uint tile_y = 0; tile_y < 8; tile_y += 2) {
+    for (uint tile_x = 0; tile_x < 8; tile_x += 2) {
+      std::unique_ptr<liang::FilmTile> tile = film->GetFilmTile(liang::Point2i(tile_x, tile_y),
+          liang::Point2i(tile_x + 2, tile_y + 2));
+      for (uint sample = 0; sample < 256; sample++) {
+        float x = tile_x + (sample % 16 + 0.5f) / 8.f;
+        float y = tile_y + (sample / 16 + 0.5f) / 8.f;
+        float value = 0.1f + 0.01f * (tile_x * 8 + tile_y + sample % 7);
+        tile->AddSample(x, y, value, 2.f * value, 3.f * value, 1.f);
+      }
+      film->MergeFilmTile(*tile);
+      compact_film->MergeFilmTile(*tile);
+    }
+  }
+  compact_film->AddSample(0.5f, 0.5f, 1.f, 1.f, 1.f, 1.f);
+  film->AddSample(0.5f, 0.5f, 1.f, 1.f, 1.f, 1.f);
+  for (uint y = 0; y < 8; y++) {
+    for (uint x = 0; x < 8; x++) {
+      liang::Pixel pixel = film->GetPixel(x, y);
+      liang::Pixel compact_pixel = compact_film->GetPixel(x, y);
+      ASSERT_EQ(pixel.weight_sum, compact_pixel.weight_sum);
+      ASSERT_EQ(pixel.sample_count, compact_pixel.sample_count);
+      // Each merge rounds to half precision once, so the error stays within a few ulps.
+      ASSERT_NEAR(pixel.r, compact_pixel.r, pixel.r * 1e-3f);
+      ASSERT_NEAR(pixel.b, compact_pixel.b, pixel.b * 1e-3f);
+      ASSERT_NEAR(pixel.luminance_sum, compact_pixel.luminance_sum, pixel.luminance_sum * 1e-3f);
+      float variance = liang::PixelVariance(pixel);
+      ASSERT_NEAR(variance, liang::PixelVariance(compact_pixel), variance * 1e-2f);
+    }
+  }
+  // Checkpoints are tied to the layout of the film that wrote them.
+  const std::string name = "compact_film_test.ckpt";
+  uint tiles_merged;
+  ASSERT_TRUE(compact_film->SaveCheckpoint(name, 1, 16));
+  ASSERT_FALSE(film->LoadCheckpoint(name, 1, &tiles_merged));
+  auto loaded_film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)), liang::FilmStorage::COMPACT);
+  ASSERT_TRUE(loaded_film->LoadCheckpoint(name, 1, &tiles_merged));
+  ASSERT_EQ(16u, tiles_merged);
+  ASSERT_EQ(compact_film->GetPixel(3, 5).r, loaded_film->GetPixel(3, 5).r);
+  std::remove(name.c_str());
+}
+
+// Asserts that a compact film holds the same color as a full precision one at the given pixel, to
+// within the rounding of a few merges.
+static void AssertCompactColorNear(const liang::Film &film, const liang::Film &compact_film,
+    uint x, uint y) {
+  liang::Pixel pixel = film.GetPixel(x, y);
+  liang::Pixel compact_pixel = compact_film.GetPixel(x, y);
+  ASSERT_EQ(pixel.weight_sum, compact_pixel.weight_sum);
+  ASSERT_TRUE(std::isfinite(compact_pixel.r));
+  ASSERT_NEAR(pixel.r, compact_pixel.r, std::abs(pixel.r) * 1e-3f + 1e-7f);
+  ASSERT_NEAR(pixel.g, compact_pixel.g, std::abs(pixel.g) * 1e-3f + 1e-7f);
+}
+
+TEST(FilmTest, CompactStorageCancellingWeights) {
+  auto film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f)));
+  auto compact_film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f)), liang::FilmStorage::COMPACT);
+  // A border tile whose samples only reach pixel (4, 4) through a negative lobe.
+  std::unique_ptr<liang::FilmTile> border_tile = film->GetFilmTile(liang::Point2i(2, 4),
+      liang::Point2i(4, 6));
+  border_tile->AddSample(2.7f, 4.5f, 1.f, 2.f, 1.f, 1.f);
+  border_tile->AddSample(2.6f, 4.5f, 1.f, 2.f, 1.f, 1.f);
+  film->MergeFilmTile(*border_tile);
+  compact_film->MergeFilmTile(*border_tile);
+  float border_weight = film->GetPixel(4, 4).weight_sum;
+  ASSERT_LT(border_weight, 0.f);
+  AssertCompactColorNear(*film, *compact_film, 4, 4);
+
+  // The owning tile's first sample is weighted to cancel the border tile's weight, but not its
+  // color, which leaves next to no weight to divide the color by.
+  auto probe_film = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f)));
+  probe_film->AddSample(4.5f, 4.5f, 1.f, 1.f, 1.f, 1.f);
+  float center_weight = probe_film->GetPixel(4, 4).weight_sum;
+  std::unique_ptr<liang::FilmTile> owning_tile = film->GetFilmTile(liang::Point2i(4, 4),
+      liang::Point2i(6, 6));
+  owning_tile->AddSample(4.5f, 4.5f, 3.f, 5.f, 3.f, -border_weight / center_weight);
+  film->MergeFilmTile(*owning_tile);
+  compact_film->MergeFilmTile(*owning_tile);
+  ASSERT_LT(std::abs(film->GetPixel(4, 4).weight_sum), 1e-3f);
+  AssertCompactColorNear(*film, *compact_film, 4, 4);
+
+  // Later merges pick up from the exact sums.
+  owning_tile = film->GetFilmTile(liang::Point2i(4, 4), liang::Point2i(6, 6));
+  owning_tile->AddSample(4.5f, 4.5f, 1.f, 1.f, 1.f, 1.f);
+  film->MergeFilmTile(*owning_tile);
+  compact_film->MergeFilmTile(*owning_tile);
+  AssertCompactColorNear(*film, *compact_film, 4, 4);
+}
+
+TEST(FilmTest, MappedFilm) {
+  const std::string name = "mapped_film_test.film";
+  ASSERT_EQ(nullptr, liang::Film::CreateMappedFilm(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)), liang::FilmStorage::FULL,
+      "missing_directory/" + name));
+  std::shared_ptr<liang::Film> film = liang::Film::CreateMappedFilm(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)), liang::FilmStorage::FULL, name);
+  ASSERT_TRUE(film->IsMapped());
+  auto expected = std::make_shared<liang::Film>(8, 8,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f)));
+  ASSERT_FALSE(expected->IsMapped());
+  ASSERT_EQ(0.f, film->GetPixel(7, 7).weight_sum);
+  for (uint tile_y = 0; tile_y < 8; tile_y += 4) {
+    for (uint tile_x = 0; tile_x < 8; tile_x += 4) {
+      std::unique_ptr<liang::FilmTile> tile = film->GetFilmTile(liang::Point2i(tile_x, tile_y),
+          liang::Point2i(tile_x + 4, tile_y + 4));
+      tile->AddSample(tile_x + 1.5f, tile_y + 3.9f, 1.f, 2.f, 3.f, 1.f);
+      film->MergeFilmTile(*tile);
+      expected->MergeFilmTile(*tile);
+    }
+  }
+  // The file holds the raw pixels, so it can be read back once the film is gone.
+  film.reset();
+  std::ifstream file(name, std::ios::binary);
+  std::vector<liang::Pixel> pixels(64);
+  ASSERT_TRUE(file.read(reinterpret_cast<char *>(pixels.data()),
+      pixels.size() * sizeof(liang::Pixel)));
+  for (uint y = 0; y < 8; y++) {
+    for (uint x = 0; x < 8; x++) {
+      liang::Pixel pixel = pixels[y * 8 + x];
+      liang::Pixel expected_pixel = expected->GetPixel(x, y);
+      ASSERT_EQ(expected_pixel.r, pixel.r);
+      ASSERT_EQ(expected_pixel.weight_sum, pixel.weight_sum);
+      ASSERT_EQ(expected_pixel.sample_count, pixel.sample_count);
+    }
+  }
+  std::remove(name.c_str());
+}
+
+TEST(FilmTest, ClearMappedFilm) {
+  const std::string name = "mapped_film_test.film";
+  std::shared_ptr<liang::Film> film = liang::Film::CreateMappedFilm(4, 4,
+      std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f)), liang::FilmStorage::COMPACT,
+      name);
+  ASSERT_EQ(liang::FilmStorage::COMPACT, film->GetStorage());
+  film->AddSample(2.5f, 1.5f, 1.f, 1.f, 1.f, 1.f);
+  ASSERT_EQ(1.f, film->GetPixel(2, 1).r);
+  ASSERT_EQ(1u, film->GetPixel(2, 1).sample_count);
+  film->ClearFilm();
+  ASSERT_EQ(0.f, film->GetPixel(2, 1).r);
+  ASSERT_EQ(0u, film->GetPixel(2, 1).sample_count);
+  film->AddSample(2.5f, 1.5f, 2.f, 2.f, 2.f, 1.f);
+  ASSERT_EQ(2.f, film->GetPixel(2, 1).r);
+  std::remove(name.c_str());
+}
+
+TEST(FilmTest, Channels) {
+  for (liang::FilmStorage storage : {liang::FilmStorage::FULL, liang::FilmStorage::COMPACT}) {
+    auto film = std::make_shared<liang::Film>(4, 1,
+        std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f)), storage);
+    ASSERT_EQ(0u, film->AddChannel("Z", liang::ChannelMode::AVERAGE));
+    ASSERT_EQ(1u, film->AddChannel("id", liang::ChannelMode::FIRST));
+    ASSERT_EQ(2u, film->AddChannel("rays", liang::ChannelMode::SUM));
+    ASSERT_EQ(3u, film->NumChannels());
+    ASSERT_EQ("id", film->GetChannel(1).name);
+    float first[] = {2.f, 7.f, 1.f};
+    float second[] = {4.f, 9.f, 3.f};
+    film->AddSample(1.5f, 0.5f, 1.f, 1.f, 1.f, 1.f, first);
+    film->AddSample(1.5f, 0.5f, 1.f, 1.f, 1.f, 1.f, second);
+    ASSERT_EQ(3.f, film->GetChannelValue(0, 1, 0));
+    ASSERT_EQ(7.f, film->GetChannelValue(1, 1, 0));
+    ASSERT_EQ(4.f, film->GetChannelValue(2, 1, 0));
+    ASSERT_EQ(0.f, film->GetChannelValue(0, 0, 0));
+
+    // Merging keeps the first sample of a pixel from whichever tile reached it first.
+    float tile_samples[2][3] = {{6.f, 5.f, 2.f}, {8.f, 11.f, 1.f}};
+    for (const float *sample : tile_samples) {
+      std::unique_ptr<liang::FilmTile> tile = film->GetFilmTile(liang::Point2i(2, 0),
+          liang::Point2i(4, 1));
+      tile->AddSample(2.5f, 0.5f, 1.f, 1.f, 1.f, 1.f, sample);
+      ASSERT_EQ(sample[1], tile->GetChannelValue(1, 2, 0));
+      film->MergeFilmTile(*tile);
+    }
+    ASSERT_EQ(7.f, film->GetChannelValue(0, 2, 0));
+    ASSERT_EQ(5.f, film->GetChannelValue(1, 2, 0));
+    ASSERT_EQ(3.f, film->GetChannelValue(2, 2, 0));
+
+    // Checkpoints carry the channels along and only load into films with the same channels.
+    const std::string name = "channels_test.checkpoint";
+    ASSERT_TRUE(film->SaveCheckpoint(name, 1, 2));
+    auto loaded = std::make_shared<liang::Film>(4, 1,
+        std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f)), storage);
+    uint tiles_merged;
+    ASSERT_FALSE(loaded->LoadCheckpoint(name, 1, &tiles_merged));
+    loaded->AddChannel("Z", liang::ChannelMode::AVERAGE);
+    loaded->AddChannel("id", liang::ChannelMode::FIRST);
+    loaded->AddChannel("rays", liang::ChannelMode::SUM);
+    ASSERT_TRUE(loaded->LoadCheckpoint(name, 1, &tiles_merged));
+    for (uint channel = 0; channel < 3; channel++) {
+      for (uint x = 0; x < 4; x++) {
+        ASSERT_EQ(film->GetChannelValue(channel, x, 0), loaded->GetChannelValue(channel, x, 0));
+      }
+    }
+    film->ClearFilm();
+    ASSERT_EQ(0.f, film->GetChannelValue(2, 1, 0));
+    std::remove(name.c_str());
+  }
+}
@@ -0,0 +1,80 @@
+#include "filters/box_filter.h"
+#include "filters/filter_table.h"
+#include "filters/gaussian_filter.h"
+#include "filters/lanczos_filter.h"
+#include "filters/mitchell_filter.h"
+#include "tests/util.h"
+#include "tests/test.h"
+
+TEST(BoxFilterTest, Evaluate) {
+  liang::BoxFilter filter(0.5f);
+  ASSERT_EQ(0.5f, filter.GetRadius());
+  ASSERT_EQ(1.f, filter.Evaluate(liang::Point2f(0.25f, -0.4f)));
+}
+
+TEST(GaussianFilterTest, Evaluate) {
+  liang::GaussianFilter filter(1.5f, 2.f);
+  ASSERT_FLOAT_EQ(1.f - std::exp(-4.5f), filter.Evaluate1D(0.f));
+  ASSERT_FLOAT_EQ(filter.Evaluate1D(0.7f), filter.Evaluate1D(-0.7f));
+  ASSERT_GT(filter.Evaluate1D(0.5f), filter.Evaluate1D(1.f));
+  ASSERT_NEAR(0.f, filter.Evaluate1D(1.5f), 1e-6);
+  ASSERT_EQ(0.f, filter.Evaluate1D(2.f));
+  ASSERT_FLOAT_EQ(filter.Evaluate1D(0.3f) * filter.Evaluate1D(0.6f),
+      filter.Evaluate(liang::Point2f(0.3f, 0.6f)));
+}
+
+TEST(MitchellFilterTest, Evaluate) {
+  liang::MitchellFilter filter(2.f);
+  ASSERT_FLOAT_EQ(8.f / 9.f, filter.Evaluate1D(0.f));
+  ASSERT_NEAR(0.f, filter.Evaluate1D(2.f), 1e-6);
+  ASSERT_EQ(0.f, filter.Evaluate1D(2.5f));
+  // The negative lobe sharpens edges.
+  ASSERT_LT(filter.Evaluate1D(1.5f), 0.f);
+  // Shifted copies of the cubic one pixel apart sum to 1, so flat regions stay flat.
+  for (float x = 0.f; x < 1.f; x += 0.125f) {
+    float sum = 0.f;
+    for (int k = -2; k <= 2; k++) {
+      sum += filter.Evaluate1D(x + k);
+    }
+    ASSERT_NEAR(1.f, sum, 1e-5);
+  }
+}
+
+TEST(LanczosFilterTest, Evaluate) {
+  liang::LanczosFilter filter(3.f);
+  ASSERT_FLOAT_EQ(1.f, filter.Evaluate1D(0.f));
+  ASSERT_NEAR(0.f, filter.Evaluate1D(1.f), 1e-6);
+  ASSERT_NEAR(0.f, filter.Evaluate1D(-2.f), 1e-6);
+  ASSERT_LT(filter.Evaluate1D(1.5f), 0.f);
+  ASSERT_EQ(0.f, filter.Evaluate1D(3.5f));
+}
+
+// A radially symmetric filter that is not separable.
+class ConeFilter : public liang::Filter {
+  public:
+    ConeFilter(float radius) : liang::Filter(radius) {}
+    float Evaluate(const liang::Point2f &location) const {
+      float distance = std::sqrt(location.x * location.x + location.y * location.y);
+      return std::max(0.f, 1.f - distance * radius_inverse);
+    }
+};
+
+TEST(FilterTableTest, Lookup) {
+  liang::MitchellFilter separable_filter(2.f);
+  liang::FilterTable separable_table(separable_filter);
+  ASSERT_TRUE(separable_table.IsSeparable());
+  ASSERT_EQ(2.f, separable_table.GetRadius());
+  ConeFilter cone_filter(2.f);
+  liang::FilterTable cone_table(cone_filter);
+  ASSERT_FALSE(cone_table.IsSeparable());
+
+  ASSERT_EQ(0u, separable_table.OffsetToIndex(0.f));
+  ASSERT_EQ(4u, separable_table.OffsetToIndex(-0.5f));
+  ASSERT_EQ(liang::FilterTable::WIDTH - 1, separable_table.OffsetToIndex(2.f));
+  // Entries hold the filter at their centers.
+  float center = 4.5f * 2.f / liang::FilterTable::WIDTH;
+  ASSERT_FLOAT_EQ(separable_filter.Evaluate1D(center), separable_table.GetAxisWeight(4));
+  ASSERT_FLOAT_EQ(separable_filter.Evaluate(liang::Point2f(center, center)),
+      separable_table.GetWeight(4, 4));
+  ASSERT_FLOAT_EQ(cone_filter.Evaluate(liang::Point2f(center, center)), cone_table.GetWeight(4, 4));
+}
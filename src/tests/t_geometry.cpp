@@ -1,3 +1,4 @@
+#include "core/geometry_wide.h"
 #include "tests/test.h"
 #include "tests/util.h"
 
@@ -427,6 +428,11 @@ TEST(GeometryTest, Ray3fCreation) {
   Point3FloatEquals(ray2.origin, 1.0, 2.0, 3.0);
   Vector3FloatEquals(ray2.direction, 0.1, 0.2, 0.3);
   ASSERT_FLOAT_EQ(ray2.max_t, std::numeric_limits<float>::infinity());
+  ASSERT_FLOAT_EQ(ray2.time, 0.0);
+
+  liang::Ray3f ray3 = liang::Ray3f(origin, direction, 5.0, 0.25);
+  ASSERT_FLOAT_EQ(ray3.time, 0.25);
+  ASSERT_FLOAT_EQ(liang::RayDifferential(ray3).time, 0.25);
 }
 
 TEST(GeometryTest, Ray3fParameterization) {
@@ -447,6 +453,24 @@ TEST(GeometryTest, Ray3fParameterizationOutOfBounds) {
   ASSERT_DEATH(liang::Ray3f(origin, direction, -5.0), ASSERTION_FAILURE);
 }
 
+TEST(GeometryTest, RayDifferentialScale) {
+  liang::RayDifferential ray = liang::RayDifferential(liang::Point3f(1.0, 2.0, 3.0),
+      liang::Vector3f(0.0, 0.0, 1.0));
+  ASSERT_FALSE(ray.has_differentials);
+  ASSERT_FLOAT_EQ(ray.max_t, std::numeric_limits<float>::infinity());
+  ray.rx_origin = liang::Point3f(2.0, 2.0, 3.0);
+  ray.rx_direction = liang::Vector3f(0.2, 0.0, 1.0);
+  ray.ry_origin = liang::Point3f(1.0, 2.0, 3.0);
+  ray.ry_direction = liang::Vector3f(0.0, -0.4, 1.0);
+  ray.has_differentials = true;
+  ray.ScaleDifferentials(0.25);
+  Point3FloatEquals(ray.rx_origin, 1.25, 2.0, 3.0);
+  Vector3FloatEquals(ray.rx_direction, 0.05, 0.0, 1.0);
+  Point3FloatEquals(ray.ry_origin, 1.0, 2.0, 3.0);
+  Vector3FloatEquals(ray.ry_direction, 0.0, -0.1, 1.0);
+  Point3FloatEquals(ray(2.0), 1.0, 2.0, 5.0);
+}
+
 TEST(GeometryTest, AABB3Creation) {
   liang::AABB3f box = liang::AABB3f(liang::Point3f(1.0, 2.0, 3.0));
   AABB3FloatEquals(box, 1.0, 2.0, 3.0, 1.0, 2.0, 3.0);
@@ -585,3 +609,118 @@ TEST(GeometryTest, AABB3Contains) {
   ASSERT_FALSE(liang::Contains(box, liang::Point3f(1.0, 1.0, 1.0)));
   ASSERT_FALSE(liang::Contains(box, liang::Point3f(2.0, 2.0, 2.0)));
 }
+
+TEST(GeometryTest, WideFloatArithmetic) {
+  liang::Floatx4 a(1.f, -2.f, 3.f, -4.f);
+  liang::Floatx4 b(2.f, 2.f, -0.5f, 8.f);
+  liang::Floatx4 sum = a + b;
+  liang::Floatx4 product = a * b;
+  liang::Floatx4 quotient = a / b;
+  liang::Floatx4 minimum = liang::Min(a, b);
+  liang::Floatx4 absolute = liang::Abs(a);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_FLOAT_EQ(a[i] + b[i], sum[i]);
+    ASSERT_FLOAT_EQ(a[i] * b[i], product[i]);
+    ASSERT_FLOAT_EQ(a[i] / b[i], quotient[i]);
+    ASSERT_FLOAT_EQ(std::min(a[i], b[i]), minimum[i]);
+    ASSERT_FLOAT_EQ(std::abs(a[i]), absolute[i]);
+  }
+  float values[8] = {4.f, 9.f, 16.f, 25.f, 36.f, 49.f, 64.f, 81.f};
+  liang::Floatx8 roots = liang::Sqrt(liang::Floatx8::Load(values));
+  for (int i = 0; i < 8; i++) {
+    ASSERT_FLOAT_EQ(i + 2.f, roots[i]);
+  }
+  liang::Floatx8 scaled = liang::Floatx8::Load(values) * 2.f - 1.f;
+  scaled.Store(values);
+  ASSERT_FLOAT_EQ(7.f, values[0]);
+  ASSERT_FLOAT_EQ(161.f, values[7]);
+}
+
+TEST(GeometryTest, WideFloatMasks) {
+  liang::Floatx4 a(1.f, 2.f, 3.f, 4.f);
+  liang::Maskx4 mask = a > 2.f;
+  ASSERT_EQ(0xc, mask.Bits());
+  ASSERT_FALSE(mask[1]);
+  ASSERT_TRUE(mask[2]);
+  ASSERT_EQ(0x3, (~mask).Bits());
+  ASSERT_EQ(0x4, (mask & (a < 4.f)).Bits());
+  ASSERT_EQ(0xd, (mask | (a == 1.f)).Bits());
+  ASSERT_TRUE(liang::Any(mask));
+  ASSERT_FALSE(liang::All(mask));
+  ASSERT_TRUE(liang::All(mask | ~mask));
+  ASSERT_TRUE(liang::None(mask & ~mask));
+  liang::Floatx4 selected = liang::Select(mask, a, -a);
+  ASSERT_FLOAT_EQ(-1.f, selected[0]);
+  ASSERT_FLOAT_EQ(4.f, selected[3]);
+
+  liang::Floatx8 b(1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f);
+  liang::Maskx8 wide_mask = b >= 4.f;
+  ASSERT_EQ(0xf8, wide_mask.Bits());
+  ASSERT_TRUE(liang::All(wide_mask | (b < 4.f)));
+  ASSERT_FALSE(liang::Any(b != b));
+  liang::Floatx8 wide_selected = liang::Select(wide_mask, b, liang::Floatx8(0.f));
+  ASSERT_FLOAT_EQ(0.f, wide_selected[2]);
+  ASSERT_FLOAT_EQ(8.f, wide_selected[7]);
+}
+
+TEST(GeometryTest, WideVectorMatchesScalar) {
+  liang::Vector3f vecs1[8], vecs2[8];
+  liang::Point3f points[8];
+  for (int i = 0; i < 8; i++) {
+    vecs1[i] = liang::Vector3f(i + 1.f, 2.f - i, 0.5f * i);
+    vecs2[i] = liang::Vector3f(-3.f, i * i, 1.f - 0.25f * i);
+    points[i] = liang::Point3f(i, -i, 2.f * i);
+  }
+  liang::Vector3fx8 wide1(vecs1);
+  liang::Vector3fx8 wide2(vecs2);
+  liang::Point3fx8 wide_points(points);
+  liang::Floatx8 dot = liang::Dot(wide1, wide2);
+  liang::Vector3fx8 cross = liang::Cross(wide1, wide2);
+  liang::Vector3fx8 normalized = liang::Normalize(wide1);
+  liang::Point3fx8 offset = wide_points + wide1 * 2.f;
+  liang::Point3fx8 lerped = liang::Lerp(wide_points, offset, liang::Floatx8(0.25f));
+  for (int i = 0; i < 8; i++) {
+    ASSERT_FLOAT_EQ(liang::Dot(vecs1[i], vecs2[i]), dot[i]);
+    liang::Vector3f expected_cross = liang::Cross(vecs1[i], vecs2[i]);
+    liang::Vector3f expected_normalized = liang::Normalize(vecs1[i]);
+    liang::Point3f expected_offset = points[i] + vecs1[i] * 2.f;
+    liang::Point3f expected_lerped = liang::Lerp(points[i], expected_offset, 0.25f);
+    Vector3FloatEquals(cross.Lane(i), expected_cross.x, expected_cross.y, expected_cross.z);
+    Vector3FloatEquals(normalized.Lane(i), expected_normalized.x, expected_normalized.y,
+        expected_normalized.z);
+    Point3FloatEquals(offset.Lane(i), expected_offset.x, expected_offset.y, expected_offset.z);
+    Point3FloatEquals(lerped.Lane(i), expected_lerped.x, expected_lerped.y, expected_lerped.z);
+  }
+}
+
+TEST(GeometryTest, WideAABBIntersectBoxes) {
+  liang::AABB3f boxes[3] = {
+      liang::AABB3f(liang::Point3f(-1.0, -1.0, 2.0), liang::Point3f(1.0, 1.0, 4.0)),
+      liang::AABB3f(liang::Point3f(2.0, 2.0, 2.0), liang::Point3f(3.0, 3.0, 3.0)),
+      liang::AABB3f(liang::Point3f(-1.0, -1.0, -1.0), liang::Point3f(1.0, 1.0, 1.0))};
+  liang::AABB3fx4 wide_boxes(boxes, 3);
+  AABB3FloatEquals(wide_boxes.Lane(1), 2.0, 2.0, 2.0, 3.0, 3.0, 3.0);
+  // The fourth lane is padding, which is empty.
+  ASSERT_EQ(0x8, wide_boxes.IsEmpty().Bits());
+
+  liang::Ray3f ray(liang::Point3f(0.0, 0.0, 0.0), liang::Vector3f(0.0, 0.0, 1.0));
+  liang::Vector3f inverse_direction(1.f / ray.direction.x, 1.f / ray.direction.y,
+      1.f / ray.direction.z);
+  liang::Floatx4 t_near;
+  liang::Maskx4 hits = liang::IntersectBoxes(wide_boxes, ray, inverse_direction, &t_near);
+  // The ray starts inside the third box and misses the second.
+  ASSERT_EQ(0x5, hits.Bits());
+  ASSERT_FLOAT_EQ(2.f, t_near[0]);
+  ASSERT_FLOAT_EQ(0.f, t_near[2]);
+
+  ray.max_t = 1.5f;
+  hits = liang::IntersectBoxes(wide_boxes, ray, inverse_direction, &t_near);
+  ASSERT_EQ(0x4, hits.Bits());
+
+  ray = liang::Ray3f(liang::Point3f(0.0, 0.0, 10.0), liang::Vector3f(1.0, 1.0, -3.0));
+  inverse_direction = liang::Vector3f(1.f / ray.direction.x, 1.f / ray.direction.y,
+      1.f / ray.direction.z);
+  hits = liang::IntersectBoxes(wide_boxes, ray, inverse_direction, &t_near);
+  ASSERT_EQ(0x2, hits.Bits());
+  ASSERT_FLOAT_EQ(7.f / 3.f, t_near[1]);
+}
@@ -0,0 +1,635 @@
+#include "cameras/film.h"
+#include "filters/box_filter.h"
+#include "images/exr_writer.h"
+#include "images/pfm_writer.h"
+#include "images/ppm_encoder.h"
+#include "images/tga_encoder.h"
+#include "utils/half.h"
+#include "tests/util.h"
+#include "tests/test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// Reads a whole file into memory.
+static std::vector<char> ReadFile(const std::string &name) {
+  std::ifstream file(name, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Reads a little endian unsigned integer at the given position and advances past it.
+template <typename T>
+static T ReadLittleEndian(const std::vector<char> &bytes, size_t *position) {
+  T value = 0;
+  for (uint i = 0; i < sizeof(T); i++) {
+    value |= (T)(unsigned char)bytes[*position + i] << (8 * i);
+  }
+  *position += sizeof(T);
+  return value;
+}
+
+// Reads a null terminated string at the given position and advances past it.
+static std::string ReadString(const std::vector<char> &bytes, size_t *position) {
+  std::string value(&bytes[*position]);
+  *position += value.size() + 1;
+  return value;
+}
+
+// Undoes ExrRleCompress() following the decoder in the OpenEXR specification.
+static std::vector<char> RleUncompress(const char *data, size_t size, size_t uncompressed_size) {
+  std::vector<char> scratch;
+  const signed char *in = (const signed char *)data;
+  const signed char *end = in + size;
+  while (in < end) {
+    if (*in < 0) {
+      int count = -*in++;
+      scratch.insert(scratch.end(), in, in + count);
+      in += count;
+    } else {
+      int count = *in++ + 1;
+      scratch.insert(scratch.end(), count, (char)*in++);
+    }
+  }
+  EXPECT_EQ(uncompressed_size, scratch.size());
+  for (size_t i = 1; i < scratch.size(); i++) {
+    scratch[i] = (char)((unsigned char)scratch[i - 1] + (unsigned char)scratch[i] - 128);
+  }
+  std::vector<char> output(scratch.size());
+  size_t half_size = (scratch.size() + 1) / 2;
+  for (size_t i = 0; i < scratch.size(); i++) {
+    output[i] = scratch[i % 2 == 0 ? i / 2 : half_size + i / 2];
+  }
+  return output;
+}
+
+// A decoded RGB scanline or tiled EXR.
+struct ExrImage {
+  uint width;
+  uint height;
+  // The size of the tiles, or 0 for a scanline file.
+  uint tile_size;
+  // The number of tiles whose offset is still 0.
+  uint missing_tiles;
+  std::vector<std::string> channels;
+  // The type of every channel, in the same order as channels.
+  std::vector<uint> channel_types;
+  // The type of the R channel.
+  uint pixel_type;
+  uint compression;
+  // Interleaved RGB values in top to bottom row order.
+  std::vector<float> rgb;
+  // The values of every channel besides R, G, and B in top to bottom row order.
+  std::map<std::string, std::vector<float>> extra;
+};
+
+// Returns the number of bytes a single pixel takes up across every channel of the image.
+static size_t ExrPixelSize(const ExrImage &image) {
+  size_t pixel_size = 0;
+  for (uint type : image.channel_types) {
+    pixel_size += type == 1 ? 2 : 4;
+  }
+  return pixel_size;
+}
+
+// Decodes the channels of a block holding the given rows and columns into the image.
+static void ReadExrBlock(const std::vector<char> &block, uint min_x, uint min_y, uint block_width,
+    uint block_height, ExrImage *image) {
+  size_t value_position = 0;
+  for (uint y = min_y; y < min_y + block_height; y++) {
+    for (uint channel = 0; channel < image->channels.size(); channel++) {
+      const std::string &name = image->channels[channel];
+      int rgb_channel = name == "R" ? 0 : name == "G" ? 1 : name == "B" ? 2 : -1;
+      for (uint x = min_x; x < min_x + block_width; x++) {
+        float value;
+        if (image->channel_types[channel] == 1) {
+          value = liang::HalfToFloat(ReadLittleEndian<uint16_t>(block, &value_position));
+        } else {
+          uint32_t bits = ReadLittleEndian<uint32_t>(block, &value_position);
+          std::memcpy(&value, &bits, sizeof(float));
+        }
+        if (rgb_channel >= 0) {
+          image->rgb[(y * image->width + x) * 3 + rgb_channel] = value;
+        } else {
+          image->extra[name][y * image->width + x] = value;
+        }
+      }
+    }
+  }
+}
+
+// Decodes an EXR written by the ExrWriter or the TiledExrWriter. Tiles that have not been written
+// yet are left black.
+static ExrImage ReadExr(const std::string &name) {
+  std::vector<char> bytes = ReadFile(name);
+  ExrImage image = {};
+  size_t position = 0;
+  EXPECT_EQ(20000630u, ReadLittleEndian<uint32_t>(bytes, &position));
+  uint32_t version = ReadLittleEndian<uint32_t>(bytes, &position);
+  EXPECT_EQ(2u, version & 0xff);
+  bool tiled = (version & 0x200) != 0;
+  while (bytes[position] != '\0') {
+    std::string attribute = ReadString(bytes, &position);
+    std::string type = ReadString(bytes, &position);
+    uint32_t size = ReadLittleEndian<uint32_t>(bytes, &position);
+    size_t value_position = position;
+    if (attribute == "channels") {
+      while (bytes[value_position] != '\0') {
+        image.channels.push_back(ReadString(bytes, &value_position));
+        image.channel_types.push_back(ReadLittleEndian<uint32_t>(bytes, &value_position));
+        if (image.channels.back() == "R") {
+          image.pixel_type = image.channel_types.back();
+        }
+        value_position += 12;
+      }
+    } else if (attribute == "compression") {
+      image.compression = (unsigned char)bytes[value_position];
+    } else if (attribute == "dataWindow") {
+      value_position += 8;
+      image.width = ReadLittleEndian<uint32_t>(bytes, &value_position) + 1;
+      image.height = ReadLittleEndian<uint32_t>(bytes, &value_position) + 1;
+    } else if (attribute == "lineOrder") {
+      EXPECT_EQ(tiled ? 2 : 0, bytes[value_position]);
+    } else if (attribute == "tiles") {
+      image.tile_size = ReadLittleEndian<uint32_t>(bytes, &value_position);
+      EXPECT_EQ(image.tile_size, ReadLittleEndian<uint32_t>(bytes, &value_position));
+      EXPECT_EQ(0, bytes[value_position]);
+    }
+    position += size;
+  }
+  position++;
+  EXPECT_EQ(tiled, image.tile_size > 0);
+  EXPECT_TRUE(std::is_sorted(image.channels.begin(), image.channels.end()));
+  for (const std::string &channel : image.channels) {
+    if (channel != "R" && channel != "G" && channel != "B") {
+      image.extra[channel].resize(image.width * image.height);
+    }
+  }
+  size_t pixel_size = ExrPixelSize(image);
+  if (tiled) {
+    uint tiles_x = (image.width + image.tile_size - 1) / image.tile_size;
+    uint tiles_y = (image.height + image.tile_size - 1) / image.tile_size;
+    image.rgb.resize(image.width * image.height * 3);
+    for (uint i = 0; i < tiles_x * tiles_y; i++) {
+      size_t block_position = ReadLittleEndian<uint64_t>(bytes, &position);
+      if (block_position == 0) {
+        image.missing_tiles++;
+        continue;
+      }
+      uint32_t tile_x = ReadLittleEndian<uint32_t>(bytes, &block_position);
+      uint32_t tile_y = ReadLittleEndian<uint32_t>(bytes, &block_position);
+      EXPECT_EQ(i, tile_y * tiles_x + tile_x);
+      EXPECT_EQ(0u, ReadLittleEndian<uint32_t>(bytes, &block_position));
+      EXPECT_EQ(0u, ReadLittleEndian<uint32_t>(bytes, &block_position));
+      uint32_t data_size = ReadLittleEndian<uint32_t>(bytes, &block_position);
+      uint min_x = tile_x * image.tile_size;
+      uint min_y = tile_y * image.tile_size;
+      uint tile_width = std::min(image.tile_size, image.width - min_x);
+      uint tile_height = std::min(image.tile_size, image.height - min_y);
+      size_t block_size = tile_width * tile_height * pixel_size;
+      std::vector<char> block(bytes.begin() + block_position,
+          bytes.begin() + block_position + data_size);
+      if (data_size < block_size) {
+        block = RleUncompress(block.data(), data_size, block_size);
+      }
+      EXPECT_EQ(block_size, block.size());
+      ReadExrBlock(block, min_x, min_y, tile_width, tile_height, &image);
+    }
+    return image;
+  }
+  size_t block_size = image.width * pixel_size;
+  image.rgb.resize(image.width * image.height * 3);
+  for (uint i = 0; i < image.height; i++) {
+    size_t block_position = ReadLittleEndian<uint64_t>(bytes, &position);
+    uint32_t y = ReadLittleEndian<uint32_t>(bytes, &block_position);
+    EXPECT_EQ(i, y);
+    uint32_t data_size = ReadLittleEndian<uint32_t>(bytes, &block_position);
+    std::vector<char> block(bytes.begin() + block_position,
+        bytes.begin() + block_position + data_size);
+    if (data_size < block_size) {
+      block = RleUncompress(block.data(), data_size, block_size);
+    }
+    EXPECT_EQ(block_size, block.size());
+    ReadExrBlock(block, 0, y, image.width, 1, &image);
+  }
+  return image;
+}
+
+// Fills a row of a test image with a smooth gradient and a few flat runs.
+static std::vector<float> TestRow(uint width, uint y) {
+  std::vector<float> row(width * 3);
+  for (uint x = 0; x < width; x++) {
+    row[x * 3] = x < width / 2 ? 0.f : (float)x / width;
+    row[x * 3 + 1] = (float)y * 10.f + 0.25f;
+    row[x * 3 + 2] = std::sin((float)(x + y)) * 100.f;
+  }
+  return row;
+}
+
+TEST(HalfTest, Conversion) {
+  ASSERT_EQ(0x0000, liang::FloatToHalf(0.f));
+  ASSERT_EQ(0x8000, liang::FloatToHalf(-0.f));
+  ASSERT_EQ(0x3c00, liang::FloatToHalf(1.f));
+  ASSERT_EQ(0xc000, liang::FloatToHalf(-2.f));
+  ASSERT_EQ(0x7bff, liang::FloatToHalf(65504.f));
+  ASSERT_EQ(0x7c00, liang::FloatToHalf(65520.f));
+  ASSERT_EQ(0x7c00, liang::FloatToHalf(std::numeric_limits<float>::infinity()));
+  ASSERT_EQ(0x0001, liang::FloatToHalf(std::ldexp(1.f, -24)));
+  ASSERT_EQ(0x0400, liang::FloatToHalf(std::ldexp(1.f, -14)));
+  ASSERT_EQ(0x0000, liang::FloatToHalf(std::ldexp(1.f, -26)));
+  // Ties round to even.
+  ASSERT_EQ(0x3c00, liang::FloatToHalf(1.f + std::ldexp(1.f, -11)));
+  ASSERT_EQ(0x3c02, liang::FloatToHalf(1.f + 3.f * std::ldexp(1.f, -11)));
+  ASSERT_TRUE(std::isnan(liang::HalfToFloat(liang::FloatToHalf(std::nanf("")))));
+  // Every finite half survives a round trip through float.
+  for (uint32_t half = 0; half < 0x10000; half++) {
+    if ((half & 0x7c00) != 0x7c00) {
+      ASSERT_EQ(half, liang::FloatToHalf(liang::HalfToFloat((uint16_t)half)));
+    }
+  }
+}
+
+TEST(ExrWriterTest, RoundTrip) {
+  const std::string name = "image_test.exr";
+  const uint width = 37;
+  const uint height = 5;
+  for (liang::ExrPixelType pixel_type : {liang::ExrPixelType::HALF, liang::ExrPixelType::FLOAT}) {
+    for (liang::ExrCompression compression :
+        {liang::ExrCompression::NONE, liang::ExrCompression::RLE}) {
+      liang::ExrWriter writer(name, width, height, pixel_type, compression);
+      for (uint y = 0; y < height; y++) {
+        ASSERT_TRUE(writer.WriteRow(TestRow(width, y).data()));
+      }
+      ASSERT_TRUE(writer.Close());
+      ExrImage image = ReadExr(name);
+      ASSERT_EQ(width, image.width);
+      ASSERT_EQ(height, image.height);
+      ASSERT_EQ(std::vector<std::string>({"B", "G", "R"}), image.channels);
+      ASSERT_EQ((uint)pixel_type, image.pixel_type);
+      ASSERT_EQ((uint)compression, image.compression);
+      for (uint y = 0; y < height; y++) {
+        std::vector<float> row = TestRow(width, y);
+        for (uint i = 0; i < width * 3; i++) {
+          float expected = pixel_type == liang::ExrPixelType::HALF ?
+              liang::HalfToFloat(liang::FloatToHalf(row[i])) : row[i];
+          ASSERT_EQ(expected, image.rgb[y * width * 3 + i]);
+        }
+      }
+    }
+  }
+  std::remove(name.c_str());
+}
+
+TEST(ExrWriterTest, RleCompress) {
+  std::vector<char> data(1000, 7);
+  for (uint i = 500; i < 600; i++) {
+    data[i] = (char)(i * 31);
+  }
+  std::vector<char> compressed;
+  std::vector<char> scratch;
+  liang::ExrRleCompress(data, &compressed, &scratch);
+  ASSERT_LT(compressed.size(), data.size() / 2);
+  ASSERT_EQ(data, RleUncompress(compressed.data(), compressed.size(), data.size()));
+}
+
+TEST(ExrWriterTest, MissingRows) {
+  const std::string name = "image_test_missing.exr";
+  liang::ExrWriter writer(name, 4, 2);
+  ASSERT_TRUE(writer.WriteRow(TestRow(4, 0).data()));
+  ASSERT_FALSE(writer.Close());
+  std::remove(name.c_str());
+}
+
+// Gets a tile of an image made of TestRow() rows as interleaved RGB values.
+static std::vector<float> TestTile(uint width, uint height, uint tile_size, uint tile_x,
+    uint tile_y) {
+  std::vector<float> tile;
+  uint min_x = tile_x * tile_size;
+  uint max_x = std::min(min_x + tile_size, width);
+  for (uint y = tile_y * tile_size; y < std::min((tile_y + 1) * tile_size, height); y++) {
+    std::vector<float> row = TestRow(width, y);
+    tile.insert(tile.end(), row.begin() + min_x * 3, row.begin() + max_x * 3);
+  }
+  return tile;
+}
+
+TEST(TiledExrWriterTest, RoundTrip) {
+  const std::string name = "image_test_tiled.exr";
+  const uint width = 37;
+  const uint height = 21;
+  const uint tile_size = 8;
+  for (liang::ExrPixelType pixel_type : {liang::ExrPixelType::HALF, liang::ExrPixelType::FLOAT}) {
+    for (liang::ExrCompression compression :
+        {liang::ExrCompression::NONE, liang::ExrCompression::RLE}) {
+      liang::TiledExrWriter writer(name, width, height, tile_size, pixel_type, compression);
+      ASSERT_EQ(5u, writer.NumTilesX());
+      ASSERT_EQ(3u, writer.NumTilesY());
+      // Write the tiles bottom up, checking that the file is readable after every tile.
+      uint tiles_written = 0;
+      for (int tile_y = 2; tile_y >= 0; tile_y--) {
+        for (uint tile_x = 0; tile_x < 5; tile_x++) {
+          ASSERT_TRUE(writer.WriteTile(tile_x, tile_y,
+              TestTile(width, height, tile_size, tile_x, tile_y).data()));
+          tiles_written++;
+          ASSERT_EQ(15 - tiles_written, ReadExr(name).missing_tiles);
+        }
+      }
+      ASSERT_FALSE(writer.WriteTile(0, 0, TestTile(width, height, tile_size, 0, 0).data()));
+      ASSERT_FALSE(writer.Close());
+      ExrImage image = ReadExr(name);
+      ASSERT_EQ(width, image.width);
+      ASSERT_EQ(height, image.height);
+      ASSERT_EQ(tile_size, image.tile_size);
+      ASSERT_EQ((uint)pixel_type, image.pixel_type);
+      ASSERT_EQ((uint)compression, image.compression);
+      for (uint y = 0; y < height; y++) {
+        std::vector<float> row = TestRow(width, y);
+        for (uint i = 0; i < width * 3; i++) {
+          float expected = pixel_type == liang::ExrPixelType::HALF ?
+              liang::HalfToFloat(liang::FloatToHalf(row[i])) : row[i];
+          ASSERT_EQ(expected, image.rgb[y * width * 3 + i]);
+        }
+      }
+    }
+  }
+  std::remove(name.c_str());
+}
+
+TEST(TiledExrWriterTest, MissingTiles) {
+  const std::string name = "image_test_tiled_missing.exr";
+  {
+    liang::TiledExrWriter writer(name, 20, 4, 16);
+    ASSERT_TRUE(writer.WriteTile(1, 0, TestTile(20, 4, 16, 1, 0).data()));
+    ASSERT_FALSE(writer.Close());
+  }
+  ExrImage image = ReadExr(name);
+  ASSERT_EQ(1u, image.missing_tiles);
+  ASSERT_EQ(0.f, image.rgb[0]);
+  ASSERT_EQ(liang::HalfToFloat(liang::FloatToHalf(TestRow(20, 0)[16 * 3])), image.rgb[16 * 3]);
+  liang::TiledExrWriter writer(name, 20, 4, 16);
+  ASSERT_TRUE(writer.WriteTile(0, 0, TestTile(20, 4, 16, 0, 0).data()));
+  ASSERT_TRUE(writer.WriteTile(1, 0, TestTile(20, 4, 16, 1, 0).data()));
+  ASSERT_TRUE(writer.Close());
+  std::remove(name.c_str());
+}
+
+TEST(PfmWriterTest, RoundTrip) {
+  const std::string name = "image_test.pfm";
+  const uint width = 6;
+  const uint height = 3;
+  liang::PfmWriter writer(name, width, height);
+  for (uint y = 0; y < height; y++) {
+    ASSERT_TRUE(writer.WriteRow(TestRow(width, y).data()));
+  }
+  ASSERT_TRUE(writer.Close());
+  std::vector<char> bytes = ReadFile(name);
+  std::string header = "PF\n6 3\n-1.0\n";
+  ASSERT_EQ(header, std::string(bytes.begin(), bytes.begin() + header.size()));
+  ASSERT_EQ(header.size() + width * height * 3 * sizeof(float), bytes.size());
+  size_t position = header.size();
+  // Rows are stored from the bottom up.
+  for (int y = height - 1; y >= 0; y--) {
+    std::vector<float> row = TestRow(width, y);
+    for (uint i = 0; i < width * 3; i++) {
+      uint32_t bits = ReadLittleEndian<uint32_t>(bytes, &position);
+      float value;
+      std::memcpy(&value, &bits, sizeof(float));
+      ASSERT_EQ(row[i], value);
+    }
+  }
+  std::remove(name.c_str());
+}
+
+TEST(FilmTest, SaveAsExr) {
+  const std::string name = "film_test.exr";
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
+  liang::Film film(3, 2, std::move(filter));
+  film.AddSample(0.5f, 0.5f, 2.f, 4.f, 6.f, 1.f);
+  film.AddSample(0.5f, 0.5f, 4.f, 4.f, 4.f, 1.f);
+  film.AddSample(2.5f, 1.5f, 1000.f, 0.5f, 0.f, 1.f);
+  ASSERT_TRUE(film.SaveAsExr(name, liang::ExrPixelType::FLOAT));
+  ExrImage image = ReadExr(name);
+  ASSERT_EQ(3u, image.width);
+  ASSERT_EQ(2u, image.height);
+  ASSERT_EQ(3.f, image.rgb[0]);
+  ASSERT_EQ(4.f, image.rgb[1]);
+  ASSERT_EQ(5.f, image.rgb[2]);
+  ASSERT_EQ(0.f, image.rgb[3]);
+  ASSERT_EQ(1000.f, image.rgb[15]);
+  ASSERT_EQ(0.5f, image.rgb[16]);
+  std::remove(name.c_str());
+}
+
+TEST(ExrWriterTest, ExtraChannels) {
+  const std::string name = "exr_channels_test.exr";
+  const uint width = 5;
+  const uint height = 3;
+  std::vector<std::string> channels = {"Z", "A", "id"};
+  // Every extra channel is written as a full float regardless of the color type.
+  liang::ExrWriter writer(name, width, height, liang::ExrPixelType::HALF,
+      liang::ExrCompression::RLE, channels);
+  for (uint y = 0; y < height; y++) {
+    std::vector<float> channel_values(channels.size() * width);
+    for (uint i = 0; i < channel_values.size(); i++) {
+      channel_values[i] = 1000.f * y + i + 0.1f;
+    }
+    ASSERT_TRUE(writer.WriteRow(TestRow(width, y).data(), channel_values.data()));
+  }
+  ASSERT_TRUE(writer.Close());
+  ExrImage image = ReadExr(name);
+  ASSERT_EQ(std::vector<std::string>({"A", "B", "G", "R", "Z", "id"}), image.channels);
+  ASSERT_EQ(std::vector<uint>({2, 1, 1, 1, 2, 2}), image.channel_types);
+  for (uint y = 0; y < height; y++) {
+    std::vector<float> row = TestRow(width, y);
+    for (uint x = 0; x < width; x++) {
+      for (uint channel = 0; channel < 3; channel++) {
+        ASSERT_EQ(liang::HalfToFloat(liang::FloatToHalf(row[x * 3 + channel])),
+            image.rgb[(y * width + x) * 3 + channel]);
+      }
+      for (uint channel = 0; channel < channels.size(); channel++) {
+        ASSERT_EQ(1000.f * y + channel * width + x + 0.1f,
+            image.extra[channels[channel]][y * width + x]);
+      }
+    }
+  }
+  std::remove(name.c_str());
+}
+
+TEST(FilmTest, SaveChannelsAsExr) {
+  const std::string name = "film_channels_test.exr";
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
+  liang::Film film(2, 1, std::move(filter));
+  film.AddChannel("Z", liang::ChannelMode::AVERAGE);
+  film.AddChannel("rays", liang::ChannelMode::SUM);
+  float first[] = {2.f, 1.f};
+  float second[] = {4.f, 3.f};
+  film.AddSample(0.5f, 0.5f, 1.f, 1.f, 1.f, 1.f, first);
+  film.AddSample(0.5f, 0.5f, 1.f, 1.f, 1.f, 1.f, second);
+  ASSERT_TRUE(film.SaveAsExr(name));
+  ExrImage image = ReadExr(name);
+  ASSERT_EQ(std::vector<std::string>({"B", "G", "R", "Z", "rays"}), image.channels);
+  ASSERT_EQ(3.f, image.extra["Z"][0]);
+  ASSERT_EQ(4.f, image.extra["rays"][0]);
+  ASSERT_EQ(0.f, image.extra["Z"][1]);
+  ASSERT_EQ(0.f, image.extra["rays"][1]);
+  std::remove(name.c_str());
+}
+
+TEST(ToneMapTest, SrgbTable) {
+  const liang::SrgbTable &table = liang::GetSrgbTable();
+  ASSERT_EQ(0.f, table.Encode(0.f));
+  ASSERT_FLOAT_EQ(1.f, table.Encode(1.f));
+  ASSERT_FLOAT_EQ(12.92f * 0.001f, liang::LinearToSrgb(0.001f));
+  for (float linear = 0.f; linear <= 1.f; linear += 0.000731f) {
+    ASSERT_NEAR(liang::LinearToSrgb(linear), table.Encode(linear), 0.25f / 65535.f);
+  }
+}
+
+// Fills a film with pixels covering the interesting cases of tone mapping, with an odd width so
+// that the vectorized conversion has leftover pixels at the end of the film.
+static std::unique_ptr<liang::Film> CreateToneMapFilm() {
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
+  auto film = std::unique_ptr<liang::Film>(new liang::Film(7, 37, std::move(filter)));
+  for (uint y = 0; y < film->height; y++) {
+    for (uint x = 0; x < film->width; x++) {
+      // Leave a pixel without any samples now and then.
+      if ((x + y) % 11 == 0) {
+        continue;
+      }
+      float value = (x * film->height + y) / 128.f;
+      film->AddSample(x + 0.5f, y + 0.5f, value, value * 0.5f, 2.5f - value, 2.f);
+    }
+  }
+  return film;
+}
+
+// Converts a channel the slow way for comparison.
+static float ReferenceToneMap(float value, float weight_sum, float exposure, bool srgb) {
+  if (weight_sum <= 0.f) {
+    return 0.f;
+  }
+  value = std::min(std::max(value / weight_sum * std::exp2(exposure), 0.f), 1.f);
+  return srgb ? liang::LinearToSrgb(value) : value;
+}
+
+TEST(ToneMapTest, ToneMap) {
+  std::unique_ptr<liang::Film> film = CreateToneMapFilm();
+  for (float exposure : {0.f, 1.f, -2.f}) {
+    for (bool srgb : {true, false}) {
+      liang::ToneMapSettings settings(exposure, srgb, 3);
+      std::vector<uint8_t> output8(film->width * film->height * 3);
+      std::vector<uint16_t> output16(film->width * film->height * 3);
+      film->ToneMap(settings, output8.data());
+      film->ToneMap(settings, output16.data());
+      for (uint y = 0; y < film->height; y++) {
+        for (uint x = 0; x < film->width; x++) {
+          liang::Pixel pixel = film->GetPixel(x, y);
+          float color[3] = {pixel.r, pixel.g, pixel.b};
+          for (uint channel = 0; channel < 3; channel++) {
+            float expected = ReferenceToneMap(color[channel], pixel.weight_sum, exposure, srgb);
+            uint index = (y * film->width + x) * 3 + channel;
+            ASSERT_NEAR(expected * 255.f, output8[index], 0.5f + 1e-3f);
+            ASSERT_NEAR(expected * 65535.f, output16[index], 0.5f + 1e-2f);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ToneMapTest, DeterministicAcrossThreadCounts) {
+  std::unique_ptr<liang::Film> film = CreateToneMapFilm();
+  std::vector<uint8_t> output1(film->width * film->height * 3);
+  std::vector<uint8_t> output2(film->width * film->height * 3);
+  film->ToneMap(liang::ToneMapSettings(0.5f, true, 1), output1.data());
+  film->ToneMap(liang::ToneMapSettings(0.5f, true, 4), output2.data());
+  ASSERT_EQ(output1, output2);
+}
+
+// Decodes a top to bottom RLE truecolor TGA to interleaved RGB values.
+static std::vector<uint8_t> DecodeTga(const std::vector<char> &bytes, uint *width, uint *height) {
+  EXPECT_EQ(10, bytes[2]);
+  EXPECT_EQ(24, bytes[16]);
+  EXPECT_EQ(0x20, bytes[17]);
+  *width = (unsigned char)bytes[12] | (unsigned char)bytes[13] << 8;
+  *height = (unsigned char)bytes[14] | (unsigned char)bytes[15] << 8;
+  std::vector<uint8_t> rgb;
+  size_t position = 18;
+  uint row_pixels = 0;
+  while (position < bytes.size()) {
+    unsigned char packet = (unsigned char)bytes[position++];
+    uint count = (packet & 0x7f) + 1;
+    // Packets must not cross the end of a row.
+    row_pixels += count;
+    EXPECT_LE(row_pixels, *width);
+    row_pixels %= *width;
+    for (uint i = 0; i < count; i++) {
+      size_t pixel_position = packet & 0x80 ? position : position + i * 3;
+      rgb.push_back((uint8_t)bytes[pixel_position + 2]);
+      rgb.push_back((uint8_t)bytes[pixel_position + 1]);
+      rgb.push_back((uint8_t)bytes[pixel_position]);
+    }
+    position += packet & 0x80 ? 3 : count * 3;
+  }
+  return rgb;
+}
+
+// Creates an image with long flat runs, short runs, and noise, tall enough for several strips.
+static std::vector<uint8_t> CreateEncoderTestImage(uint width, uint height) {
+  std::vector<uint8_t> rgb(width * height * 3);
+  for (uint y = 0; y < height; y++) {
+    for (uint x = 0; x < width; x++) {
+      uint8_t *pixel = &rgb[(y * width + x) * 3];
+      if (x < width / 2) {
+        pixel[0] = 10;
+        pixel[1] = 20;
+        pixel[2] = (uint8_t)(y / 8);
+      } else {
+        pixel[0] = (uint8_t)(x * 37 + y * 11);
+        pixel[1] = (uint8_t)(x / 2 % 2);
+        pixel[2] = (uint8_t)(x * y);
+      }
+    }
+  }
+  return rgb;
+}
+
+TEST(ImageEncoderTest, Ppm) {
+  std::vector<uint8_t> rgb = CreateEncoderTestImage(5, 130);
+  std::vector<char> bytes = liang::PpmEncoder().EncodeToMemory(rgb.data(), 5, 130, 3);
+  std::string header = "P6\n5 130\n255\n";
+  ASSERT_EQ(header, std::string(bytes.begin(), bytes.begin() + header.size()));
+  ASSERT_EQ(std::vector<char>(rgb.begin(), rgb.end()),
+      std::vector<char>(bytes.begin() + header.size(), bytes.end()));
+}
+
+TEST(ImageEncoderTest, Tga) {
+  for (uint width : {1u, 2u, 300u}) {
+    uint height = 150;
+    std::vector<uint8_t> rgb = CreateEncoderTestImage(width, height);
+    std::vector<char> bytes = liang::TgaEncoder().EncodeToMemory(rgb.data(), width, height, 3);
+    uint decoded_width, decoded_height;
+    ASSERT_EQ(rgb, DecodeTga(bytes, &decoded_width, &decoded_height));
+    ASSERT_EQ(width, decoded_width);
+    ASSERT_EQ(height, decoded_height);
+    ASSERT_EQ(bytes, liang::TgaEncoder().EncodeToMemory(rgb.data(), width, height, 1));
+    if (width == 300) {
+      ASSERT_LT(bytes.size(), rgb.size());
+    }
+  }
+}
+
+TEST(FilmTest, SaveWithEncoder) {
+  const std::string name = "film_test.ppm";
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f));
+  liang::Film film(2, 1, std::move(filter));
+  film.AddSample(0.5f, 0.5f, 1.f, 0.5f, 0.f, 1.f);
+  ASSERT_TRUE(film.Save(name, liang::PpmEncoder(), liang::ToneMapSettings(0.f, false)));
+  std::vector<char> bytes = ReadFile(name);
+  std::string expected = std::string("P6\n2 1\n255\n") + (char)255 + (char)128 + '\0' + '\0' +
+      '\0' + '\0';
+  ASSERT_EQ(expected, std::string(bytes.begin(), bytes.end()));
+  std::remove(name.c_str());
+}
@@ -0,0 +1,762 @@
+#include "cameras/film.h"
+#include "cameras/perspective_camera.h"
+#include "core/animated_transform.h"
+#include "core/scene.h"
+#include "filters/box_filter.h"
+#include "filters/mitchell_filter.h"
+#include "integrators/render_farm.h"
+#include "integrators/reprojection_cache.h"
+#include "integrators/tile_order.h"
+#include "integrators/visibility_buffer.h"
+#include "integrators/visibility_integrator.h"
+#include "primitives/aggregate_primitive.h"
+#include "primitives/animated_primitive.h"
+#include "primitives/motion_bvh.h"
+#include "samplers/adaptive_sampler.h"
+#include "samplers/random_sampler.h"
+#include "utils/socket.h"
+#include "tests/util.h"
+#include "tests/test.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Everything needed to render the unit cube from a fixed viewpoint.
+struct UnitCubeRender {
+  std::shared_ptr<liang::Mesh> mesh;
+  std::unique_ptr<liang::Scene> scene;
+  std::shared_ptr<liang::Film> film;
+  std::shared_ptr<liang::PerspectiveCamera> camera;
+  std::shared_ptr<liang::Sampler> sampler;
+  std::shared_ptr<liang::VisibilityIntegrator> integrator;
+};
+
+// Sets up a render of the unit cube to a new film of the given size with the given number of
+// threads and sampler seed.
+static UnitCubeRender CreateUnitCubeRender(uint width, uint height, uint num_threads,
+    uint64_t seed = 7) {
+  UnitCubeRender render;
+  render.mesh = CreateUnitCube();
+  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims =
+      liang::CreateGeometricPrimitives(liang::CreateTriangles(render.mesh));
+  std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
+  render.scene = std::unique_ptr<liang::Scene>(
+      new liang::Scene(std::make_shared<liang::AggregatePrimitive>(prims)));
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(3.01f, 3.0f, 3.0f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  render.film = std::make_shared<liang::Film>(width, height, std::move(filter));
+  render.camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, render.film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  render.sampler = std::make_shared<liang::AdaptiveSampler>(
+      std::unique_ptr<liang::Sampler>(new liang::RandomSampler(16, seed)), 4, 0.05f);
+  render.integrator = std::make_shared<liang::VisibilityIntegrator>(render.camera,
+      render.sampler, num_threads);
+  return render;
+}
+
+// Renders the unit cube to a new film of the given size with the given number of threads.
+static std::shared_ptr<liang::Film> RenderUnitCube(uint width, uint height, uint num_threads,
+    std::shared_ptr<const liang::TileOrder> tile_order = nullptr) {
+  UnitCubeRender render = CreateUnitCubeRender(width, height, num_threads);
+  if (tile_order) {
+    render.integrator->SetTileOrder(tile_order);
+  }
+  render.integrator->Render(*render.scene);
+  return render.film;
+}
+
+// Asserts that two films hold bit identical pixels.
+static void AssertFilmsIdentical(const liang::Film &film1, const liang::Film &film2) {
+  ASSERT_EQ(film1.width, film2.width);
+  ASSERT_EQ(film1.height, film2.height);
+  for (uint y = 0; y < film1.height; y++) {
+    for (uint x = 0; x < film1.width; x++) {
+      liang::Pixel pixel1 = film1.GetPixel(x, y);
+      liang::Pixel pixel2 = film2.GetPixel(x, y);
+      ASSERT_EQ(0, std::memcmp(&pixel1, &pixel2, sizeof(liang::Pixel)));
+    }
+  }
+}
+
+TEST(VisibilityIntegratorTest, Render) {
+  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims = CreateUnitCubePrimitives();
+  std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
+  liang::Scene scene(std::make_shared<liang::AggregatePrimitive>(prims));
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(3.01f, 3.0f, 3.0f),
+      liang::Vector3f(0.f, 0.f, 0.f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  auto film = std::make_shared<liang::Film>(16, 16, std::move(filter));
+  auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  auto sampler = std::make_shared<liang::AdaptiveSampler>(
+      std::unique_ptr<liang::Sampler>(new liang::RandomSampler(16)), 4, 0.05f);
+  liang::VisibilityIntegrator integrator(camera, sampler);
+  integrator.Render(scene);
+
+  liang::Pixel center = film->GetPixel(8, 8);
+  ASSERT_EQ(4u, center.sample_count);
+  ASSERT_FLOAT_EQ(center.weight_sum, center.r);
+  liang::Pixel corner = film->GetPixel(0, 0);
+  ASSERT_EQ(4u, corner.sample_count);
+  ASSERT_EQ(0.f, corner.r);
+  for (uint y = 0; y < 16; y++) {
+    for (uint x = 0; x < 16; x++) {
+      liang::Pixel pixel = film->GetPixel(x, y);
+      ASSERT_TRUE(pixel.sample_count >= 4u && pixel.sample_count <= 16u);
+    }
+  }
+}
+
+TEST(VisibilityIntegratorTest, DeterministicAcrossThreadCounts) {
+  std::shared_ptr<liang::Film> film1 = RenderUnitCube(50, 37, 1);
+  std::shared_ptr<liang::Film> film2 = RenderUnitCube(50, 37, 4);
+  AssertFilmsIdentical(*film1, *film2);
+}
+
+// Asserts that a tile order visits every tile of the grid exactly once.
+static void AssertIsPermutation(const std::vector<uint> &order, uint tiles_x, uint tiles_y) {
+  ASSERT_EQ(tiles_x * tiles_y, order.size());
+  std::vector<bool> visited(tiles_x * tiles_y, false);
+  for (uint tile_index : order) {
+    ASSERT_LT(tile_index, tiles_x * tiles_y);
+    ASSERT_FALSE(visited[tile_index]);
+    visited[tile_index] = true;
+  }
+}
+
+TEST(TileOrderTest, Permutations) {
+  std::vector<std::shared_ptr<liang::TileOrder>> tile_orders = {
+      std::make_shared<liang::ScanlineTileOrder>(), std::make_shared<liang::MortonTileOrder>(),
+      std::make_shared<liang::HilbertTileOrder>(), std::make_shared<liang::SpiralTileOrder>()};
+  for (auto tile_order : tile_orders) {
+    AssertIsPermutation(tile_order->Order(1, 1), 1, 1);
+    AssertIsPermutation(tile_order->Order(8, 8), 8, 8);
+    AssertIsPermutation(tile_order->Order(5, 3), 5, 3);
+    AssertIsPermutation(tile_order->Order(2, 9), 2, 9);
+  }
+}
+
+TEST(TileOrderTest, Morton) {
+  std::vector<uint> expected = {0, 1, 4, 5, 2, 3, 6, 7};
+  ASSERT_EQ(expected, liang::MortonTileOrder().Order(4, 2));
+}
+
+TEST(TileOrderTest, HilbertAdjacency) {
+  std::vector<uint> order = liang::HilbertTileOrder().Order(16, 16);
+  for (uint i = 1; i < order.size(); i++) {
+    int dx = std::abs((int)(order[i] % 16) - (int)(order[i - 1] % 16));
+    int dy = std::abs((int)(order[i] / 16) - (int)(order[i - 1] / 16));
+    ASSERT_EQ(1, dx + dy);
+  }
+}
+
+TEST(TileOrderTest, Spiral) {
+  std::vector<uint> expected = {4, 5, 8, 7, 6, 3, 0, 1, 2};
+  ASSERT_EQ(expected, liang::SpiralTileOrder().Order(3, 3));
+}
+
+TEST(VisibilityIntegratorTest, TileOrderDoesNotChangeOutput) {
+  std::shared_ptr<liang::Film> film1 = RenderUnitCube(50, 37, 2);
+  std::shared_ptr<liang::Film> film2 = RenderUnitCube(50, 37, 2,
+      std::make_shared<liang::HilbertTileOrder>());
+  AssertFilmsIdentical(*film1, *film2);
+}
+
+// A TiledImageWriter that keeps the image in memory and tracks how many tiles the stream feeding it
+// holds at once.
+class MemoryTiledWriter : public liang::TiledImageWriter {
+  public:
+    // The stream writing to the writer.
+    const liang::FilmTileStream *stream;
+    // Interleaved RGB values of the whole image.
+    std::vector<float> rgb;
+    // The number of times each tile has been written.
+    std::vector<uint> write_counts;
+    // The most tiles the stream has held at once.
+    uint max_buffered_tiles;
+
+    MemoryTiledWriter(uint width, uint height, uint tile_size) :
+        liang::TiledImageWriter(width, height, tile_size), stream{nullptr},
+        rgb(width * height * 3), write_counts(NumTilesX() * NumTilesY()),
+        max_buffered_tiles{0} {}
+
+    bool WriteTile(uint tile_x, uint tile_y, const float *tile_rgb) {
+      write_counts[tile_y * NumTilesX() + tile_x]++;
+      max_buffered_tiles = std::max(max_buffered_tiles, stream->NumBufferedTiles());
+      uint min_x = tile_x * tile_size;
+      uint min_y = tile_y * tile_size;
+      uint tile_width = std::min(tile_size, width - min_x);
+      uint tile_height = std::min(tile_size, height - min_y);
+      for (uint y = 0; y < tile_height; y++) {
+        std::copy(tile_rgb + y * tile_width * 3, tile_rgb + (y + 1) * tile_width * 3,
+            rgb.begin() + ((min_y + y) * width + min_x) * 3);
+      }
+      return true;
+    }
+
+    bool Close() {
+      return true;
+    }
+};
+
+TEST(VisibilityIntegratorTest, RenderToStream) {
+  std::shared_ptr<liang::Film> expected = RenderUnitCube(70, 53, 2,
+      std::make_shared<liang::HilbertTileOrder>());
+  UnitCubeRender render = CreateUnitCubeRender(70, 53, 2);
+  render.integrator->SetTileOrder(std::make_shared<liang::HilbertTileOrder>());
+  MemoryTiledWriter writer(70, 53, 8);
+  liang::FilmTileStream stream(*render.film, liang::Integrator::TILE_SIZE, &writer);
+  writer.stream = &stream;
+  ASSERT_TRUE(render.integrator->Render(*render.scene, &stream));
+  ASSERT_EQ(0u, stream.NumBufferedTiles());
+  for (uint count : writer.write_counts) {
+    ASSERT_EQ(1u, count);
+  }
+  // Only the tiles around the frontier of the render are ever held.
+  ASSERT_LT(writer.max_buffered_tiles, writer.write_counts.size());
+  for (uint y = 0; y < 53; y++) {
+    for (uint x = 0; x < 70; x++) {
+      liang::Pixel pixel = expected->GetPixel(x, y);
+      float inverse_weight = pixel.weight_sum > 0.f ? 1.f / pixel.weight_sum : 0.f;
+      ASSERT_EQ(pixel.r * inverse_weight, writer.rgb[(y * 70 + x) * 3]);
+      ASSERT_EQ(pixel.b * inverse_weight, writer.rgb[(y * 70 + x) * 3 + 2]);
+    }
+  }
+  // The film itself was never written to.
+  ASSERT_EQ(0.f, render.film->GetPixel(35, 26).weight_sum);
+}
+
+TEST(VisibilityIntegratorTest, CheckpointResume) {
+  const std::string checkpoint_name = "integrator_test_checkpoint.bin";
+  std::remove(checkpoint_name.c_str());
+  std::shared_ptr<liang::Film> expected = RenderUnitCube(50, 37, 2);
+
+  // Simulate a render that was killed after five tiles by merging them by hand.
+  UnitCubeRender killed = CreateUnitCubeRender(50, 37, 2);
+  killed.integrator->SetCheckpoint(checkpoint_name, 0.0);
+  for (uint i = 0; i < 5; i++) {
+    auto sampler = std::unique_ptr<liang::Sampler>(new liang::RandomSampler(16, 7));
+    liang::AdaptiveSampler adaptive_sampler(std::move(sampler), 4, 0.05f);
+    killed.film->MergeFilmTile(*killed.integrator->RenderTile(*killed.scene, i,
+        &adaptive_sampler));
+  }
+  ASSERT_TRUE(killed.film->SaveCheckpoint(checkpoint_name,
+      killed.integrator->CheckpointFingerprint(), 5));
+
+  // A render with a different seed must not pick up the checkpoint.
+  UnitCubeRender other = CreateUnitCubeRender(50, 37, 2, 8);
+  uint tiles_merged = 0;
+  ASSERT_FALSE(other.film->LoadCheckpoint(checkpoint_name,
+      other.integrator->CheckpointFingerprint(), &tiles_merged));
+
+  UnitCubeRender resumed = CreateUnitCubeRender(50, 37, 3);
+  resumed.integrator->SetCheckpoint(checkpoint_name, 0.0);
+  resumed.integrator->Render(*resumed.scene);
+  AssertFilmsIdentical(*expected, *resumed.film);
+  ASSERT_TRUE(resumed.film->LoadCheckpoint(checkpoint_name,
+      resumed.integrator->CheckpointFingerprint(), &tiles_merged));
+  ASSERT_EQ(resumed.integrator->NumTiles(), tiles_merged);
+
+  // A checkpoint claiming more tiles than the film has is stale, so the render starts over.
+  ASSERT_TRUE(resumed.film->SaveCheckpoint(checkpoint_name,
+      resumed.integrator->CheckpointFingerprint(), resumed.integrator->NumTiles() + 1));
+  UnitCubeRender restarted = CreateUnitCubeRender(50, 37, 3);
+  restarted.integrator->SetCheckpoint(checkpoint_name, 0.0);
+  restarted.integrator->Render(*restarted.scene);
+  AssertFilmsIdentical(*expected, *restarted.film);
+  std::remove(checkpoint_name.c_str());
+}
+
+TEST(RenderFarmTest, MatchesLocalRender) {
+  std::shared_ptr<liang::Film> expected = RenderUnitCube(50, 37, 1);
+  UnitCubeRender coordinator_render = CreateUnitCubeRender(50, 37, 1);
+  liang::RenderCoordinator coordinator(coordinator_render.integrator);
+  uint16_t port = coordinator.GetPort();
+  ASSERT_NE(0, port);
+
+  // A worker set up with a different seed is turned away before it renders anything.
+  std::thread coordinator_thread([&] { coordinator.Run(); });
+  UnitCubeRender other = CreateUnitCubeRender(50, 37, 1, 8);
+  ASSERT_FALSE(liang::RunRenderWorker(*other.integrator, *other.scene, "127.0.0.1", port));
+
+  // Each worker builds its own scene and film, just as a separate process would.
+  std::vector<bool> results(3, false);
+  std::vector<std::thread> worker_threads;
+  for (uint i = 0; i < results.size(); i++) {
+    worker_threads.emplace_back([&, i] {
+      UnitCubeRender worker = CreateUnitCubeRender(50, 37, 1);
+      results[i] = liang::RunRenderWorker(*worker.integrator, *worker.scene, "127.0.0.1", port);
+    });
+  }
+  for (std::thread &thread : worker_threads) {
+    thread.join();
+  }
+  coordinator_thread.join();
+  for (bool result : results) {
+    ASSERT_TRUE(result);
+  }
+  AssertFilmsIdentical(*expected, *coordinator_render.film);
+}
+
+TEST(RenderFarmTest, RedispatchesStalledTile) {
+  std::shared_ptr<liang::Film> expected = RenderUnitCube(50, 37, 1);
+  UnitCubeRender coordinator_render = CreateUnitCubeRender(50, 37, 1);
+  liang::RenderCoordinator coordinator(coordinator_render.integrator, 0, 200);
+  uint16_t port = coordinator.GetPort();
+  ASSERT_NE(0, port);
+  std::thread coordinator_thread([&] { coordinator.Run(); });
+
+  // A worker that takes a tile and then goes quiet, speaking the farm's wire format by hand.
+  struct {
+    uint32_t type;
+    uint32_t dispatch_index;
+    uint64_t value;
+  } message = {1, 0, coordinator_render.integrator->CheckpointFingerprint()};
+  int stalled_socket = liang::ConnectToHost("127.0.0.1", port);
+  ASSERT_GE(stalled_socket, 0);
+  ASSERT_TRUE(liang::SendAll(stalled_socket, &message, sizeof(message)));
+  ASSERT_TRUE(liang::ReceiveAll(stalled_socket, &message, sizeof(message)));
+  ASSERT_EQ(3u, message.type);
+
+  // Once the coordinator gives up on the stalled worker, its tile goes to the next worker.
+  UnitCubeRender worker = CreateUnitCubeRender(50, 37, 1);
+  ASSERT_TRUE(liang::RunRenderWorker(*worker.integrator, *worker.scene, "127.0.0.1", port));
+  coordinator_thread.join();
+  ASSERT_FALSE(liang::ReceiveAll(stalled_socket, &message, sizeof(message)));
+  liang::CloseSocket(stalled_socket);
+  AssertFilmsIdentical(*expected, *coordinator_render.film);
+}
+
+// A VisibilityIntegrator that stalls for a while the first time it shades a ray, like a worker
+// rendering a heavy tile would.
+class SlowVisibilityIntegrator : public liang::VisibilityIntegrator {
+  public:
+    // SlowVisibilityIntegrator constructor that takes the camera, the sampler, and how long to
+    // stall for.
+    SlowVisibilityIntegrator(std::shared_ptr<const liang::Camera> camera,
+        std::shared_ptr<liang::Sampler> sampler, int stall_ms) :
+        liang::VisibilityIntegrator(camera, sampler), stall_ms{stall_ms}, stalled{false} {}
+
+    // Returns the same radiance as VisibilityIntegrator::Li(), stalling on the first call.
+    float Li(const liang::RayDifferential &ray, const liang::Scene &scene) const {
+      if (!stalled.exchange(true)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+      }
+      return liang::VisibilityIntegrator::Li(ray, scene);
+    }
+
+  private:
+    // How long to stall for.
+    int stall_ms;
+    // Whether the stall has happened yet.
+    mutable std::atomic<bool> stalled;
+};
+
+TEST(RenderFarmTest, KeepsSlowWorkerAlive) {
+  std::shared_ptr<liang::Film> expected = RenderUnitCube(50, 37, 1);
+  UnitCubeRender coordinator_render = CreateUnitCubeRender(50, 37, 1);
+  liang::RenderCoordinator coordinator(coordinator_render.integrator, 0, 200);
+  uint16_t port = coordinator.GetPort();
+  ASSERT_NE(0, port);
+  std::thread coordinator_thread([&] { coordinator.Run(); });
+
+  // The first tile takes several timeouts to render, but heartbeats keep the worker connected.
+  UnitCubeRender worker = CreateUnitCubeRender(50, 37, 1);
+  SlowVisibilityIntegrator slow_integrator(worker.camera, worker.sampler, 1000);
+  bool slow_result = liang::RunRenderWorker(slow_integrator, *worker.scene, "127.0.0.1", port,
+      20);
+  if (!slow_result) {
+    // Finish the render so the coordinator can be joined before failing.
+    UnitCubeRender rescue = CreateUnitCubeRender(50, 37, 1);
+    liang::RunRenderWorker(*rescue.integrator, *rescue.scene, "127.0.0.1", port);
+  }
+  coordinator_thread.join();
+  ASSERT_TRUE(slow_result);
+  AssertFilmsIdentical(*expected, *coordinator_render.film);
+}
+
+// Asserts that two films hold the same extra channels with bit identical values.
+static void AssertChannelsIdentical(const liang::Film &film1, const liang::Film &film2) {
+  ASSERT_EQ(film1.NumChannels(), film2.NumChannels());
+  for (uint channel = 0; channel < film1.NumChannels(); channel++) {
+    ASSERT_EQ(film1.GetChannel(channel).name, film2.GetChannel(channel).name);
+    for (uint y = 0; y < film1.height; y++) {
+      for (uint x = 0; x < film1.width; x++) {
+        ASSERT_EQ(film1.GetChannelValue(channel, x, y), film2.GetChannelValue(channel, x, y));
+      }
+    }
+  }
+}
+
+// The AOVs recorded by the AOV tests.
+static const std::vector<liang::Aov> ALL_AOVS = {liang::Aov::DEPTH, liang::Aov::NORMAL,
+    liang::Aov::PRIMITIVE_ID, liang::Aov::RAY_COUNT};
+
+TEST(VisibilityIntegratorTest, RenderAovs) {
+  UnitCubeRender render = CreateUnitCubeRender(16, 16, 4);
+  render.integrator->SetAovs(ALL_AOVS);
+  ASSERT_EQ(6u, render.film->NumChannels());
+  render.integrator->Render(*render.scene);
+  // Recording AOVs leaves the color untouched.
+  AssertFilmsIdentical(*RenderUnitCube(16, 16, 1), *render.film);
+
+  const liang::Film &film = *render.film;
+  // The center of the image looks at the cube around the corner nearest the camera.
+  ASSERT_GT(film.GetChannelValue(0, 8, 8), std::sqrt(3.f) * 2.5f - 0.001f);
+  ASSERT_LT(film.GetChannelValue(0, 8, 8), 5.f);
+  ASSERT_EQ(0.f, film.GetChannelValue(4, 8, 8));
+  ASSERT_EQ(0.f, film.GetChannelValue(0, 0, 0));
+  ASSERT_EQ(-1.f, film.GetChannelValue(4, 0, 0));
+  for (uint y = 0; y < 16; y++) {
+    for (uint x = 0; x < 16; x++) {
+      ASSERT_EQ((float)film.GetPixel(x, y).sample_count, film.GetChannelValue(5, x, y));
+      // Pixels entirely on one face of the cube have that face's normal.
+      if (film.GetPixel(x, y).r == film.GetPixel(x, y).weight_sum) {
+        liang::Normal3f normal(film.GetChannelValue(1, x, y), film.GetChannelValue(2, x, y),
+            film.GetChannelValue(3, x, y));
+        ASSERT_GT(normal.x + normal.y + normal.z, 0.99f);
+      }
+    }
+  }
+}
+
+// A VisibilityIntegrator that counts its calls to Li() and pretends to trace two more rays from
+// every hit.
+class RayCountingIntegrator : public liang::VisibilityIntegrator {
+  public:
+    // The number of times Li() was called.
+    mutable std::atomic<uint> li_calls;
+
+    // RayCountingIntegrator constructor that takes the camera and the sampler.
+    RayCountingIntegrator(std::shared_ptr<const liang::Camera> camera,
+        std::shared_ptr<liang::Sampler> sampler) :
+        liang::VisibilityIntegrator(camera, sampler), li_calls{0} {}
+
+    // Returns the same radiance as VisibilityIntegrator::Li(), counting the call.
+    float Li(const liang::RayDifferential &ray, const liang::Scene &scene) const {
+      li_calls++;
+      return liang::VisibilityIntegrator::Li(ray, scene);
+    }
+
+    // Returns the same radiance as VisibilityIntegrator::ShadeFirstHit(), counting two rays for
+    // every hit.
+    float ShadeFirstHit(const liang::RayDifferential &ray, const liang::Intersection *intersection,
+        const liang::Scene &scene, uint *ray_count) const {
+      if (intersection) {
+        *ray_count += 2;
+      }
+      return liang::VisibilityIntegrator::ShadeFirstHit(ray, intersection, scene, ray_count);
+    }
+};
+
+TEST(VisibilityIntegratorTest, AovsShadeTracedFirstHit) {
+  UnitCubeRender render = CreateUnitCubeRender(16, 16, 4);
+  RayCountingIntegrator integrator(render.camera, render.sampler);
+  integrator.SetAovs(ALL_AOVS);
+  integrator.Render(*render.scene);
+  AssertFilmsIdentical(*RenderUnitCube(16, 16, 1), *render.film);
+  // The first hit is shaded where it was traced rather than tracing the camera ray again.
+  ASSERT_EQ(0u, integrator.li_calls.load());
+  // The rays traced past the first hit are counted along with the camera rays.
+  const liang::Film &film = *render.film;
+  ASSERT_EQ(3.f * film.GetPixel(8, 8).sample_count, film.GetChannelValue(5, 8, 8));
+  ASSERT_EQ((float)film.GetPixel(0, 0).sample_count, film.GetChannelValue(5, 0, 0));
+}
+
+TEST(RenderFarmTest, MatchesLocalRenderWithAovs) {
+  UnitCubeRender expected = CreateUnitCubeRender(50, 37, 1);
+  expected.integrator->SetAovs(ALL_AOVS);
+  expected.integrator->Render(*expected.scene);
+  UnitCubeRender coordinator_render = CreateUnitCubeRender(50, 37, 1);
+  coordinator_render.integrator->SetAovs(ALL_AOVS);
+  liang::RenderCoordinator coordinator(coordinator_render.integrator);
+  uint16_t port = coordinator.GetPort();
+  ASSERT_NE(0, port);
+  std::thread coordinator_thread([&] { coordinator.Run(); });
+  // A worker that doesn't record the same AOVs is turned away.
+  UnitCubeRender other = CreateUnitCubeRender(50, 37, 1);
+  ASSERT_FALSE(liang::RunRenderWorker(*other.integrator, *other.scene, "127.0.0.1", port));
+  UnitCubeRender worker = CreateUnitCubeRender(50, 37, 1);
+  worker.integrator->SetAovs(ALL_AOVS);
+  ASSERT_TRUE(liang::RunRenderWorker(*worker.integrator, *worker.scene, "127.0.0.1", port));
+  coordinator_thread.join();
+  AssertFilmsIdentical(*expected.film, *coordinator_render.film);
+  AssertChannelsIdentical(*expected.film, *coordinator_render.film);
+}
+
+// Checks every pixel of a visibility buffer of the unit cube against the ray traced through the
+// pixel's center, and returns the number of pixels where one hit and the other missed. Where both
+// hit, the rasterized hit must be the traced hit point.
+static uint CountRasterMismatches(const liang::VisibilityBuffer &visibility_buffer,
+    const liang::PerspectiveCamera &camera, const liang::Mesh &mesh, const liang::Scene &scene) {
+  std::shared_ptr<liang::Film> film = camera.GetFilm();
+  const liang::TriangleVertex *vertices = mesh.vertices.get();
+  uint mismatches = 0;
+  for (uint y = 0; y < film->height; y++) {
+    for (uint x = 0; x < film->width; x++) {
+      liang::Ray3f ray;
+      camera.GenerateRay(liang::Point2f(x + 0.5f, y + 0.5f), &ray);
+      liang::Intersection intersection;
+      bool traced_hit = scene.Intersect(ray, &intersection);
+      const liang::VisibilitySample &sample = visibility_buffer.GetSample(x, y);
+      bool rasterized_hit = sample.triangle != liang::VisibilityBuffer::NO_TRIANGLE;
+      if (traced_hit != rasterized_hit) {
+        mismatches++;
+        continue;
+      }
+      if (!traced_hit) {
+        continue;
+      }
+      // The unit cube doesn't share vertices between triangles.
+      const liang::Point3f &p0 = vertices[sample.triangle * 3].position;
+      const liang::Point3f &p1 = vertices[sample.triangle * 3 + 1].position;
+      const liang::Point3f &p2 = vertices[sample.triangle * 3 + 2].position;
+      float b0 = 1.f - sample.b1 - sample.b2;
+      liang::Point3f rasterized = (*mesh.object_to_world)(liang::Point3f(
+          b0 * p0.x + sample.b1 * p1.x + sample.b2 * p2.x,
+          b0 * p0.y + sample.b1 * p1.y + sample.b2 * p2.y,
+          b0 * p0.z + sample.b1 * p1.z + sample.b2 * p2.z));
+      liang::Point3f traced = ray(intersection.t);
+      EXPECT_NEAR(traced.x, rasterized.x, 1e-3f);
+      EXPECT_NEAR(traced.y, rasterized.y, 1e-3f);
+      EXPECT_NEAR(traced.z, rasterized.z, 1e-3f);
+      EXPECT_GT(sample.depth, 0.f);
+      EXPECT_LE(sample.depth, intersection.t * 1.0001f);
+    }
+  }
+  return mismatches;
+}
+
+TEST(VisibilityBufferTest, MatchesTracedPrimaryHits) {
+  UnitCubeRender render = CreateUnitCubeRender(64, 48, 4);
+  liang::VisibilityBuffer visibility_buffer(render.camera, {{render.mesh, 0}}, 4);
+  ASSERT_EQ(12u, visibility_buffer.NumTriangles());
+  // Only pixel centers right on the silhouette can disagree.
+  ASSERT_LE(CountRasterMismatches(visibility_buffer, *render.camera, *render.mesh,
+      *render.scene), 4u);
+  ASSERT_EQ(liang::VisibilityBuffer::NO_TRIANGLE, visibility_buffer.GetSample(0, 0).triangle);
+  ASSERT_NE(liang::VisibilityBuffer::NO_TRIANGLE, visibility_buffer.GetSample(32, 24).triangle);
+}
+
+TEST(VisibilityBufferTest, ClipsAgainstNearPlane) {
+  // From the center of the cube, every triangle crosses behind the camera.
+  UnitCubeRender render = CreateUnitCubeRender(32, 32, 1);
+  liang::Transform world_to_camera = liang::LookAtTransform(liang::Vector3f(0.1f, 0.f, 0.f),
+      liang::Vector3f(1.f, 0.3f, 0.2f), liang::Vector3f(0.f, 0.f, 1.f));
+  auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, render.film, 90.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  liang::VisibilityBuffer visibility_buffer(camera, {{render.mesh, 0}}, 2);
+  ASSERT_EQ(0u, CountRasterMismatches(visibility_buffer, *camera, *render.mesh, *render.scene));
+}
+
+TEST(VisibilityBufferTest, LooksUpPixelCenters) {
+  UnitCubeRender render = CreateUnitCubeRender(64, 48, 1);
+  liang::VisibilityBuffer visibility_buffer(render.camera, {{render.mesh, 0}}, 1);
+  for (uint y = 0; y < 48; y++) {
+    for (uint x = 0; x < 64; x++) {
+      liang::Point2f center(x + 0.5f, y + 0.5f);
+      liang::RayDifferential traced_ray, looked_up_ray;
+      render.camera->GenerateRayDifferential(center, &traced_ray);
+      render.camera->GenerateRayDifferential(center, &looked_up_ray);
+      liang::Intersection traced, looked_up;
+      if (!render.scene->Intersect(traced_ray, &traced) ||
+          !visibility_buffer.Intersect(looked_up_ray, center, *render.scene, &looked_up)) {
+        continue;
+      }
+      ASSERT_NEAR(traced.t, looked_up.t, 1e-3f);
+      ASSERT_NEAR(traced.normal.x, looked_up.normal.x, 1e-4f);
+      ASSERT_NEAR(traced.normal.y, looked_up.normal.y, 1e-4f);
+      ASSERT_NEAR(traced.normal.z, looked_up.normal.z, 1e-4f);
+      ASSERT_EQ(traced.primitive_id, looked_up.primitive_id);
+    }
+  }
+  // Moving the cube out of view after rasterizing it shows which lookups intersect it again.
+  liang::Point2f center(32.5f, 24.5f);
+  liang::RayDifferential ray;
+  render.camera->GenerateRayDifferential(center, &ray);
+  liang::Intersection before;
+  ASSERT_TRUE(visibility_buffer.Intersect(ray, center, *render.scene, &before));
+  for (uint i = 0; i < render.mesh->num_vertices; i++) {
+    render.mesh->vertices.get()[i].position.z += 100.f;
+  }
+  render.camera->GenerateRayDifferential(center, &ray);
+  liang::Intersection after;
+  ASSERT_TRUE(visibility_buffer.Intersect(ray, center, *render.scene, &after));
+  ASSERT_EQ(before.t, after.t);
+  liang::Point2f off_center(32.25f, 24.25f);
+  render.camera->GenerateRayDifferential(off_center, &ray);
+  ASSERT_FALSE(visibility_buffer.Intersect(ray, off_center, *render.scene, &after));
+}
+
+// Returns the sum of the normalized values of every pixel of the film.
+static float SumFilm(const liang::Film &film) {
+  float sum = 0.f;
+  for (uint y = 0; y < film.height; y++) {
+    for (uint x = 0; x < film.width; x++) {
+      liang::Pixel pixel = film.GetPixel(x, y);
+      sum += pixel.weight_sum > 0.f ? pixel.r / pixel.weight_sum : 0.f;
+    }
+  }
+  return sum;
+}
+
+TEST(VisibilityIntegratorTest, MotionBlurSamplesTime) {
+  UnitCubeRender still = CreateUnitCubeRender(32, 24, 2);
+  UnitCubeRender blurred = CreateUnitCubeRender(32, 24, 2);
+  // The cube rises out of view while the shutter is open, which thins it out on the film.
+  liang::AnimatedTransform cube_to_world(liang::AffineTransform(), 0.f,
+      liang::AffineTransform(liang::TranslationTransform(liang::Vector3f(0.f, 0.f, 4.f))), 1.f);
+  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims =
+      liang::CreateGeometricPrimitives(liang::CreateTriangles(blurred.mesh));
+  std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
+  std::vector<std::shared_ptr<liang::Primitive>> animated = {
+      std::make_shared<liang::AnimatedPrimitive>(
+          std::make_shared<liang::AggregatePrimitive>(prims), &cube_to_world)};
+  liang::Scene scene(std::make_shared<liang::MotionBVH>(animated, 0.f, 1.f));
+  blurred.camera->SetShutter(0.f, 1.f);
+  ASSERT_NE(still.integrator->CheckpointFingerprint(),
+      blurred.integrator->CheckpointFingerprint());
+  still.integrator->Render(*still.scene);
+  blurred.integrator->Render(scene);
+  float still_sum = SumFilm(*still.film);
+  float blurred_sum = SumFilm(*blurred.film);
+  ASSERT_GT(blurred_sum, 0.f);
+  ASSERT_LT(blurred_sum, 0.8f * still_sum);
+}
+
+TEST(VisibilityIntegratorTest, RasterizedPrimaryHitsMatchTracing) {
+  UnitCubeRender traced = CreateUnitCubeRender(50, 37, 4);
+  traced.integrator->SetAovs({liang::Aov::PRIMITIVE_ID});
+  traced.integrator->Render(*traced.scene);
+  UnitCubeRender rasterized = CreateUnitCubeRender(50, 37, 4);
+  rasterized.integrator->SetAovs({liang::Aov::PRIMITIVE_ID});
+  auto visibility_buffer = std::make_shared<liang::VisibilityBuffer>(rasterized.camera,
+      std::vector<liang::RasterMesh>{{rasterized.mesh, 0}});
+  rasterized.integrator->SetVisibilityBuffer(visibility_buffer);
+  ASSERT_NE(traced.integrator->CheckpointFingerprint(),
+      rasterized.integrator->CheckpointFingerprint());
+  rasterized.integrator->Render(*rasterized.scene);
+  AssertFilmsIdentical(*traced.film, *rasterized.film);
+  AssertChannelsIdentical(*traced.film, *rasterized.film);
+}
+
+// Renders a frame of the unit cube scene from the given eye position with a reprojection cache,
+// recording the number of rays traced for every pixel. Returns the film.
+static std::shared_ptr<liang::Film> RenderFrameWithCache(const liang::Scene &scene,
+    const liang::Vector3f &eye, std::shared_ptr<liang::ReprojectionCache> cache,
+    std::unique_ptr<liang::Filter> filter =
+    std::unique_ptr<liang::Filter>(new liang::BoxFilter(0.5f))) {
+  liang::Transform world_to_camera = liang::LookAtTransform(eye, liang::Vector3f(0.f, 0.f, 0.f),
+      liang::Vector3f(0.f, 0.f, 1.f));
+  auto film = std::make_shared<liang::Film>(40, 30, std::move(filter));
+  auto camera = std::make_shared<liang::PerspectiveCamera>(world_to_camera, film, 45.f,
+      liang::Point2f(-1.f, -1.f), liang::Point2f(1.f, 1.f));
+  auto sampler = std::make_shared<liang::RandomSampler>(8);
+  liang::VisibilityIntegrator integrator(camera, sampler, 4);
+  integrator.SetAovs({liang::Aov::RAY_COUNT});
+  integrator.SetReprojectionCache(cache);
+  integrator.Render(scene);
+  return film;
+}
+
+// Returns the total number of rays recorded in a film rendered by RenderFrameWithCache().
+static float TotalRays(const liang::Film &film) {
+  float total = 0.f;
+  for (uint y = 0; y < film.height; y++) {
+    for (uint x = 0; x < film.width; x++) {
+      total += film.GetChannelValue(0, x, y);
+    }
+  }
+  return total;
+}
+
+TEST(ReprojectionCacheTest, ReusesUnchangedPixels) {
+  UnitCubeRender render = CreateUnitCubeRender(1, 1, 1);
+  auto cache = std::make_shared<liang::ReprojectionCache>();
+  liang::Vector3f eye(3.01f, 3.f, 3.f);
+  std::shared_ptr<liang::Film> first = RenderFrameWithCache(*render.scene, eye, cache);
+  ASSERT_EQ(0u, cache->NumReusedPixels());
+  std::shared_ptr<liang::Film> second = RenderFrameWithCache(*render.scene, eye, cache);
+  // From the same viewpoint, every pixel reprojects onto itself.
+  ASSERT_EQ(40u * 30u, cache->NumReusedPixels());
+  ASSERT_EQ(40.f * 30.f, TotalRays(*second));
+  ASSERT_EQ(8.f * 40.f * 30.f, TotalRays(*first));
+  for (uint y = 0; y < 30; y++) {
+    for (uint x = 0; x < 40; x++) {
+      liang::Pixel expected = first->GetPixel(x, y);
+      liang::Pixel reused = second->GetPixel(x, y);
+      ASSERT_FLOAT_EQ(expected.r / expected.weight_sum, reused.r / reused.weight_sum);
+    }
+  }
+}
+
+TEST(ReprojectionCacheTest, ReusesColorsUnfilteredWithWideFilter) {
+  UnitCubeRender render = CreateUnitCubeRender(1, 1, 1);
+  auto cache = std::make_shared<liang::ReprojectionCache>();
+  liang::Vector3f eye(3.01f, 3.f, 3.f);
+  std::shared_ptr<liang::Film> first = RenderFrameWithCache(*render.scene, eye, cache,
+      std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f)));
+  // Every pixel of the later frames is reused, so none of them are filtered again.
+  for (uint frame = 0; frame < 3; frame++) {
+    std::shared_ptr<liang::Film> reused = RenderFrameWithCache(*render.scene, eye, cache,
+        std::unique_ptr<liang::Filter>(new liang::MitchellFilter(2.f)));
+    ASSERT_EQ(40u * 30u, cache->NumReusedPixels());
+    ASSERT_EQ(40.f * 30.f, TotalRays(*reused));
+    for (uint y = 0; y < 30; y++) {
+      for (uint x = 0; x < 40; x++) {
+        liang::Pixel expected = first->GetPixel(x, y);
+        liang::Pixel pixel = reused->GetPixel(x, y);
+        ASSERT_FLOAT_EQ(expected.weight_sum, pixel.weight_sum);
+        ASSERT_NEAR(expected.r / expected.weight_sum, pixel.r / pixel.weight_sum, 1e-5f);
+      }
+    }
+  }
+}
+
+TEST(ReprojectionCacheTest, RerendersChangedPixels) {
+  UnitCubeRender render = CreateUnitCubeRender(1, 1, 1);
+  auto cache = std::make_shared<liang::ReprojectionCache>();
+  RenderFrameWithCache(*render.scene, liang::Vector3f(3.01f, 3.f, 3.f), cache);
+  liang::Vector3f eye(3.2f, 2.8f, 3.f);
+  std::shared_ptr<liang::Film> moved = RenderFrameWithCache(*render.scene, eye, cache);
+  // Most of the background and the faces of the cube are still visible, but the pixels that
+  // moved onto or off of the cube and those nothing reprojected onto are rendered again.
+  uint reused = cache->NumReusedPixels();
+  ASSERT_GT(reused, 40u * 30u / 2);
+  ASSERT_LT(reused, 40u * 30u);
+  // Reused pixels still agree with what their centers see. Colors reused from pixels on the
+  // silhouette can be partly covered, but never entirely wrong.
+  liang::PerspectiveCamera camera(liang::LookAtTransform(eye, liang::Vector3f(0.f, 0.f, 0.f),
+      liang::Vector3f(0.f, 0.f, 1.f)), moved, 45.f, liang::Point2f(-1.f, -1.f),
+      liang::Point2f(1.f, 1.f));
+  for (uint y = 0; y < 30; y++) {
+    for (uint x = 0; x < 40; x++) {
+      if (moved->GetChannelValue(0, x, y) != 1.f) {
+        continue;
+      }
+      liang::Ray3f ray;
+      camera.GenerateRay(liang::Point2f(x + 0.5f, y + 0.5f), &ray);
+      liang::Pixel pixel = moved->GetPixel(x, y);
+      if (render.scene->Intersect(ray)) {
+        ASSERT_GT(pixel.r, 0.f);
+      } else {
+        ASSERT_LT(pixel.r, pixel.weight_sum);
+      }
+    }
+  }
+}
+
+TEST(ReprojectionCacheTest, RerendersPixelsPastMaxAge) {
+  UnitCubeRender render = CreateUnitCubeRender(1, 1, 1);
+  auto cache = std::make_shared<liang::ReprojectionCache>(0.01f, 1);
+  liang::Vector3f eye(3.01f, 3.f, 3.f);
+  RenderFrameWithCache(*render.scene, eye, cache);
+  RenderFrameWithCache(*render.scene, eye, cache);
+  ASSERT_EQ(40u * 30u, cache->NumReusedPixels());
+  RenderFrameWithCache(*render.scene, eye, cache);
+  ASSERT_EQ(0u, cache->NumReusedPixels());
+  RenderFrameWithCache(*render.scene, eye, cache);
+  ASSERT_EQ(40u * 30u, cache->NumReusedPixels());
+}
@@ -0,0 +1,38 @@
+#include "utils/numa.h"
+#include "utils/parallel.h"
+#include "tests/util.h"
+#include "tests/test.h"
+
+#include <atomic>
+
+TEST(ParallelTest, ParallelFor) {
+  std::vector<std::atomic<int>> counts(100);
+  for (auto &count : counts) {
+    count = 0;
+  }
+  liang::ParallelFor(100, 4, [&](uint i) { counts[i]++; });
+  for (auto &count : counts) {
+    ASSERT_EQ(1, count);
+  }
+  liang::ParallelFor(100, 3, [&](uint i) { counts[i]++; }, true);
+  for (auto &count : counts) {
+    ASSERT_EQ(2, count);
+  }
+}
+
+TEST(NumaTest, ParseCpuList) {
+  std::vector<uint> cpus = liang::ParseCpuList("0-3,8,10-11\n");
+  std::vector<uint> expected = {0, 1, 2, 3, 8, 10, 11};
+  ASSERT_EQ(expected, cpus);
+  ASSERT_TRUE(liang::ParseCpuList("").empty());
+}
+
+TEST(NumaTest, NumaNodes) {
+  const std::vector<liang::NumaNode> &nodes = liang::GetNumaNodes();
+  ASSERT_FALSE(nodes.empty());
+  for (const liang::NumaNode &node : nodes) {
+    ASSERT_FALSE(node.cpus.empty());
+  }
+  ASSERT_EQ(nodes.front().id, liang::NumaNodeForThread(0, 8).id);
+  ASSERT_EQ(nodes.back().id, liang::NumaNodeForThread(7, 8).id);
+}
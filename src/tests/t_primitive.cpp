@@ -1,9 +1,13 @@
 #include "shapes/mesh.h"
+#include "core/animated_transform.h"
 #include "primitives/aggregate_primitive.h"
+#include "primitives/animated_primitive.h"
 #include "primitives/geometric_primitive.h"
+#include "primitives/motion_bvh.h"
 #include "primitives/primitive.h"
 #include "tests/util.h"
 #include "tests/test.h"
+#include "utils/rng.h"
 
 TEST(GeometricPrimitiveTest, Creation) {
   auto prims = CreateUnitCubePrimitives();
@@ -15,3 +19,117 @@ TEST(AggregatePrimitiveTest, Creation) {
   std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
   ASSERT_NO_THROW({liang::AggregatePrimitive{prims};});
 }
+
+TEST(AggregatePrimitiveTest, ClosestIntersection) {
+  liang::AffineTransform near_transform(
+      liang::TranslationTransform(liang::Vector3f(0.0, 0.0, 2.0)));
+  liang::AffineTransform far_transform(
+      liang::TranslationTransform(liang::Vector3f(0.0, 0.0, -2.0)));
+  auto near_prims = liang::CreateGeometricPrimitives(
+      liang::CreateTriangles(CreateUnitCube(&near_transform)), 1);
+  auto far_prims = liang::CreateGeometricPrimitives(
+      liang::CreateTriangles(CreateUnitCube(&far_transform)), 2);
+  // The far cube comes first so that the closest hit is not simply the first one found.
+  std::vector<std::shared_ptr<liang::Primitive>> prims(far_prims.begin(), far_prims.end());
+  prims.insert(prims.end(), near_prims.begin(), near_prims.end());
+  liang::AggregatePrimitive aggregate(prims);
+  liang::Ray3f ray = liang::Ray3f(liang::Point3f(0.1, 0.2, 5.0), liang::Vector3f(0.0, 0.0, -1.0));
+  liang::Intersection intersection;
+  ASSERT_TRUE(aggregate.Intersect(ray, &intersection));
+  ASSERT_NEAR(2.5f, intersection.t, 0.00001);
+  Normal3FloatEquals(intersection.normal, 0.0, 0.0, 1.0);
+  ASSERT_EQ(1u, intersection.primitive_id);
+  ray = liang::Ray3f(liang::Point3f(0.1, 0.2, -5.0), liang::Vector3f(0.0, 0.0, 1.0));
+  ASSERT_TRUE(aggregate.Intersect(ray, &intersection));
+  ASSERT_NEAR(2.5f, intersection.t, 0.00001);
+  Normal3FloatEquals(intersection.normal, 0.0, 0.0, -1.0);
+  ASSERT_EQ(2u, intersection.primitive_id);
+  ray = liang::Ray3f(liang::Point3f(3.0, 0.2, 5.0), liang::Vector3f(0.0, 0.0, -1.0));
+  ASSERT_FALSE(aggregate.Intersect(ray, &intersection));
+}
+
+TEST(AnimatedPrimitiveTest, IntersectsAtRayTime) {
+  liang::AnimatedTransform cube_to_world(liang::AffineTransform(), 0.f,
+      liang::AffineTransform(liang::TranslationTransform(liang::Vector3f(3.0, 0.0, 0.0))), 1.f);
+  auto geo_prims = CreateUnitCubePrimitives();
+  std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
+  liang::AnimatedPrimitive animated(std::make_shared<liang::AggregatePrimitive>(prims),
+      &cube_to_world);
+  AABB3FloatEquals(animated.WorldBounds(), -0.5, -0.5, -0.5, 3.5, 0.5, 0.5);
+  liang::Ray3f ray(liang::Point3f(3.0, 0.2, 5.0), liang::Vector3f(0.0, 0.0, -2.0),
+      std::numeric_limits<float>::infinity(), 0.f);
+  liang::Intersection intersection;
+  ASSERT_FALSE(animated.Intersect(ray));
+  ASSERT_FALSE(animated.Intersect(ray, &intersection));
+  ray.time = 1.f;
+  ASSERT_TRUE(animated.Intersect(ray));
+  ASSERT_TRUE(animated.Intersect(ray, &intersection));
+  ASSERT_NEAR(2.25f, intersection.t, 0.00001);
+  ASSERT_NEAR(2.25f, ray.max_t, 0.00001);
+  Normal3FloatEquals(intersection.normal, 0.0, 0.0, 1.0);
+  // Halfway through, the cube only covers x from 1 to 2.
+  ray = liang::Ray3f(liang::Point3f(2.4, 0.2, 5.0), liang::Vector3f(0.0, 0.0, -1.0),
+      std::numeric_limits<float>::infinity(), 0.5f);
+  ASSERT_FALSE(animated.Intersect(ray));
+  ray.time = 0.75f;
+  ASSERT_TRUE(animated.Intersect(ray));
+}
+
+TEST(MotionBVHTest, MatchesAggregatePrimitive) {
+  // A grid of cubes, every other one flying and tumbling across the grid while the shutter is
+  // open.
+  std::vector<std::unique_ptr<liang::AffineTransform>> placements;
+  std::vector<std::unique_ptr<liang::AnimatedTransform>> motions;
+  std::vector<std::shared_ptr<liang::Primitive>> prims;
+  for (int i = 0; i < 36; i++) {
+    liang::Vector3f position(i % 6 * 2.f, i / 6 * 2.f, 0.f);
+    if (i % 2 == 0) {
+      placements.emplace_back(new liang::AffineTransform(liang::TranslationTransform(position)));
+      auto cube_prims = liang::CreateGeometricPrimitives(
+          liang::CreateTriangles(CreateUnitCube(placements.back().get())), i);
+      prims.insert(prims.end(), cube_prims.begin(), cube_prims.end());
+      continue;
+    }
+    liang::AffineTransform end(liang::TranslationTransform(liang::Vector3f(10.f, 10.f, 0.f) -
+        position) * liang::RotateArbitraryAxisTransform(liang::Vector3f(1.0, 2.0, 3.0), 2.5f));
+    motions.emplace_back(new liang::AnimatedTransform(liang::AffineTransform(
+        liang::TranslationTransform(position)), 0.f, end, 1.f));
+    auto cube_prims = liang::CreateGeometricPrimitives(liang::CreateTriangles(CreateUnitCube()), i);
+    std::vector<std::shared_ptr<liang::Primitive>> cube(cube_prims.begin(), cube_prims.end());
+    prims.push_back(std::make_shared<liang::AnimatedPrimitive>(
+        std::make_shared<liang::AggregatePrimitive>(cube), motions.back().get()));
+  }
+  liang::AggregatePrimitive aggregate(prims);
+  liang::MotionBVH bvh(prims, 0.f, 1.f);
+  ASSERT_GT(bvh.NumNodes(), 1u);
+  AABB3FloatEquals(bvh.WorldBounds(), aggregate.WorldBounds().min_point.x,
+      aggregate.WorldBounds().min_point.y, aggregate.WorldBounds().min_point.z,
+      aggregate.WorldBounds().max_point.x, aggregate.WorldBounds().max_point.y,
+      aggregate.WorldBounds().max_point.z);
+
+  liang::Rng rng(3);
+  uint num_hits = 0;
+  for (uint i = 0; i < 2000; i++) {
+    liang::Point3f origin(rng.UniformFloat() * 14.f - 2.f, rng.UniformFloat() * 14.f - 2.f, 6.f);
+    liang::Point3f target(rng.UniformFloat() * 12.f - 1.f, rng.UniformFloat() * 12.f - 1.f,
+        rng.UniformFloat() * 2.f - 1.f);
+    float time = rng.UniformFloat();
+    liang::Ray3f expected_ray(origin, target - origin, std::numeric_limits<float>::infinity(),
+        time);
+    liang::Ray3f ray = expected_ray;
+    liang::Intersection expected, actual;
+    bool expected_hit = aggregate.Intersect(expected_ray, &expected);
+    ASSERT_EQ(expected_hit, bvh.Intersect(ray, &actual));
+    ASSERT_EQ(expected_hit, bvh.Intersect(liang::Ray3f(origin, target - origin,
+        std::numeric_limits<float>::infinity(), time)));
+    if (expected_hit) {
+      num_hits++;
+      ASSERT_FLOAT_EQ(expected.t, actual.t);
+      ASSERT_FLOAT_EQ(expected_ray.max_t, ray.max_t);
+      ASSERT_EQ(expected.primitive_id, actual.primitive_id);
+    }
+  }
+  // Make sure the comparison covered plenty of hits and misses alike.
+  ASSERT_GT(num_hits, 200u);
+  ASSERT_LT(num_hits, 1800u);
+}
@@ -0,0 +1,213 @@
+#include "cameras/film.h"
+#include "filters/box_filter.h"
+#include "samplers/adaptive_sampler.h"
+#include "samplers/halton_sampler.h"
+#include "samplers/low_discrepancy.h"
+#include "samplers/random_sampler.h"
+#include "samplers/sampler.h"
+#include "samplers/sobol_sampler.h"
+#include "samplers/stratified_sampler.h"
+#include "utils/rng.h"
+#include "tests/util.h"
+#include "tests/test.h"
+
+TEST(RandomSamplerTest, SampleCount) {
+  liang::RandomSampler sampler(4);
+  sampler.StartPixel(liang::Point2i(3, 5));
+  uint count = 1;
+  while (sampler.StartNextSample()) {
+    count++;
+  }
+  ASSERT_EQ(4u, count);
+  sampler.StartPixel(liang::Point2i(4, 5));
+  ASSERT_EQ(0u, sampler.GetSampleIndex());
+}
+
+TEST(RandomSamplerTest, FilmLocation) {
+  liang::RandomSampler sampler(16);
+  sampler.StartPixel(liang::Point2i(3, 5));
+  do {
+    liang::Point2f location = sampler.GetFilmLocation();
+    ASSERT_TRUE(location.x >= 3.f && location.x < 4.f);
+    ASSERT_TRUE(location.y >= 5.f && location.y < 6.f);
+    float value = sampler.Get1D();
+    ASSERT_TRUE(value >= 0.f && value < 1.f);
+  } while (sampler.StartNextSample());
+}
+
+// Takes every sample of the given pixel and returns the given number of 1D values of each, stored
+// sample major.
+static std::vector<float> TakeSamples(liang::Sampler *sampler, const liang::Point2i &pixel,
+    uint num_dimensions) {
+  std::vector<float> values;
+  sampler->StartPixel(pixel);
+  do {
+    for (uint dimension = 0; dimension < num_dimensions; dimension++) {
+      float value = sampler->Get1D();
+      EXPECT_TRUE(value >= 0.f && value < 1.f);
+      values.push_back(value);
+    }
+  } while (sampler->StartNextSample());
+  return values;
+}
+
+// Returns whether the first count values of the given dimension fall in distinct intervals of
+// width 1 / count.
+static bool IsStratified(const std::vector<float> &values, uint num_dimensions, uint dimension,
+    uint count) {
+  std::vector<bool> hit(count, false);
+  for (uint i = 0; i < count; i++) {
+    uint interval = (uint)(values[i * num_dimensions + dimension] * count);
+    if (hit[interval]) {
+      return false;
+    }
+    hit[interval] = true;
+  }
+  return true;
+}
+
+TEST(StratifiedSamplerTest, OneSamplePerStratum) {
+  liang::StratifiedSampler sampler(4, 2);
+  ASSERT_EQ(8u, sampler.samples_per_pixel);
+  std::vector<bool> cells(8, false);
+  std::vector<float> values;
+  sampler.StartPixel(liang::Point2i(7, 2));
+  do {
+    liang::Point2f point = sampler.Get2D();
+    ASSERT_TRUE(point.x >= 0.f && point.x < 1.f && point.y >= 0.f && point.y < 1.f);
+    uint cell = (uint)(point.y * 2) * 4 + (uint)(point.x * 4);
+    ASSERT_FALSE(cells[cell]);
+    cells[cell] = true;
+    values.push_back(sampler.Get1D());
+  } while (sampler.StartNextSample());
+  ASSERT_TRUE(IsStratified(values, 1, 0, 8));
+}
+
+TEST(StratifiedSamplerTest, CenteredWithoutJitter) {
+  liang::StratifiedSampler sampler(2, 2, false);
+  sampler.StartPixel(liang::Point2i(0, 0));
+  do {
+    liang::Point2f point = sampler.Get2D();
+    ASSERT_TRUE(point.x == 0.25f || point.x == 0.75f);
+    ASSERT_TRUE(point.y == 0.25f || point.y == 0.75f);
+  } while (sampler.StartNextSample());
+}
+
+TEST(HaltonSamplerTest, StratifiesEachDimension) {
+  const uint num_dimensions = 40;
+  liang::HaltonSampler sampler(27);
+  std::vector<float> values = TakeSamples(&sampler, liang::Point2i(3, 9), num_dimensions);
+  // Any prefix of base^k samples of a scrambled radical inverse has one sample per interval.
+  ASSERT_TRUE(IsStratified(values, num_dimensions, 0, 16));
+  ASSERT_TRUE(IsStratified(values, num_dimensions, 1, 27));
+  ASSERT_TRUE(IsStratified(values, num_dimensions, 2, 25));
+  // Dimensions past the precomputed bases shuffle the samples but keep them stratified.
+  ASSERT_TRUE(IsStratified(values, num_dimensions, liang::NUM_HALTON_DIMENSIONS + 1, 27));
+}
+
+TEST(HaltonSamplerTest, DeterministicPerPixel) {
+  liang::HaltonSampler sampler(16, 3);
+  std::vector<float> values = TakeSamples(&sampler, liang::Point2i(5, 6), 4);
+  std::unique_ptr<liang::Sampler> clone = sampler.Clone();
+  TakeSamples(clone.get(), liang::Point2i(1, 1), 4);
+  ASSERT_EQ(values, TakeSamples(clone.get(), liang::Point2i(5, 6), 4));
+  ASSERT_NE(values, TakeSamples(clone.get(), liang::Point2i(6, 5), 4));
+}
+
+TEST(SobolSamplerTest, FilmLocationsFormNet) {
+  liang::SobolSampler sampler(64);
+  sampler.StartPixel(liang::Point2i(11, 4));
+  std::vector<liang::Point2f> points;
+  do {
+    points.push_back(sampler.Get2D());
+  } while (sampler.StartNextSample());
+  // Every elementary interval of area 1 / 64 holds exactly one point.
+  for (uint x_bits = 0; x_bits <= 6; x_bits++) {
+    uint x_cells = 1u << x_bits;
+    uint y_cells = 64 / x_cells;
+    std::vector<bool> hit(64, false);
+    for (const liang::Point2f &point : points) {
+      uint cell = (uint)(point.y * y_cells) * x_cells + (uint)(point.x * x_cells);
+      ASSERT_FALSE(hit[cell]);
+      hit[cell] = true;
+    }
+  }
+}
+
+TEST(SobolSamplerTest, StratifiesEachDimension) {
+  const uint num_dimensions = 20;
+  liang::SobolSampler sampler(32, 7);
+  std::vector<float> values = TakeSamples(&sampler, liang::Point2i(2, 8), num_dimensions);
+  for (uint dimension = 0; dimension < num_dimensions; dimension++) {
+    ASSERT_TRUE(IsStratified(values, num_dimensions, dimension, 32));
+    // Only dimensions with their own generator matrix keep the order of the sequence.
+    if (dimension < liang::NUM_SOBOL_DIMENSIONS) {
+      ASSERT_TRUE(IsStratified(values, num_dimensions, dimension, 8));
+    }
+  }
+}
+
+TEST(SobolSamplerTest, DeterministicPerPixel) {
+  liang::SobolSampler sampler(16);
+  std::vector<float> values = TakeSamples(&sampler, liang::Point2i(5, 6), 4);
+  std::unique_ptr<liang::Sampler> clone = sampler.Clone();
+  TakeSamples(clone.get(), liang::Point2i(1, 1), 4);
+  ASSERT_EQ(values, TakeSamples(clone.get(), liang::Point2i(5, 6), 4));
+  ASSERT_NE(values, TakeSamples(clone.get(), liang::Point2i(6, 5), 4));
+  ASSERT_NE(values, TakeSamples(liang::SobolSampler(16, 1).Clone().get(),
+      liang::Point2i(5, 6), 4));
+}
+
+TEST(AdaptiveSamplerTest, ConvergesOnConstantPixel) {
+  auto random_sampler = std::unique_ptr<liang::Sampler>(new liang::RandomSampler(64));
+  liang::AdaptiveSampler sampler(std::move(random_sampler), 4, 0.05f);
+  ASSERT_EQ(64u, sampler.samples_per_pixel);
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  liang::Film film(1, 1, std::move(filter));
+  sampler.StartPixel(liang::Point2i(0, 0));
+  uint count = 0;
+  do {
+    liang::Point2f location = sampler.GetFilmLocation();
+    film.AddSample(location.x, location.y, 0.5f, 0.5f, 0.5f, 1.f);
+    count++;
+  } while (!sampler.IsConverged(film.GetPixel(0, 0)) && sampler.StartNextSample());
+  ASSERT_EQ(4u, count);
+}
+
+TEST(AdaptiveSamplerTest, SpendsSamplesOnNoisyPixel) {
+  auto random_sampler = std::unique_ptr<liang::Sampler>(new liang::RandomSampler(64));
+  liang::AdaptiveSampler sampler(std::move(random_sampler), 4, 0.01f);
+  auto filter = std::unique_ptr<liang::Filter>(new liang::BoxFilter(1.f));
+  liang::Film film(1, 1, std::move(filter));
+  sampler.StartPixel(liang::Point2i(0, 0));
+  uint count = 0;
+  do {
+    liang::Point2f location = sampler.GetFilmLocation();
+    float value = count % 2 == 0 ? 1.f : 0.f;
+    film.AddSample(location.x, location.y, value, value, value, 1.f);
+    count++;
+  } while (!sampler.IsConverged(film.GetPixel(0, 0)) && sampler.StartNextSample());
+  ASSERT_EQ(64u, count);
+}
+
+// A sampler that always returns the largest value below 1.
+class MaxSampler : public liang::Sampler {
+  public:
+    MaxSampler() : liang::Sampler(1) {}
+    float Get1D() { return liang::ONE_MINUS_EPSILON; }
+    liang::Point2f Get2D() {
+      return liang::Point2f(liang::ONE_MINUS_EPSILON, liang::ONE_MINUS_EPSILON);
+    }
+    std::unique_ptr<liang::Sampler> Clone() const {
+      return std::unique_ptr<liang::Sampler>(new MaxSampler());
+    }
+};
+
+TEST(SamplerTest, FilmLocationStaysInPixel) {
+  MaxSampler sampler;
+  sampler.StartPixel(liang::Point2i(1000, 3));
+  liang::Point2f location = sampler.GetFilmLocation();
+  ASSERT_LT(location.x, 1001.f);
+  ASSERT_GE(location.x, 1000.f);
+  ASSERT_LT(location.y, 4.f);
+}
@@ -9,3 +9,29 @@ TEST(SceneTest, Creation) {
   std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
   ASSERT_NO_THROW({liang::Scene(std::make_shared<liang::AggregatePrimitive>(prims));});
 }
+
+TEST(SceneTest, IntersectDifferentials) {
+  std::vector<std::shared_ptr<liang::GeometricPrimitive>> geo_prims = CreateUnitCubePrimitives();
+  std::vector<std::shared_ptr<liang::Primitive>> prims(geo_prims.begin(), geo_prims.end());
+  liang::Scene scene(std::make_shared<liang::AggregatePrimitive>(prims));
+  liang::RayDifferential ray = liang::RayDifferential(liang::Point3f(0.1, 0.2, 5.0),
+      liang::Vector3f(0.0, 0.0, -1.0));
+  liang::Intersection intersection;
+  ASSERT_TRUE(scene.Intersect(ray, &intersection));
+  ASSERT_FALSE(intersection.has_differentials);
+  ASSERT_EQ(0.f, liang::FootprintWidth(intersection));
+
+  // The offset rays fan out from the same origin and hit the top face 4.5 units away.
+  ray = liang::RayDifferential(liang::Point3f(0.1, 0.2, 5.0), liang::Vector3f(0.0, 0.0, -1.0));
+  ray.rx_origin = ray.origin;
+  ray.rx_direction = liang::Vector3f(0.01, 0.0, -1.0);
+  ray.ry_origin = ray.origin;
+  ray.ry_direction = liang::Vector3f(0.0, -0.02, -1.0);
+  ray.has_differentials = true;
+  ASSERT_TRUE(scene.Intersect(ray, &intersection));
+  ASSERT_NEAR(4.5f, intersection.t, 0.00001);
+  ASSERT_TRUE(intersection.has_differentials);
+  Vector3FloatEquals(intersection.dpdx, 0.045, 0.0, 0.0);
+  Vector3FloatEquals(intersection.dpdy, 0.0, -0.09, 0.0);
+  ASSERT_NEAR(0.09f, liang::FootprintWidth(intersection), 0.00001);
+}
@@ -17,7 +17,7 @@ TEST(TriangleTest, Creation) {
 }
 
 TEST(TriangleTest, Intersection) {
-  liang::Transform translate = liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0));
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0)));
   std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(&translate);
   auto triangles = liang::CreateTriangles(mesh);
   liang::Ray3f ray = liang::Ray3f(liang::Point3f(5.2, 4.8, 5.2), liang::Vector3f(0.0, 0.0, -1.0));
@@ -32,10 +32,42 @@ TEST(TriangleTest, Intersection) {
   ASSERT_FALSE(triangles[0]->Intersect(ray));
 }
 
+TEST(TriangleTest, ClosestIntersection) {
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0)));
+  std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(&translate);
+  auto triangles = liang::CreateTriangles(mesh);
+  liang::Ray3f ray = liang::Ray3f(liang::Point3f(5.2, 4.8, 5.2), liang::Vector3f(0.0, 0.0, -1.0));
+  liang::Intersection intersection;
+  ASSERT_TRUE(triangles[0]->Intersect(ray, &intersection));
+  ASSERT_NEAR(0.7f, intersection.t, 0.00001);
+  ASSERT_NEAR(0.7f, ray.max_t, 0.00001);
+  Normal3FloatEquals(intersection.normal, 0.0, 0.0, -1.0);
+  // Hits past the ray's max_t are ignored and leave the intersection alone.
+  ray = liang::Ray3f(liang::Point3f(5.2, 4.8, 5.2), liang::Vector3f(0.0, 0.0, -1.0), 0.5);
+  ASSERT_FALSE(triangles[0]->Intersect(ray, &intersection));
+  ASSERT_NEAR(0.7f, intersection.t, 0.00001);
+  ASSERT_EQ(0.5f, ray.max_t);
+}
+
+TEST(TriangleTest, IntersectionWithZeroNormals) {
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0)));
+  std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(&translate);
+  // Opposing vertex normals interpolate to zero, so the geometric normal is used instead.
+  for (uint i = 0; i < 3; i++) {
+    mesh->vertices.get()[mesh->elements.get()[i]].normal = liang::Normal3f(0.0, 0.0, 0.0);
+  }
+  auto triangles = liang::CreateTriangles(mesh);
+  liang::Ray3f ray = liang::Ray3f(liang::Point3f(5.2, 4.8, 5.2), liang::Vector3f(0.0, 0.0, -1.0));
+  liang::Intersection intersection;
+  ASSERT_TRUE(triangles[0]->Intersect(ray, &intersection));
+  ASSERT_NEAR(0.7f, intersection.t, 0.00001);
+  Normal3FloatEquals(intersection.normal, 0.0, 0.0, -1.0);
+}
+
 TEST(TriangleTest, ObjectBounds) {
-  liang::Transform translate = liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0));
-  liang::Transform scale = liang::ScaleTransform(2.0, 2.0, 2.0);
-  liang::Transform transform = scale * translate;
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0)));
+  liang::AffineTransform scale(liang::ScaleTransform(2.0, 2.0, 2.0));
+  liang::AffineTransform transform = scale * translate;
   std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(&transform);
   auto triangles = liang::CreateTriangles(mesh);
   auto bounding_box = triangles[0]->ObjectBounds();
@@ -44,9 +76,9 @@ TEST(TriangleTest, ObjectBounds) {
 }
 
 TEST(TriangleTest, WorldBounds) {
-  liang::Transform translate = liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0));
-  liang::Transform scale = liang::ScaleTransform(2.0, 2.0, 2.0);
-  liang::Transform transform = scale * translate;
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(5.0, 5.0, 5.0)));
+  liang::AffineTransform scale(liang::ScaleTransform(2.0, 2.0, 2.0));
+  liang::AffineTransform transform = scale * translate;
   std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(&transform);
   auto triangles = liang::CreateTriangles(mesh);
   auto bounding_box = triangles[0]->WorldBounds();
@@ -1,8 +1,13 @@
+#include "core/animated_transform.h"
 #include "core/geometry.h"
+#include "core/quaternion.h"
 #include "core/transform.h"
+#include "core/transform_cache.h"
 #include "tests/util.h"
 #include "tests/test.h"
+#include "utils/cpu_features.h"
 #include "utils/math.h"
+#include "utils/rng.h"
 
 TEST(TransformTest, Matrix4x4Creation) {
   liang::Matrix4x4 mat = liang::Matrix4x4();
@@ -259,3 +264,295 @@ TEST(TransformTest, TransformComposition) {
   ASSERT_TRUE(expected == (translate * scale * rotate));
   ASSERT_FALSE((translate * scale * rotate) == (rotate * scale * translate));
 }
+
+TEST(TransformTest, TransformRayDifferential) {
+  liang::Transform translate = liang::TranslationTransform(liang::Vector3f(1.0, 2.0, 3.0));
+  liang::RayDifferential ray = liang::RayDifferential(liang::Point3f(0.0, 0.0, 0.0),
+      liang::Vector3f(0.0, 0.0, 1.0), 4.0);
+  ray.rx_origin = liang::Point3f(1.0, 0.0, 0.0);
+  ray.rx_direction = liang::Vector3f(0.1, 0.0, 1.0);
+  ray.ry_origin = liang::Point3f(0.0, 1.0, 0.0);
+  ray.ry_direction = liang::Vector3f(0.0, 0.1, 1.0);
+  ray.has_differentials = true;
+  liang::RayDifferential transformed = translate(ray);
+  ASSERT_TRUE(transformed.has_differentials);
+  ASSERT_FLOAT_EQ(4.0, transformed.max_t);
+  Point3FloatEquals(transformed.origin, 1.0, 2.0, 3.0);
+  Point3FloatEquals(transformed.rx_origin, 2.0, 2.0, 3.0);
+  Point3FloatEquals(transformed.ry_origin, 1.0, 3.0, 3.0);
+  Vector3FloatEquals(transformed.rx_direction, 0.1, 0.0, 1.0);
+  Vector3FloatEquals(transformed.ry_direction, 0.0, 0.1, 1.0);
+}
+
+// Asserts that two floats are bit-identical, telling apart zeros of different signs.
+static void AssertBitsEqual(float expected, float actual) {
+  ASSERT_EQ(expected, actual);
+  ASSERT_EQ(std::signbit(expected), std::signbit(actual));
+}
+
+TEST(TransformTest, TransformBatch) {
+  liang::Transform transform = liang::PerspectiveTransform(60.0, 1.0, 100.0) *
+      liang::TranslationTransform(liang::Vector3f(1.0, -2.0, 5.0)) *
+      liang::RotateArbitraryAxisTransform(liang::Vector3f(1.0, 1.0, 0.0), 0.5);
+  liang::Rng rng;
+  std::vector<liang::Point3f> points;
+  std::vector<liang::Vector3f> vectors;
+  for (int i = 0; i < 19; i++) {
+    points.push_back(liang::Point3f(rng.UniformFloat(), rng.UniformFloat(), rng.UniformFloat()));
+    vectors.push_back(liang::Vector3f(rng.UniformFloat(), rng.UniformFloat(),
+        rng.UniformFloat()));
+  }
+  std::vector<liang::Point3f> transformed_points(points.size());
+  transform.TransformPoints(points.data(), points.size(), transformed_points.data());
+  std::vector<liang::Vector3f> transformed_vectors = vectors;
+  transform.TransformVectors(transformed_vectors.data(), vectors.size(),
+      transformed_vectors.data());
+  for (size_t i = 0; i < points.size(); i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      AssertBitsEqual(transform(points[i])[axis], transformed_points[i][axis]);
+      AssertBitsEqual(transform(vectors[i])[axis], transformed_vectors[i][axis]);
+    }
+  }
+}
+
+TEST(TransformTest, SimdKernelsMatchScalar) {
+  liang::Rng rng;
+  float values[2][16];
+  for (int i = 0; i < 16; i++) {
+    values[0][i] = rng.UniformFloat() * 2.f - 1.f;
+    values[1][i] = rng.UniformFloat() * 2.f - 1.f;
+  }
+  liang::Matrix4x4 a(values[0]);
+  liang::Matrix4x4 b(values[1]);
+  float affine_values[16] = {0.6f, 0.f, 0.8f, 1.f, 0.f, 1.f, 0.f, 2.f, -0.8f, 0.f, 0.6f, 3.f, 0.f,
+      0.f, 0.f, 1.f};
+  liang::Matrix4x4 affine(affine_values);
+  // Every point is divided by a projective transform and none by an affine one.
+  std::vector<liang::Transform> transforms = {liang::Transform(a), liang::Transform(affine)};
+  std::vector<liang::Point3f> points;
+  std::vector<liang::Vector3f> vectors;
+  for (int i = 0; i < 21; i++) {
+    points.push_back(liang::Point3f(rng.UniformFloat(), rng.UniformFloat(), rng.UniformFloat()));
+    vectors.push_back(liang::Vector3f(rng.UniformFloat(), rng.UniformFloat(),
+        rng.UniformFloat()));
+  }
+
+  liang::SimdLevel supported = liang::SupportedSimdLevel();
+  std::vector<liang::Matrix4x4> products, inverses;
+  std::vector<std::vector<liang::Point3f>> transformed_points;
+  std::vector<std::vector<liang::Vector3f>> transformed_vectors;
+  for (liang::SimdLevel level : {liang::SimdLevel::SCALAR, liang::SimdLevel::SSE2,
+      liang::SimdLevel::AVX}) {
+    liang::SetSimdLevel(level);
+    ASSERT_EQ(std::min(level, supported), liang::GetSimdLevel());
+    products.push_back(a * b);
+    // The affine matrix's inverse has exact zeros, whose signs have to match too.
+    inverses.push_back(a.Inverse());
+    inverses.push_back(affine.Inverse());
+    for (const liang::Transform &transform : transforms) {
+      transformed_points.push_back(std::vector<liang::Point3f>(points.size()));
+      transform.TransformPoints(points.data(), points.size(), transformed_points.back().data());
+      transformed_vectors.push_back(std::vector<liang::Vector3f>(vectors.size()));
+      transform.TransformVectors(vectors.data(), vectors.size(),
+          transformed_vectors.back().data());
+    }
+  }
+  liang::SetSimdLevel(supported);
+
+  for (size_t level = 1; level < products.size(); level++) {
+    for (int i = 0; i < 16; i++) {
+      AssertBitsEqual(products[0][i], products[level][i]);
+    }
+  }
+  for (size_t level = 2; level < inverses.size(); level++) {
+    for (int i = 0; i < 16; i++) {
+      AssertBitsEqual(inverses[level % 2][i], inverses[level][i]);
+    }
+  }
+  for (size_t level = 2; level < transformed_points.size(); level++) {
+    for (size_t i = 0; i < points.size(); i++) {
+      const liang::Point3f &expected_point = transformed_points[level % 2][i];
+      const liang::Vector3f &expected_vector = transformed_vectors[level % 2][i];
+      for (int axis = 0; axis < 3; axis++) {
+        AssertBitsEqual(expected_point[axis], transformed_points[level][i][axis]);
+        AssertBitsEqual(expected_vector[axis], transformed_vectors[level][i][axis]);
+      }
+    }
+  }
+}
+
+TEST(TransformTest, AffineTransformMatchesTransform) {
+  liang::Transform transform = liang::TranslationTransform(liang::Vector3f(1.0, -2.0, 3.0)) *
+      liang::RotateArbitraryAxisTransform(liang::Vector3f(1.0, 2.0, 0.5), 0.8) *
+      liang::ScaleTransform(2.0, -1.0, 0.5);
+  ASSERT_TRUE(transform.IsAffine());
+  ASSERT_FALSE(liang::PerspectiveTransform(90.0, 1.0, 10.0).IsAffine());
+  liang::AffineTransform affine(transform);
+  ASSERT_TRUE(affine.ToTransform() == transform);
+  ASSERT_EQ(transform.SwapsHandedness(), affine.SwapsHandedness());
+  liang::Rng rng;
+  for (int i = 0; i < 16; i++) {
+    liang::Point3f p(rng.UniformFloat(), rng.UniformFloat(), rng.UniformFloat());
+    liang::Vector3f v(rng.UniformFloat(), rng.UniformFloat(), rng.UniformFloat());
+    liang::Normal3f n(rng.UniformFloat(), rng.UniformFloat(), rng.UniformFloat());
+    // Skipping w changes nothing for affine matrices, so the results are bit-identical.
+    for (int axis = 0; axis < 3; axis++) {
+      AssertBitsEqual(transform(p)[axis], affine(p)[axis]);
+      AssertBitsEqual(transform(v)[axis], affine(v)[axis]);
+      AssertBitsEqual(transform(n)[axis], affine(n)[axis]);
+    }
+  }
+}
+
+TEST(TransformTest, AffineTransformInverse) {
+  float values[16] = {2, 1, 0, 4, 0, 3, 1, -2, 1, 0, 1, 5, 0, 0, 0, 1};
+  liang::Matrix4x4 mat(values);
+  liang::AffineTransform affine(mat);
+  ASSERT_TRUE(affine.ToTransform() == liang::Transform(mat));
+  ASSERT_TRUE(affine.Inverse().ToTransform() == liang::Transform(mat).Inverse());
+  liang::Point3f p(0.3, -0.7, 1.1);
+  Point3FloatEquals(affine.Inverse()(affine(p)), 0.3, -0.7, 1.1);
+  ASSERT_TRUE(affine * affine.Inverse() == liang::AffineTransform());
+}
+
+TEST(TransformTest, AffineTransformComposition) {
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(1.0, 2.0, 3.0)));
+  liang::AffineTransform scale(liang::ScaleTransform(-1.0, 2.0, 5.0));
+  liang::AffineTransform rotate(liang::RotateXTransform(PI / 2));
+  float values[16] = {-1,  0, 0, 1, 0, 0, -2, 2, 0, 5, 0, 3, 0, 0, 0, 1};
+  ASSERT_TRUE(liang::AffineTransform(liang::Matrix4x4(values)) == translate * scale * rotate);
+  ASSERT_TRUE((translate * scale * rotate).ToTransform() ==
+      translate.ToTransform() * scale.ToTransform() * rotate.ToTransform());
+  ASSERT_FALSE((translate * scale * rotate) == (rotate * scale * translate));
+}
+
+TEST(TransformCacheTest, InternsIdenticalTransforms) {
+  liang::TransformCache cache;
+  liang::AffineTransform translate(liang::TranslationTransform(liang::Vector3f(1.0, 2.0, 3.0)));
+  const liang::AffineTransform *first = cache.Intern(translate);
+  ASSERT_TRUE(*first == translate);
+  // A copy built the same way is bit-identical, so it shares the first transform.
+  ASSERT_EQ(first, cache.Intern(
+      liang::AffineTransform(liang::TranslationTransform(liang::Vector3f(1.0, 2.0, 3.0)))));
+  const liang::AffineTransform *identity = cache.Intern(liang::AffineTransform());
+  ASSERT_NE(first, identity);
+  ASSERT_EQ(2u, cache.Size());
+  // Interning many more transforms leaves the pointers handed out so far valid.
+  for (int i = 0; i < 1000; i++) {
+    cache.Intern(liang::AffineTransform(liang::TranslationTransform(
+        liang::Vector3f((float)i, 0.0, 0.0))));
+  }
+  ASSERT_EQ(first, cache.Intern(translate));
+  ASSERT_EQ(identity, cache.Intern(liang::AffineTransform()));
+  ASSERT_TRUE(*first == translate);
+  // The translation by zero shares the identity, even though its inverse translates by -0.
+  ASSERT_EQ(identity, cache.Intern(liang::AffineTransform(liang::TranslationTransform(
+      liang::Vector3f(0.0, 0.0, 0.0)))));
+  ASSERT_EQ(1001u, cache.Size());
+}
+
+// Returns the matrix of an affine transform, read off from where it takes the basis vectors and
+// the origin.
+static liang::Matrix4x4 AffineMatrixOf(const liang::Transform &transform) {
+  liang::Point3f origin = transform(liang::Point3f(0.0, 0.0, 0.0));
+  liang::Vector3f columns[3] = {transform(liang::Vector3f(1.0, 0.0, 0.0)),
+      transform(liang::Vector3f(0.0, 1.0, 0.0)), transform(liang::Vector3f(0.0, 0.0, 1.0))};
+  float values[16] = {columns[0].x, columns[1].x, columns[2].x, origin.x,
+      columns[0].y, columns[1].y, columns[2].y, origin.y,
+      columns[0].z, columns[1].z, columns[2].z, origin.z, 0, 0, 0, 1};
+  return liang::Matrix4x4(values);
+}
+
+// Asserts that two transforms take a handful of points to the same place, and that their inverses
+// take them back.
+static void AssertTransformsNear(const liang::AffineTransform &expected,
+    const liang::AffineTransform &actual) {
+  liang::Point3f points[4] = {liang::Point3f(0.0, 0.0, 0.0), liang::Point3f(1.0, 0.0, 0.0),
+      liang::Point3f(0.0, -2.0, 0.5), liang::Point3f(0.3, 0.7, -1.1)};
+  for (const liang::Point3f &point : points) {
+    liang::Point3f expected_point = expected(point);
+    liang::Point3f actual_point = actual(point);
+    liang::Point3f expected_inverse_point = expected.Inverse()(point);
+    liang::Point3f actual_inverse_point = actual.Inverse()(point);
+    for (int axis = 0; axis < 3; axis++) {
+      ASSERT_NEAR(expected_point[axis], actual_point[axis], 0.0001);
+      ASSERT_NEAR(expected_inverse_point[axis], actual_inverse_point[axis], 0.0001);
+    }
+  }
+}
+
+TEST(QuaternionTest, MatrixRoundTrip) {
+  // These rotations take every branch of the conversion from a matrix.
+  liang::Transform rotations[4] = {liang::RotateZTransform(0.5f), liang::RotateXTransform(3.f),
+      liang::RotateYTransform(3.f), liang::RotateZTransform(3.f)};
+  for (const liang::Transform &rotation : rotations) {
+    liang::Quaternion quaternion(AffineMatrixOf(rotation));
+    ASSERT_NEAR(1.f, liang::Dot(quaternion, quaternion), 0.00001);
+    AssertTransformsNear(liang::AffineTransform(rotation), quaternion.ToTransform());
+  }
+}
+
+TEST(QuaternionTest, Slerp) {
+  liang::Quaternion start(AffineMatrixOf(liang::RotateZTransform(0.f)));
+  liang::Quaternion end(AffineMatrixOf(liang::RotateZTransform(PI / 2)));
+  AssertTransformsNear(liang::AffineTransform(liang::RotateZTransform(PI / 8)),
+      liang::Slerp(start, end, 0.25f).ToTransform());
+  // -end is the same rotation, and the interpolation still takes the short way around.
+  AssertTransformsNear(liang::AffineTransform(liang::RotateZTransform(PI / 8)),
+      liang::Slerp(start, -end, 0.25f).ToTransform());
+}
+
+TEST(AnimatedTransformTest, Interpolate) {
+  liang::AffineTransform start(liang::TranslationTransform(liang::Vector3f(0.0, 1.0, 0.0)));
+  liang::AffineTransform end(liang::TranslationTransform(liang::Vector3f(2.0, 1.0, 0.0)) *
+      liang::RotateZTransform(PI / 2) * liang::ScaleTransform(3.0, 3.0, 3.0));
+  liang::AnimatedTransform animated(start, 1.f, end, 3.f);
+  ASSERT_TRUE(animated.IsAnimated());
+  ASSERT_FALSE(liang::AnimatedTransform(start, 1.f, start, 3.f).IsAnimated());
+  ASSERT_TRUE(start == animated.Interpolate(0.f));
+  ASSERT_TRUE(start == animated.Interpolate(1.f));
+  ASSERT_TRUE(end == animated.Interpolate(3.f));
+  ASSERT_TRUE(end == animated.Interpolate(4.f));
+  // Halfway through, the rotation is halfway around rather than a blend of the matrices.
+  liang::AffineTransform expected(liang::TranslationTransform(liang::Vector3f(1.0, 1.0, 0.0)) *
+      liang::RotateZTransform(PI / 4) * liang::ScaleTransform(2.0, 2.0, 2.0));
+  AssertTransformsNear(expected, animated.Interpolate(2.f));
+  Point3FloatEquals(animated(2.f, liang::Point3f(1.0, 0.0, 0.0)), 1.f + std::sqrt(2.f),
+      1.f + std::sqrt(2.f), 0.0);
+
+  liang::Ray3f ray(liang::Point3f(1.0, 0.0, 0.0), liang::Vector3f(0.0, 0.0, 1.0), 5.f, 2.f);
+  liang::Ray3f transformed = animated(ray);
+  Point3FloatEquals(transformed.origin, 1.f + std::sqrt(2.f), 1.f + std::sqrt(2.f), 0.0);
+  Vector3FloatEquals(transformed.direction, 0.0, 0.0, 2.0);
+  ASSERT_FLOAT_EQ(5.f, transformed.max_t);
+  ASSERT_FLOAT_EQ(2.f, transformed.time);
+}
+
+TEST(AnimatedTransformTest, LinearBoundsContainMotion) {
+  liang::AABB3f box(liang::Point3f(-1.0, -0.5, -0.25), liang::Point3f(1.0, 0.5, 0.25));
+  liang::AffineTransform start(liang::TranslationTransform(liang::Vector3f(5.0, 0.0, 0.0)));
+  liang::AffineTransform end(liang::TranslationTransform(liang::Vector3f(-5.0, 2.0, 1.0)) *
+      liang::RotateArbitraryAxisTransform(liang::Vector3f(1.0, 1.0, 0.0), 3.f) *
+      liang::ScaleTransform(2.0, 1.0, 0.5));
+  liang::AnimatedTransform animated(start, 0.f, end, 1.f);
+  liang::AABB3f bounds_0 = box, bounds_1 = box;
+  animated.LinearBounds(box, 0.2f, 0.9f, &bounds_0, &bounds_1);
+  for (uint i = 0; i <= 1000; i++) {
+    float s = i / 1000.f;
+    liang::AABB3f moved = animated.Interpolate(0.2f + 0.7f * s)(box);
+    liang::Point3f min_point = liang::Lerp(bounds_0.min_point, bounds_1.min_point, s);
+    liang::Point3f max_point = liang::Lerp(bounds_0.max_point, bounds_1.max_point, s);
+    for (int axis = 0; axis < 3; axis++) {
+      ASSERT_LE(min_point[axis], moved.min_point[axis]);
+      ASSERT_GE(max_point[axis], moved.max_point[axis]);
+    }
+  }
+
+  // Without any rotation the corners move in straight lines, and the bounds are tight.
+  liang::AnimatedTransform translated(start, 0.f, liang::AffineTransform(
+      liang::TranslationTransform(liang::Vector3f(-5.0, 2.0, 1.0)) *
+      liang::ScaleTransform(2.0, 1.0, 1.0)), 1.f);
+  translated.LinearBounds(box, 0.f, 0.5f, &bounds_0, &bounds_1);
+  AABB3FloatEquals(bounds_0, 4.0, -0.5, -0.25, 6.0, 0.5, 0.25);
+  AABB3FloatEquals(bounds_1, -1.5, 0.5, 0.25, 1.5, 1.5, 0.75);
+}
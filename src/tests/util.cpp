@@ -4,6 +4,10 @@
 
 #include "tests/util.h"
 #include "tests/test.h"
+#include "core/transform_cache.h"
+
+// Owns the transforms of the unit cubes created without one.
+static liang::TransformCache transform_cache;
 
 void Vector2IntEquals(liang::Vector2i vec, int x, int y) {
   ASSERT_EQ(vec.x, x);
@@ -71,7 +75,7 @@ void AssertMatEquals(const liang::Matrix4x4 &matrix, const std::vector<float> &v
   }
 }
 
-std::shared_ptr<liang::Mesh> CreateUnitCube(liang::Transform *object_to_world) {
+std::shared_ptr<liang::Mesh> CreateUnitCube(const liang::AffineTransform *object_to_world) {
   std::shared_ptr<liang::TriangleVertex> vertices(new liang::TriangleVertex[36]);
   vertices.get()[0] = {liang::Point3f(-0.5, -0.5, -0.5), liang::Normal3f(0.0, 0.0, -1.0)};
   vertices.get()[1] = {liang::Point3f(0.5, -0.5, -0.5), liang::Normal3f(0.0, 0.0, -1.0)};
@@ -118,18 +122,16 @@ std::shared_ptr<liang::Mesh> CreateUnitCube(liang::Transform *object_to_world) {
 }
 
 std::shared_ptr<liang::Mesh> CreateUnitCube() {
-  liang::Transform *object_to_world = new liang::Transform();
-  return CreateUnitCube(object_to_world);
+  return CreateUnitCube(transform_cache.Intern(liang::AffineTransform()));
 }
 
 extern std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives(
-    liang::Transform *object_to_world) {
+    const liang::AffineTransform *object_to_world) {
   std::shared_ptr<liang::Mesh> mesh = CreateUnitCube(object_to_world);
   auto triangles = liang::CreateTriangles(mesh);
   return liang::CreateGeometricPrimitives(triangles);
 }
 
 extern std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives() {
-  liang::Transform *object_to_world = new liang::Transform();
-  return CreateUnitCubePrimitives(object_to_world);
+  return CreateUnitCubePrimitives(transform_cache.Intern(liang::AffineTransform()));
 }
@@ -34,13 +34,14 @@ extern void AABB3FloatEquals(liang::AABB3f box, float min_x, float min_y, float
 
 extern void AssertMatEquals(const liang::Matrix4x4 &matrix, const std::vector<float> &values);
 
-// This is ugly and leaks memory. Clean this up when we have a real model loading system.
-extern std::shared_ptr<liang::Mesh> CreateUnitCube(liang::Transform *object_to_world);
+// This is ugly. Clean this up when we have a real model loading system.
+extern std::shared_ptr<liang::Mesh> CreateUnitCube(
+    const liang::AffineTransform *object_to_world);
 
 extern std::shared_ptr<liang::Mesh> CreateUnitCube();
 
 extern std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives(
-    liang::Transform *object_to_world);
+    const liang::AffineTransform *object_to_world);
 
 extern std::vector<std::shared_ptr<liang::GeometricPrimitive>> CreateUnitCubePrimitives();
 
@@ -0,0 +1,55 @@
+#include "utils/cpu_features.h"
+
+#include <atomic>
+
+namespace liang {
+
+// Detects the instruction sets of the CPU, limited to the ones this build has kernels for.
+static SimdLevel DetectSimdLevel() {
+#ifdef LIANG_AVX_DISPATCH
+  __builtin_cpu_init();
+  // This also checks that the operating system saves the AVX registers on context switches.
+  if (__builtin_cpu_supports("avx")) {
+    return SimdLevel::AVX;
+  }
+#endif
+#ifdef __SSE2__
+  return SimdLevel::SSE2;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+// The instruction set kernels dispatch to. This is written by SetSimdLevel() while other threads
+// may be dispatching, hence the atomic.
+static std::atomic<SimdLevel> &CurrentSimdLevel() {
+  static std::atomic<SimdLevel> level(SupportedSimdLevel());
+  return level;
+}
+
+SimdLevel SupportedSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+SimdLevel GetSimdLevel() {
+  return CurrentSimdLevel().load(std::memory_order_relaxed);
+}
+
+void SetSimdLevel(SimdLevel level) {
+  CurrentSimdLevel().store(std::min(level, SupportedSimdLevel()), std::memory_order_relaxed);
+}
+
+std::string SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::SCALAR:
+      return "scalar";
+    case SimdLevel::SSE2:
+      return "SSE2";
+    case SimdLevel::AVX:
+      return "AVX";
+  }
+  return "unknown";
+}
+
+}
@@ -0,0 +1,45 @@
+// This header defines runtime detection of the SIMD instruction sets the CPU supports. Kernels
+// with several SIMD implementations are compiled for every instruction set up front and pick one
+// when they run, so a single binary uses AVX on machines that have it and still runs on machines
+// that only have SSE2. Every implementation of a kernel gives bit-identical results, so the level
+// only affects speed.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_CPU_FEATURES_H
+#define LIANG_UTILS_CPU_FEATURES_H
+
+#include "core/liang.h"
+
+// Defined if this compiler can build AVX kernels into a binary that is not itself compiled for
+// AVX, using the target function attribute.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LIANG_AVX_DISPATCH
+// Compiles the function it is attached to for AVX. It must only be called when GetSimdLevel() is
+// SimdLevel::AVX.
+#define LIANG_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+namespace liang {
+
+// The instruction sets kernels can be dispatched to, from least to most capable.
+enum class SimdLevel { SCALAR, SSE2, AVX };
+
+// Returns the most capable instruction set that both this build and the CPU running it support.
+// This is detected once and cached.
+SimdLevel SupportedSimdLevel();
+
+// Returns the instruction set kernels dispatch to, which is SupportedSimdLevel() unless it was
+// lowered by SetSimdLevel().
+SimdLevel GetSimdLevel();
+
+// Sets the instruction set kernels dispatch to, capped at SupportedSimdLevel(). This is meant for
+// testing and benchmarking each implementation of a kernel.
+void SetSimdLevel(SimdLevel level);
+
+// Returns the name of an instruction set.
+std::string SimdLevelName(SimdLevel level);
+
+}
+
+#endif  // LIANG_UTILS_CPU_FEATURES_H
@@ -0,0 +1,67 @@
+// This is a header only library for converting between floats and IEEE 754 half precision floats,
+// which are stored as their raw 16 bits. Conversions to half round to the nearest representable
+// value, with ties to even, and values too large for a half become infinity.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_HALF_H
+#define LIANG_UTILS_HALF_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+// Converts a float to the bits of the nearest half.
+inline uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7fffffff;
+  if (magnitude >= 0x7f800000) {
+    // Infinity stays infinity and NaN stays a quiet NaN.
+    return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+  }
+  if (magnitude >= 0x477ff000) {
+    // 65520 and above round past the largest half, 65504.
+    return sign | 0x7c00;
+  }
+  if (magnitude < 0x38800000) {
+    // Below the smallest normal half, 2^-14, so the result is subnormal.
+    if (magnitude < 0x33000000) {
+      return sign;
+    }
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+    uint32_t shift = 126 - exponent;
+    uint32_t half_mantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {
+      half_mantissa++;
+    }
+    return sign | half_mantissa;
+  }
+  // Rebias the exponent from 127 to 15 and round off the low 13 bits of the mantissa.
+  magnitude += 0xfff + ((magnitude >> 13) & 1);
+  return sign | ((magnitude - 0x38000000) >> 13);
+}
+
+// Converts the bits of a half to a float. This is exact.
+inline float HalfToFloat(uint16_t half) {
+  uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  if (exponent == 0) {
+    float value = std::ldexp((float)mantissa, -24);
+    return sign ? -value : value;
+  }
+  uint32_t bits = exponent == 31 ? sign | 0x7f800000 | (mantissa << 13) :
+      sign | ((exponent + 112) << 23) | (mantissa << 13);
+  float value;
+  std::memcpy(&value, &bits, sizeof(float));
+  return value;
+}
+
+}
+
+#endif  // LIANG_UTILS_HALF_H
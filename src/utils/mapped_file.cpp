@@ -0,0 +1,71 @@
+#include "utils/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace liang {
+
+std::unique_ptr<MappedFile> MappedFile::Create(const std::string &name, size_t size) {
+  assert(size > 0);
+  int file = open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file < 0) {
+    return nullptr;
+  }
+  // Growing an empty file leaves a hole, so no blocks are allocated until pages are written.
+  if (ftruncate(file, (off_t)size) != 0) {
+    close(file);
+    return nullptr;
+  }
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  if (data == MAP_FAILED) {
+    close(file);
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(file, (char *)data, size));
+}
+
+MappedFile::MappedFile(int file, char *data, size_t size) : file{file}, data{data}, size{size} {}
+
+MappedFile::~MappedFile() {
+  munmap(data, size);
+  close(file);
+}
+
+char *MappedFile::GetData() {
+  return data;
+}
+
+const char *MappedFile::GetData() const {
+  return data;
+}
+
+size_t MappedFile::GetSize() const {
+  return size;
+}
+
+#ifdef __linux__
+bool MappedFile::Flush(size_t offset, size_t length) {
+  assert(offset + length <= size);
+  // The pages of a shared mapping are the file's page cache, so writing the file range back
+  // writes the mapped bytes. Unlike msync() with MS_ASYNC, which Linux treats as a no-op, this
+  // actually starts the writes.
+  return sync_file_range(file, (off64_t)offset, (off64_t)length, SYNC_FILE_RANGE_WRITE) == 0;
+}
+#else
+bool MappedFile::Flush(size_t offset, size_t length) {
+  assert(offset + length <= size);
+  // msync() needs a page aligned address, so round the start of the range down to its page.
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t aligned_offset = offset / page_size * page_size;
+  return msync(data + aligned_offset, length + (offset - aligned_offset), MS_ASYNC) == 0;
+}
+#endif
+
+bool MappedFile::Clear() {
+  // Truncating drops every page of the file, and growing it again brings them back as a hole. The
+  // mapping stays valid throughout, since nothing touches it in between.
+  return ftruncate(file, 0) == 0 && ftruncate(file, (off_t)size) == 0;
+}
+
+}
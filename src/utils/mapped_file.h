@@ -0,0 +1,54 @@
+// This header defines a file mapped into memory, used to hold data too large for RAM. The file is
+// created sparse, so pages that are never written take no space on disk, and the kernel pages the
+// mapped data in and out on demand.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_MAPPED_FILE_H
+#define LIANG_UTILS_MAPPED_FILE_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+class MappedFile {
+  public:
+    // Creates (or truncates) the file with the given name, sizes it to the given number of zeroed
+    // bytes, and maps it into memory. Returns nullptr on failure. The file stays on disk after
+    // the MappedFile is destroyed.
+    static std::unique_ptr<MappedFile> Create(const std::string &name, size_t size);
+
+    ~MappedFile();
+
+    // Gets the mapped bytes.
+    char *GetData();
+    const char *GetData() const;
+
+    // Returns the number of mapped bytes.
+    size_t GetSize() const;
+
+    // Starts writing the given range of bytes back to disk without waiting for it to finish. Once
+    // written, the pages are clean, so the kernel can drop them under memory pressure without
+    // writing them first. The pages stay mapped, so bytes that are read or written again are
+    // simply paged back in. Returns false if the writes could not be started.
+    bool Flush(size_t offset, size_t length);
+
+    // Zeroes every byte and releases the file's disk blocks, so it is sparse again. Nothing else
+    // may access the mapping while it is cleared.
+    bool Clear();
+
+  private:
+    // The file descriptor of the file.
+    int file;
+    // The start of the mapping.
+    char *data;
+    // The number of mapped bytes.
+    size_t size;
+
+    // MappedFile constructor that takes ownership of an open file and its mapping.
+    MappedFile(int file, char *data, size_t size);
+};
+
+}
+
+#endif  // LIANG_UTILS_MAPPED_FILE_H
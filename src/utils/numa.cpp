@@ -0,0 +1,86 @@
+#include "utils/numa.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace liang {
+
+std::vector<uint> ParseCpuList(const std::string &cpu_list) {
+  std::vector<uint> cpus;
+  std::stringstream stream(cpu_list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    size_t dash = range.find('-');
+    uint first = (uint)std::stoul(range.substr(0, dash));
+    uint last = dash == std::string::npos ? first : (uint)std::stoul(range.substr(dash + 1));
+    for (uint cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Reads the NUMA nodes from sysfs, falling back to a single node with every CPU.
+static std::vector<NumaNode> ReadNumaNodes() {
+  std::vector<NumaNode> nodes;
+  std::ifstream online_file("/sys/devices/system/node/online");
+  std::string online;
+  if (online_file && std::getline(online_file, online)) {
+    for (uint id : ParseCpuList(online)) {
+      std::ifstream cpu_file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+      std::string cpu_list;
+      if (cpu_file && std::getline(cpu_file, cpu_list)) {
+        std::vector<uint> cpus = ParseCpuList(cpu_list);
+        // Memory-only nodes have no CPUs to pin to.
+        if (!cpus.empty()) {
+          nodes.push_back(NumaNode{id, cpus});
+        }
+      }
+    }
+  }
+  if (nodes.empty()) {
+    NumaNode node{0, {}};
+    for (uint cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+      node.cpus.push_back(cpu);
+    }
+    nodes.push_back(node);
+  }
+  return nodes;
+}
+
+const std::vector<NumaNode> &GetNumaNodes() {
+  static const std::vector<NumaNode> nodes = ReadNumaNodes();
+  return nodes;
+}
+
+const NumaNode &NumaNodeForThread(uint index, uint num_threads) {
+  assert(index < num_threads);
+  const std::vector<NumaNode> &nodes = GetNumaNodes();
+  return nodes[(uint64_t)index * nodes.size() / num_threads];
+}
+
+#ifdef __linux__
+bool PinThreadToNumaNode(const NumaNode &node) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint cpu : node.cpus) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+#else
+bool PinThreadToNumaNode(const NumaNode & /* node */) {
+  return false;
+}
+#endif
+
+}
@@ -0,0 +1,40 @@
+// This header defines utilities for discovering the NUMA topology of the machine and pinning
+// threads to NUMA nodes. On multi-socket machines, memory is attached to a specific socket, and
+// threads that stay on one node keep hitting memory that was first touched (and therefore
+// allocated) on that node instead of crossing the interconnect. On systems without NUMA
+// information, the whole machine is reported as a single node.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_NUMA_H
+#define LIANG_UTILS_NUMA_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+// A NUMA node and the logical CPUs that belong to it.
+struct NumaNode {
+  // The id of the node as reported by the operating system.
+  uint id;
+  // The logical CPUs belonging to the node.
+  std::vector<uint> cpus;
+};
+
+// Parses a Linux CPU list like "0-3,8,10-11" into the CPUs it contains.
+std::vector<uint> ParseCpuList(const std::string &cpu_list);
+
+// Returns the NUMA nodes of the machine. This is read once and cached.
+const std::vector<NumaNode> &GetNumaNodes();
+
+// Returns the node that the index-th of num_threads threads should be pinned to. Threads are
+// split into contiguous blocks so each node gets an equal share.
+const NumaNode &NumaNodeForThread(uint index, uint num_threads);
+
+// Restricts the calling thread to the CPUs of the given node. Returns false if pinning is not
+// supported on this platform or fails.
+bool PinThreadToNumaNode(const NumaNode &node);
+
+}
+
+#endif  // LIANG_UTILS_NUMA_H
@@ -0,0 +1,50 @@
+#include "utils/numa.h"
+#include "utils/parallel.h"
+
+#include <atomic>
+#include <thread>
+
+namespace liang {
+
+uint NumSystemThreads() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ParallelFor(uint count, uint num_threads, const std::function<void(uint)> &func,
+    bool pin_threads) {
+  if (num_threads == 0) {
+    num_threads = NumSystemThreads();
+  }
+  num_threads = std::min(num_threads, count);
+  // Run on the calling thread if there is nothing to parallelize.
+  if (num_threads <= 1 && !pin_threads) {
+    for (uint i = 0; i < count; i++) {
+      func(i);
+    }
+    return;
+  }
+  std::atomic<uint> next_index{0};
+  auto worker = [&](uint thread_index) {
+    if (pin_threads) {
+      PinThreadToNumaNode(NumaNodeForThread(thread_index, num_threads));
+    }
+    for (uint i = next_index++; i < count; i = next_index++) {
+      func(i);
+    }
+  };
+  // The calling thread only joins a pinned run as a worker, since pinning it would leak the
+  // affinity to the caller after we return.
+  uint first_spawned = pin_threads ? 0 : 1;
+  std::vector<std::thread> threads;
+  for (uint i = first_spawned; i < num_threads; i++) {
+    threads.push_back(std::thread(worker, i));
+  }
+  if (!pin_threads) {
+    worker(0);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}
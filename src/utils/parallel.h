@@ -0,0 +1,29 @@
+// This header defines the small set of threading utilities used to spread work across cores. Work
+// is expressed as a range of independent indices that threads claim one at a time, which keeps
+// load balanced when some indices (like tiles with lots of geometry) take longer than others.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_PARALLEL_H
+#define LIANG_UTILS_PARALLEL_H
+
+#include "core/liang.h"
+
+#include <functional>
+
+namespace liang {
+
+// Returns the number of threads the hardware can run concurrently, or 1 if it is unknown.
+uint NumSystemThreads();
+
+// Calls func for every index in [0, count) using num_threads threads (0 uses all of the system's
+// threads). Indices are claimed in increasing order, but they may finish in any order, so func
+// must not rely on the order of calls for anything that affects the output. If pin_threads is
+// true, every thread is pinned to a NUMA node before it starts, so memory it allocates and touches
+// first (like a FilmTile) is placed on that node.
+void ParallelFor(uint count, uint num_threads, const std::function<void(uint)> &func,
+    bool pin_threads = false);
+
+}
+
+#endif  // LIANG_UTILS_PARALLEL_H
@@ -0,0 +1,71 @@
+// This is a header only library defining the random number generator used by the samplers. This
+// is the PCG32 generator by Melissa O'Neill, adapted from the version in pbrt.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_RNG_H
+#define LIANG_UTILS_RNG_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+// The largest float that is strictly less than 1.
+const float ONE_MINUS_EPSILON = 0.99999994f;
+
+// Scrambles the bits of a 64-bit integer. This is the finalizer of SplitMix64, and is used to turn
+// structured values like pixel coordinates into well distributed random seeds.
+inline uint64_t MixBits(uint64_t v) {
+  v ^= v >> 31;
+  v *= 0x7fb5d329728ea185ULL;
+  v ^= v >> 27;
+  v *= 0x81dadef4bc2dd44dULL;
+  v ^= v >> 33;
+  return v;
+}
+
+class Rng {
+  public:
+    // Default constructor initializing the generator to the default PCG32 state.
+    Rng() : state{0x853c49e6748fea9bULL}, increment{0xda3e39cb94b95bdbULL} {}
+
+    // Constructor initializing the generator to the start of the given sequence.
+    Rng(uint64_t sequence_index) { SetSequence(sequence_index); }
+
+    // Moves the generator to the start of the given sequence. Different sequences are
+    // statistically independent streams of numbers.
+    void SetSequence(uint64_t sequence_index) {
+      state = 0u;
+      increment = (sequence_index << 1u) | 1u;
+      UniformUInt32();
+      state += 0x853c49e6748fea9bULL;
+      UniformUInt32();
+    }
+
+    // Returns a uniformly distributed 32-bit unsigned integer.
+    uint32_t UniformUInt32() {
+      uint64_t old_state = state;
+      state = old_state * MULTIPLIER + increment;
+      uint32_t xor_shifted = (uint32_t)(((old_state >> 18u) ^ old_state) >> 27u);
+      uint32_t rotation = (uint32_t)(old_state >> 59u);
+      return (xor_shifted >> rotation) | (xor_shifted << ((~rotation + 1u) & 31));
+    }
+
+    // Returns a uniformly distributed float in [0, 1).
+    float UniformFloat() {
+      return std::min(ONE_MINUS_EPSILON, UniformUInt32() * 2.3283064365386963e-10f);
+    }
+
+  private:
+    // The multiplier of the underlying linear congruential generator.
+    static const uint64_t MULTIPLIER = 0x5851f42d4c957f2dULL;
+
+    // The current state of the generator.
+    uint64_t state;
+    // The increment of the underlying linear congruential generator which selects the sequence.
+    uint64_t increment;
+};
+
+}
+
+#endif  // LIANG_UTILS_RNG_H
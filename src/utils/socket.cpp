@@ -0,0 +1,119 @@
+#include "utils/socket.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace liang {
+
+// Disables Nagle's algorithm, since the farm exchanges small request and reply messages.
+static void DisableDelay(int socket) {
+  int enable = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+int ListenOnLocalhost(uint16_t port, uint16_t *bound_port) {
+  int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_socket < 0) {
+    return -1;
+  }
+  int enable = 1;
+  setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t address_size = sizeof(address);
+  if (bind(listen_socket, (sockaddr *)&address, address_size) != 0 ||
+      listen(listen_socket, SOMAXCONN) != 0 ||
+      getsockname(listen_socket, (sockaddr *)&address, &address_size) != 0) {
+    close(listen_socket);
+    return -1;
+  }
+  *bound_port = ntohs(address.sin_port);
+  return listen_socket;
+}
+
+int AcceptConnection(int listen_socket, int timeout_ms) {
+  pollfd poll_socket = {listen_socket, POLLIN, 0};
+  if (poll(&poll_socket, 1, timeout_ms) <= 0) {
+    return -1;
+  }
+  int socket = accept(listen_socket, nullptr, nullptr);
+  if (socket >= 0) {
+    DisableDelay(socket);
+  }
+  return socket;
+}
+
+bool SetReceiveTimeout(int socket, int timeout_ms) {
+  timeval timeout = {};
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_usec = (timeout_ms % 1000) * 1000;
+  return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+int ConnectToHost(const std::string &host, uint16_t port) {
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+    return -1;
+  }
+  int connected_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (connected_socket < 0) {
+    return -1;
+  }
+  if (connect(connected_socket, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(connected_socket);
+    return -1;
+  }
+  DisableDelay(connected_socket);
+  return connected_socket;
+}
+
+bool SendAll(int socket, const void *data, size_t size) {
+  const char *bytes = (const char *)data;
+  while (size > 0) {
+    // MSG_NOSIGNAL keeps a worker that hung up from killing the sender with SIGPIPE.
+    ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool ReceiveAll(int socket, void *data, size_t size) {
+  char *bytes = (char *)data;
+  while (size > 0) {
+    ssize_t received = recv(socket, bytes, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= received;
+  }
+  return true;
+}
+
+void CloseSocket(int socket) {
+  if (socket >= 0) {
+    close(socket);
+  }
+}
+
+}
@@ -0,0 +1,40 @@
+// This header defines thin wrappers around POSIX TCP sockets, used to pass tiles between the
+// processes of a render farm. Sockets are plain file descriptors, with -1 signalling failure.
+//
+// Author: brian@brkho.com
+
+#ifndef LIANG_UTILS_SOCKET_H
+#define LIANG_UTILS_SOCKET_H
+
+#include "core/liang.h"
+
+namespace liang {
+
+// Opens a socket listening on the loopback interface on the given port, or on a port picked by the
+// system if the port is 0. Outputs the port actually bound. Returns -1 on failure.
+int ListenOnLocalhost(uint16_t port, uint16_t *bound_port);
+
+// Waits up to timeout_ms milliseconds for a connection on a listening socket and accepts it.
+// Returns -1 if no connection arrived in time or the accept failed.
+int AcceptConnection(int listen_socket, int timeout_ms);
+
+// Makes receives on a socket give up once no data has arrived for timeout_ms milliseconds, after
+// which ReceiveAll() returns false. Returns false if the timeout could not be set.
+bool SetReceiveTimeout(int socket, int timeout_ms);
+
+// Connects to the given port on the given IPv4 host. Returns -1 on failure.
+int ConnectToHost(const std::string &host, uint16_t port);
+
+// Sends exactly size bytes, retrying partial writes. Returns false if the connection failed.
+bool SendAll(int socket, const void *data, size_t size);
+
+// Receives exactly size bytes, retrying partial reads. Returns false if the connection failed or
+// was closed before all the bytes arrived.
+bool ReceiveAll(int socket, void *data, size_t size);
+
+// Closes a socket. Closing -1 is a no-op.
+void CloseSocket(int socket);
+
+}
+
+#endif  // LIANG_UTILS_SOCKET_H